@@ -0,0 +1,113 @@
+// AcsController.h
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// The calls the gantry driver makes to an ACS SPiiPlus controller, so that it can
+// run against the SPiiPlus C library or against SimulatedAcsController.
+// Axis lists end with -1, as in the library. Calls return false on failure, with
+// the reason in LastError().
+class AcsController {
+public:
+    // Called on the backend's thread when motion of some of the handled axes ends,
+    // normally or with a motion failure
+    using MotionEndHandler = std::function<void(std::uint64_t axisMask, bool succeeded)>;
+
+    // acsc_GetMotorState / MST bit of an axis that is moving
+    static constexpr int MotorMoving = 0x20;
+
+    virtual ~AcsController() = default;
+
+    virtual bool Open(const std::string& address, int port) = 0;
+    virtual void Close() = 0;
+    virtual bool IsOpen() const = 0;
+
+    virtual bool Enable(const int* axes) = 0;
+
+    // acsc_ToPointM at the default velocity
+    virtual bool ToPoint(const int* axes, const double* point) = 0;
+
+    // acsc_ExtToPointM with a velocity and, if positive, an end velocity that runs
+    // into the next queued motion
+    virtual bool ExtToPoint(const int* axes, const double* point, double velocity, double endVelocity) = 0;
+
+    virtual bool Halt(const int* axes) = 0;
+
+    // PV spline (acsc_SplineM, cubic, waiting for Go): each AddPVPoint gives a
+    // position and velocity per axis, the points periodMs apart. ReadInteger("GSFREE")
+    // tells how many more the controller's buffer takes; EndSequence says there
+    // are no more to come.
+    virtual bool Spline(const int* axes, double periodMs) = 0;
+    virtual bool AddPVPoint(const int* axes, const double* point, const double* velocity) = 0;
+    virtual bool EndSequence(const int* axes) = 0;
+    virtual bool Go(const int* axes) = 0;
+
+    virtual bool GetFPosition(int axis, double& position) = 0;
+    virtual bool GetMotorState(int axis, int& state) = 0;
+
+    // Elements from..to of a per-axis controller array such as FPOS or MST; -1 for
+    // both reads a scalar such as S_DCN
+    virtual bool ReadReal(const char* variable, int from, int to, double* values) = 0;
+    virtual bool ReadInteger(const char* variable, int from, int to, int* values) = 0;
+
+    // Rows fromRow..toRow, columns fromColumn..toColumn of a real matrix, row by row
+    virtual bool ReadRealMatrix(const char* variable, int fromRow, int toRow, int fromColumn, int toColumn, double* values) = 0;
+
+    // Data collection (acsc_DataCollectionExt): every periodMs the variables, e.g.
+    // "FPOS(0) PE(0) AIN(0)", go into the next column of 'array', a global real matrix
+    // with a row per variable, until 'samples' columns are filled or it is stopped.
+    // S_DCN counts the samples collected.
+    virtual bool StartCollection(const char* array, int samples, double periodMs, const char* variables) = 0;
+    virtual bool StopCollection() = 0;
+
+    virtual bool WaitMotionEnd(int axis, int timeoutMs) = 0;
+
+    // One handler at a time; an empty one removes it
+    virtual bool SetMotionEndHandler(std::uint64_t axisMask, MotionEndHandler handler) = 0;
+
+    virtual std::string LastError() = 0;
+};
+
+// Backend on the SPiiPlus C library. Without UAA4_WITH_ACSC (see CMakeLists.txt)
+// every call fails.
+class AcsLibraryController : public AcsController {
+public:
+    AcsLibraryController() = default;
+    ~AcsLibraryController() override;
+
+    AcsLibraryController(const AcsLibraryController&) = delete;
+    AcsLibraryController& operator=(const AcsLibraryController&) = delete;
+
+    bool Open(const std::string& address, int port) override;
+    void Close() override;
+    bool IsOpen() const override { return m_handle != nullptr; }
+
+    bool Enable(const int* axes) override;
+    bool ToPoint(const int* axes, const double* point) override;
+    bool ExtToPoint(const int* axes, const double* point, double velocity, double endVelocity) override;
+    bool Halt(const int* axes) override;
+    bool Spline(const int* axes, double periodMs) override;
+    bool AddPVPoint(const int* axes, const double* point, const double* velocity) override;
+    bool EndSequence(const int* axes) override;
+    bool Go(const int* axes) override;
+    bool GetFPosition(int axis, double& position) override;
+    bool GetMotorState(int axis, int& state) override;
+    bool ReadReal(const char* variable, int from, int to, double* values) override;
+    bool ReadInteger(const char* variable, int from, int to, int* values) override;
+    bool ReadRealMatrix(const char* variable, int fromRow, int toRow, int fromColumn, int toColumn, double* values) override;
+    bool StartCollection(const char* array, int samples, double periodMs, const char* variables) override;
+    bool StopCollection() override;
+    bool WaitMotionEnd(int axis, int timeoutMs) override;
+    bool SetMotionEndHandler(std::uint64_t axisMask, MotionEndHandler handler) override;
+    std::string LastError() override;
+
+    // For the library callbacks
+    void OnMotionEnd(std::uint64_t axisMask, bool succeeded);
+
+private:
+    void* m_handle = nullptr;
+    MotionEndHandler m_handler;
+};
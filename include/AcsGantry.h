@@ -0,0 +1,118 @@
+// AcsGantry.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "MotionProfile.h"
+#include "AcsController.h"
+#include "GraphExecutor.h"
+#include "AsyncMotion.h"
+#include "DataCollector.h"
+#include "MotionEndNotifier.h"
+#include "DevicePoller.h"
+#include "PvtFeeder.h"
+#include "TrajectoryPath.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Gantry on an ACS SPiiPlus controller, driven through an AcsController: the
+// SPiiPlus C library by default, or e.g. a SimulatedAcsController.
+// Only the linear installed axes (X, Y, Z as controller axes 0, 1, 2) are moved.
+// The end of a move comes from the controller's motion-end interrupt rather than
+// from polling.
+// Use either the blocking calls or the MotionDriver ones for a gantry, not both at once.
+class AcsGantry : public MotionDriver, public StatusSource {
+public:
+    AcsGantry(const MotionDevice& device, const MotionLimits& limits);
+
+    // The controller must outlive the gantry
+    AcsGantry(const MotionDevice& device, const MotionLimits& limits, AcsController& controller);
+    ~AcsGantry();
+
+    AcsGantry(const AcsGantry&) = delete;
+    AcsGantry& operator=(const AcsGantry&) = delete;
+
+    // Fails without an X, Y or Z in the device's InstalledAxes
+    bool Connect();
+    void Disconnect();
+    bool IsConnected() const { return m_controller.IsOpen(); }
+
+    // Point-to-point move that stops at the target
+    bool MoveTo(const PositionStruct& target);
+
+    // Move through every waypoint of a route and wait until the last one is reached.
+    // Blended, intermediate waypoints are passed at the speed BlendedPath allows for
+    // their corner tolerance and only the final one is a full stop; otherwise the
+    // gantry stops at each of them.
+    bool MoveAlong(const std::vector<MotionWaypoint>& route, bool blended = true);
+
+    // Go to the start of the path, then stream it as a PV spline with points at most
+    // 'period' seconds apart, and wait until it ends. The feeder's figures go to stats.
+    bool StreamPath(const TrajectoryPath& path, double period, PvtFeederStats* stats = nullptr);
+
+    // Feedback position of the linear axes
+    std::optional<PositionStruct> GetPosition() override;
+
+    // StatusSource: FPOS and MST of every axis, one array read each
+    bool ReadStatus(DeviceStatus& status) override;
+
+    // MotionDriver: queue a blended MoveAlong and report its end from the controller's
+    // interrupt thread. There is no timeout here; the scheduler has one.
+    bool StartMove(const std::vector<MotionWaypoint>& route, Completion done) override;
+    void Halt() override;
+    LatencyHistogram* CompletionLatency() override { return &m_motionEnd.Latency(); }
+
+    // Collect data on the controller around every move from now on, or stop with
+    // nullptr. The collector must stay open while it is set.
+    void SetDataCollector(DataCollector* collector) { m_collector = collector; }
+
+    // ID of the latest move, the key of its record in the collection file
+    std::uint64_t LastMoveId() const { return m_moveId; }
+
+    // From the motion-end interrupt to the blocking call waking, or to the
+    // scheduler picking up a StartMove completion
+    const LatencyHistogram& MotionEndLatency() const { return m_motionEnd.Latency(); }
+
+    // MoveAlong, for use as a GraphExecutor::MoveHandler
+    GraphExecutor::MoveHandler Handler() {
+        return [this](const MotionTask& task) { return MoveAlong(task.Route); };
+    }
+
+    // Set from the caller's, the scheduler's and the interrupt thread
+    std::string LastError() const;
+
+private:
+    // Queue every segment of the route; returns the estimated duration
+    std::optional<double> QueueRoute(const std::vector<MotionWaypoint>& route, bool blended);
+    bool WaitForMotionEnd(double estimatedSeconds);
+    void MotionEnded(bool succeeded, MotionEndNotifier::Clock::time_point signalled, Completion done);
+    void BeginCollection();
+    void EndCollection();
+
+    // The axis whose motion end stands for the whole move
+    int LeadAxis() const { return m_axes[0]; }
+
+    std::optional<bool> IsMoving();
+    bool ReadAxes(PositionStruct* position, std::uint32_t* movingAxes);  // FPOS and/or MST
+    bool Fail(const std::string& operation);
+    void SetError(const std::string& error);
+
+    MotionDevice m_device;
+    MotionLimits m_limits;
+    std::vector<int> m_axes;   // Controller axes, terminated by -1 as the library expects
+    std::unique_ptr<AcsController> m_ownedController;
+    AcsController& m_controller;
+    mutable std::mutex m_errorMutex;
+    std::string m_lastError;
+
+    std::atomic<DataCollector*> m_collector{ nullptr };
+    std::atomic<std::uint64_t> m_moveId{ 0 };
+
+    AcsMotionEndNotifier m_motionEnd;
+    std::mutex m_haltMutex;
+    bool m_halted = false;
+};
@@ -0,0 +1,277 @@
+// AsyncMotion.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "GraphExecutor.h"
+#include "DevicePoller.h"
+#include "LatencyHistogram.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+
+class MotionConfigManager;
+
+// When a move's future completes. The device takes its next move only once the
+// motion has ended, whatever the policy.
+enum class CompletionPolicy {
+    MotionEnd,          // The driver reports the motion has ended
+    InWindow,           // Every coordinate is within the tolerance of the target, or the motion has ended
+    InWindowSettled     // Within the tolerance without leaving it for Settle; may be after the motion end
+};
+
+struct MoveCompletion {
+    CompletionPolicy Policy = CompletionPolicy::MotionEnd;
+    double Tolerance = -1.0;                           // Settings::PositionTolerance if negative
+    std::chrono::milliseconds Settle{ 0 };
+    std::chrono::milliseconds SettleTimeout{ 1000 };   // After the motion end, before failing unsettled
+};
+
+// One started move, in seconds since the scheduler was created
+struct MoveTiming {
+    std::uint64_t Id = 0;
+    std::string Device;
+    std::string Position;
+    CompletionPolicy Policy = CompletionPolicy::MotionEnd;
+    double Started = 0.0;
+    double Released = -1.0;   // Future completed; -1 while pending
+    double Ended = -1.0;      // Driver reported the end; -1 while moving
+    bool Succeeded = false;
+
+    // Time the next step gained by not waiting for the motion end; negative when
+    // settling took longer
+    double Overlap() const { return Released >= 0.0 && Ended >= 0.0 ? Ended - Released : 0.0; }
+};
+
+enum class MotionStatus {
+    Pending,
+    Succeeded,
+    Failed,
+    Cancelled,
+    TimedOut
+};
+
+// Result of an asynchronous move, or of several combined with WhenAll/WhenAny.
+// Copies share one state. Waiting blocks only the caller; Then runs a continuation
+// on the thread that completes the future instead.
+class MotionFuture {
+public:
+    static constexpr std::size_t NoIndex = static_cast<std::size_t>(-1);
+
+    MotionFuture() = default;
+
+    // A future that is already complete, e.g. for a move rejected up front
+    static MotionFuture Ready(MotionStatus status, const std::string& error = std::string());
+
+    bool Valid() const { return m_state != nullptr; }
+    bool IsReady() const { return Status() != MotionStatus::Pending; }
+    MotionStatus Status() const;
+    std::string Error() const;
+
+    // For WhenAny, the index of the future that completed it
+    std::size_t ReadyIndex() const;
+
+    MotionStatus Wait() const;
+    bool WaitFor(std::chrono::milliseconds timeout) const;  // True if ready
+
+    // Halt the move if it is queued or running; does nothing once ready.
+    // Cancelling a combined future cancels every future in it.
+    void Cancel() const;
+
+    // Run once the future is ready, immediately if it already is. Keep continuations
+    // short: they run on the scheduler thread for moves.
+    void Then(std::function<void(const MotionFuture&)> continuation) const;
+
+    // Succeeds once all succeed; completes with the first failure seen otherwise,
+    // after the rest have finished
+    static MotionFuture WhenAll(const std::vector<MotionFuture>& futures);
+
+    // Completes like the first future to become ready
+    static MotionFuture WhenAny(const std::vector<MotionFuture>& futures);
+
+private:
+    friend class AsyncMotionScheduler;
+
+    struct State;
+    explicit MotionFuture(std::shared_ptr<State> state) : m_state(std::move(state)) {}
+
+    // False if the future was already complete
+    static bool Complete(const std::shared_ptr<State>& state, MotionStatus status, const std::string& error,
+        std::size_t index = NoIndex);
+
+    std::shared_ptr<State> m_state;
+};
+
+// A controller that starts moves without blocking and reports when they end
+class MotionDriver {
+public:
+    // 'ended' is when the driver noticed the motion end, default-constructed if no
+    // motion was involved
+    using Completion = std::function<void(bool succeeded, const std::string& error,
+        std::chrono::steady_clock::time_point ended)>;
+
+    virtual ~MotionDriver() = default;
+
+    // Start moving through the route and return at once; false if the move couldn't
+    // start. Otherwise 'done' is called exactly once, from any thread, when the motion
+    // has ended, including after Halt.
+    virtual bool StartMove(const std::vector<MotionWaypoint>& route, Completion done) = 0;
+
+    // Where the scheduler records the time from 'ended' to acting on the completion;
+    // nullptr if the driver keeps no such histogram
+    virtual LatencyHistogram* CompletionLatency() { return nullptr; }
+
+    // Stop the current move
+    virtual void Halt() = 0;
+
+    virtual std::optional<PositionStruct> GetPosition() = 0;
+};
+
+// Moves a device was spared because it already stood at the target
+struct MoveSavings {
+    std::uint64_t Moves = 0;
+    double Seconds = 0.0;          // Estimated time of the routes not driven
+    std::uint64_t StalePoses = 0;  // Checks that found the feed too old or the device moving
+};
+
+// Drives many devices from one thread. Moves to one device run in the order they
+// were requested; moves to different devices run concurrently. A move follows the
+// fastest route of the graph (see MotionPlan) and times out after the sum of
+// EdgeConditions::TimeoutSeconds along it, unless an edge on the way has none.
+// After a move fails, times out or is cancelled, the device's node is looked up
+// from its measured position (FindNearestPosition).
+// A move can complete before the motion has ended (MoveCompletion), judged from the
+// device's position feed, so whatever waits on it overlaps the last of the motion.
+// The feed's latest status also serves as the device's pose: a move whose target is
+// within Settings::PositionTolerance of a fresh, still pose completes without
+// moving, and a lost node is looked up from it rather than from the driver.
+class AsyncMotionScheduler {
+public:
+    AsyncMotionScheduler(const MotionConfigManager& config, const std::string& graphName);
+    ~AsyncMotionScheduler();
+
+    AsyncMotionScheduler(const AsyncMotionScheduler&) = delete;
+    AsyncMotionScheduler& operator=(const AsyncMotionScheduler&) = delete;
+
+    // The driver must outlive the scheduler. Without startNodeId the device's node is
+    // found from its position. Throws std::runtime_error if the device is already added.
+    void AddDevice(const std::string& deviceName, MotionDriver& driver, const std::string& startNodeId = std::string());
+
+    // Judge the device's in-window policies from the poller, which must outlive the
+    // scheduler. Without one they wait for the motion end. Throws std::runtime_error
+    // if the device isn't added.
+    void SetPositionFeed(const std::string& deviceName, const DevicePoller& poller);
+
+    // Move the device to a taught position that has a node in the graph
+    MotionFuture MoveTo(const std::string& deviceName, const std::string& positionName,
+        const MoveCompletion& completion = MoveCompletion());
+
+    // Node the device was last known to stand on, or empty
+    std::string CurrentNode(const std::string& deviceName) const;
+
+    // Every move started so far
+    std::vector<MoveTiming> Timings() const;
+
+    // Per device, since the last ResetSavings, e.g. once a shift
+    std::map<std::string, MoveSavings> Savings() const;
+    void ResetSavings();
+
+    // A line per move with its overlap, and the total, for logs
+    std::string FormatTimings() const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Move {
+        std::uint64_t Id;
+        std::string Device;
+        std::string Position;
+        std::string TargetNode;
+        MoveCompletion Completion;
+        PositionStruct Target;
+        double PositionTolerance = 0.0;
+        std::shared_ptr<MotionFuture::State> Future;
+
+        // Scheduler thread only, once started
+        std::size_t Timing = 0;                   // Index in m_timings
+        std::uint64_t StartCycle = 0;             // Feed cycle before the start
+        std::optional<Clock::time_point> InWindowSince;
+        std::optional<Clock::time_point> EndedAt; // Ended but not yet settled
+    };
+
+    struct DeviceEntry {
+        MotionDriver* Driver = nullptr;
+        std::atomic<const DevicePoller*> Feed{ nullptr };   // May be set while moves run
+        std::string NodeId;
+        std::deque<std::shared_ptr<Move>> Queue;
+        std::shared_ptr<Move> Active;
+        Clock::time_point MovedAt;   // Last start or end of a move; older poses are stale
+    };
+
+    struct Timer {
+        Clock::time_point Deadline;
+        std::uint64_t MoveId;
+        std::string Device;
+        bool operator>(const Timer& other) const { return Deadline > other.Deadline; }
+    };
+
+    // Events for the scheduler thread. Shared with driver callbacks and cancel hooks,
+    // which may outlive the scheduler; nothing is queued once it stops.
+    struct Mailbox {
+        std::mutex Mutex;
+        std::condition_variable Wake;
+        std::deque<std::function<void()>> Events;
+        bool Stopping = false;
+    };
+
+    static void Post(const std::shared_ptr<Mailbox>& mailbox, std::function<void()> event);
+    void Loop();
+
+    DeviceEntry* FindDevice(const std::string& deviceName);
+    void SetNode(DeviceEntry& device, const std::string& nodeId);
+
+    // Scheduler thread only
+    void StartNext(DeviceEntry& device);
+    void Finished(const std::string& deviceName, std::uint64_t moveId, bool succeeded, const std::string& error,
+        Clock::time_point ended);
+    void Abort(const std::string& deviceName, std::uint64_t moveId, MotionStatus status, const std::string& error);
+    bool Release(Move& move, MotionStatus status, const std::string& error);
+    void Ended(Move& move, bool succeeded);
+    std::optional<Clock::time_point> CheckWindows();
+    // From the pose if there is one, otherwise from the driver
+    std::string LocateNode(const std::string& deviceName, MotionDriver& driver,
+        const std::optional<PositionStruct>& pose = std::nullopt) const;
+    std::optional<PositionStruct> CachedPose(const DeviceEntry& device) const;
+    bool AlreadyThere(DeviceEntry& device, const Move& move, double estimatedSeconds);
+
+    const MotionConfigManager& m_config;
+    std::string m_graphName;
+
+    std::shared_ptr<Mailbox> m_mailbox = std::make_shared<Mailbox>();
+
+    mutable std::mutex m_mutex;
+    std::uint64_t m_nextMoveId = 1;
+
+    // Entries are added under m_mutex and never removed. Only the scheduler thread
+    // touches them afterwards, taking m_mutex to change NodeId.
+    std::map<std::string, DeviceEntry> m_devices;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> m_timers;
+    std::vector<DeviceEntry*> m_watching;   // Active moves with an in-window policy
+
+    const Clock::time_point m_epoch = Clock::now();
+    std::vector<MoveTiming> m_timings;      // Under m_mutex
+    std::map<std::string, MoveSavings> m_savings;   // Likewise
+
+    std::thread m_thread;
+};
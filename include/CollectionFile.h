@@ -0,0 +1,74 @@
+// CollectionFile.h
+#pragma once
+
+#include "MappedFile.h"
+#include "Span.h"
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// File of samples collected on the controller, one record per move. A record holds
+// its header, the column names, and then each column's samples back to back, so a
+// column of a move is one contiguous array of doubles in the mapping.
+// Records are only appended. The file header's End moves past a record once it is
+// complete, so a crash loses at most the move being written.
+namespace CollectionFormat {
+constexpr std::uint32_t Version = 1;
+constexpr std::size_t NameSize = 32;   // Per column, NUL-padded
+}
+
+// Writes records straight into a writable mapping of the file
+class CollectionWriter {
+public:
+    // Create the file, or open it to append
+    bool Open(const std::string& filePath);
+    void Close();
+    bool IsOpen() const { return m_file.IsOpen(); }
+
+    // Set aside room for 'capacity' samples of each column. Names are cut to
+    // NameSize - 1 characters.
+    bool BeginRecord(std::uint64_t moveId, const std::vector<std::string>& columns, std::size_t capacity, double periodMs);
+
+    // Samples first.. of a column of the record being written
+    void Write(std::size_t column, std::size_t first, const double* values, std::size_t count);
+
+    // Complete the record with the samples actually collected, and flush it
+    bool EndRecord(std::size_t samples);
+
+private:
+    WritableMappedFile m_file;
+    std::size_t m_record = 0;      // Offset of the record being written, 0 if none
+    std::size_t m_columns = 0;
+    std::size_t m_capacity = 0;
+};
+
+// Reads records by move ID from a read-only mapping
+class CollectionReader {
+public:
+    struct Record {
+        std::uint64_t MoveId = 0;
+        double PeriodMs = 0.0;
+        std::size_t Samples = 0;
+        std::vector<std::string> Columns;
+        std::vector<Span<const double>> Data;   // Per column, Samples long
+    };
+
+    bool Open(const std::string& filePath);
+
+    // In the order they were written
+    std::vector<std::uint64_t> MoveIds() const;
+
+    // The last record of the move, if any; its spans point into the mapping
+    std::optional<Record> Find(std::uint64_t moveId) const;
+
+    // One column of a record, empty if there is no such column
+    static Span<const double> Column(const Record& record, const std::string& name);
+
+private:
+    MappedFile m_file;
+    std::vector<std::uint64_t> m_moveIds;
+    std::unordered_map<std::uint64_t, std::size_t> m_offsets;
+};
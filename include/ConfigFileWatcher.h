@@ -0,0 +1,68 @@
+// ConfigFileWatcher.h
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Calls back when watched files change on disk, from a background thread.
+// On Linux changes arrive through inotify on the containing directories, which
+// also catches files replaced by rename (as DurableFile::WriteAtomically and most
+// editors do). Elsewhere the files' modification times are polled.
+// Bursts of events are coalesced: a callback runs once no further change has been
+// seen for the settle delay, and the delay from the first event to the callback
+// finishing is logged.
+class ConfigFileWatcher {
+public:
+    using Callback = std::function<void(const std::string& filePath)>;
+
+    explicit ConfigFileWatcher(std::chrono::milliseconds settleDelay = std::chrono::milliseconds(50));
+    ~ConfigFileWatcher();
+
+    ConfigFileWatcher(const ConfigFileWatcher&) = delete;
+    ConfigFileWatcher& operator=(const ConfigFileWatcher&) = delete;
+
+    // Register before Start
+    void Watch(const std::string& filePath, Callback callback);
+
+    bool Start();
+    void Stop();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string Path;
+        std::string Directory;
+        std::string FileName;
+        Callback OnChange;
+        bool Pending = false;
+        Clock::time_point FirstEvent;
+        Clock::time_point LastEvent;
+        std::int64_t LastWriteTime = 0;  // Polling fallback only
+    };
+
+    void Run();
+    void MarkChanged(Entry& entry, Clock::time_point now);
+    // Fires settled entries and returns how long until the next one settles (or -1 for none)
+    int DispatchSettled(Clock::time_point now);
+
+    std::chrono::milliseconds m_settleDelay;
+    std::vector<Entry> m_entries;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_stopSignal;
+    bool m_stopping = false;
+
+#ifdef __linux__
+    int m_inotify = -1;
+    int m_wake = -1;                            // eventfd that interrupts the wait on Stop
+    std::map<int, std::string> m_directories;   // Watch descriptor -> directory
+#endif
+};
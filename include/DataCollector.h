@@ -0,0 +1,105 @@
+// DataCollector.h
+#pragma once
+
+#include "AcsController.h"
+#include "CollectionFile.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct DataCollectorSettings {
+    // Global real matrix on the controller with a row per variable and at least
+    // Samples columns, e.g. "GLOBAL REAL DCA(2)(20000)" in a D-buffer
+    std::string Array = "DCA";
+    std::string Variables = "FPOS(0) PE(0)";   // One column of the file each
+    double PeriodMs = 1.0;
+    int Samples = 20000;              // Most per move; collection stops there
+    double TrailingMs = 200.0;        // Kept after the move ends, for the settling
+    std::chrono::milliseconds PullPeriod{ 50 };
+    int ChunkSamples = 2000;          // Most columns read in one call
+};
+
+struct DataCollectorStats {
+    std::size_t Moves = 0;            // Records written
+    std::size_t Samples = 0;          // In those records
+    std::size_t Chunks = 0;           // Matrix reads
+    std::size_t Failures = 0;         // Controller calls or file writes that failed
+    std::size_t Truncated = 0;        // Records cut short of their trailing samples
+    double MeanPullMicroseconds = 0.0;
+    double MaxPullMicroseconds = 0.0;
+};
+
+// Controller-side data collection around each move, written to a CollectionFile
+// keyed by move ID. Begin arms the collection just before a move starts; End marks
+// it ended and returns at once. A worker thread makes every other controller call:
+// it pulls the samples in chunks while the move runs, and after TrailingMs more
+// stops the collection and completes the record. Only one move is collected at a
+// time; a Begin cuts the previous move's trailing samples short, so the settling of
+// a move followed at once by another is at the start of the next move's record.
+class DataCollector {
+public:
+    DataCollector(AcsController& controller, DataCollectorSettings settings = DataCollectorSettings());
+    ~DataCollector();
+
+    DataCollector(const DataCollector&) = delete;
+    DataCollector& operator=(const DataCollector&) = delete;
+
+    // Create or append to the file and start the worker
+    bool Open(const std::string& filePath);
+
+    // Complete the current record and close the file
+    void Close();
+    bool IsOpen() const;
+
+    // Start collecting for a move, and wait until the controller is collecting
+    bool Begin(std::uint64_t moveId);
+
+    // The move has ended; safe from a motion-end handler
+    void End();
+
+    // Until the record of the move ended last is complete
+    void Flush();
+
+    DataCollectorStats Stats() const;
+    std::string LastError() const;
+
+private:
+    struct Active {
+        std::uint64_t MoveId = 0;
+        int Pulled = 0;                            // Samples in the file so far
+        std::optional<int> Target;                 // Samples to end at, once ended
+        std::chrono::steady_clock::time_point Deadline;
+    };
+
+    void Run();
+    bool StartRecord(std::uint64_t moveId);
+    bool Pull(int collected);
+    void FinishRecord();
+    void Fail(const std::string& operation, bool controller = true);
+
+    AcsController& m_controller;
+    DataCollectorSettings m_settings;
+    std::vector<std::string> m_columns;
+    std::vector<double> m_chunk;
+    CollectionWriter m_writer;
+    std::optional<Active> m_active;   // Worker only
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    bool m_open = false;
+    bool m_stopping = false;
+    std::optional<std::uint64_t> m_pending;   // Begin waiting for the worker
+    bool m_started = false;                   // The pending Begin's outcome
+    bool m_ended = false;
+    bool m_idle = true;
+    DataCollectorStats m_stats;
+    std::string m_lastError;
+    std::thread m_thread;
+};
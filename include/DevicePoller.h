@@ -0,0 +1,80 @@
+// DevicePoller.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "Seqlock.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Everything a poll cycle reads from a controller
+struct DeviceStatus {
+    PositionStruct Position;
+    std::uint32_t MovingAxes = 0;   // Bit per controller axis still moving / not on target
+    std::uint64_t Cycle = 0;        // Poll cycle that read it; 0 before the first read
+    std::chrono::steady_clock::time_point Time;   // When the read completed
+};
+
+// A controller that can read all of its axes' position and status in one batch
+class StatusSource {
+public:
+    virtual ~StatusSource() = default;
+
+    // Fill Position and MovingAxes; false if the controller couldn't be read
+    virtual bool ReadStatus(DeviceStatus& status) = 0;
+};
+
+struct PollStats {
+    double TargetHz = 0.0;
+    double AchievedHz = 0.0;
+    double JitterUs = 0.0;       // Standard deviation of the cycle period
+    double MaxLateUs = 0.0;      // Worst start after the scheduled time
+    double MeanReadUs = 0.0;     // Time spent in ReadStatus
+    std::uint64_t Cycles = 0;
+    std::uint64_t Failures = 0;
+    std::uint64_t Overruns = 0;  // Cycles skipped because a read ran past the next one
+};
+
+// One thread per controller reads every axis per cycle and publishes the result
+// through a seqlock, so any number of readers get the latest status without
+// locks or I/O of their own. Failed reads keep the last good status published.
+class DevicePoller {
+public:
+    DevicePoller(const std::string& deviceName, StatusSource& source, double rateHz);
+    ~DevicePoller();
+
+    DevicePoller(const DevicePoller&) = delete;
+    DevicePoller& operator=(const DevicePoller&) = delete;
+
+    void Start();
+    void Stop();
+
+    // Takes effect from the next cycle and restarts the statistics
+    void SetRate(double rateHz);
+
+    const std::string& DeviceName() const { return m_deviceName; }
+
+    DeviceStatus Latest() const { return m_status.Load(); }
+
+    // Since Start or the last SetRate
+    PollStats Stats() const { return m_stats.Load(); }
+
+private:
+    void Loop();
+
+    std::string m_deviceName;
+    StatusSource& m_source;
+
+    Seqlock<DeviceStatus> m_status;
+    Seqlock<PollStats> m_stats;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    double m_rateHz;
+    bool m_rateChanged = false;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
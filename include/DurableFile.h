@@ -0,0 +1,50 @@
+// DurableFile.h
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Append-only file with explicit flushes to stable storage.
+// Move-only; the file is closed on destruction.
+class DurableFile {
+public:
+    DurableFile() = default;
+    ~DurableFile();
+
+    DurableFile(DurableFile&& other) noexcept;
+    DurableFile& operator=(DurableFile&& other) noexcept;
+    DurableFile(const DurableFile&) = delete;
+    DurableFile& operator=(const DurableFile&) = delete;
+
+    // Open for appending, creating the file if needed. truncate discards existing contents.
+    bool Open(const std::string& filePath, bool truncate);
+    void Close();
+    bool IsOpen() const;
+
+    // Append at the end of the file. Data is durable only after Sync().
+    bool Append(const void* data, std::size_t size);
+
+    // Cut the file back to size bytes (used to drop a torn tail)
+    bool Truncate(std::uint64_t size);
+
+    // Flush written data to stable storage
+    bool Sync();
+
+    std::uint64_t Size() const { return m_size; }
+
+    // Write a whole file so that a crash leaves either the old or the new contents:
+    // temp file, flush, rename over the target, flush the directory entry.
+    static bool WriteAtomically(const std::string& filePath, const void* data, std::size_t size);
+
+    // Atomically replace 'to' with 'from' and make the rename durable
+    static bool Replace(const std::string& from, const std::string& to);
+
+private:
+#ifdef _WIN32
+    void* m_handle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+    std::uint64_t m_size = 0;
+};
@@ -0,0 +1,163 @@
+// GraphExecutor.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "MotionConfigVersion.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A graph node a move passes through or ends on, resolved to its taught position
+struct MotionWaypoint {
+    std::string NodeId;
+    std::string Position;
+    PositionStruct Target;
+    double CornerTolerance = 0.0;  // Of the edge arriving here, see EdgeConditions
+    int TimeoutSeconds = 0;        // Likewise
+};
+
+// Moves of one device from where its previous task left it to a target node
+struct MotionTask {
+    std::string Device;
+    std::vector<MotionWaypoint> Route;        // Fastest route through the graph; empty if already there
+    std::vector<std::size_t> Prerequisites;   // Earlier tasks that must finish first, the device's own previous one included
+    double EstimatedSeconds = 0.0;            // See TravelTimeTable::EstimateMoveTime
+};
+
+// Turns a sequence of target nodes into a DAG of per-device tasks.
+// Tasks of one device run in the order they were planned. Tasks of different
+// devices only wait for each other through AddDependency, e.g. the hexapods
+// reaching a clearance position before the gantry moves in; anything not
+// ordered that way may run concurrently. Positions are resolved against the
+// version the plan was made from.
+class MotionPlan {
+public:
+    MotionPlan(MotionConfigVersionPtr version, const std::string& graphName);
+
+    // Node the device of nodeId is standing on before the plan runs.
+    // Throws std::runtime_error if the node isn't in the graph.
+    void SetStart(const std::string& nodeId);
+
+    // Plan the device of nodeId to travel there and return the task index. Throws
+    // std::runtime_error if the node isn't in the graph, its device has no start,
+    // or no route resolves to taught positions.
+    std::size_t MoveTo(const std::string& nodeId);
+
+    // 'task' doesn't start before 'prerequisite' has finished. Dependencies only point
+    // backwards, so a plan can't contain a cycle and its task order is a valid
+    // serial order. Throws std::runtime_error otherwise.
+    void AddDependency(std::size_t task, std::size_t prerequisite);
+
+    const std::vector<MotionTask>& Tasks() const { return m_tasks; }
+    const std::string& GraphName() const { return m_graphName; }
+
+    // Sum of all task estimates, i.e. one device moving at a time
+    double EstimateSerialSeconds() const;
+
+    // Longest chain of dependent tasks, i.e. the cycle time with unlimited concurrency
+    double EstimateCriticalPathSeconds() const;
+
+private:
+    struct DeviceState {
+        std::string NodeId;
+        std::size_t LastTask;
+    };
+
+    MotionConfigVersionPtr m_version;
+    std::string m_graphName;
+    std::vector<MotionTask> m_tasks;
+    std::map<std::string, DeviceState> m_devices;
+};
+
+// Timing of one task, in seconds since the run started
+struct TaskTiming {
+    double Start = 0.0;
+    double End = 0.0;
+    bool Ran = false;
+    bool Succeeded = false;
+};
+
+struct ExecutionResult {
+    static constexpr std::size_t NoTask = static_cast<std::size_t>(-1);
+
+    bool Success = false;
+    std::size_t FailedTask = NoTask;
+    double Seconds = 0.0;
+    std::vector<TaskTiming> Tasks;  // Parallel to MotionPlan::Tasks
+};
+
+// Runs plans on one worker thread per device, so independent devices move at the
+// same time. A task is handed to its device's worker once all its prerequisites
+// have finished. If a move fails, moves already running finish but nothing new
+// starts. Runs are serialized; workers are kept between them.
+class GraphExecutor {
+public:
+    // Performs one task on the hardware and returns false if it failed.
+    // Called on the device's worker thread.
+    using MoveHandler = std::function<bool(const MotionTask& task)>;
+
+    explicit GraphExecutor(MoveHandler handler);
+    ~GraphExecutor();
+
+    GraphExecutor(const GraphExecutor&) = delete;
+    GraphExecutor& operator=(const GraphExecutor&) = delete;
+
+    // Blocks until the plan has finished or failed
+    ExecutionResult Run(const MotionPlan& plan);
+
+    // One task at a time in plan order, on the calling thread
+    ExecutionResult RunSerial(const MotionPlan& plan);
+
+private:
+    struct Worker {
+        std::thread Thread;
+        std::deque<std::size_t> Queue;
+        std::condition_variable Ready;
+    };
+
+    Worker& WorkerFor(const std::string& deviceName);
+    void WorkerLoop(Worker& worker);
+    void Dispatch(std::size_t task);
+
+    MoveHandler m_handler;
+    std::mutex m_runMutex;
+
+    // Guards everything below
+    std::mutex m_mutex;
+    std::condition_variable m_progress;
+    std::map<std::string, std::unique_ptr<Worker>> m_workers;
+    bool m_stopping = false;
+
+    // State of the current run
+    const MotionPlan* m_plan = nullptr;
+    std::chrono::steady_clock::time_point m_start;
+    std::vector<std::size_t> m_waitingOn;                 // Unfinished prerequisites per task
+    std::vector<std::vector<std::size_t>> m_dependents;
+    ExecutionResult m_result;
+    std::size_t m_finished = 0;
+    std::size_t m_running = 0;
+};
+
+// Stand-in for the hardware: each task sleeps for its estimated duration, scaled
+// by timeScale, so plans can be timed without a rig
+class SimulatedRig {
+public:
+    explicit SimulatedRig(double timeScale = 1.0) : m_timeScale(timeScale) {}
+
+    bool Move(const MotionTask& task) const;
+
+    GraphExecutor::MoveHandler Handler() const {
+        return [this](const MotionTask& task) { return Move(task); };
+    }
+
+private:
+    double m_timeScale;
+};
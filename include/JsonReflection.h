@@ -0,0 +1,435 @@
+// JsonReflection.h
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Compile-time field tables for plain structs, and JSON readers and writers
+// generated from them.
+//
+// A struct opts in by specializing Reflect<T> with a constexpr tuple of
+// JsonField descriptors, one per member, each pairing the JSON key with the
+// member pointer. The key table is checked at compile time (see
+// Reflection::CheckFields): keys must be unique, non-empty, need no escaping,
+// and every member of the aggregate must be listed.
+// A member added to an existing file format can be declared with OptionalField:
+// it is left out of the JSON while it holds its default value, so files that
+// don't use it keep their layout. Missing keys always leave the default in place.
+template <typename T>
+struct Reflect;
+
+template <typename Struct, typename Member>
+struct JsonField {
+    std::string_view Key;
+    Member Struct::* Pointer;
+    bool OmitIfDefault = false;
+};
+
+template <typename Struct, typename Member>
+constexpr JsonField<Struct, Member> Field(std::string_view key, Member Struct::* pointer) {
+    return { key, pointer };
+}
+
+template <typename Struct, typename Member>
+constexpr JsonField<Struct, Member> OptionalField(std::string_view key, Member Struct::* pointer) {
+    return { key, pointer, true };
+}
+
+namespace Reflection {
+
+template <typename T, typename = void>
+struct IsReflected : std::false_type {};
+
+template <typename T>
+struct IsReflected<T, std::void_t<decltype(Reflect<T>::Fields)>> : std::true_type {};
+
+template <typename T>
+constexpr std::size_t FieldCount() {
+    return std::tuple_size_v<std::decay_t<decltype(Reflect<T>::Fields)>>;
+}
+
+template <typename T, std::size_t... I>
+constexpr auto KeysOf(std::index_sequence<I...>) {
+    return std::array<std::string_view, sizeof...(I)>{ std::get<I>(Reflect<T>::Fields).Key... };
+}
+
+template <typename T>
+constexpr auto Keys() {
+    return KeysOf<T>(std::make_index_sequence<FieldCount<T>()>{});
+}
+
+// Index of the field with the given key, or FieldCount<T>() if there is none
+template <typename T>
+constexpr std::size_t FieldIndex(std::string_view key) {
+    constexpr auto keys = Keys<T>();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i] == key) {
+            return i;
+        }
+    }
+    return keys.size();
+}
+
+template <typename T>
+constexpr bool HasKey(std::string_view key) {
+    return FieldIndex<T>(key) < FieldCount<T>();
+}
+
+// Field indices in the order keys compare with std::less<std::string>, which is
+// how nlohmann::json lays out object members when dumping
+template <typename T>
+constexpr auto SortedFieldOrder() {
+    constexpr auto keys = Keys<T>();
+    std::array<std::size_t, keys.size()> order{};
+    for (std::size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    for (std::size_t i = 1; i < order.size(); ++i) {
+        for (std::size_t j = i; j > 0 && keys[order[j]] < keys[order[j - 1]]; --j) {
+            const std::size_t swap = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = swap;
+        }
+    }
+    return order;
+}
+
+template <typename T>
+constexpr bool KeysAreUnique() {
+    constexpr auto keys = Keys<T>();
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+        for (std::size_t j = i + 1; j < keys.size(); ++j) {
+            if (keys[i] == keys[j]) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Keys are written verbatim, so they must not contain anything JSON would escape
+template <typename T>
+constexpr bool KeysArePlain() {
+    for (std::string_view key : Keys<T>()) {
+        if (key.empty()) {
+            return false;
+        }
+        for (char c : key) {
+            if (static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\') {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Counts aggregate members by probing brace initialization with a value that
+// converts to anything. Only declared; used in unevaluated contexts.
+struct AnyMember {
+    template <typename U>
+    operator U() const;
+};
+
+template <typename T, typename Indices, typename = void>
+struct IsBraceConstructible : std::false_type {};
+
+template <typename T, std::size_t... I>
+struct IsBraceConstructible<T, std::index_sequence<I...>,
+    std::void_t<decltype(T{ (static_cast<void>(I), AnyMember{})... })>> : std::true_type {};
+
+template <typename T, std::size_t N = 0>
+constexpr std::size_t MemberCount() {
+    if constexpr (IsBraceConstructible<T, std::make_index_sequence<N + 1>>::value) {
+        return MemberCount<T, N + 1>();
+    }
+    else {
+        return N;
+    }
+}
+
+template <typename T>
+constexpr bool CheckFields() {
+    static_assert(std::is_aggregate_v<T>, "Reflected types must be aggregates");
+    static_assert(KeysAreUnique<T>(), "Duplicate JSON key in field table");
+    static_assert(KeysArePlain<T>(), "JSON keys must be non-empty and need no escaping");
+    static_assert(FieldCount<T>() == MemberCount<T>(), "Field table doesn't cover every member");
+    return true;
+}
+
+template <typename T, typename Function, std::size_t... I>
+void ForEachField(Function&& function, std::index_sequence<I...>) {
+    (function(std::integral_constant<std::size_t, I>{}), ...);
+}
+
+template <typename T, typename Function>
+void ForEachField(Function&& function) {
+    ForEachField<T>(std::forward<Function>(function), std::make_index_sequence<FieldCount<T>()>{});
+}
+
+// Member-wise equality through the field tables
+template <typename T>
+std::enable_if_t<!IsReflected<T>::value, bool> Equal(const T& a, const T& b) {
+    return a == b;
+}
+
+template <typename T>
+std::enable_if_t<IsReflected<T>::value, bool> Equal(const T& a, const T& b);
+
+template <typename K, typename T>
+bool Equal(const std::map<K, T>& a, const std::map<K, T>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (auto i = a.begin(), j = b.begin(); i != a.end(); ++i, ++j) {
+        if (i->first != j->first || !Equal(i->second, j->second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+bool Equal(const std::vector<T>& a, const std::vector<T>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < a.size(); ++i) {
+        if (!Equal(a[i], b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+std::enable_if_t<IsReflected<T>::value, bool> Equal(const T& a, const T& b) {
+    bool equal = true;
+    ForEachField<T>([&](auto index) {
+        constexpr auto field = std::get<decltype(index)::value>(Reflect<T>::Fields);
+        equal = equal && Equal(a.*field.Pointer, b.*field.Pointer);
+    });
+    return equal;
+}
+
+} // namespace Reflection
+
+// Pull parser over a JSON text held in memory.
+// Strings, numbers and literals are decoded on demand; nothing is materialized
+// beyond what the caller reads. After an error every call fails.
+class JsonReader {
+public:
+    enum class Token {
+        Object,
+        Array,
+        String,
+        Number,
+        Boolean,
+        Null,
+        End,
+        Error
+    };
+
+    JsonReader(const char* data, std::size_t size);
+
+    // Type of the next value without consuming it
+    Token Peek();
+
+    // Object members: BeginObject, then NextKey until it returns false
+    bool BeginObject();
+    bool NextKey(std::string_view& key);
+
+    // Array elements: BeginArray, then NextElement until it returns false
+    bool BeginArray();
+    bool NextElement();
+
+    bool ReadString(std::string& value);
+    bool ReadNumber(double& value);
+    // Fails unless the number is whole and within int's range
+    bool ReadInteger(int& value);
+    bool ReadBoolean(bool& value);
+    bool SkipValue();
+
+    // True if only whitespace is left
+    bool AtEnd();
+
+    bool Failed() const { return !m_error.empty(); }
+    const std::string& Error() const { return m_error; }
+    std::size_t ErrorOffset() const { return m_errorOffset; }
+    std::size_t Offset() const { return static_cast<std::size_t>(m_cursor - m_begin); }
+
+private:
+    void SkipWhitespace();
+    bool Expect(char c);
+    bool Fail(const char* message);
+    bool ScanString(std::string* value);
+    bool ScanKey(std::string_view& key);
+    bool ScanNumber(std::string_view& text);
+    bool ScanLiteral(std::string_view literal);
+
+    const char* m_begin;
+    const char* m_cursor;
+    const char* m_end;
+    std::string m_error;
+    std::size_t m_errorOffset = 0;
+    std::string m_keyBuffer;  // Keys that contain escapes, decoded
+    bool m_first = false;  // Next member or element is the first of its container
+};
+
+// Writes JSON text laid out exactly like nlohmann::json::dump(2)
+class JsonWriter {
+public:
+    explicit JsonWriter(std::string& out) : m_out(out) {}
+
+    void BeginObject();
+    void Key(std::string_view key);
+    void EndObject();
+
+    void BeginArray();
+    void Element();
+    void EndArray();
+
+    void String(std::string_view value);
+    void Number(double value);
+    void Integer(long long value);
+    void Boolean(bool value);
+
+private:
+    void NewLine(std::size_t depth);
+
+    std::string& m_out;
+    std::vector<std::size_t> m_counts;  // Members written per open container
+};
+
+// Readers. Values of an unexpected JSON type are skipped and leave the target unchanged.
+bool ReadJson(JsonReader& reader, double& value);
+bool ReadJson(JsonReader& reader, int& value);
+bool ReadJson(JsonReader& reader, bool& value);
+bool ReadJson(JsonReader& reader, std::string& value);
+
+template <typename T>
+std::enable_if_t<Reflection::IsReflected<T>::value, bool> ReadJson(JsonReader& reader, T& value);
+
+template <typename T>
+bool ReadJson(JsonReader& reader, std::map<std::string, T>& value);
+
+template <typename T>
+bool ReadJson(JsonReader& reader, std::vector<T>& value);
+
+template <typename T>
+std::enable_if_t<Reflection::IsReflected<T>::value, bool> ReadJson(JsonReader& reader, T& value) {
+    if (reader.Peek() != JsonReader::Token::Object) {
+        return reader.SkipValue();
+    }
+    reader.BeginObject();
+    std::string_view key;
+    while (reader.NextKey(key)) {
+        bool matched = false;
+        Reflection::ForEachField<T>([&](auto index) {
+            constexpr auto field = std::get<decltype(index)::value>(Reflect<T>::Fields);
+            if (!matched && key == field.Key) {
+                matched = true;
+                ReadJson(reader, value.*field.Pointer);
+            }
+        });
+        if (!matched) {
+            reader.SkipValue();
+        }
+    }
+    return !reader.Failed();
+}
+
+// Members merge into existing entries, as repeated keys do in a DOM
+template <typename T>
+bool ReadJson(JsonReader& reader, std::map<std::string, T>& value) {
+    if (reader.Peek() != JsonReader::Token::Object) {
+        return reader.SkipValue();
+    }
+    reader.BeginObject();
+    std::string_view key;
+    while (reader.NextKey(key)) {
+        ReadJson(reader, value[std::string(key)]);
+    }
+    return !reader.Failed();
+}
+
+// Elements are appended
+template <typename T>
+bool ReadJson(JsonReader& reader, std::vector<T>& value) {
+    if (reader.Peek() != JsonReader::Token::Array) {
+        return reader.SkipValue();
+    }
+    reader.BeginArray();
+    while (reader.NextElement()) {
+        value.emplace_back();
+        ReadJson(reader, value.back());
+    }
+    return !reader.Failed();
+}
+
+// Writers
+inline void WriteJson(JsonWriter& writer, double value) { writer.Number(value); }
+inline void WriteJson(JsonWriter& writer, int value) { writer.Integer(value); }
+inline void WriteJson(JsonWriter& writer, bool value) { writer.Boolean(value); }
+inline void WriteJson(JsonWriter& writer, const std::string& value) { writer.String(value); }
+
+template <typename T>
+std::enable_if_t<Reflection::IsReflected<T>::value> WriteJson(JsonWriter& writer, const T& value);
+
+template <typename T>
+void WriteJson(JsonWriter& writer, const std::shared_ptr<const T>& value);
+
+template <typename T>
+void WriteJson(JsonWriter& writer, const std::map<std::string, T>& value);
+
+template <typename T>
+void WriteJson(JsonWriter& writer, const std::vector<T>& value);
+
+template <typename T>
+std::enable_if_t<Reflection::IsReflected<T>::value> WriteJson(JsonWriter& writer, const T& value) {
+    writer.BeginObject();
+    Reflection::ForEachField<T>([&](auto position) {
+        constexpr std::size_t index = Reflection::SortedFieldOrder<T>()[decltype(position)::value];
+        constexpr auto field = std::get<index>(Reflect<T>::Fields);
+        if constexpr (field.OmitIfDefault) {
+            if (Reflection::Equal(value.*field.Pointer, T{}.*field.Pointer)) {
+                return;
+            }
+        }
+        writer.Key(field.Key);
+        WriteJson(writer, value.*field.Pointer);
+    });
+    writer.EndObject();
+}
+
+template <typename T>
+void WriteJson(JsonWriter& writer, const std::shared_ptr<const T>& value) {
+    WriteJson(writer, *value);
+}
+
+template <typename T>
+void WriteJson(JsonWriter& writer, const std::map<std::string, T>& value) {
+    writer.BeginObject();
+    for (const auto& [key, entry] : value) {
+        writer.Key(key);
+        WriteJson(writer, entry);
+    }
+    writer.EndObject();
+}
+
+template <typename T>
+void WriteJson(JsonWriter& writer, const std::vector<T>& value) {
+    writer.BeginArray();
+    for (const T& entry : value) {
+        writer.Element();
+        WriteJson(writer, entry);
+    }
+    writer.EndArray();
+}
@@ -0,0 +1,35 @@
+// LatencyHistogram.h
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Lock-free histogram of durations with power-of-two microsecond buckets:
+// bucket 0 holds [0, 1) us, bucket i holds [2^(i-1), 2^i) us.
+// Record may be called from any thread; readers see a consistent-enough view.
+class LatencyHistogram {
+public:
+    static constexpr std::size_t BucketCount = 32;
+
+    void Record(std::chrono::nanoseconds latency);
+    void Reset();
+
+    std::uint64_t Count() const;
+    std::chrono::nanoseconds Max() const { return std::chrono::nanoseconds(m_maxNs.load(std::memory_order_relaxed)); }
+    std::chrono::nanoseconds Mean() const;
+
+    // Upper bound of the bucket holding the given fraction of samples, e.g. 0.99
+    std::chrono::microseconds Percentile(double fraction) const;
+
+    // One line per non-empty bucket, for logs
+    std::string Format() const;
+
+private:
+    std::array<std::atomic<std::uint64_t>, BucketCount> m_buckets{};
+    std::atomic<std::uint64_t> m_totalNs{ 0 };
+    std::atomic<std::int64_t> m_maxNs{ 0 };
+};
@@ -0,0 +1,74 @@
+// MappedFile.h
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+// The mapping is released when the object is destroyed.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& filePath);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Map the file, replacing any previous mapping. Returns false if the file can't be opened or mapped.
+    bool Open(const std::string& filePath);
+    void Close();
+
+    bool IsOpen() const { return m_data != nullptr || m_isEmptyFile; }
+    const char* Data() const { return m_data; }
+    std::size_t Size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    std::size_t m_size = 0;
+    bool m_isEmptyFile = false;
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#endif
+};
+
+// Read-write mapping of a file that can grow, for writing through memory.
+// Growing remaps the file, so pointers into Data() are only good until the next Reserve.
+class WritableMappedFile {
+public:
+    WritableMappedFile() = default;
+    ~WritableMappedFile();
+
+    WritableMappedFile(const WritableMappedFile&) = delete;
+    WritableMappedFile& operator=(const WritableMappedFile&) = delete;
+
+    // Open or create the file and map all of it, at least minimumSize bytes
+    bool Open(const std::string& filePath, std::size_t minimumSize);
+    void Close();
+
+    // Grow the file and the mapping to at least 'size' bytes
+    bool Reserve(std::size_t size);
+
+    // Write the mapped pages back to the file
+    bool Flush();
+
+    bool IsOpen() const { return m_data != nullptr; }
+    char* Data() const { return m_data; }
+    std::size_t Size() const { return m_size; }
+
+private:
+    bool Map(std::size_t size);
+    void Unmap();
+
+    char* m_data = nullptr;
+    std::size_t m_size = 0;
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
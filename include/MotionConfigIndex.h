@@ -0,0 +1,171 @@
+// MotionConfigIndex.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "PositionKdTree.h"
+#include "Span.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+
+// Sentinel for "no such entry" in the dense id spaces below
+constexpr std::uint32_t InvalidIndex = 0xFFFFFFFFu;
+
+// Handles are resolved once from names and then used for O(1) lookups.
+// A handle is tied to the generation of its device's or graph's index entry and
+// stops resolving once that device or graph is modified or removed, or when
+// adding or removing a device moves its dense id. Other edits leave it valid.
+// Generation 0 is never issued.
+struct DeviceHandle {
+    std::uint32_t Index = InvalidIndex;
+    std::uint32_t Generation = 0;
+    bool IsValid() const { return Index != InvalidIndex; }
+};
+
+struct PositionHandle {
+    std::uint32_t Device = InvalidIndex;
+    std::uint32_t Index = InvalidIndex;  // Into the device's flat position array
+    std::uint32_t Generation = 0;
+    bool IsValid() const { return Device != InvalidIndex && Index != InvalidIndex; }
+};
+
+struct NodeHandle {
+    std::uint32_t Graph = InvalidIndex;
+    std::uint32_t Index = InvalidIndex;  // Into the graph's Nodes vector
+    std::uint32_t Generation = 0;
+    bool IsValid() const { return Graph != InvalidIndex && Index != InvalidIndex; }
+};
+
+// Interns strings into dense ids using open addressing with linear probing.
+// Lookups take a string_view and never allocate.
+class FlatNameTable {
+public:
+    void Clear();
+    void Reserve(std::size_t count);
+
+    // Returns the id of name, adding it if it isn't present yet
+    std::uint32_t Intern(std::string_view name);
+
+    // Returns the id of name or InvalidIndex
+    std::uint32_t Find(std::string_view name) const;
+
+    const std::string& Name(std::uint32_t id) const { return m_names[id]; }
+    std::size_t Size() const { return m_names.size(); }
+
+private:
+    struct Slot {
+        std::uint32_t Hash = 0;
+        std::uint32_t Id = InvalidIndex;
+    };
+
+    static std::uint32_t HashName(std::string_view name);
+    void Rehash(std::size_t slotCount);
+
+    std::vector<Slot> m_slots;
+    std::vector<std::string> m_names;
+    std::size_t m_mask = 0;
+};
+
+// Containers whose entries are shared between configuration versions
+using SharedDeviceMap = std::map<std::string, std::shared_ptr<const MotionDevice>>;
+using SharedGraphMap = std::map<std::string, std::shared_ptr<const Graph>>;
+
+// Interned positions of one device, stored contiguously in name order
+struct DeviceIndex {
+    std::shared_ptr<const MotionDevice> Source;
+    std::uint32_t Generation = 0;  // Unique to this build
+    FlatNameTable PositionNames;
+    std::vector<PositionStruct> Positions;
+    PositionKdTree Spatial;  // Over Positions, for nearest-position queries
+
+    void Build(std::shared_ptr<const MotionDevice> device);
+};
+
+// Dense per-graph lookup tables with compressed-sparse-row (CSR) adjacency.
+// Row i of a CSR table is [Offsets[i], Offsets[i + 1]) in the matching value array.
+struct GraphIndex {
+    std::shared_ptr<const Graph> Owner;
+    const Graph* Source = nullptr;
+    std::uint32_t Generation = 0;           // Unique to this build
+    FlatNameTable NodeIds;                  // Node::Id -> interned id
+    std::vector<std::uint32_t> NodeIndex;   // Interned id -> index into Source->Nodes
+    FlatNameTable EdgeIds;                  // Edge::Id -> interned id
+    std::vector<std::uint32_t> EdgeIndex;   // Interned id -> index into Source->Edges
+    std::vector<std::uint32_t> EdgeSource;  // Edge index -> node index (InvalidIndex if dangling)
+    std::vector<std::uint32_t> EdgeTarget;
+
+    // Edges whose Source is the node, in declaration order
+    std::vector<std::uint32_t> OutEdgeOffsets;
+    std::vector<const Edge*> OutEdges;
+
+    // Traversable neighbours; bidirectional edges appear in both directions
+    std::vector<std::uint32_t> AdjacencyOffsets;
+    std::vector<std::uint32_t> AdjacencyNodes;
+    std::vector<std::uint32_t> AdjacencyEdges;
+
+    // Nodes bucketed by their Node::Device string
+    FlatNameTable DeviceNames;
+    std::vector<std::uint32_t> DeviceNodeOffsets;
+    std::vector<const Node*> DeviceNodes;
+
+    void Build(std::shared_ptr<const Graph> graph);
+
+    std::uint32_t FindNode(std::string_view nodeId) const;
+    Span<const Edge* const> EdgesFrom(std::uint32_t node) const;
+    Span<const std::uint32_t> Neighbours(std::uint32_t node) const;
+    Span<const std::uint32_t> NeighbourEdges(std::uint32_t node) const;
+    Span<const Node* const> NodesOfDevice(std::string_view deviceName) const;
+};
+
+// Flat, interned view of a configuration. Devices, positions and graph nodes
+// are addressed by dense ids. Per-device and per-graph entries are immutable
+// and shared, so a copied index only rebuilds the entries that changed.
+class MotionConfigIndex {
+public:
+    void Build(const SharedDeviceMap& devices, const SharedGraphMap& graphs);
+
+    // Partial rebuilds that reuse entries whose source object is unchanged.
+    // Handles into the entries they rebuild stop resolving.
+    void RebuildDevices(const SharedDeviceMap& devices);
+    void RebuildGraph(const std::string& graphName, std::shared_ptr<const Graph> graph);
+
+    // Generation of the entry, or 0 if there is none
+    std::uint32_t DeviceGeneration(std::uint32_t device) const {
+        return device < m_devices.size() ? m_devices[device]->Generation : 0;
+    }
+    std::uint32_t GraphGeneration(std::uint32_t graph) const {
+        return graph < m_graphs.size() ? m_graphs[graph]->Generation : 0;
+    }
+
+    // For DeviceIndex and GraphIndex builds; unique across every index in the process
+    static std::uint32_t NextGeneration();
+
+    std::uint32_t FindDevice(std::string_view deviceName) const { return m_deviceNames.Find(deviceName); }
+    std::uint32_t FindPosition(std::uint32_t device, std::string_view positionName) const;
+    std::uint32_t FindGraph(std::string_view graphName) const { return m_graphNames.Find(graphName); }
+    std::uint32_t FindNode(std::uint32_t graph, std::string_view nodeId) const;
+    std::uint32_t FindEdge(std::uint32_t graph, std::string_view edgeId) const;
+
+    std::size_t DeviceCount() const { return m_devices.size(); }
+    std::size_t GraphCount() const { return m_graphs.size(); }
+
+    const MotionDevice& Device(std::uint32_t device) const { return *m_devices[device]->Source; }
+    const DeviceIndex& DeviceAt(std::uint32_t device) const { return *m_devices[device]; }
+    const std::string& DeviceName(std::uint32_t device) const { return m_deviceNames.Name(device); }
+    const PositionStruct& Position(std::uint32_t device, std::uint32_t position) const { return m_devices[device]->Positions[position]; }
+    const std::string& GraphName(std::uint32_t graph) const { return m_graphNames.Name(graph); }
+    const GraphIndex& GraphAt(std::uint32_t graph) const { return *m_graphs[graph]; }
+
+private:
+    static std::atomic<std::uint32_t> s_nextGeneration;
+
+    FlatNameTable m_deviceNames;
+    std::vector<std::shared_ptr<const DeviceIndex>> m_devices;
+
+    FlatNameTable m_graphNames;
+    std::vector<std::shared_ptr<const GraphIndex>> m_graphs;
+};
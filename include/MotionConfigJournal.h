@@ -0,0 +1,94 @@
+// MotionConfigJournal.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "DurableFile.h"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// One configuration mutation as stored in the journal
+struct JournalRecord {
+    enum class Type : std::uint8_t {
+        UpdateDevice = 1,
+        AddPosition,
+        AddDevice,
+        DeleteDevice,
+        DeletePosition,
+        UpdateSettings,
+        UpdateGraph
+    };
+
+    Type Op = Type::UpdateDevice;
+    std::uint64_t Sequence = 0;     // Assigned when appended
+    std::string Name;               // Device or graph name
+    std::string PositionName;
+    PositionStruct Position;
+    MotionDevice Device;
+    Settings NewSettings;
+    Graph NewGraph;
+
+    static JournalRecord ForDevice(Type op, const std::string& deviceName, const MotionDevice& device);
+    static JournalRecord ForPosition(Type op, const std::string& deviceName, const std::string& positionName, const PositionStruct& position = {});
+    static JournalRecord ForDeleteDevice(const std::string& deviceName);
+    static JournalRecord ForSettings(const Settings& settings);
+    static JournalRecord ForGraph(const std::string& graphName, const Graph& graph);
+
+    // Replay the mutation onto plain configuration containers
+    void Apply(std::map<std::string, MotionDevice>& devices, std::map<std::string, Graph>& graphs, Settings& settings) const;
+};
+
+// Write-ahead journal of configuration mutations.
+// Records are appended as length-prefixed, checksummed binary frames on top of a
+// base configuration file identified by its content hash. Appends are cheap;
+// Sync() makes them durable and coalesces concurrent callers into one flush.
+// Compaction rewrites the base file elsewhere and switches appends to a fresh
+// segment, so a crash at any point leaves a recoverable pair of files.
+class MotionConfigJournal {
+public:
+    static constexpr std::uint32_t FormatVersion = 2;
+
+    // Journal file that accompanies the given JSON configuration
+    static std::string PathFor(const std::string& configFilePath);
+
+    // Recover the records that apply on top of the configuration whose bytes hash
+    // to baseHash, then open the journal for appending. A torn tail from a crash
+    // is dropped. Journals written against a different base are set aside.
+    bool Open(const std::string& journalPath, std::uint64_t baseHash, std::vector<JournalRecord>& recovered);
+    void Close();
+    bool IsOpen() const;
+
+    // Append records in order and return the sequence number of the last one (0 on failure)
+    std::uint64_t Append(std::vector<JournalRecord>& records);
+
+    // Make every record up to sequence durable
+    bool Sync(std::uint64_t sequence);
+
+    std::uint64_t LastSequence() const;
+    std::uint64_t Size() const;
+
+    // Switch appends to a new segment based on a compacted file with the given hash.
+    // Call FinishCompaction once that file has replaced the configuration, or
+    // AbortCompaction if it couldn't be written.
+    bool BeginCompaction(std::uint64_t newBaseHash);
+    bool FinishCompaction();
+    bool AbortCompaction();
+
+    // Rewrite the journal as the given records on top of a configuration file with
+    // the given hash, after that file was replaced from outside. Not during a compaction.
+    bool Rebase(std::uint64_t newBaseHash, const std::vector<JournalRecord>& records);
+
+private:
+    std::string NextSegmentPath() const { return m_path + ".next"; }
+
+    std::string m_path;
+    DurableFile m_file;
+    bool m_compacting = false;
+
+    mutable std::mutex m_mutex;      // Appends and sequence numbers
+    std::mutex m_syncMutex;          // Held by the flushing thread and by segment switches
+    std::uint64_t m_lastSequence = 0;
+    std::uint64_t m_syncedSequence = 0;
+};
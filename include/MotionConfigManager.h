@@ -2,55 +2,96 @@
 #pragma once
 
 #include "MotionTypes.h"
-#include <nlohmann/json.hpp>
+#include "MotionConfigIndex.h"
+#include "MotionConfigVersion.h"
+#include "MotionConfigJournal.h"
+#include "MotionConfigTransaction.h"
+#include "MotionConfigValidator.h"
+#include "ThreadPool.h"
+#include "ConfigFileWatcher.h"
+#include "Rcu.h"
 #include <string>
 #include <map>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 #include <optional>
 #include <functional>
 
-using json = nlohmann::json;
-
+// Readers see the configuration as an immutable MotionConfigVersion published
+// through an RCU pointer, so lookups never take a lock. Modifications copy the
+// current version, replace only the affected devices or graphs and publish the
+// result. The getters below return copies taken from the version current at the
+// call; to make several lookups against one version, or to use references into it
+// without copying, hold an AcquireVersion() pointer.
 class MotionConfigManager {
 public:
     // Constructor that takes a path to the JSON configuration file
     MotionConfigManager(const std::string& configFilePath);
+    ~MotionConfigManager();
+
+    MotionConfigManager(const MotionConfigManager&) = delete;
+    MotionConfigManager& operator=(const MotionConfigManager&) = delete;
+
+    // Reference-counted handle to the current version, safe to use from any thread
+    MotionConfigVersionPtr AcquireVersion() const { return m_current.Load(); }
 
     // Get all motion devices
-    const std::map<std::string, MotionDevice>& GetAllDevices() const;
+    std::map<std::string, MotionDevice> GetAllDevices() const;
 
     // Get a specific device by name
-    std::optional<std::reference_wrapper<const MotionDevice>> GetDevice(const std::string& deviceName) const;
+    std::optional<MotionDevice> GetDevice(const std::string& deviceName) const;
 
     // Get all enabled devices
-    std::map<std::string, std::reference_wrapper<const MotionDevice>> GetEnabledDevices() const;
+    std::map<std::string, MotionDevice> GetEnabledDevices() const;
 
     // Get all positions for a device
-    std::optional<std::reference_wrapper<const std::map<std::string, PositionStruct>>> GetDevicePositions(const std::string& deviceName) const;
+    std::optional<std::map<std::string, PositionStruct>> GetDevicePositions(const std::string& deviceName) const;
 
     // Get a specific named position for a device
-    std::optional<std::reference_wrapper<const PositionStruct>> GetNamedPosition(const std::string& deviceName, const std::string& positionName) const;
+    std::optional<PositionStruct> GetNamedPosition(const std::string& deviceName, const std::string& positionName) const;
+
+    // Resolve names to handles once, then use the handle overloads for O(1) lookups.
+    // Handles stop resolving once their device or graph is modified or removed; see
+    // DeviceHandle.
+    DeviceHandle ResolveDevice(const std::string& deviceName) const;
+    PositionHandle ResolvePosition(const std::string& deviceName, const std::string& positionName) const;
+    PositionHandle ResolvePosition(DeviceHandle device, const std::string& positionName) const;
+    NodeHandle ResolveNode(const std::string& graphName, const std::string& nodeId) const;
+
+    // These copy what they find out of the current version, a whole MotionDevice
+    // with its positions for GetDevice. Hot paths should pin a version instead and
+    // look up by reference there, e.g. AcquireVersion()->GetDevice(handle). A handle
+    // resolves against any version in which its entry is unchanged.
+    std::optional<MotionDevice> GetDevice(DeviceHandle device) const;
+    std::optional<PositionStruct> GetNamedPosition(PositionHandle position) const;
+    std::optional<Node> GetNodeById(NodeHandle node) const;
 
     // Get all graphs
-    const std::map<std::string, Graph>& GetAllGraphs() const;
+    std::map<std::string, Graph> GetAllGraphs() const;
 
     // Get a specific graph
-    std::optional<std::reference_wrapper<const Graph>> GetGraph(const std::string& graphName) const;
+    std::optional<Graph> GetGraph(const std::string& graphName) const;
 
     // Find a node by ID within a graph
-    const Node* GetNodeById(const std::string& graphName, const std::string& nodeId) const;
+    std::optional<Node> GetNodeById(const std::string& graphName, const std::string& nodeId) const;
 
     // Get all nodes associated with a specific device
-    std::vector<std::reference_wrapper<const Node>> GetNodesByDevice(const std::string& graphName, const std::string& deviceName) const;
+    std::vector<Node> GetNodesByDevice(const std::string& graphName, const std::string& deviceName) const;
 
     // Get all edges with a specific source node
-    std::vector<std::reference_wrapper<const Edge>> GetEdgesBySource(const std::string& graphName, const std::string& sourceNodeId) const;
+    std::vector<Edge> GetEdgesBySource(const std::string& graphName, const std::string& sourceNodeId) const;
 
     // Find a path between two nodes in a graph
-    std::vector<std::reference_wrapper<const Node>> FindPath(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId) const;
+    std::vector<Node> FindPath(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId) const;
+    std::vector<Node> FindPath(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId, PathMetric metric) const;
+
+    // Estimated travel time of the fastest route between two nodes, or infinity if unreachable
+    double EstimateTravelTime(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId) const;
 
     // Get global settings
-    const Settings& GetSettings() const;
+    Settings GetSettings() const;
 
     // Update a device configuration
     void UpdateDevice(const std::string& deviceName, const MotionDevice& updatedDevice);
@@ -66,23 +107,98 @@ public:
     // Updated settings
     void UpdateSettings(const Settings& newSettings);
 
-    // Save the configuration to a file
+    // Product variants: overlay files layered over the base configuration, later files
+    // winning. Selecting a product publishes a version with the overrides applied, so
+    // lookups cost the same as without one, and only devices overridden by the previous
+    // or new product are rebuilt. Edits still go to the base file; positions left at the
+    // product's value aren't written back. Throws std::runtime_error if a file can't be loaded.
+    void SelectProduct(const std::string& productName, const std::vector<std::string>& overlayPaths);
+    void ClearProduct();
+
+    // Name of the selected product, or empty
+    std::string GetSelectedProduct() const;
+
+    // Stage many edits and apply them with a single re-index and validation
+    MotionConfigTransaction BeginTransaction();
+
+    // Check graph nodes and edges against devices, positions and each other.
+    // Only graphs and devices changed since the previous call are re-checked.
+    std::vector<ConfigDiagnostic> ValidateConfig() const;
+
+    // Save the configuration. For the loaded file this appends the edits made since
+    // the last save to the journal and flushes it; the JSON file itself is rewritten
+    // by a background compaction. Any other path gets a complete, atomically written
+    // file, with no snapshot or journal beside it.
     bool SaveConfig(const std::string& filePath = "");
 
     void UpdateGraph(const std::string& graphName, const Graph& updatedGraph);
+
+    // Re-read the configuration file after another tool changed it and apply only the
+    // devices, graphs and settings that differ. Readers keep working throughout; the
+    // new state is published as one version. Edits saved to the journal but not yet
+    // compacted into the file are replayed on top of it and kept in the journal;
+    // unsaved edits are dropped. Returns false and keeps the running configuration if
+    // the file can't be read or parsed. Changes this manager wrote itself are ignored.
+    // Called by the manager's own file watcher whenever the file is replaced.
+    bool ReloadConfig();
     // Add this to the public section of MotionConfigManager.h
 // Get all named positions for a device
-    std::optional<std::reference_wrapper<const std::map<std::string, PositionStruct>>> GetNamedPositions(const std::string& deviceName) const;
+    std::optional<std::map<std::string, PositionStruct>> GetNamedPositions(const std::string& deviceName) const;
 private:
     // Parse and load the configuration
     void LoadConfig(const std::string& filePath);
 
-    // Validate the configuration
-    bool ValidateConfig();
+    std::vector<ConfigDiagnostic> ValidateConfig(const MotionConfigVersion& version) const;
+
+    // Version last published; caller holds m_writeMutex
+    const MotionConfigVersion& Current() const { return *m_published; }
+
+    // Copy of the current version for a writer to modify; caller holds m_writeMutex
+    std::shared_ptr<MotionConfigVersion> BeginUpdate() const;
+    void Publish(std::shared_ptr<MotionConfigVersion> version);
+    void Publish(std::shared_ptr<MotionConfigVersion> version, JournalRecord record);
+
+    friend class MotionConfigTransaction;
+    bool CommitTransaction(MotionConfigTransaction& transaction);
+
+    void ApplyProduct(std::shared_ptr<const ProductOverlay> overlay);
+
+    static std::string SerializeConfig(const MotionConfigVersion& version);
+    static bool WriteConfigFile(const std::string& filePath, const MotionConfigVersion& version, std::uint64_t* fileHash = nullptr);
+
+    // Keep the loaded file's compiled snapshot in step so the next start doesn't
+    // have to reparse. Only the loaded file has one; other paths are plain exports.
+    void WriteSnapshot(const MotionConfigVersion& version, std::uint64_t fileHash) const;
+
+    // Fold the journal into a freshly written JSON file
+    void RequestCompaction();
+    void CompactionLoop();
+    bool CompactJournal();
+
+    // Journal size that triggers a background compaction. The journal is also
+    // compacted at startup and when the manager is destroyed.
+    static constexpr std::uint64_t JournalCompactionBytes = 64 * 1024;
 
     // Data members
-    std::map<std::string, MotionDevice> m_devices;
-    std::map<std::string, Graph> m_graphs;
-    Settings m_settings;
     std::string m_configFilePath;
+    RcuPointer<MotionConfigVersion> m_current;
+    MotionConfigVersionPtr m_published;  // Writers' reference to what m_current holds
+    std::mutex m_writeMutex;  // Serializes modifications; readers never take it
+    std::mutex m_fileMutex;   // Held over whole-file rewrites and reloads; taken before m_writeMutex
+    std::uint64_t m_fileHash = 0;  // Hash of the file's bytes as last loaded or written
+
+    mutable MotionConfigValidator m_validator{ &ThreadPool::Shared() };
+
+    MotionConfigJournal m_journal;
+    std::vector<JournalRecord> m_pendingRecords;  // Edits since the last save
+    std::vector<JournalRecord> m_journalRecords;  // Saved edits the journal holds on top of the file
+    MotionConfigVersionPtr m_savedVersion;        // State the journal describes
+
+    std::thread m_compactionThread;
+    std::mutex m_compactionMutex;
+    std::condition_variable m_compactionSignal;
+    bool m_compactionRequested = false;
+    bool m_stopCompaction = false;
+
+    ConfigFileWatcher m_watcher;  // Reloads the file when another tool replaces it
 };
\ No newline at end of file
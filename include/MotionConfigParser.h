@@ -0,0 +1,18 @@
+// MotionConfigParser.h
+#pragma once
+
+#include "MotionTypes.h"
+#include <cstddef>
+#include <string>
+#include <map>
+
+// Streaming parser for motion_config.json, driven by the field tables in
+// MotionTypesReflection.h. Values are decoded straight from the text into the
+// destination containers, so no intermediate json DOM is built. Unknown keys and
+// values of the wrong type are skipped.
+// Returns false and fills errorMessage if the document is malformed.
+bool ParseMotionConfig(const char* data, std::size_t size,
+    std::map<std::string, MotionDevice>& devices,
+    std::map<std::string, Graph>& graphs,
+    Settings& settings,
+    std::string& errorMessage);
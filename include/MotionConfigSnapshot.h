@@ -0,0 +1,51 @@
+// MotionConfigSnapshot.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "MappedFile.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <map>
+
+// Compiled binary image of a motion configuration.
+// The image is a flat, offset-based layout (header, record tables, string blob)
+// that is memory-mapped, verified in place and decoded straight from the mapping
+// into the configuration containers, which own their strings; nothing refers to
+// the mapping after Load. It carries the hash of the JSON it was compiled from,
+// so a stale snapshot is detected and rebuilt from the JSON, which stays the
+// source of truth.
+class MotionConfigSnapshot {
+public:
+    static constexpr std::uint32_t FormatVersion = 2;
+
+    // Snapshot file that caches the given JSON configuration
+    static std::string PathFor(const std::string& configFilePath);
+
+    // Hash used to tie a snapshot to the exact bytes of its JSON source
+    static std::uint64_t HashBytes(const void* data, std::size_t size);
+
+    // Compile the configuration into a snapshot file (written to a temp file, then renamed)
+    static bool Write(const std::string& snapshotPath, std::uint64_t sourceHash,
+        const std::map<std::string, MotionDevice>& devices,
+        const std::map<std::string, Graph>& graphs,
+        const Settings& settings);
+
+    // Map a snapshot and verify magic, version, source hash, bounds and checksum.
+    // Returns false if the snapshot is missing, corrupt or stale.
+    bool Open(const std::string& snapshotPath, std::uint64_t expectedSourceHash);
+
+    // Copy the mapped image into the configuration containers
+    void Load(std::map<std::string, MotionDevice>& devices,
+        std::map<std::string, Graph>& graphs,
+        Settings& settings) const;
+
+private:
+    std::string_view String(std::uint32_t offset, std::uint32_t length) const;
+    const char* Section(std::uint64_t offset) const;
+
+    MappedFile m_file;
+    const char* m_payload = nullptr;
+    std::size_t m_payloadSize = 0;
+};
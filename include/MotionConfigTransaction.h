@@ -0,0 +1,68 @@
+// MotionConfigTransaction.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "MotionConfigJournal.h"
+#include "MotionConfigVersion.h"
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+class MotionConfigManager;
+
+// Batch of configuration edits applied as one unit.
+// Edits are staged on private copies of the touched devices and graphs and are
+// invisible to readers until Commit(), which re-indexes the affected entries once,
+// validates once and publishes a single new version. A transaction that isn't
+// committed is rolled back when it goes out of scope.
+//
+// Commit is optimistic: it fails if another writer changed one of the touched
+// devices or graphs after the transaction started.
+class MotionConfigTransaction {
+public:
+    ~MotionConfigTransaction();
+
+    MotionConfigTransaction(MotionConfigTransaction&& other) noexcept;
+    MotionConfigTransaction& operator=(MotionConfigTransaction&& other) noexcept;
+    MotionConfigTransaction(const MotionConfigTransaction&) = delete;
+    MotionConfigTransaction& operator=(const MotionConfigTransaction&) = delete;
+
+    // Same contracts as the MotionConfigManager methods of the same name
+    void UpdateDevice(const std::string& deviceName, const MotionDevice& updatedDevice);
+    void AddPosition(const std::string& deviceName, const std::string& positionName, const PositionStruct& position);
+    void AddDevice(const std::string& deviceName, const MotionDevice& device);
+    bool DeleteDevice(const std::string& deviceName);
+    bool DeletePosition(const std::string& deviceName, const std::string& positionName);
+    void UpdateSettings(const Settings& newSettings);
+    void UpdateGraph(const std::string& graphName, const Graph& updatedGraph);
+
+    // Publish the staged edits. Returns false and discards them if they introduce
+    // validation errors or conflict with a concurrent edit.
+    bool Commit();
+
+    // Discard the staged edits
+    void Rollback();
+
+    bool IsActive() const { return m_manager != nullptr; }
+    std::size_t EditCount() const { return m_records.size(); }
+
+private:
+    friend class MotionConfigManager;
+
+    explicit MotionConfigTransaction(MotionConfigManager& manager);
+
+    // Staged, writable copy of a device, or nullptr if it doesn't exist (any more)
+    MotionDevice* StagedDevice(const std::string& deviceName);
+
+    MotionConfigManager* m_manager = nullptr;
+    MotionConfigVersionPtr m_base;
+
+    // Touched entries; a null device marks a deletion
+    std::map<std::string, std::shared_ptr<MotionDevice>> m_devices;
+    std::map<std::string, std::shared_ptr<const Graph>> m_graphs;
+    std::optional<Settings> m_settings;
+
+    std::vector<JournalRecord> m_records;  // Staged edits in order, journaled on save
+};
@@ -0,0 +1,74 @@
+// MotionConfigValidator.h
+#pragma once
+
+#include "MotionTypes.h"
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class MotionConfigVersion;
+class ThreadPool;
+
+// One finding of ValidateConfig
+struct ConfigDiagnostic {
+    enum class Severity {
+        Warning,
+        Error
+    };
+
+    enum class Kind {
+        DuplicateNodeId,   // Node::Id used more than once in a graph
+        UnknownDevice,     // Node::Device names no motion device
+        UnknownPosition,   // Node::Position names no position of its device
+        DanglingEdge,      // Edge::Source or Edge::Target names no node
+        InvalidCornerTolerance  // EdgeConditions::CornerTolerance negative or not finite
+    };
+
+    Severity Level = Severity::Error;
+    Kind Type = Kind::UnknownDevice;
+    std::string Graph;
+    std::string Subject;   // Node or edge id
+    std::string Device;    // Referenced device, if any
+    std::string Message;
+};
+
+// Cross-reference checks between graphs and devices, cached per entity.
+// Work is split into one unit per graph (node ids, edge endpoints) and one unit
+// per (graph, referenced device) pair (device and position references). A unit is
+// re-checked only when the graph or device object it depends on was replaced since
+// the previous call; configuration versions share unchanged objects, so pointer
+// identity is the dirty flag. Dirty units fan out across a thread pool.
+class MotionConfigValidator {
+public:
+    struct Stats {
+        std::size_t UnitsChecked = 0;
+        std::size_t UnitsReused = 0;
+    };
+
+    explicit MotionConfigValidator(ThreadPool* pool = nullptr);
+
+    // Diagnostics for the whole version, ordered by graph
+    std::vector<ConfigDiagnostic> Validate(const MotionConfigVersion& version);
+
+    Stats LastStats() const;
+
+private:
+    struct DeviceUnit {
+        std::shared_ptr<const MotionDevice> Device;  // Null if the device didn't exist
+        std::vector<ConfigDiagnostic> Diagnostics;
+    };
+
+    struct GraphEntry {
+        std::shared_ptr<const Graph> Source;
+        std::vector<ConfigDiagnostic> Diagnostics;   // Node id and edge checks
+        std::map<std::string, DeviceUnit> Devices;   // By Node::Device
+    };
+
+    ThreadPool* m_pool;
+    mutable std::mutex m_mutex;
+    std::map<std::string, GraphEntry> m_graphs;
+    Stats m_stats;
+};
@@ -0,0 +1,157 @@
+// MotionConfigVersion.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "MotionConfigIndex.h"
+#include "ProductOverlay.h"
+#include "TravelTimeTable.h"
+#include <string>
+#include <atomic>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <functional>
+
+// How FindPath ranks candidate routes
+enum class PathMetric {
+    HopCount,    // Fewest edges
+    TravelTime   // Shortest estimated move time (trapezoidal profile from Settings)
+};
+
+// Taught position closest to a measured pose, see FindNearestPosition
+struct PositionMatch {
+    PositionHandle Position;
+    std::string Name;
+    double Distance = 0.0;             // Weighted Euclidean, see AxisWeights
+    const Node* GraphNode = nullptr;   // Node of the requested graph on that position, if any
+};
+
+// One immutable version of the motion configuration.
+// Devices, graphs, their index entries and travel tables are held through
+// shared pointers, so a new version shares everything a modification didn't touch.
+// A travel table is built by WarmTravelTables or the first travel-time query of
+// its graph, whichever comes first, and only replaced when the graph, the settings
+// or a position one of its nodes stands on changes.
+// With a product selected, every read sees the base devices with the product's
+// overlay applied; only BaseDevices() shows what the configuration file holds.
+// All methods are safe to call concurrently; references stay valid while the
+// version is alive.
+class MotionConfigVersion {
+public:
+    MotionConfigVersion() = default;
+    MotionConfigVersion(const MotionConfigVersion& other);
+    MotionConfigVersion& operator=(const MotionConfigVersion&) = delete;
+
+    // Plain-map views of the configuration, built on first use
+    const std::map<std::string, MotionDevice>& GetAllDevices() const;
+    const std::map<std::string, Graph>& GetAllGraphs() const;
+
+    const SharedDeviceMap& Devices() const { return m_devices; }
+    const SharedDeviceMap& BaseDevices() const { return m_baseDevices; }
+    const ProductOverlay* Overlay() const { return m_overlay.get(); }
+    const SharedGraphMap& Graphs() const { return m_graphs; }
+    const MotionConfigIndex& Index() const { return m_index; }
+
+    std::optional<std::reference_wrapper<const MotionDevice>> GetDevice(const std::string& deviceName) const;
+    std::map<std::string, std::reference_wrapper<const MotionDevice>> GetEnabledDevices() const;
+    std::optional<std::reference_wrapper<const std::map<std::string, PositionStruct>>> GetDevicePositions(const std::string& deviceName) const;
+    std::optional<std::reference_wrapper<const PositionStruct>> GetNamedPosition(const std::string& deviceName, const std::string& positionName) const;
+
+    DeviceHandle ResolveDevice(const std::string& deviceName) const;
+    PositionHandle ResolvePosition(const std::string& deviceName, const std::string& positionName) const;
+    PositionHandle ResolvePosition(DeviceHandle device, const std::string& positionName) const;
+    NodeHandle ResolveNode(const std::string& graphName, const std::string& nodeId) const;
+
+    std::optional<std::reference_wrapper<const MotionDevice>> GetDevice(DeviceHandle device) const;
+    std::optional<std::reference_wrapper<const PositionStruct>> GetNamedPosition(PositionHandle position) const;
+    const Node* GetNodeById(NodeHandle node) const;
+
+    std::optional<std::reference_wrapper<const Graph>> GetGraph(const std::string& graphName) const;
+    const Node* GetNodeById(const std::string& graphName, const std::string& nodeId) const;
+    Span<const Node* const> GetNodesByDevice(const std::string& graphName, const std::string& deviceName) const;
+    Span<const Edge* const> GetEdgesBySource(const std::string& graphName, const std::string& sourceNodeId) const;
+
+    // By travel time, the route is read from the graph's travel table, which the first
+    // such query builds. Graphs of more than TravelTimeTable::MaxNodes nodes have no
+    // table (it would take 12 bytes per node pair); each query then runs its own
+    // Dijkstra search, costing every edge again.
+    std::vector<std::reference_wrapper<const Node>> FindPath(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId,
+        PathMetric metric = PathMetric::HopCount) const;
+    double EstimateTravelTime(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId) const;
+
+    // Build every travel table not built yet, so route queries don't have to. A query
+    // arriving mid-build waits for it. MotionConfigManager runs this on the shared
+    // thread pool whenever it publishes a version with such tables.
+    void WarmTravelTables() const;
+    bool TravelTablesWarm() const;
+
+    // Work out which taught position a device is sitting at, e.g. after an abort.
+    // Returns the nearest position no further than tolerance (Settings::PositionTolerance
+    // if negative), plus the node of graphName that stands on it. Without explicit
+    // weights, the device's installed axes count equally and the others not at all.
+    std::optional<PositionMatch> FindNearestPosition(const std::string& deviceName, const PositionStruct& actual,
+        const std::string& graphName = std::string(), double tolerance = -1.0) const;
+    std::optional<PositionMatch> FindNearestPosition(const std::string& deviceName, const PositionStruct& actual,
+        const AxisWeights& weights, const std::string& graphName = std::string(), double tolerance = -1.0) const;
+
+    const Settings& GetSettings() const { return m_settings; }
+
+    // A device read from this version and edited, as it should be stored in the base
+    // layer (see ProductOverlay::Strip). Unchanged without a product selected.
+    MotionDevice StripOverlay(const std::string& deviceName, const MotionDevice& edited) const;
+
+private:
+    friend class MotionConfigManager;
+
+    // Rebuild index entries and travel tables after the containers change.
+    // Edits go to m_baseDevices; these re-apply the overlay to the named devices first.
+    // A device edit drops only the travel tables of graphs with a node on a position
+    // that was added, removed or moved.
+    void RebuildIndex();
+    void RefreshDevices(const std::string& deviceName);
+    void RefreshGraph(const std::string& graphName);
+
+    // Batched form: one device index pass, then each affected graph and travel table once
+    void Refresh(const std::set<std::string>& deviceNames, const std::set<std::string>& graphNames, bool settingsChanged);
+    void RefreshTravelTable(std::uint32_t graph);
+    void RefreshAllTravelTables();
+
+    // Whether a node of the graph stands on a position that differs between the two
+    // entries of the device (null where it doesn't exist)
+    bool NodePositionsChanged(std::uint32_t graph, const std::string& deviceName,
+        const MotionDevice* before, const MotionDevice* after) const;
+
+    // The graph's table, built by the first caller; not built above MaxNodes
+    const TravelTimeTable& TravelTable(std::uint32_t graph) const;
+
+    // Recompute the flattened entry of one device from its base entry and the overlay
+    void ApplyOverlay(const std::string& deviceName);
+
+    SharedDeviceMap m_baseDevices;  // As in the configuration file
+    std::shared_ptr<const ProductOverlay> m_overlay;
+    SharedDeviceMap m_devices;      // m_baseDevices with m_overlay applied; entries are shared where it has no effect
+    SharedGraphMap m_graphs;
+    Settings m_settings;
+    MotionConfigIndex m_index;
+
+    // Shared by the versions the table is valid for, whichever builds it
+    struct LazyTravelTable {
+        std::once_flag Once;
+        std::atomic<bool> Built{ false };
+        TravelTimeTable Table;
+    };
+    std::vector<std::shared_ptr<LazyTravelTable>> m_travelTables;  // By graph index
+
+    struct PlainMaps {
+        std::once_flag DevicesOnce;
+        std::once_flag GraphsOnce;
+        std::map<std::string, MotionDevice> Devices;
+        std::map<std::string, Graph> Graphs;
+    };
+    std::unique_ptr<PlainMaps> m_plainMaps = std::make_unique<PlainMaps>();
+};
+
+using MotionConfigVersionPtr = std::shared_ptr<const MotionConfigVersion>;
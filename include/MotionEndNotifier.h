@@ -0,0 +1,107 @@
+// MotionEndNotifier.h
+#pragma once
+
+#include "LatencyHistogram.h"
+#include "AcsController.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+// Tells whoever waits for a particular axis that its motion has ended. Each axis
+// has its own slot and condition variable, so a notification wakes that waiter
+// only. Arm or Expect before starting the motion, or a quick move can end before
+// anyone listens. Latency() holds the time from the backend noticing the end to
+// the waiter running: Wait records it, and an Expect caller records it where the
+// end is finally acted on, from the time its callback is given.
+class MotionEndNotifier {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void(bool succeeded, Clock::time_point signalled)>;
+    static constexpr int MaxAxes = 64;
+
+    virtual ~MotionEndNotifier() = default;
+
+    // Wait for the next end of motion of the axis with Wait
+    void Arm(int axis);
+
+    // Or have 'done' called once, on the backend's thread, when it comes, with the
+    // time the backend noticed it
+    void Expect(int axis, Callback done);
+
+    // Forget an armed axis, e.g. when starting the motion failed. False if it was
+    // no longer armed, i.e. its end has already been signalled.
+    bool Disarm(int axis);
+
+    // True once the armed axis has stopped normally; false on failure or timeout
+    bool Wait(int axis, std::chrono::milliseconds timeout);
+
+    const LatencyHistogram& Latency() const { return m_latency; }
+    LatencyHistogram& Latency() { return m_latency; }
+
+protected:
+    // For backends: the axes in axisMask have stopped, or failed to
+    void Signal(std::uint64_t axisMask, bool succeeded);
+
+    std::uint64_t ArmedAxes() const;
+
+    // Called after an axis is armed, with no lock held
+    virtual void OnArmed() {}
+
+private:
+    struct Slot {
+        bool Signalled = false;
+        bool Succeeded = false;
+        Clock::time_point SignalTime;
+        Callback Done;
+        std::condition_variable Ready;
+    };
+
+    mutable std::mutex m_mutex;
+    std::array<Slot, MaxAxes> m_slots;
+    std::uint64_t m_armed = 0;
+    LatencyHistogram m_latency;
+};
+
+// ACS SPiiPlus backend: the controller's physical-motion-end and motion-failure
+// interrupts, through AcsController::SetMotionEndHandler
+class AcsMotionEndNotifier : public MotionEndNotifier {
+public:
+    ~AcsMotionEndNotifier() override;
+
+    bool Attach(AcsController& controller, std::uint64_t axisMask);
+
+    // Remove the handler; anyone still waiting is told the motion failed
+    void Detach();
+
+private:
+    AcsController* m_controller = nullptr;
+};
+
+// For controllers without interrupts, such as PI GCS: one thread per controller
+// asks which armed axes have stopped, and only while any are armed. Latency is
+// measured from the poll that sees the end, so add up to one period to it.
+class PolledMotionEndNotifier : public MotionEndNotifier {
+public:
+    // Given the armed axes, return those that have stopped (e.g. from ONT?), or
+    // nullopt if the controller couldn't be read, which fails every armed axis
+    using StatusQuery = std::function<std::optional<std::uint64_t>(std::uint64_t armedAxes)>;
+
+    PolledMotionEndNotifier(StatusQuery query, std::chrono::microseconds period);
+    ~PolledMotionEndNotifier() override;
+
+private:
+    void OnArmed() override;
+    void Loop();
+
+    StatusQuery m_query;
+    std::chrono::microseconds m_period;
+    std::mutex m_pollMutex;
+    std::condition_variable m_pollWake;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
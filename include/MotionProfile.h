@@ -0,0 +1,104 @@
+// MotionProfile.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "Span.h"
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+// Kinematic limits of one group of axes
+struct AxisLimits {
+    double Velocity = 0.0;
+    double Acceleration = 0.0;
+    double Jerk = 0.0;  // 0 means unlimited, i.e. a trapezoidal profile
+};
+
+// Limits of a device. Linear axes (x, y, z) are in mm, rotational axes (u, v, w) in degrees.
+struct MotionLimits {
+    AxisLimits Linear;
+    AxisLimits Rotational;
+
+    // DefaultSpeed and DefaultAcceleration for both groups, no jerk limit
+    static MotionLimits FromSettings(const Settings& settings);
+};
+
+// Rest-to-rest move along a straight path under velocity, acceleration and jerk limits.
+// Phases follow the seven-segment S-curve: jerk up, constant acceleration, jerk down,
+// cruise, then the same three mirrored for deceleration. A trapezoid has no jerk phases;
+// a short move has no cruise (and possibly no constant-acceleration) phase.
+struct MoveProfile {
+    double Distance = 0.0;
+    double Duration = 0.0;             // Seconds; infinity if the limits don't allow motion
+    double PeakVelocity = 0.0;
+    double PeakAcceleration = 0.0;
+    std::array<double, 7> Phases{};    // Seconds per segment
+
+    double AccelerationTime() const { return Phases[0] + Phases[1] + Phases[2]; }
+    double CruiseTime() const { return Phases[3]; }
+    double DecelerationTime() const { return Phases[4] + Phases[5] + Phases[6]; }
+
+    static MoveProfile Plan(double distance, const AxisLimits& limits);
+};
+
+// Multi-axis point-to-point move. Linear and rotational axes each follow a vector
+// profile along their own straight line; both groups start and stop together, so the
+// slower one sets the duration and the other is stretched to match.
+struct MoveEstimate {
+    double Duration = 0.0;
+    MoveProfile Linear;
+    MoveProfile Rotational;
+    bool RotationLimited = false;  // The rotational group sets the duration
+};
+
+// Predicts move and cycle times without touching hardware.
+// Devices without limits of their own use the ones from Settings.
+class TrajectoryEstimator {
+public:
+    explicit TrajectoryEstimator(const Settings& settings = Settings());
+
+    void SetDefaultLimits(const MotionLimits& limits) { m_defaultLimits = limits; }
+    void SetDeviceLimits(const std::string& deviceName, const MotionLimits& limits);
+    const MotionLimits& LimitsFor(const std::string& deviceName) const;
+
+    MoveEstimate Estimate(const std::string& deviceName, const PositionStruct& from, const PositionStruct& to) const;
+    static MoveEstimate Estimate(const PositionStruct& from, const PositionStruct& to, const MotionLimits& limits);
+
+    // Durations only, for scoring many candidate moves at once: skips building the
+    // profiles and picks the jerk mode once per call. durations must be as long as from and to.
+    static void EstimateDurations(Span<const PositionStruct> from, Span<const PositionStruct> to,
+        const MotionLimits& limits, Span<double> durations);
+
+private:
+    MotionLimits m_defaultLimits;
+    std::map<std::string, MotionLimits> m_deviceLimits;
+};
+
+// One straight segment of a blended move
+struct BlendSegment {
+    PositionStruct Target;
+    double Distance = 0.0;     // Linear path length, mm
+    double EndVelocity = 0.0;  // Linear speed when passing Target, mm/s; 0 for a stop
+    double Seconds = 0.0;      // Estimated time from the previous point
+};
+
+// Multi-point move that passes intermediate points at speed instead of stopping.
+// The speed allowed at a corner keeps an acceleration-limited blend within the
+// corner's tolerance (junction deviation), and is then lowered where the segments
+// around it are too short to reach it or to stop after it. Only linear axes blend:
+// a segment that turns u, v or w starts and ends at rest. Jerk is left to the
+// controller, so Seconds follow trapezoidal profiles.
+class BlendedPath {
+public:
+    // tolerances[i] is the corner tolerance at points[i], in mm. The last point is
+    // always a full stop.
+    static std::vector<BlendSegment> Plan(const PositionStruct& start, const std::vector<PositionStruct>& points,
+        const std::vector<double>& tolerances, const MotionLimits& limits);
+
+    // Highest speed at which the path can turn at 'corner' within 'tolerance'
+    static double CornerVelocity(const PositionStruct& previous, const PositionStruct& corner, const PositionStruct& next,
+        double tolerance, const AxisLimits& limits);
+
+    static double TotalSeconds(const std::vector<BlendSegment>& segments);
+};
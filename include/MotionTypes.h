@@ -44,6 +44,7 @@ struct EdgeConditions {
     bool RequiresOperatorApproval = false;
     int TimeoutSeconds = 0;
     bool IsBidirectional = false;  // Add this new property
+    double CornerTolerance = 0.0;  // mm a blended move may cut the corner at the node it arrives at; 0 stops there
 };
 
 // Graph edge structure
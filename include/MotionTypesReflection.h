@@ -0,0 +1,94 @@
+// MotionTypesReflection.h
+#pragma once
+
+#include "JsonReflection.h"
+#include "MotionTypes.h"
+
+// JSON field tables for the structs in MotionTypes.h, as laid out in
+// motion_config.json. Keys match the member names except where the file
+// format predates them (see MotionDevice). Members added since are optional,
+// so files written without them are written back unchanged.
+
+template <>
+struct Reflect<PositionStruct> {
+    static constexpr auto Fields = std::make_tuple(
+        Field("x", &PositionStruct::x),
+        Field("y", &PositionStruct::y),
+        Field("z", &PositionStruct::z),
+        Field("u", &PositionStruct::u),
+        Field("v", &PositionStruct::v),
+        Field("w", &PositionStruct::w));
+};
+
+template <>
+struct Reflect<MotionDevice> {
+    static constexpr auto Fields = std::make_tuple(
+        Field("IsEnabled", &MotionDevice::IsEnabled),
+        Field("IpAddress", &MotionDevice::IpAddress),
+        Field("Port", &MotionDevice::Port),
+        Field("Id", &MotionDevice::Id),
+        Field("Name", &MotionDevice::Name),
+        Field("Positions", &MotionDevice::Positions),
+        Field("typeController", &MotionDevice::TypeController),
+        Field("installAxes", &MotionDevice::InstalledAxes));
+};
+
+template <>
+struct Reflect<Node> {
+    static constexpr auto Fields = std::make_tuple(
+        Field("Id", &Node::Id),
+        Field("Label", &Node::Label),
+        Field("Device", &Node::Device),
+        Field("Position", &Node::Position),
+        Field("X", &Node::X),
+        Field("Y", &Node::Y));
+};
+
+template <>
+struct Reflect<EdgeConditions> {
+    static constexpr auto Fields = std::make_tuple(
+        Field("RequiresOperatorApproval", &EdgeConditions::RequiresOperatorApproval),
+        Field("TimeoutSeconds", &EdgeConditions::TimeoutSeconds),
+        Field("IsBidirectional", &EdgeConditions::IsBidirectional),
+        OptionalField("CornerTolerance", &EdgeConditions::CornerTolerance));
+};
+
+template <>
+struct Reflect<Edge> {
+    static constexpr auto Fields = std::make_tuple(
+        Field("Id", &Edge::Id),
+        Field("Source", &Edge::Source),
+        Field("Target", &Edge::Target),
+        Field("Label", &Edge::Label),
+        Field("Conditions", &Edge::Conditions));
+};
+
+template <>
+struct Reflect<Graph> {
+    static constexpr auto Fields = std::make_tuple(
+        Field("Nodes", &Graph::Nodes),
+        Field("Edges", &Graph::Edges));
+};
+
+template <>
+struct Reflect<Settings> {
+    static constexpr auto Fields = std::make_tuple(
+        Field("DefaultSpeed", &Settings::DefaultSpeed),
+        Field("DefaultAcceleration", &Settings::DefaultAcceleration),
+        Field("LogLevel", &Settings::LogLevel),
+        Field("AutoReconnect", &Settings::AutoReconnect),
+        Field("ConnectionTimeout", &Settings::ConnectionTimeout),
+        Field("PositionTolerance", &Settings::PositionTolerance));
+};
+
+static_assert(Reflection::CheckFields<PositionStruct>());
+static_assert(Reflection::CheckFields<MotionDevice>());
+static_assert(Reflection::CheckFields<Node>());
+static_assert(Reflection::CheckFields<EdgeConditions>());
+static_assert(Reflection::CheckFields<Edge>());
+static_assert(Reflection::CheckFields<Graph>());
+static_assert(Reflection::CheckFields<Settings>());
+
+// Existing files spell these two keys differently from the members
+static_assert(Reflection::HasKey<MotionDevice>("typeController") && !Reflection::HasKey<MotionDevice>("TypeController"));
+static_assert(Reflection::HasKey<MotionDevice>("installAxes") && !Reflection::HasKey<MotionDevice>("InstalledAxes"));
@@ -0,0 +1,87 @@
+// PiGcsClient.h
+#pragma once
+
+#include <SFML/Network/SocketSelector.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+// Client for PI controllers speaking GCS 2.0 over TCP, such as the hexapods on
+// port 50000. The connection stays open, and each call below sends all of its
+// commands in one write and reads their replies back in order, so it costs a
+// single round trip: a move is "VEL ...\nMOV ...\nERR?\n". Commands and replies
+// go through fixed buffers and replies are parsed in place; nothing allocates
+// once connected, except on errors.
+//
+// Axes are given as a string of GCS identifiers such as "XYZUVW", with one value
+// per identifier, in that order. All calls are thread-safe. After an I/O error
+// or timeout the replies could be out of step, so the client disconnects.
+class PiGcsClient {
+public:
+    static constexpr std::size_t MaxAxes = 6;
+
+    PiGcsClient() = default;
+    ~PiGcsClient();
+
+    PiGcsClient(const PiGcsClient&) = delete;
+    PiGcsClient& operator=(const PiGcsClient&) = delete;
+
+    bool Connect(const std::string& address, unsigned short port,
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(2000));
+    void Disconnect();
+    bool IsConnected() const;
+
+    // MOV, preceded by VEL if velocities are given, then ERR?
+    bool Move(const char* axes, const double* targets, const double* velocities = nullptr);
+
+    // VEL, then ERR?
+    bool SetVelocity(const char* axes, const double* velocities);
+
+    // HLT, then ERR?, which reports the halt itself as error 10
+    bool Halt();
+
+    // POS? and ONT? together. Bit i of onTargetAxes is set if axes[i] is on target.
+    bool ReadStatus(const char* axes, double* positions, std::uint32_t& onTargetAxes);
+
+    // ONT? only
+    bool ReadOnTarget(const char* axes, std::uint32_t& onTargetAxes);
+
+    // Last nonzero ERR? answer
+    int ControllerError() const { return m_controllerError; }
+    const std::string& LastError() const { return m_lastError; }
+    std::uint64_t RoundTrips() const { return m_roundTrips; }
+
+    // Parse an "X=1.5 \nY=-2\n" reply into one value per axis; false if any is missing
+    static bool ParseAxisValues(std::string_view reply, const char* axes, double* values);
+
+private:
+    static constexpr std::size_t MaxReplies = 4;
+
+    // Caller holds m_mutex
+    bool Append(std::string_view text);
+    bool AppendAxisValues(std::string_view command, const char* axes, const double* values);
+    bool Exchange(std::size_t replies);   // Send the batch and read that many replies
+    bool CheckError(std::string_view reply, const char* operation, int tolerated = 0);
+    bool ParseOnTarget(std::string_view reply, const char* axes, std::uint32_t& onTargetAxes);
+    bool Fail(const std::string& message, bool disconnect);
+
+    mutable std::mutex m_mutex;
+    sf::TcpSocket m_socket;
+    sf::SocketSelector m_selector;
+    bool m_connected = false;
+    std::chrono::milliseconds m_timeout{ 2000 };
+
+    std::array<char, 1024> m_out{};
+    std::size_t m_outSize = 0;
+    std::array<char, 4096> m_in{};
+    std::array<std::string_view, MaxReplies> m_replies;
+
+    int m_controllerError = 0;
+    std::string m_lastError;
+    std::uint64_t m_roundTrips = 0;
+};
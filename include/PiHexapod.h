@@ -0,0 +1,83 @@
+// PiHexapod.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "MotionProfile.h"
+#include "GraphExecutor.h"
+#include "AsyncMotion.h"
+#include "DevicePoller.h"
+#include "MotionEndNotifier.h"
+#include "PiGcsClient.h"
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Hexapod on a PI controller (C-887 and alike), driven through PiGcsClient. The
+// controller has no motion queue, so a route is run one MOV per waypoint, each sent
+// once the previous one is on target; a PolledMotionEndNotifier asks ONT? for that.
+// Velocities come from the limits: Linear for X, Y, Z and Rotational for U, V, W.
+// Use either the blocking calls or the MotionDriver ones, not both at once.
+class PiHexapod : public MotionDriver, public StatusSource {
+public:
+    PiHexapod(const MotionDevice& device, const MotionLimits& limits,
+        std::chrono::microseconds onTargetPollPeriod = std::chrono::milliseconds(2));
+    ~PiHexapod();
+
+    PiHexapod(const PiHexapod&) = delete;
+    PiHexapod& operator=(const PiHexapod&) = delete;
+
+    bool Connect();
+    void Disconnect();
+    bool IsConnected() const { return m_client.IsConnected(); }
+
+    bool MoveTo(const PositionStruct& target);
+
+    // Move to every waypoint of a route in turn and wait until the last is on target
+    bool MoveAlong(const std::vector<MotionWaypoint>& route);
+
+    std::optional<PositionStruct> GetPosition() override;
+
+    // StatusSource: POS? and ONT? in one round trip; MovingAxes has the axes not on target
+    bool ReadStatus(DeviceStatus& status) override;
+
+    // MotionDriver: waypoints are sent from the notifier's thread
+    bool StartMove(const std::vector<MotionWaypoint>& route, Completion done) override;
+    void Halt() override;
+    LatencyHistogram* CompletionLatency() override { return &m_motionEnd.Latency(); }
+
+    // MoveAlong, for use as a GraphExecutor::MoveHandler
+    GraphExecutor::MoveHandler Handler() {
+        return [this](const MotionTask& task) { return MoveAlong(task.Route); };
+    }
+
+    const LatencyHistogram& MotionEndLatency() const { return m_motionEnd.Latency(); }
+    const PiGcsClient& Client() const { return m_client; }
+    const std::string& LastError() const { return m_client.LastError(); }
+
+private:
+    // The notifier's only axis stands for the whole hexapod
+    static constexpr int AllAxes = 0;
+
+    bool SendMove(const PositionStruct& target);
+    std::optional<std::uint64_t> QueryStopped();
+    void WaypointReached(bool succeeded, MotionEndNotifier::Clock::time_point signalled);
+
+    MotionDevice m_device;
+    MotionLimits m_limits;
+    std::string m_axes;                       // GCS identifiers of the installed axes
+    std::vector<std::size_t> m_coordinates;   // Index of each into PositionStruct
+    std::vector<double> m_velocities;
+
+    PiGcsClient m_client;
+
+    std::mutex m_moveMutex;
+    std::vector<MotionWaypoint> m_route;
+    std::size_t m_nextWaypoint = 0;
+    Completion m_done;
+    bool m_halted = false;
+
+    PolledMotionEndNotifier m_motionEnd;      // Last, so its thread stops first
+};
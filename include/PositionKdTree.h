@@ -0,0 +1,55 @@
+// PositionKdTree.h
+#pragma once
+
+#include "MotionTypes.h"
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+// Per-axis scale applied to coordinate differences before measuring distance,
+// in x, y, z, u, v, w order. Linear axes are in mm and rotational axes in degrees,
+// so the ratio between the two decides how much a degree counts against a mm.
+// A weight of 0 ignores the axis.
+struct AxisWeights {
+    std::array<double, 6> Axis{ 1.0, 1.0, 1.0, 1.0, 1.0, 1.0 };
+
+    // Installed linear axes get 'linear', installed rotational axes 'rotational'.
+    // Axes missing from MotionDevice::InstalledAxes get 0, since whatever is
+    // stored for them was never measured.
+    static AxisWeights ForDevice(const MotionDevice& device, double linear = 1.0, double rotational = 1.0);
+};
+
+// Static k-d tree over the taught positions of one device in six-axis space.
+// Splitting planes are axis-aligned, so weights only scale per-axis bounds and
+// can be chosen per query rather than at build time.
+class PositionKdTree {
+public:
+    struct Match {
+        std::uint32_t Index;  // Into the positions the tree was built from
+        double Distance;      // Weighted Euclidean
+    };
+
+    void Build(const std::vector<PositionStruct>& positions);
+
+    // Closest position no further than maxDistance, if any
+    std::optional<Match> Nearest(const PositionStruct& query, const AxisWeights& weights,
+        double maxDistance = std::numeric_limits<double>::infinity()) const;
+
+    std::size_t Size() const { return m_nodes.size(); }
+
+private:
+    // Implicit balanced layout: the node splitting [lo, hi) sits at (lo + hi) / 2
+    struct TreeNode {
+        std::array<double, 6> Point;
+        std::uint32_t Index;
+        std::uint8_t Axis;
+    };
+
+    void Build(std::size_t lo, std::size_t hi);
+    void Search(std::size_t lo, std::size_t hi, const std::array<double, 6>& query, const std::array<double, 6>& weights,
+        double& bestSquared, std::uint32_t& best) const;
+
+    std::vector<TreeNode> m_nodes;
+};
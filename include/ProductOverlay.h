@@ -0,0 +1,32 @@
+// ProductOverlay.h
+#pragma once
+
+#include "MotionTypes.h"
+#include <map>
+#include <string>
+#include <vector>
+
+// Position overrides for one product variant, layered over motion_config.json.
+// Overlay files use the motion_config.json layout, but only positions are taken:
+//   { "MotionDevices": { "gantry-main": { "Positions": { "dispense1": { ... } } } } }
+// Several files can be stacked, later ones winning. The layers are merged once on
+// load, and the configuration applies the result to its devices when the product is
+// selected, so lookups never consult the layers.
+struct ProductOverlay {
+    std::string Product;
+    std::vector<std::string> LayerPaths;
+    std::map<std::string, std::map<std::string, PositionStruct>> Positions;  // Device -> position -> value
+
+    // Throws std::runtime_error if a layer can't be read or parsed
+    static ProductOverlay Load(const std::string& product, const std::vector<std::string>& layerPaths);
+
+    bool Overrides(const std::string& deviceName) const { return Positions.count(deviceName) > 0; }
+
+    // Base device with this product's positions applied
+    MotionDevice Apply(const std::string& deviceName, const MotionDevice& base) const;
+
+    // Inverse of Apply for a device edited through the flattened view: positions still
+    // holding this product's value get the base value back (or are dropped if the base
+    // doesn't have them), so the overrides don't leak into the base file
+    MotionDevice Strip(const std::string& deviceName, MotionDevice edited, const MotionDevice* base) const;
+};
@@ -0,0 +1,71 @@
+// PvtFeeder.h
+#pragma once
+
+#include "AcsController.h"
+#include "TrajectoryPath.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct PvtFeederStats {
+    std::size_t Points = 0;          // Sent so far
+    std::size_t TotalPoints = 0;
+    double Period = 0.0;             // Seconds between points
+    int BufferSize = 0;              // Points the controller took before Go
+    int LowestQueued = -1;           // Fewest points found waiting at a top-up
+    std::size_t Refills = 0;         // Top-ups that sent anything
+    std::size_t Underruns = 0;       // Top-ups that found the buffer empty
+    double Seconds = 0.0;            // From Go to the last point sent
+    double PointsPerSecond = 0.0;    // Points sent over Seconds
+    double MeanAddMicroseconds = 0.0;
+    double MaxAddMicroseconds = 0.0;
+};
+
+// Streams a TrajectoryPath to the linear axes of an ACS controller as a PV spline.
+// A producer thread fills the controller's point buffer before Go and then tops it
+// up, so the axes move continuously from the first point to the last. The axes
+// must already be at the start of the path.
+class PvtFeeder {
+public:
+    // Controller axes 0, 1, 2 for x, y, z, terminated by -1
+    PvtFeeder(AcsController& controller, std::vector<int> axes);
+    ~PvtFeeder();
+
+    PvtFeeder(const PvtFeeder&) = delete;
+    PvtFeeder& operator=(const PvtFeeder&) = delete;
+
+    // Points at most 'period' seconds apart. The buffer is topped up every 'refill',
+    // by default a quarter of the time it holds. False if already streaming or the
+    // path has no points.
+    bool Start(const TrajectoryPath& path, double period, std::chrono::microseconds refill = {});
+
+    // Until every point is sent and the sequence ended; false if that failed or
+    // was stopped
+    bool Wait();
+
+    // Stop sending and halt the axes
+    void Stop();
+
+    PvtFeederStats Stats() const;
+    std::string LastError() const;
+
+private:
+    void Run(TrajectoryPath path, double period, std::chrono::microseconds refill);
+    bool Send(const TrajectoryPath& path, std::size_t count);
+    bool Fail(const std::string& operation);
+
+    AcsController& m_controller;
+    std::vector<int> m_axes;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+    bool m_succeeded = false;
+    PvtFeederStats m_stats;
+    std::string m_lastError;
+    std::thread m_thread;
+};
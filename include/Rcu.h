@@ -0,0 +1,59 @@
+// Rcu.h
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+// Read-copy-update support.
+// Readers mark a short read-side critical section with Rcu::ReadGuard; entering
+// and leaving it is a single store to a per-thread slot, with no locks.
+// Writers publish a new value and call Rcu::Synchronize() to wait until every
+// reader that could still see the old value has left its critical section.
+namespace Rcu {
+
+class ReadGuard {
+public:
+    ReadGuard();
+    ~ReadGuard();
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+};
+
+// Wait for all pre-existing read-side critical sections to finish.
+// Must not be called from inside a ReadGuard.
+void Synchronize();
+
+} // namespace Rcu
+
+// Atomically published, immutable value.
+// Load() hands out a reference-counted pointer without taking a lock.
+// Publish() must be serialized by the caller.
+template <typename T>
+class RcuPointer {
+public:
+    RcuPointer() = default;
+    ~RcuPointer() { delete m_current.load(); }
+
+    RcuPointer(const RcuPointer&) = delete;
+    RcuPointer& operator=(const RcuPointer&) = delete;
+
+    std::shared_ptr<const T> Load() const {
+        Rcu::ReadGuard guard;
+        const std::shared_ptr<const T>* holder = m_current.load();
+        return holder ? *holder : nullptr;
+    }
+
+    void Publish(std::shared_ptr<const T> value) {
+        auto* holder = new std::shared_ptr<const T>(std::move(value));
+        const std::shared_ptr<const T>* previous = m_current.exchange(holder);
+        if (previous) {
+            // Readers may still be copying the old holder; free it after a grace period.
+            // The value itself lives on for as long as readers hold references to it.
+            Rcu::Synchronize();
+            delete previous;
+        }
+    }
+
+private:
+    std::atomic<const std::shared_ptr<const T>*> m_current{ nullptr };
+};
@@ -0,0 +1,64 @@
+// Seqlock.h
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single-writer sequence lock for small, trivially copyable values.
+// Store() never waits; Load() takes no lock and retries while a store is in
+// progress, so readers never block the writer or each other. The value is kept
+// in relaxed atomic words, which makes the torn reads that are retried well defined.
+template <typename T>
+class Seqlock {
+    static_assert(std::is_trivially_copyable<T>::value, "Seqlock needs a trivially copyable value");
+
+public:
+    Seqlock() { Store(T{}); }
+
+    // One writer at a time
+    void Store(const T& value) {
+        Words words{};
+        std::memcpy(words.data(), &value, sizeof(T));
+        const std::uint64_t sequence = m_sequence.load(std::memory_order_relaxed);
+        m_sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < WordCount; ++i) {
+            m_words[i].store(words[i], std::memory_order_relaxed);
+        }
+        m_sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    T Load() const {
+        Words words;
+        for (;;) {
+            const std::uint64_t before = m_sequence.load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            for (std::size_t i = 0; i < WordCount; ++i) {
+                words[i] = m_words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == before) {
+                break;
+            }
+        }
+        T value;
+        std::memcpy(static_cast<void*>(&value), words.data(), sizeof(T));
+        return value;
+    }
+
+    // Number of completed stores, not counting the initial value
+    std::uint64_t Version() const { return m_sequence.load(std::memory_order_acquire) / 2 - 1; }
+
+private:
+    static constexpr std::size_t WordCount = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+    using Words = std::array<std::uint64_t, WordCount>;
+
+    std::atomic<std::uint64_t> m_sequence{ 0 };
+    std::array<std::atomic<std::uint64_t>, WordCount> m_words{};
+};
@@ -0,0 +1,194 @@
+// SimulatedAcsController.h
+#pragma once
+
+#include "AcsController.h"
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SimulatedGantrySettings {
+    double MaxVelocity = 200.0;      // Per move, also the ToPoint velocity; units/s
+    double Acceleration = 1000.0;    // units/s^2, the same for speeding up and slowing down
+
+    // Simulated seconds per real second. 0 runs as fast as the client keeps up:
+    // time jumps to the next event (a motion end, a spline point reached) once
+    // neither a call nor an event has happened for SettleTime.
+    double TimeScale = 1.0;
+    std::chrono::microseconds SettleTime{ 300 };
+
+    // Simulated time every call takes, like a round trip to the controller
+    double CallLatency = 0.0;
+
+    int PvBufferSize = 50;           // PV spline points the controller holds
+
+    // After a motion comes to rest the feedback position rings about the target: it
+    // starts SettleAmplitude past it in the direction of travel and oscillates at
+    // SettleFrequency, dying away with SettleTimeConstant. PE is RPOS - FPOS.
+    double SettleAmplitude = 0.0;
+    double SettleFrequency = 40.0;
+    double SettleTimeConstant = 0.02;
+};
+
+// In-process stand-in for an ACS controller with up to 8 axes. Queued motions run
+// one after the other along straight lines with trapezoidal velocity profiles;
+// positions are computed from simulated time, never integrated, so a run in which
+// the client issues the same calls gives the same positions and times. A motion
+// with an end velocity runs straight into the next one if it is queued in time;
+// otherwise the axes stop at its end and an underrun is counted.
+// A PV spline runs cubic Hermite segments between its points. If its buffer runs dry
+// before EndSequence the axes hold at the last point, an underrun is counted, and the
+// next point added starts a new segment from there.
+// Data collection samples FPOS, RPOS, PE and AIN (always 0) of any axis, in
+// simulated time.
+// Motion-end handlers run on the simulator's thread, once per completed motion.
+class SimulatedAcsController : public AcsController {
+public:
+    static constexpr int AxisCount = 8;
+
+    explicit SimulatedAcsController(const SimulatedGantrySettings& settings = SimulatedGantrySettings());
+    ~SimulatedAcsController() override;
+
+    SimulatedAcsController(const SimulatedAcsController&) = delete;
+    SimulatedAcsController& operator=(const SimulatedAcsController&) = delete;
+
+    bool Open(const std::string& address, int port) override;
+    void Close() override;
+    bool IsOpen() const override;
+
+    bool Enable(const int* axes) override;
+    bool ToPoint(const int* axes, const double* point) override;
+    bool ExtToPoint(const int* axes, const double* point, double velocity, double endVelocity) override;
+    bool Halt(const int* axes) override;
+    bool Spline(const int* axes, double periodMs) override;
+    bool AddPVPoint(const int* axes, const double* point, const double* velocity) override;
+    bool EndSequence(const int* axes) override;
+    bool Go(const int* axes) override;
+    bool GetFPosition(int axis, double& position) override;
+    bool GetMotorState(int axis, int& state) override;
+    bool ReadReal(const char* variable, int from, int to, double* values) override;
+    bool ReadInteger(const char* variable, int from, int to, int* values) override;
+    bool ReadRealMatrix(const char* variable, int fromRow, int toRow, int fromColumn, int toColumn, double* values) override;
+    bool StartCollection(const char* array, int samples, double periodMs, const char* variables) override;
+    bool StopCollection() override;
+    bool WaitMotionEnd(int axis, int timeoutMs) override;
+    bool SetMotionEndHandler(std::uint64_t axisMask, MotionEndHandler handler) override;
+    std::string LastError() override;
+
+    // Simulated seconds since construction
+    double Now() const;
+
+    // Place an axis without moving it, e.g. at a taught home position
+    void SetPosition(int axis, double position);
+
+    std::uint64_t Calls() const;
+    std::uint64_t Underruns() const;
+
+private:
+    struct Motion {
+        std::uint32_t Axes = 0;
+        std::array<double, AxisCount> From{};
+        std::array<double, AxisCount> To{};
+        double Length = 0.0;
+        double Start = 0.0;            // Simulated time
+        double StartVelocity = 0.0;
+        double PeakVelocity = 0.0;
+        double EndVelocity = 0.0;
+        double Acceleration = 0.0;
+        double AccelerationTime = 0.0;
+        double CruiseTime = 0.0;
+        double DecelerationTime = 0.0;
+
+        double End() const { return Start + AccelerationTime + CruiseTime + DecelerationTime; }
+        double Distance(double time) const;   // Along the path, time since Start
+    };
+
+    struct PvSample {
+        std::array<double, AxisCount> Position{};
+        std::array<double, AxisCount> Velocity{};
+    };
+
+    struct PvSpline {
+        std::uint32_t Axes = 0;
+        bool Started = false;          // Go
+        bool Ended = false;            // EndSequence
+        bool Starved = false;          // Ran out of points before EndSequence
+        double Period = 0.0;           // Simulated seconds per segment
+        double SegmentStart = 0.0;
+        PvSample From;                 // Where the current segment starts
+        std::deque<PvSample> Points;
+    };
+
+    enum class Quantity { FeedbackPosition, ReferencePosition, PositionError, AnalogInput };
+
+    struct Collection {
+        std::string Array;
+        std::vector<std::pair<Quantity, int>> Rows;   // And the axis or input
+        int Capacity = 0;
+        double Period = 0.0;
+        double Start = 0.0;
+        int Collected = 0;
+        bool Active = false;
+        std::vector<double> Values;                   // Row by row, Capacity each
+    };
+
+    // The last time each axis came to rest, for the ringing after it
+    struct Stop {
+        double Time = 0.0;
+        double Direction = 0.0;    // Of travel along the axis, -1..1
+    };
+
+    // Caller holds m_mutex
+    double NowLocked() const;
+    void Call(std::unique_lock<std::mutex>& lock);
+    bool Fail(const std::string& message);
+    bool ValidAxes(const int* axes, std::uint32_t& mask);
+    double PositionAt(int axis, double time) const;     // Reference
+    double FeedbackAt(int axis, double time) const;
+    double Sample(Quantity quantity, int index, double time) const;
+    void Collect(double now);
+    void Rest(int axis, double time, double direction);
+    std::uint32_t MovingAxes() const;
+    bool SplineAxes(const int* axes, std::uint32_t& mask);
+    std::optional<double> NextEvent() const;
+    std::uint32_t AdvanceSpline();
+    void Plan(Motion& motion, double velocity, double endVelocity);
+
+    void Loop();
+
+    const SimulatedGantrySettings m_settings;
+    const std::chrono::steady_clock::time_point m_realStart = std::chrono::steady_clock::now();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;      // Simulator thread
+    std::condition_variable m_ended;     // WaitMotionEnd
+    bool m_open = false;
+    bool m_stopping = false;
+    std::string m_lastError;
+
+    double m_virtualNow = 0.0;           // TimeScale 0 only
+    std::chrono::steady_clock::time_point m_lastCall;
+    std::chrono::steady_clock::time_point m_lastEvent;
+
+    std::array<double, AxisCount> m_positions{};
+    std::deque<Motion> m_motions;        // Queued and running, in order
+    std::optional<PvSpline> m_spline;
+    std::uint32_t m_enabled = 0;
+    std::array<Stop, AxisCount> m_stops{};
+    std::optional<Collection> m_collection;
+
+    MotionEndHandler m_handler;
+    std::uint64_t m_handlerMask = 0;
+    bool m_inHandler = false;
+
+    std::uint64_t m_calls = 0;
+    std::uint64_t m_underruns = 0;
+
+    std::thread m_thread;
+};
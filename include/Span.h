@@ -0,0 +1,23 @@
+// Span.h
+#pragma once
+
+#include <cstddef>
+
+// Minimal non-owning view over a contiguous range (std::span is C++20)
+template <typename T>
+class Span {
+public:
+    Span() = default;
+    Span(T* data, std::size_t size) : m_data(data), m_size(size) {}
+
+    T* begin() const { return m_data; }
+    T* end() const { return m_data + m_size; }
+    T& operator[](std::size_t i) const { return m_data[i]; }
+    T* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+private:
+    T* m_data = nullptr;
+    std::size_t m_size = 0;
+};
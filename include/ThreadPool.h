@@ -0,0 +1,41 @@
+// ThreadPool.h
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads draining a FIFO task queue
+class ThreadPool {
+public:
+    // 0 picks one thread per hardware thread
+    explicit ThreadPool(std::size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Process-wide pool for short CPU-bound work
+    static ThreadPool& Shared();
+
+    std::size_t Size() const { return m_workers.size(); }
+
+    void Submit(std::function<void()> task);
+
+    // Run body(i) for every i in [0, count) and wait for all of them.
+    // The calling thread takes part, so this is safe to call from a worker.
+    void ParallelFor(std::size_t count, const std::function<void(std::size_t)>& body);
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_taskAvailable;
+    bool m_stopping = false;
+};
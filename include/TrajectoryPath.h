@@ -0,0 +1,71 @@
+// TrajectoryPath.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "MotionProfile.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Position and velocity of the linear axes at one instant of a path
+struct PvPoint {
+    PositionStruct Position;
+    PositionStruct Velocity;   // mm/s
+};
+
+// A path of the linear axes (x, y, z) as a function of time, for streaming to a
+// controller as position/velocity points a fixed period apart. Paths built from a
+// curve start and end at rest and keep to the limits: the tangential and the
+// centripetal acceleration each stay within limits.Acceleration and the speed within
+// limits.Velocity.
+class TrajectoryPath {
+public:
+    using Function = std::function<PositionStruct(double seconds)>;
+    using Curve = std::function<PositionStruct(double u)>;   // u from 0 to 1
+
+    // A path already timed by the caller. Without 'velocity' it is the central
+    // difference of 'position'.
+    TrajectoryPath(Function position, double duration, Function velocity = nullptr);
+
+    // Any curve, timed as fast as the limits allow. It is sampled about every
+    // 'resolution' mm to find its length and curvature.
+    static TrajectoryPath FromCurve(const Curve& curve, const AxisLimits& limits, double resolution = 0.05);
+
+    // Serpentine over a rectangle from 'corner', width along x and height along y,
+    // lines lineSpacing apart joined by semicircles that reach lineSpacing / 2 past
+    // the rectangle's ends
+    static TrajectoryPath Raster(const PositionStruct& corner, double width, double height, double lineSpacing,
+        const AxisLimits& limits);
+
+    // Archimedean spiral in the xy plane from 'center' out to 'radius', turns
+    // 'pitch' apart
+    static TrajectoryPath Spiral(const PositionStruct& center, double radius, double pitch, const AxisLimits& limits);
+
+    double Duration() const { return m_duration; }
+    PvPoint At(double seconds) const;
+
+    // Points 1..Count(period) of a stream: evenly spaced, no more than 'period'
+    // apart, the last one at Duration(). Point 0 is At(0), where the axes start.
+    std::size_t PointCount(double period) const;
+    double PointPeriod(double period) const;
+
+private:
+    // Speed along a sampled curve: Speed[k] at Length[k], reached at Time[k], in the
+    // direction of Tangent[k]
+    struct Timing {
+        Curve Shape;
+        std::vector<double> Parameter;
+        std::vector<PositionStruct> Tangent;
+        std::vector<double> Length;
+        std::vector<double> Speed;
+        std::vector<double> Time;
+    };
+
+    TrajectoryPath() = default;
+    PvPoint AtTiming(double seconds) const;
+
+    Function m_position;
+    Function m_velocity;
+    std::shared_ptr<const Timing> m_timing;
+    double m_duration = 0.0;
+};
@@ -0,0 +1,45 @@
+// TravelTimeTable.h
+#pragma once
+
+#include "MotionTypes.h"
+#include "MotionConfigIndex.h"
+#include <cstdint>
+#include <vector>
+
+// All-pairs shortest travel time for one graph, stored as a next-hop table.
+// Edge cost is the estimated move duration between the two nodes' positions.
+// Graphs larger than MaxNodes are not tabulated; FindPath then searches per query.
+class TravelTimeTable {
+public:
+    // A table holds a next hop and a cost per node pair, 48 MB at this size
+    static constexpr std::size_t MaxNodes = 2048;
+
+    // Estimated duration of a point-to-point move with the Settings limits (see TrajectoryEstimator).
+    // Linear (x, y, z) and rotational (u, v, w) axes move together, so the slower group wins.
+    static double EstimateMoveTime(const PositionStruct& from, const PositionStruct& to, const Settings& settings);
+
+    // Cost of every CSR adjacency entry of the graph (parallel to GraphIndex::AdjacencyNodes).
+    // Hops between nodes that don't resolve to positions on the same device cost only a
+    // negligible per-hop penalty.
+    static std::vector<double> AdjacencyCosts(const GraphIndex& graph, const MotionConfigIndex& index, const Settings& settings);
+
+    // Single-source search used when no table is available
+    static std::vector<std::uint32_t> ShortestPath(const GraphIndex& graph, const std::vector<double>& costs,
+        std::uint32_t start, std::uint32_t end);
+
+    void Build(const GraphIndex& graph, const MotionConfigIndex& index, const Settings& settings);
+    void Clear();
+
+    bool IsBuilt() const { return m_nodeCount > 0; }
+
+    // Next node on the fastest route from 'from' to 'to', or InvalidIndex if unreachable
+    std::uint32_t NextHop(std::uint32_t from, std::uint32_t to) const { return m_nextHop[from * m_nodeCount + to]; }
+
+    // Total estimated travel time, or infinity if unreachable
+    double Cost(std::uint32_t from, std::uint32_t to) const { return m_cost[from * m_nodeCount + to]; }
+
+private:
+    std::size_t m_nodeCount = 0;
+    std::vector<std::uint32_t> m_nextHop;
+    std::vector<double> m_cost;
+};
@@ -0,0 +1,343 @@
+#include "AcsGantry.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <iostream>
+
+namespace {
+
+double& Coordinate(PositionStruct& position, int axis) {
+    return axis == 0 ? position.x : axis == 1 ? position.y : position.z;
+}
+
+double Coordinate(const PositionStruct& position, int axis) {
+    return axis == 0 ? position.x : axis == 1 ? position.y : position.z;
+}
+
+// Installed linear axes, terminated by -1
+std::vector<int> ControllerAxes(const MotionDevice& device) {
+    std::vector<int> axes;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (char c : device.InstalledAxes) {
+            if (std::toupper(static_cast<unsigned char>(c)) == "XYZ"[axis]) {
+                axes.push_back(axis);
+                break;
+            }
+        }
+    }
+    axes.push_back(-1);
+    return axes;
+}
+
+} // namespace
+
+AcsGantry::AcsGantry(const MotionDevice& device, const MotionLimits& limits)
+    : m_device(device),
+      m_limits(limits),
+      m_axes(ControllerAxes(device)),
+      m_ownedController(std::make_unique<AcsLibraryController>()),
+      m_controller(*m_ownedController) {
+}
+
+AcsGantry::AcsGantry(const MotionDevice& device, const MotionLimits& limits, AcsController& controller)
+    : m_device(device), m_limits(limits), m_axes(ControllerAxes(device)), m_controller(controller) {
+}
+
+AcsGantry::~AcsGantry() {
+    Disconnect();
+}
+
+bool AcsGantry::MoveTo(const PositionStruct& target) {
+    MotionWaypoint waypoint;
+    waypoint.Target = target;
+    return MoveAlong({ waypoint }, false);
+}
+
+bool AcsGantry::MoveAlong(const std::vector<MotionWaypoint>& route, bool blended) {
+    // Armed before the move starts so a short one can't end unnoticed
+    m_motionEnd.Arm(LeadAxis());
+    BeginCollection();
+    std::optional<double> seconds = QueueRoute(route, blended);
+    if (!seconds) {
+        m_motionEnd.Disarm(LeadAxis());
+        EndCollection();
+        return false;
+    }
+    const bool reached = WaitForMotionEnd(*seconds);
+    EndCollection();
+    return reached;
+}
+
+bool AcsGantry::StreamPath(const TrajectoryPath& path, double period, PvtFeederStats* stats) {
+    if (!MoveTo(path.At(0.0).Position)) {
+        return false;
+    }
+    PvtFeeder feeder(m_controller, m_axes);
+    // The whole spline is one motion on the controller
+    m_motionEnd.Arm(LeadAxis());
+    BeginCollection();
+    if (!feeder.Start(path, period)) {
+        m_motionEnd.Disarm(LeadAxis());
+        EndCollection();
+        SetError(m_device.Name + ": nothing to stream");
+        return false;
+    }
+    const bool fed = feeder.Wait();
+    if (stats) {
+        *stats = feeder.Stats();
+    }
+    if (!fed) {
+        m_motionEnd.Disarm(LeadAxis());
+        EndCollection();
+        SetError(m_device.Name + ": " + feeder.LastError());
+        return false;
+    }
+    const bool reached = WaitForMotionEnd(path.Duration());
+    EndCollection();
+    return reached;
+}
+
+bool AcsGantry::StartMove(const std::vector<MotionWaypoint>& route, Completion done) {
+    {
+        std::lock_guard<std::mutex> lock(m_haltMutex);
+        m_halted = false;
+    }
+    m_motionEnd.Expect(LeadAxis(), [this, done](bool succeeded, MotionEndNotifier::Clock::time_point signalled) {
+        MotionEnded(succeeded, signalled, done);
+    });
+    BeginCollection();
+    if (!QueueRoute(route, true)) {
+        m_motionEnd.Disarm(LeadAxis());
+        EndCollection();
+        return false;
+    }
+    return true;
+}
+
+void AcsGantry::Halt() {
+    {
+        std::lock_guard<std::mutex> lock(m_haltMutex);
+        m_halted = true;
+    }
+    m_controller.Halt(m_axes.data());
+}
+
+bool AcsGantry::WaitForMotionEnd(double estimatedSeconds) {
+    // Twice the estimate plus some slack before giving up on the controller
+    const auto deadline = std::chrono::steady_clock::now() +
+        std::chrono::milliseconds(static_cast<long long>((2.0 * estimatedSeconds + 5.0) * 1000.0));
+    for (;;) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (!m_motionEnd.Wait(LeadAxis(), std::max(left, std::chrono::milliseconds(0)))) {
+            const std::string error = m_device.Name + ": motion failed or did not end in time";
+            SetError(error);
+            std::cerr << error << std::endl;
+            m_controller.Halt(m_axes.data());
+            return false;
+        }
+        // Every blended segment ends a motion on the controller; wait for the last one
+        m_motionEnd.Arm(LeadAxis());
+        std::optional<bool> moving = IsMoving();
+        if (!moving || !*moving) {
+            m_motionEnd.Disarm(LeadAxis());
+            return moving.has_value();
+        }
+    }
+}
+
+void AcsGantry::MotionEnded(bool succeeded, MotionEndNotifier::Clock::time_point signalled, Completion done) {
+    if (succeeded) {
+        // As in WaitForMotionEnd, only the end of the last segment counts
+        m_motionEnd.Expect(LeadAxis(), [this, done](bool next, MotionEndNotifier::Clock::time_point nextSignalled) {
+            MotionEnded(next, nextSignalled, done);
+        });
+        std::optional<bool> moving = IsMoving();
+        if (moving && *moving) {
+            return;
+        }
+        if (!m_motionEnd.Disarm(LeadAxis())) {
+            return;  // Ended meanwhile; that call reports it
+        }
+        succeeded = moving.has_value();
+    }
+
+    bool halted = false;
+    {
+        std::lock_guard<std::mutex> lock(m_haltMutex);
+        std::swap(halted, m_halted);
+    }
+    // Stopped short of the target
+    if (halted) {
+        succeeded = false;
+    }
+    EndCollection();
+    done(succeeded, succeeded ? std::string() : m_device.Name + " halted or failed: " + LastError(), signalled);
+}
+
+// Collection is armed before the move is queued so it holds the whole move. A
+// collector that fails only costs the record, not the move.
+void AcsGantry::BeginCollection() {
+    const std::uint64_t moveId = ++m_moveId;
+    DataCollector* collector = m_collector;
+    if (collector && !collector->Begin(moveId)) {
+        std::cerr << m_device.Name << ": no data collected for move " << moveId << ": " << collector->LastError() << std::endl;
+    }
+}
+
+void AcsGantry::EndCollection() {
+    if (DataCollector* collector = m_collector) {
+        collector->End();
+    }
+}
+
+std::optional<double> AcsGantry::QueueRoute(const std::vector<MotionWaypoint>& route, bool blended) {
+    if (!IsConnected()) {
+        SetError(m_device.Name + " is not connected");
+        return std::nullopt;
+    }
+    if (route.empty()) {
+        return 0.0;
+    }
+    std::optional<PositionStruct> start = GetPosition();
+    if (!start) {
+        return std::nullopt;
+    }
+
+    // Plan over the axes this driver moves; the others stay where they are
+    std::vector<PositionStruct> points;
+    std::vector<double> tolerances;
+    for (const MotionWaypoint& waypoint : route) {
+        PositionStruct point = *start;
+        for (std::size_t i = 0; m_axes[i] >= 0; ++i) {
+            Coordinate(point, m_axes[i]) = Coordinate(waypoint.Target, m_axes[i]);
+        }
+        points.push_back(point);
+        tolerances.push_back(blended ? waypoint.CornerTolerance : 0.0);
+    }
+    const std::vector<BlendSegment> segments = BlendedPath::Plan(*start, points, tolerances, m_limits);
+
+    // The controller queues motions per axis, so a segment with an end velocity runs
+    // straight into the next one
+    for (std::size_t s = 0; s < segments.size(); ++s) {
+        const BlendSegment& segment = segments[s];
+        std::vector<double> point;
+        for (std::size_t i = 0; m_axes[i] >= 0; ++i) {
+            point.push_back(Coordinate(segment.Target, m_axes[i]));
+        }
+        if (!m_controller.ExtToPoint(m_axes.data(), point.data(), m_limits.Linear.Velocity, segment.EndVelocity)) {
+            Fail("start move");
+            // The segments already queued end moving, into one that never came
+            if (s > 0) {
+                m_controller.Halt(m_axes.data());
+            }
+            return std::nullopt;
+        }
+    }
+    return BlendedPath::TotalSeconds(segments);
+}
+
+bool AcsGantry::Connect() {
+    if (IsConnected()) {
+        return true;
+    }
+    // Without a lead axis no motion end could ever be reported
+    if (m_axes.front() < 0) {
+        const std::string error = m_device.Name + ": no X, Y or Z axis in InstalledAxes \"" + m_device.InstalledAxes + "\"";
+        SetError(error);
+        std::cerr << error << std::endl;
+        return false;
+    }
+    if (!m_controller.Open(m_device.IpAddress, m_device.Port)) {
+        return Fail("connect to " + m_device.IpAddress + ":" + std::to_string(m_device.Port));
+    }
+    if (!m_controller.Enable(m_axes.data())) {
+        Fail("enable axes");
+        Disconnect();
+        return false;
+    }
+    std::uint64_t axisMask = 0;
+    for (std::size_t i = 0; m_axes[i] >= 0; ++i) {
+        axisMask |= std::uint64_t(1) << m_axes[i];
+    }
+    if (!m_motionEnd.Attach(m_controller, axisMask)) {
+        Fail("install motion interrupts");
+        Disconnect();
+        return false;
+    }
+    return true;
+}
+
+void AcsGantry::Disconnect() {
+    m_motionEnd.Detach();
+    m_controller.Close();
+}
+
+std::optional<PositionStruct> AcsGantry::GetPosition() {
+    PositionStruct position;
+    if (!ReadAxes(&position, nullptr)) {
+        return std::nullopt;
+    }
+    return position;
+}
+
+bool AcsGantry::ReadStatus(DeviceStatus& status) {
+    return ReadAxes(&status.Position, &status.MovingAxes);
+}
+
+bool AcsGantry::ReadAxes(PositionStruct* position, std::uint32_t* movingAxes) {
+    // The driven axes lie within one range of the controller's per-axis arrays
+    if (m_axes.size() < 2) {
+        return true;
+    }
+    const int first = m_axes.front();
+    const int last = m_axes[m_axes.size() - 2];
+    if (position) {
+        double values[3] = {};
+        if (!m_controller.ReadReal("FPOS", first, last, values)) {
+            return Fail("read FPOS");
+        }
+        for (std::size_t i = 0; m_axes[i] >= 0; ++i) {
+            Coordinate(*position, m_axes[i]) = values[m_axes[i] - first];
+        }
+    }
+    if (movingAxes) {
+        int values[3] = {};
+        if (!m_controller.ReadInteger("MST", first, last, values)) {
+            return Fail("read MST");
+        }
+        *movingAxes = 0;
+        for (std::size_t i = 0; m_axes[i] >= 0; ++i) {
+            if (values[m_axes[i] - first] & AcsController::MotorMoving) {
+                *movingAxes |= 1u << m_axes[i];
+            }
+        }
+    }
+    return true;
+}
+
+std::optional<bool> AcsGantry::IsMoving() {
+    int state = 0;
+    if (!m_controller.GetMotorState(LeadAxis(), state)) {
+        Fail("read motor state");
+        return std::nullopt;
+    }
+    return (state & AcsController::MotorMoving) != 0;
+}
+
+bool AcsGantry::Fail(const std::string& operation) {
+    const std::string error = m_device.Name + ": " + operation + " failed: " + m_controller.LastError();
+    SetError(error);
+    std::cerr << error << std::endl;
+    return false;
+}
+
+std::string AcsGantry::LastError() const {
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    return m_lastError;
+}
+
+void AcsGantry::SetError(const std::string& error) {
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_lastError = error;
+}
@@ -0,0 +1,229 @@
+#include "AcsController.h"
+
+#if defined(UAA4_WITH_ACSC)
+#include "ACSC.h"
+#endif
+
+AcsLibraryController::~AcsLibraryController() {
+    Close();
+}
+
+void AcsLibraryController::OnMotionEnd(std::uint64_t axisMask, bool succeeded) {
+    if (m_handler) {
+        m_handler(axisMask, succeeded);
+    }
+}
+
+#if defined(UAA4_WITH_ACSC)
+
+namespace {
+
+int WINAPI MotionEndCallback(int param, void* context) {
+    static_cast<AcsLibraryController*>(context)->OnMotionEnd(static_cast<std::uint32_t>(param), true);
+    return 0;
+}
+
+int WINAPI MotionFailureCallback(int param, void* context) {
+    static_cast<AcsLibraryController*>(context)->OnMotionEnd(static_cast<std::uint32_t>(param), false);
+    return 0;
+}
+
+char* Name(const char* variable) {
+    return const_cast<char*>(variable);
+}
+
+} // namespace
+
+bool AcsLibraryController::Open(const std::string& address, int port) {
+    if (m_handle) {
+        return true;
+    }
+    HANDLE handle = acsc_OpenCommEthernetTCP(const_cast<char*>(address.c_str()), port);
+    if (handle == ACSC_INVALID) {
+        return false;
+    }
+    m_handle = handle;
+    return true;
+}
+
+void AcsLibraryController::Close() {
+    if (m_handle) {
+        SetMotionEndHandler(0, nullptr);
+        acsc_CloseComm(m_handle);
+        m_handle = nullptr;
+    }
+}
+
+bool AcsLibraryController::Enable(const int* axes) {
+    return acsc_EnableM(m_handle, const_cast<int*>(axes), ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::ToPoint(const int* axes, const double* point) {
+    return acsc_ToPointM(m_handle, 0, const_cast<int*>(axes), const_cast<double*>(point), ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::ExtToPoint(const int* axes, const double* point, double velocity, double endVelocity) {
+    const int flags = endVelocity > 0.0 ? ACSC_AMF_VELOCITY | ACSC_AMF_ENDVELOCITY : ACSC_AMF_VELOCITY;
+    return acsc_ExtToPointM(m_handle, flags, const_cast<int*>(axes), const_cast<double*>(point), velocity, endVelocity,
+        ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::Halt(const int* axes) {
+    return acsc_HaltM(m_handle, const_cast<int*>(axes), ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::Spline(const int* axes, double periodMs) {
+    return acsc_SplineM(m_handle, ACSC_AMF_CUBIC | ACSC_AMF_WAIT, const_cast<int*>(axes), periodMs, ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::AddPVPoint(const int* axes, const double* point, const double* velocity) {
+    return acsc_AddPVPointM(m_handle, const_cast<int*>(axes), const_cast<double*>(point), const_cast<double*>(velocity),
+        ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::EndSequence(const int* axes) {
+    return acsc_EndSequenceM(m_handle, const_cast<int*>(axes), ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::Go(const int* axes) {
+    return acsc_GoM(m_handle, const_cast<int*>(axes), ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::GetFPosition(int axis, double& position) {
+    return acsc_GetFPosition(m_handle, axis, &position, ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::GetMotorState(int axis, int& state) {
+    return acsc_GetMotorState(m_handle, axis, &state, ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::ReadReal(const char* variable, int from, int to, double* values) {
+    return acsc_ReadReal(m_handle, ACSC_NONE, Name(variable), from, to, ACSC_NONE, ACSC_NONE, values, ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::ReadInteger(const char* variable, int from, int to, int* values) {
+    return acsc_ReadInteger(m_handle, ACSC_NONE, Name(variable), from, to, ACSC_NONE, ACSC_NONE, values, ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::ReadRealMatrix(const char* variable, int fromRow, int toRow, int fromColumn, int toColumn,
+    double* values) {
+    return acsc_ReadReal(m_handle, ACSC_NONE, Name(variable), fromRow, toRow, fromColumn, toColumn, values, ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::StartCollection(const char* array, int samples, double periodMs, const char* variables) {
+    return acsc_DataCollectionExt(m_handle, 0, ACSC_NONE, Name(array), samples, periodMs, Name(variables), ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::StopCollection() {
+    return acsc_StopCollect(m_handle, ACSC_SYNCHRONOUS) != 0;
+}
+
+bool AcsLibraryController::WaitMotionEnd(int axis, int timeoutMs) {
+    return acsc_WaitMotionEnd(m_handle, axis, timeoutMs) != 0;
+}
+
+bool AcsLibraryController::SetMotionEndHandler(std::uint64_t axisMask, MotionEndHandler handler) {
+    // Removing a callback waits for one in progress to return
+    acsc_SetCallbackExt(m_handle, nullptr, nullptr, ACSC_INTR_PHYSICAL_MOTION_END);
+    acsc_SetCallbackExt(m_handle, nullptr, nullptr, ACSC_INTR_MOTION_FAILURE);
+    m_handler = std::move(handler);
+    if (!m_handler) {
+        return true;
+    }
+    return acsc_SetCallbackExt(m_handle, MotionEndCallback, this, ACSC_INTR_PHYSICAL_MOTION_END) &&
+        acsc_SetCallbackMask(m_handle, ACSC_INTR_PHYSICAL_MOTION_END, axisMask) &&
+        acsc_SetCallbackExt(m_handle, MotionFailureCallback, this, ACSC_INTR_MOTION_FAILURE) &&
+        acsc_SetCallbackMask(m_handle, ACSC_INTR_MOTION_FAILURE, axisMask);
+}
+
+std::string AcsLibraryController::LastError() {
+    const int code = acsc_GetLastError();
+    char message[256] = {};
+    int received = 0;
+    acsc_GetErrorString(m_handle ? m_handle : ACSC_INVALID, code, message, sizeof(message) - 1, &received);
+    return std::string(message, received > 0 ? received : 0) + " (" + std::to_string(code) + ")";
+}
+
+#else
+
+bool AcsLibraryController::Open(const std::string&, int) {
+    return false;
+}
+
+void AcsLibraryController::Close() {
+}
+
+bool AcsLibraryController::Enable(const int*) {
+    return false;
+}
+
+bool AcsLibraryController::ToPoint(const int*, const double*) {
+    return false;
+}
+
+bool AcsLibraryController::ExtToPoint(const int*, const double*, double, double) {
+    return false;
+}
+
+bool AcsLibraryController::Halt(const int*) {
+    return false;
+}
+
+bool AcsLibraryController::Spline(const int*, double) {
+    return false;
+}
+
+bool AcsLibraryController::AddPVPoint(const int*, const double*, const double*) {
+    return false;
+}
+
+bool AcsLibraryController::EndSequence(const int*) {
+    return false;
+}
+
+bool AcsLibraryController::Go(const int*) {
+    return false;
+}
+
+bool AcsLibraryController::GetFPosition(int, double&) {
+    return false;
+}
+
+bool AcsLibraryController::GetMotorState(int, int&) {
+    return false;
+}
+
+bool AcsLibraryController::ReadReal(const char*, int, int, double*) {
+    return false;
+}
+
+bool AcsLibraryController::ReadInteger(const char*, int, int, int*) {
+    return false;
+}
+
+bool AcsLibraryController::ReadRealMatrix(const char*, int, int, int, int, double*) {
+    return false;
+}
+
+bool AcsLibraryController::StartCollection(const char*, int, double, const char*) {
+    return false;
+}
+
+bool AcsLibraryController::StopCollection() {
+    return false;
+}
+
+bool AcsLibraryController::WaitMotionEnd(int, int) {
+    return false;
+}
+
+bool AcsLibraryController::SetMotionEndHandler(std::uint64_t, MotionEndHandler handler) {
+    m_handler = std::move(handler);
+    return false;
+}
+
+std::string AcsLibraryController::LastError() {
+    return "built without the SPiiPlus C library";
+}
+
+#endif
@@ -0,0 +1,650 @@
+#include "AsyncMotion.h"
+#include "MotionConfigManager.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+bool WithinTolerance(const PositionStruct& actual, const PositionStruct& target, double tolerance) {
+    return std::fabs(actual.x - target.x) <= tolerance && std::fabs(actual.y - target.y) <= tolerance &&
+        std::fabs(actual.z - target.z) <= tolerance && std::fabs(actual.u - target.u) <= tolerance &&
+        std::fabs(actual.v - target.v) <= tolerance && std::fabs(actual.w - target.w) <= tolerance;
+}
+
+const char* PolicyName(CompletionPolicy policy) {
+    switch (policy) {
+    case CompletionPolicy::InWindow:
+        return "in window";
+    case CompletionPolicy::InWindowSettled:
+        return "settled";
+    default:
+        return "motion end";
+    }
+}
+
+} // namespace
+
+struct MotionFuture::State {
+    std::mutex Mutex;
+    std::condition_variable ReadyCondition;
+    MotionStatus Status = MotionStatus::Pending;
+    std::string Error;
+    std::size_t Index = NoIndex;
+    std::vector<std::function<void(const MotionFuture&)>> Continuations;
+    std::function<void()> CancelHook;
+};
+
+MotionFuture MotionFuture::Ready(MotionStatus status, const std::string& error) {
+    auto state = std::make_shared<State>();
+    state->Status = status;
+    state->Error = error;
+    return MotionFuture(std::move(state));
+}
+
+MotionStatus MotionFuture::Status() const {
+    std::lock_guard<std::mutex> lock(m_state->Mutex);
+    return m_state->Status;
+}
+
+std::string MotionFuture::Error() const {
+    std::lock_guard<std::mutex> lock(m_state->Mutex);
+    return m_state->Error;
+}
+
+std::size_t MotionFuture::ReadyIndex() const {
+    std::lock_guard<std::mutex> lock(m_state->Mutex);
+    return m_state->Index;
+}
+
+MotionStatus MotionFuture::Wait() const {
+    std::unique_lock<std::mutex> lock(m_state->Mutex);
+    m_state->ReadyCondition.wait(lock, [this] { return m_state->Status != MotionStatus::Pending; });
+    return m_state->Status;
+}
+
+bool MotionFuture::WaitFor(std::chrono::milliseconds timeout) const {
+    std::unique_lock<std::mutex> lock(m_state->Mutex);
+    return m_state->ReadyCondition.wait_for(lock, timeout, [this] { return m_state->Status != MotionStatus::Pending; });
+}
+
+void MotionFuture::Cancel() const {
+    std::function<void()> hook;
+    {
+        std::lock_guard<std::mutex> lock(m_state->Mutex);
+        if (m_state->Status != MotionStatus::Pending) {
+            return;
+        }
+        hook = m_state->CancelHook;
+    }
+    if (hook) {
+        hook();
+    }
+}
+
+void MotionFuture::Then(std::function<void(const MotionFuture&)> continuation) const {
+    {
+        std::lock_guard<std::mutex> lock(m_state->Mutex);
+        if (m_state->Status == MotionStatus::Pending) {
+            m_state->Continuations.push_back(std::move(continuation));
+            return;
+        }
+    }
+    continuation(*this);
+}
+
+bool MotionFuture::Complete(const std::shared_ptr<State>& state, MotionStatus status, const std::string& error, std::size_t index) {
+    std::vector<std::function<void(const MotionFuture&)>> continuations;
+    {
+        std::lock_guard<std::mutex> lock(state->Mutex);
+        if (state->Status != MotionStatus::Pending) {
+            return false;
+        }
+        state->Status = status;
+        state->Error = error;
+        state->Index = index;
+        continuations.swap(state->Continuations);
+        state->CancelHook = nullptr;
+    }
+    state->ReadyCondition.notify_all();
+
+    const MotionFuture future(state);
+    for (auto& continuation : continuations) {
+        continuation(future);
+    }
+    return true;
+}
+
+MotionFuture MotionFuture::WhenAll(const std::vector<MotionFuture>& futures) {
+    if (futures.empty()) {
+        return Ready(MotionStatus::Succeeded);
+    }
+
+    struct Progress {
+        std::mutex Mutex;
+        std::size_t Remaining;
+        MotionStatus Status = MotionStatus::Succeeded;
+        std::string Error;
+    };
+    auto state = std::make_shared<State>();
+    auto progress = std::make_shared<Progress>();
+    progress->Remaining = futures.size();
+    state->CancelHook = [futures] {
+        for (const MotionFuture& future : futures) {
+            future.Cancel();
+        }
+    };
+
+    for (const MotionFuture& future : futures) {
+        future.Then([state, progress](const MotionFuture& ready) {
+            MotionStatus status;
+            std::string error;
+            {
+                std::lock_guard<std::mutex> lock(progress->Mutex);
+                if (ready.Status() != MotionStatus::Succeeded && progress->Status == MotionStatus::Succeeded) {
+                    progress->Status = ready.Status();
+                    progress->Error = ready.Error();
+                }
+                if (--progress->Remaining > 0) {
+                    return;
+                }
+                status = progress->Status;
+                error = progress->Error;
+            }
+            Complete(state, status, error);
+        });
+    }
+    return MotionFuture(state);
+}
+
+MotionFuture MotionFuture::WhenAny(const std::vector<MotionFuture>& futures) {
+    if (futures.empty()) {
+        return Ready(MotionStatus::Succeeded);
+    }
+
+    auto state = std::make_shared<State>();
+    state->CancelHook = [futures] {
+        for (const MotionFuture& future : futures) {
+            future.Cancel();
+        }
+    };
+    for (std::size_t i = 0; i < futures.size(); ++i) {
+        futures[i].Then([state, i](const MotionFuture& ready) {
+            Complete(state, ready.Status(), ready.Error(), i);
+        });
+    }
+    return MotionFuture(state);
+}
+
+AsyncMotionScheduler::AsyncMotionScheduler(const MotionConfigManager& config, const std::string& graphName)
+    : m_config(config), m_graphName(graphName) {
+    m_thread = std::thread(&AsyncMotionScheduler::Loop, this);
+}
+
+AsyncMotionScheduler::~AsyncMotionScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(m_mailbox->Mutex);
+        m_mailbox->Stopping = true;
+    }
+    m_mailbox->Wake.notify_one();
+    m_thread.join();
+
+    for (auto& [name, device] : m_devices) {
+        if (device.Active && MotionFuture::Complete(device.Active->Future, MotionStatus::Cancelled, "Scheduler stopped")) {
+            device.Driver->Halt();
+        }
+        for (const auto& move : device.Queue) {
+            MotionFuture::Complete(move->Future, MotionStatus::Cancelled, "Scheduler stopped");
+        }
+    }
+}
+
+void AsyncMotionScheduler::Post(const std::shared_ptr<Mailbox>& mailbox, std::function<void()> event) {
+    {
+        std::lock_guard<std::mutex> lock(mailbox->Mutex);
+        if (mailbox->Stopping) {
+            return;
+        }
+        mailbox->Events.push_back(std::move(event));
+    }
+    mailbox->Wake.notify_one();
+}
+
+void AsyncMotionScheduler::Loop() {
+    for (;;) {
+        while (!m_timers.empty() && m_timers.top().Deadline <= Clock::now()) {
+            const Timer timer = m_timers.top();
+            m_timers.pop();
+            Abort(timer.Device, timer.MoveId, MotionStatus::TimedOut, "Move of " + timer.Device + " timed out");
+        }
+
+        std::optional<Clock::time_point> wake = CheckWindows();
+        if (!m_timers.empty() && (!wake || m_timers.top().Deadline < *wake)) {
+            wake = m_timers.top().Deadline;
+        }
+
+        std::function<void()> event;
+        {
+            std::unique_lock<std::mutex> lock(m_mailbox->Mutex);
+            auto ready = [this] { return m_mailbox->Stopping || !m_mailbox->Events.empty(); };
+            if (!wake) {
+                m_mailbox->Wake.wait(lock, ready);
+            }
+            else {
+                m_mailbox->Wake.wait_until(lock, *wake, ready);
+            }
+            if (m_mailbox->Stopping) {
+                return;
+            }
+            if (!m_mailbox->Events.empty()) {
+                event = std::move(m_mailbox->Events.front());
+                m_mailbox->Events.pop_front();
+            }
+        }
+        if (event) {
+            event();
+        }
+    }
+}
+
+AsyncMotionScheduler::DeviceEntry* AsyncMotionScheduler::FindDevice(const std::string& deviceName) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_devices.find(deviceName);
+    return it == m_devices.end() ? nullptr : &it->second;
+}
+
+void AsyncMotionScheduler::SetNode(DeviceEntry& device, const std::string& nodeId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    device.NodeId = nodeId;
+}
+
+std::string AsyncMotionScheduler::CurrentNode(const std::string& deviceName) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_devices.find(deviceName);
+    return it == m_devices.end() ? std::string() : it->second.NodeId;
+}
+
+std::string AsyncMotionScheduler::LocateNode(const std::string& deviceName, MotionDriver& driver,
+    const std::optional<PositionStruct>& pose) const {
+    std::optional<PositionStruct> actual = pose ? pose : driver.GetPosition();
+    if (!actual) {
+        return std::string();
+    }
+    const MotionConfigVersionPtr version = m_config.AcquireVersion();
+    auto match = version->FindNearestPosition(deviceName, *actual, m_graphName);
+    return match && match->GraphNode ? match->GraphNode->Id : std::string();
+}
+
+void AsyncMotionScheduler::AddDevice(const std::string& deviceName, MotionDriver& driver, const std::string& startNodeId) {
+    const std::string nodeId = startNodeId.empty() ? LocateNode(deviceName, driver) : startNodeId;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto [it, inserted] = m_devices.try_emplace(deviceName);
+    if (!inserted) {
+        throw std::runtime_error("Device " + deviceName + " is already scheduled");
+    }
+    it->second.Driver = &driver;
+    it->second.NodeId = nodeId;
+}
+
+void AsyncMotionScheduler::SetPositionFeed(const std::string& deviceName, const DevicePoller& poller) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_devices.find(deviceName);
+    if (it == m_devices.end()) {
+        throw std::runtime_error("Device " + deviceName + " is not scheduled");
+    }
+    it->second.Feed = &poller;
+}
+
+std::map<std::string, MoveSavings> AsyncMotionScheduler::Savings() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_savings;
+}
+
+void AsyncMotionScheduler::ResetSavings() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_savings.clear();
+}
+
+std::vector<MoveTiming> AsyncMotionScheduler::Timings() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_timings;
+}
+
+std::string AsyncMotionScheduler::FormatTimings() const {
+    const std::vector<MoveTiming> timings = Timings();
+    std::ostringstream out;
+    double overlap = 0.0;
+    for (const MoveTiming& timing : timings) {
+        out << "  #" << timing.Id << " " << timing.Device << " -> " << timing.Position << " (" << PolicyName(timing.Policy)
+            << "): started " << timing.Started << " s";
+        if (timing.Released >= 0.0) {
+            out << ", released after " << (timing.Released - timing.Started) * 1000.0 << " ms";
+        }
+        if (timing.Ended >= 0.0) {
+            out << ", ended after " << (timing.Ended - timing.Started) * 1000.0 << " ms";
+        }
+        out << ", overlap " << timing.Overlap() * 1000.0 << " ms" << (timing.Succeeded ? "" : ", failed") << "\n";
+        overlap += timing.Overlap();
+    }
+    std::ostringstream total;
+    total << timings.size() << " moves, overlap " << overlap * 1000.0 << " ms in total\n";
+    return total.str() + out.str();
+}
+
+MotionFuture AsyncMotionScheduler::MoveTo(const std::string& deviceName, const std::string& positionName,
+    const MoveCompletion& completion) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_devices.find(deviceName) == m_devices.end()) {
+            return MotionFuture::Ready(MotionStatus::Failed, "Device " + deviceName + " is not scheduled");
+        }
+    }
+
+    MotionConfigVersionPtr version = m_config.AcquireVersion();
+    std::string targetNode;
+    for (const Node* node : version->GetNodesByDevice(m_graphName, deviceName)) {
+        if (node->Position == positionName) {
+            targetNode = node->Id;
+            break;
+        }
+    }
+    auto target = version->GetNamedPosition(deviceName, positionName);
+    if (targetNode.empty() || !target) {
+        return MotionFuture::Ready(MotionStatus::Failed,
+            "Position " + positionName + " of " + deviceName + " has no node in graph " + m_graphName);
+    }
+
+    auto move = std::make_shared<Move>();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        move->Id = m_nextMoveId++;
+    }
+    move->Device = deviceName;
+    move->Position = positionName;
+    move->TargetNode = targetNode;
+    move->Completion = completion;
+    move->Target = target->get();
+    move->PositionTolerance = version->GetSettings().PositionTolerance;
+    if (move->Completion.Tolerance < 0.0) {
+        move->Completion.Tolerance = version->GetSettings().PositionTolerance;
+    }
+    move->Future = std::make_shared<MotionFuture::State>();
+    move->Future->CancelHook = [this, mailbox = m_mailbox, deviceName, id = move->Id] {
+        Post(mailbox, [this, deviceName, id] { Abort(deviceName, id, MotionStatus::Cancelled, "Move of " + deviceName + " cancelled"); });
+    };
+
+    Post(m_mailbox, [this, move] {
+        DeviceEntry* device = FindDevice(move->Device);
+        device->Queue.push_back(move);
+        StartNext(*device);
+    });
+    return MotionFuture(move->Future);
+}
+
+void AsyncMotionScheduler::StartNext(DeviceEntry& device) {
+    while (!device.Active && !device.Queue.empty()) {
+        std::shared_ptr<Move> move = std::move(device.Queue.front());
+        device.Queue.pop_front();
+        if (MotionFuture(move->Future).IsReady()) {
+            continue;
+        }
+        if (device.NodeId.empty()) {
+            SetNode(device, LocateNode(move->Device, *device.Driver, CachedPose(device)));
+        }
+        if (device.NodeId.empty()) {
+            MotionFuture::Complete(move->Future, MotionStatus::Failed, "Position of " + move->Device + " is unknown");
+            continue;
+        }
+
+        MotionTask task;
+        try {
+            MotionPlan plan(m_config.AcquireVersion(), m_graphName);
+            plan.SetStart(device.NodeId);
+            plan.MoveTo(move->TargetNode);
+            task = plan.Tasks().front();
+        }
+        catch (const std::exception& ex) {
+            MotionFuture::Complete(move->Future, MotionStatus::Failed, ex.what());
+            continue;
+        }
+        if (task.Route.empty()) {
+            MotionFuture::Complete(move->Future, MotionStatus::Succeeded, std::string());
+            continue;
+        }
+        if (AlreadyThere(device, *move, task.EstimatedSeconds)) {
+            continue;
+        }
+
+        // An edge without a limit leaves the whole route without one
+        int timeoutSeconds = 0;
+        for (const MotionWaypoint& waypoint : task.Route) {
+            if (waypoint.TimeoutSeconds <= 0) {
+                timeoutSeconds = 0;
+                break;
+            }
+            timeoutSeconds += waypoint.TimeoutSeconds;
+        }
+
+        const DevicePoller* feed = device.Feed;
+        move->StartCycle = feed ? feed->Latest().Cycle : 0;
+        move->InWindowSince.reset();
+        move->EndedAt.reset();
+        const double started = std::chrono::duration<double>(Clock::now() - m_epoch).count();
+
+        device.Active = move;
+        device.MovedAt = Clock::now();
+        const bool moving = device.Driver->StartMove(task.Route,
+            [this, mailbox = m_mailbox, deviceName = move->Device, id = move->Id](bool succeeded, const std::string& error, Clock::time_point ended) {
+                Post(mailbox, [this, deviceName, id, succeeded, error, ended] { Finished(deviceName, id, succeeded, error, ended); });
+            });
+        if (!moving) {
+            device.Active.reset();
+            MotionFuture::Complete(move->Future, MotionStatus::Failed, "Move of " + move->Device + " couldn't start");
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            MoveTiming timing;
+            timing.Id = move->Id;
+            timing.Device = move->Device;
+            timing.Position = move->Position;
+            timing.Policy = move->Completion.Policy;
+            timing.Started = started;
+            move->Timing = m_timings.size();
+            m_timings.push_back(timing);
+        }
+        DeviceEntry* entry = &device;
+        if (feed && move->Completion.Policy != CompletionPolicy::MotionEnd &&
+            std::find(m_watching.begin(), m_watching.end(), entry) == m_watching.end()) {
+            m_watching.push_back(entry);
+        }
+        if (timeoutSeconds > 0) {
+            m_timers.push({ Clock::now() + std::chrono::seconds(timeoutSeconds), move->Id, move->Device });
+        }
+    }
+}
+
+void AsyncMotionScheduler::Finished(const std::string& deviceName, std::uint64_t moveId, bool succeeded, const std::string& error,
+    Clock::time_point ended) {
+    DeviceEntry* device = FindDevice(deviceName);
+    LatencyHistogram* latency = device->Driver->CompletionLatency();
+    if (latency && ended != Clock::time_point()) {
+        latency->Record(Clock::now() - ended);
+    }
+    if (!device->Active || device->Active->Id != moveId) {
+        return;
+    }
+    std::shared_ptr<Move> move = device->Active;
+    Ended(*move, succeeded);
+    // The motion end alone doesn't say the feedback has settled; CheckWindows releases it
+    const DevicePoller* feed = device->Feed;
+    if (succeeded && move->Completion.Policy == CompletionPolicy::InWindowSettled && feed &&
+        !MotionFuture(move->Future).IsReady()) {
+        if (std::find(m_watching.begin(), m_watching.end(), device) == m_watching.end()) {
+            // The feed was set after the move started; judge it from the samples after the end
+            move->StartCycle = feed->Latest().Cycle;
+            move->InWindowSince.reset();
+            m_watching.push_back(device);
+        }
+        move->EndedAt = Clock::now();
+        SetNode(*device, move->TargetNode);
+        return;
+    }
+    device->Active.reset();
+
+    // A move halted too late may still have arrived
+    device->MovedAt = Clock::now();
+    SetNode(*device, succeeded ? move->TargetNode : LocateNode(deviceName, *device->Driver));
+    const bool released = MotionFuture(move->Future).Status() == MotionStatus::Succeeded;
+    if (!Release(*move, succeeded ? MotionStatus::Succeeded : MotionStatus::Failed, error) && released && !succeeded) {
+        std::cerr << "Move of " << deviceName << " failed after it was released in position: " << error << std::endl;
+    }
+    StartNext(*device);
+}
+
+void AsyncMotionScheduler::Abort(const std::string& deviceName, std::uint64_t moveId, MotionStatus status, const std::string& error) {
+    DeviceEntry* device = FindDevice(deviceName);
+    if (device->Active && device->Active->Id == moveId) {
+        if (device->Active->EndedAt) {
+            // Ended already, only waiting to settle
+            Release(*device->Active, status, error);
+            device->Active.reset();
+            StartNext(*device);
+            return;
+        }
+        // The device stays busy until the driver reports the motion has ended. A move
+        // released in position still stops when its time runs out.
+        if (Release(*device->Active, status, error) || status == MotionStatus::TimedOut) {
+            device->Driver->Halt();
+        }
+        return;
+    }
+    for (auto it = device->Queue.begin(); it != device->Queue.end(); ++it) {
+        if ((*it)->Id == moveId) {
+            std::shared_ptr<Move> move = std::move(*it);
+            device->Queue.erase(it);
+            MotionFuture::Complete(move->Future, status, error);
+            return;
+        }
+    }
+}
+
+// The feed's latest status, if it was read after the device last started or ended
+// a move, within three poll periods, with no axis moving
+std::optional<PositionStruct> AsyncMotionScheduler::CachedPose(const DeviceEntry& device) const {
+    const DevicePoller* feed = device.Feed;
+    if (!feed) {
+        return std::nullopt;
+    }
+    const DeviceStatus status = feed->Latest();
+    const double rateHz = feed->Stats().TargetHz;
+    const Clock::duration maxAge = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(rateHz > 0.0 ? 3.0 / rateHz : 0.03));
+    if (status.Cycle == 0 || status.Time <= device.MovedAt || Clock::now() - status.Time > maxAge ||
+        status.MovingAxes != 0) {
+        return std::nullopt;
+    }
+    return status.Position;
+}
+
+// Complete a move whose target the device already stands at, without a round trip
+bool AsyncMotionScheduler::AlreadyThere(DeviceEntry& device, const Move& move, double estimatedSeconds) {
+    if (!device.Feed) {
+        return false;
+    }
+    const std::optional<PositionStruct> pose = CachedPose(device);
+    if (!pose) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_savings[move.Device].StalePoses;
+        return false;
+    }
+    if (!WithinTolerance(*pose, move.Target, move.PositionTolerance)) {
+        return false;
+    }
+    SetNode(device, move.TargetNode);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        MoveSavings& savings = m_savings[move.Device];
+        ++savings.Moves;
+        savings.Seconds += estimatedSeconds;
+    }
+    MotionFuture::Complete(move.Future, MotionStatus::Succeeded, std::string());
+    return true;
+}
+
+bool AsyncMotionScheduler::Release(Move& move, MotionStatus status, const std::string& error) {
+    if (!MotionFuture::Complete(move.Future, status, error)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timings[move.Timing].Released = std::chrono::duration<double>(Clock::now() - m_epoch).count();
+    return true;
+}
+
+void AsyncMotionScheduler::Ended(Move& move, bool succeeded) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_timings[move.Timing].Ended = std::chrono::duration<double>(Clock::now() - m_epoch).count();
+    m_timings[move.Timing].Succeeded = succeeded;
+}
+
+// Release the moves whose policy the latest status of their feed meets; returns
+// when to look again, at the feed's poll rate
+std::optional<AsyncMotionScheduler::Clock::time_point> AsyncMotionScheduler::CheckWindows() {
+    std::optional<Clock::time_point> next;
+    std::vector<DeviceEntry*> settled;
+    for (std::size_t i = 0; i < m_watching.size();) {
+        DeviceEntry& device = *m_watching[i];
+        Move* move = device.Active.get();
+        if (!move || MotionFuture(move->Future).IsReady()) {
+            m_watching.erase(m_watching.begin() + i);
+            continue;
+        }
+
+        const DevicePoller* feed = device.Feed;
+        const DeviceStatus status = feed->Latest();
+        if (status.Cycle > move->StartCycle) {
+            if (!WithinTolerance(status.Position, move->Target, move->Completion.Tolerance)) {
+                move->InWindowSince.reset();
+            }
+            else if (!move->InWindowSince) {
+                move->InWindowSince = status.Time;
+            }
+        }
+        const Clock::time_point now = Clock::now();
+        const bool met = move->InWindowSince && (move->Completion.Policy == CompletionPolicy::InWindow ||
+            status.Time - *move->InWindowSince >= move->Completion.Settle);
+        const bool unsettled = !met && move->EndedAt && now - *move->EndedAt >= move->Completion.SettleTimeout;
+        if (met || unsettled) {
+            if (met) {
+                Release(*move, MotionStatus::Succeeded, std::string());
+            }
+            else {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_timings[move->Timing].Succeeded = false;
+                }
+                Release(*move, MotionStatus::Failed, move->Device + " did not settle within tolerance of " + move->Position);
+            }
+            if (move->EndedAt) {
+                settled.push_back(&device);
+            }
+            m_watching.erase(m_watching.begin() + i);
+            continue;
+        }
+
+        const double rateHz = feed->Stats().TargetHz;
+        const Clock::duration period = rateHz > 0.0
+            ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rateHz))
+            : std::chrono::duration_cast<Clock::duration>(std::chrono::milliseconds(10));
+        next = next ? std::min(*next, now + period) : now + period;
+        ++i;
+    }
+    for (DeviceEntry* device : settled) {
+        device->Active.reset();
+        StartNext(*device);
+    }
+    return next;
+}
@@ -0,0 +1,200 @@
+#include "CollectionFile.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr char kMagic[8] = { 'U', 'A', 'A', '4', 'D', 'C', 'O', 'L' };
+constexpr std::uint32_t kEndianTag = 0x01020304;
+constexpr std::size_t kMinimumGrowth = 1 << 20;
+
+struct FileHeader {
+    char Magic[8];
+    std::uint32_t Version;
+    std::uint32_t EndianTag;
+    std::uint64_t End;        // Bytes of complete records, header included
+    std::uint64_t Records;
+};
+
+struct RecordHeader {
+    std::uint64_t MoveId;
+    std::uint64_t Size;       // Whole record
+    std::uint64_t Capacity;   // Samples per column, the stride between columns
+    std::uint64_t Samples;
+    std::uint32_t Columns;
+    std::uint32_t Reserved;
+    double PeriodMs;
+};
+
+static_assert(sizeof(FileHeader) % 8 == 0 && sizeof(RecordHeader) % 8 == 0 && CollectionFormat::NameSize % 8 == 0,
+    "columns must stay aligned for doubles");
+
+std::size_t RecordSize(std::size_t columns, std::size_t capacity) {
+    return sizeof(RecordHeader) + columns * (CollectionFormat::NameSize + capacity * sizeof(double));
+}
+
+bool ValidHeader(const FileHeader& header, std::size_t fileSize) {
+    return std::memcmp(header.Magic, kMagic, sizeof(kMagic)) == 0 && header.Version == CollectionFormat::Version &&
+        header.EndianTag == kEndianTag && header.End >= sizeof(FileHeader) && header.End <= fileSize;
+}
+
+} // namespace
+
+bool CollectionWriter::Open(const std::string& filePath) {
+    Close();
+    if (!m_file.Open(filePath, sizeof(FileHeader))) {
+        return false;
+    }
+    FileHeader header;
+    std::memcpy(&header, m_file.Data(), sizeof(header));
+    static const char empty[sizeof(kMagic)] = {};
+    if (std::memcmp(header.Magic, empty, sizeof(empty)) == 0) {
+        std::memcpy(header.Magic, kMagic, sizeof(kMagic));
+        header.Version = CollectionFormat::Version;
+        header.EndianTag = kEndianTag;
+        header.End = sizeof(FileHeader);
+        header.Records = 0;
+        std::memcpy(m_file.Data(), &header, sizeof(header));
+        return m_file.Flush();
+    }
+    if (!ValidHeader(header, m_file.Size())) {
+        m_file.Close();
+        return false;
+    }
+    return true;
+}
+
+void CollectionWriter::Close() {
+    m_file.Close();
+    m_record = 0;
+}
+
+bool CollectionWriter::BeginRecord(std::uint64_t moveId, const std::vector<std::string>& columns, std::size_t capacity,
+    double periodMs) {
+    if (!IsOpen() || columns.empty()) {
+        return false;
+    }
+    // A record begun but never ended is overwritten
+    FileHeader header;
+    std::memcpy(&header, m_file.Data(), sizeof(header));
+    const std::size_t offset = static_cast<std::size_t>(header.End);
+    const std::size_t size = RecordSize(columns.size(), capacity);
+    if (offset + size > m_file.Size() &&
+        !m_file.Reserve(std::max(offset + size, m_file.Size() + std::max(m_file.Size() / 2, kMinimumGrowth)))) {
+        m_record = 0;
+        return false;
+    }
+
+    RecordHeader record = {};
+    record.MoveId = moveId;
+    record.Size = size;
+    record.Capacity = capacity;
+    record.Columns = static_cast<std::uint32_t>(columns.size());
+    record.PeriodMs = periodMs;
+    char* data = m_file.Data() + offset;
+    std::memcpy(data, &record, sizeof(record));
+    char* names = data + sizeof(RecordHeader);
+    std::memset(names, 0, columns.size() * CollectionFormat::NameSize);
+    for (std::size_t i = 0; i < columns.size(); ++i) {
+        std::memcpy(names + i * CollectionFormat::NameSize, columns[i].data(),
+            std::min(columns[i].size(), CollectionFormat::NameSize - 1));
+    }
+
+    m_record = offset;
+    m_columns = columns.size();
+    m_capacity = capacity;
+    return true;
+}
+
+void CollectionWriter::Write(std::size_t column, std::size_t first, const double* values, std::size_t count) {
+    if (m_record == 0 || column >= m_columns || first >= m_capacity) {
+        return;
+    }
+    count = std::min(count, m_capacity - first);
+    char* data = m_file.Data() + m_record + sizeof(RecordHeader) + m_columns * CollectionFormat::NameSize;
+    std::memcpy(data + (column * m_capacity + first) * sizeof(double), values, count * sizeof(double));
+}
+
+bool CollectionWriter::EndRecord(std::size_t samples) {
+    if (m_record == 0) {
+        return false;
+    }
+    char* data = m_file.Data();
+    RecordHeader record;
+    std::memcpy(&record, data + m_record, sizeof(record));
+    record.Samples = std::min(samples, m_capacity);
+    std::memcpy(data + m_record, &record, sizeof(record));
+
+    // The record reaches the disk before the header points past it
+    bool flushed = m_file.Flush();
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    header.End = m_record + record.Size;
+    ++header.Records;
+    std::memcpy(data, &header, sizeof(header));
+    flushed = m_file.Flush() && flushed;
+    m_record = 0;
+    return flushed;
+}
+
+bool CollectionReader::Open(const std::string& filePath) {
+    m_moveIds.clear();
+    m_offsets.clear();
+    if (!m_file.Open(filePath) || m_file.Size() < sizeof(FileHeader)) {
+        return false;
+    }
+    FileHeader header;
+    std::memcpy(&header, m_file.Data(), sizeof(header));
+    if (!ValidHeader(header, m_file.Size())) {
+        return false;
+    }
+    std::size_t offset = sizeof(FileHeader);
+    while (offset + sizeof(RecordHeader) <= header.End) {
+        RecordHeader record;
+        std::memcpy(&record, m_file.Data() + offset, sizeof(record));
+        if (record.Size < RecordSize(record.Columns, record.Capacity) || offset + record.Size > header.End) {
+            break;
+        }
+        m_moveIds.push_back(record.MoveId);
+        m_offsets[record.MoveId] = offset;
+        offset += static_cast<std::size_t>(record.Size);
+    }
+    return true;
+}
+
+std::vector<std::uint64_t> CollectionReader::MoveIds() const {
+    return m_moveIds;
+}
+
+std::optional<CollectionReader::Record> CollectionReader::Find(std::uint64_t moveId) const {
+    auto it = m_offsets.find(moveId);
+    if (it == m_offsets.end()) {
+        return std::nullopt;
+    }
+    const char* data = m_file.Data() + it->second;
+    RecordHeader header;
+    std::memcpy(&header, data, sizeof(header));
+
+    Record record;
+    record.MoveId = header.MoveId;
+    record.PeriodMs = header.PeriodMs;
+    record.Samples = static_cast<std::size_t>(std::min(header.Samples, header.Capacity));
+    const char* names = data + sizeof(RecordHeader);
+    const double* columns = reinterpret_cast<const double*>(names + header.Columns * CollectionFormat::NameSize);
+    for (std::uint32_t i = 0; i < header.Columns; ++i) {
+        const char* name = names + i * CollectionFormat::NameSize;
+        record.Columns.emplace_back(name, strnlen(name, CollectionFormat::NameSize));
+        record.Data.emplace_back(columns + i * header.Capacity, record.Samples);
+    }
+    return record;
+}
+
+Span<const double> CollectionReader::Column(const Record& record, const std::string& name) {
+    for (std::size_t i = 0; i < record.Columns.size(); ++i) {
+        if (record.Columns[i] == name) {
+            return record.Data[i];
+        }
+    }
+    return Span<const double>();
+}
@@ -0,0 +1,202 @@
+#include "ConfigFileWatcher.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::int64_t WriteTimeOf(const std::string& path) {
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    return error ? 0 : static_cast<std::int64_t>(time.time_since_epoch().count());
+}
+
+} // namespace
+
+ConfigFileWatcher::ConfigFileWatcher(std::chrono::milliseconds settleDelay)
+    : m_settleDelay(settleDelay) {
+}
+
+ConfigFileWatcher::~ConfigFileWatcher() {
+    Stop();
+}
+
+void ConfigFileWatcher::Watch(const std::string& filePath, Callback callback) {
+    std::filesystem::path path(filePath);
+    Entry entry;
+    entry.Path = filePath;
+    entry.Directory = path.has_parent_path() ? path.parent_path().string() : std::string(".");
+    entry.FileName = path.filename().string();
+    entry.OnChange = std::move(callback);
+    entry.LastWriteTime = WriteTimeOf(filePath);
+    m_entries.push_back(std::move(entry));
+}
+
+bool ConfigFileWatcher::Start() {
+    if (m_thread.joinable()) {
+        return true;
+    }
+    m_stopping = false;
+
+#ifdef __linux__
+    m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_inotify < 0 || m_wake < 0) {
+        std::cerr << "Config file watcher: inotify unavailable" << std::endl;
+        Stop();
+        return false;
+    }
+    for (const Entry& entry : m_entries) {
+        bool known = false;
+        for (const auto& [descriptor, directory] : m_directories) {
+            known = known || directory == entry.Directory;
+        }
+        if (known) {
+            continue;
+        }
+        int descriptor = inotify_add_watch(m_inotify, entry.Directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (descriptor < 0) {
+            std::cerr << "Config file watcher: can't watch " << entry.Directory << std::endl;
+            continue;
+        }
+        m_directories.emplace(descriptor, entry.Directory);
+    }
+#endif
+
+    m_thread = std::thread(&ConfigFileWatcher::Run, this);
+    return true;
+}
+
+void ConfigFileWatcher::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_stopSignal.notify_all();
+#ifdef __linux__
+    if (m_wake >= 0) {
+        std::uint64_t one = 1;
+        (void)!write(m_wake, &one, sizeof(one));
+    }
+#endif
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+#ifdef __linux__
+    if (m_inotify >= 0) {
+        close(m_inotify);
+        m_inotify = -1;
+    }
+    if (m_wake >= 0) {
+        close(m_wake);
+        m_wake = -1;
+    }
+    m_directories.clear();
+#endif
+}
+
+void ConfigFileWatcher::MarkChanged(Entry& entry, Clock::time_point now) {
+    if (!entry.Pending) {
+        entry.Pending = true;
+        entry.FirstEvent = now;
+    }
+    entry.LastEvent = now;
+}
+
+int ConfigFileWatcher::DispatchSettled(Clock::time_point now) {
+    int nextWait = -1;
+    for (Entry& entry : m_entries) {
+        if (!entry.Pending) {
+            continue;
+        }
+        const auto settleAt = entry.LastEvent + m_settleDelay;
+        if (now < settleAt) {
+            const int wait = static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(settleAt - now).count());
+            nextWait = nextWait < 0 ? wait : std::min(nextWait, wait);
+            continue;
+        }
+
+        entry.Pending = false;
+        try {
+            entry.OnChange(entry.Path);
+        }
+        catch (const std::exception& ex) {
+            std::cerr << "Reload of " << entry.Path << " failed: " << ex.what() << std::endl;
+            continue;
+        }
+        auto latency = std::chrono::duration<double, std::milli>(Clock::now() - entry.FirstEvent);
+        std::cout << "Handled change to " << entry.Path << " " << latency.count() << " ms after it was detected ("
+            << m_settleDelay.count() << " ms settle delay)" << std::endl;
+    }
+    return nextWait;
+}
+
+#ifdef __linux__
+
+void ConfigFileWatcher::Run() {
+    alignas(inotify_event) char buffer[4096];
+    int timeout = -1;
+    for (;;) {
+        pollfd descriptors[2] = { { m_inotify, POLLIN, 0 }, { m_wake, POLLIN, 0 } };
+        poll(descriptors, 2, timeout);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_stopping) {
+                return;
+            }
+        }
+
+        const auto now = Clock::now();
+        for (;;) {
+            const ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+            if (length <= 0) {
+                break;
+            }
+            for (char* p = buffer; p < buffer + length;) {
+                const auto* event = reinterpret_cast<const inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+                auto directory = m_directories.find(event->wd);
+                if (event->len == 0 || directory == m_directories.end()) {
+                    continue;
+                }
+                for (Entry& entry : m_entries) {
+                    if (entry.Directory == directory->second && entry.FileName == event->name) {
+                        MarkChanged(entry, now);
+                    }
+                }
+            }
+        }
+        timeout = DispatchSettled(Clock::now());
+    }
+}
+
+#else
+
+void ConfigFileWatcher::Run() {
+    const auto interval = std::max(m_settleDelay, std::chrono::milliseconds(100));
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopSignal.wait_for(lock, interval, [this] { return m_stopping; })) {
+        lock.unlock();
+        const auto now = Clock::now();
+        for (Entry& entry : m_entries) {
+            const std::int64_t writeTime = WriteTimeOf(entry.Path);
+            if (writeTime != 0 && writeTime != entry.LastWriteTime) {
+                entry.LastWriteTime = writeTime;
+                MarkChanged(entry, now);
+            }
+        }
+        DispatchSettled(Clock::now());
+        lock.lock();
+    }
+}
+
+#endif
@@ -0,0 +1,250 @@
+#include "DataCollector.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+} // namespace
+
+DataCollector::DataCollector(AcsController& controller, DataCollectorSettings settings)
+    : m_controller(controller), m_settings(std::move(settings)) {
+    std::istringstream variables(m_settings.Variables);
+    std::string name;
+    while (variables >> name) {
+        m_columns.push_back(name);
+    }
+    if (m_columns.empty() || m_settings.Samples <= 0 || m_settings.PeriodMs <= 0.0 || m_settings.ChunkSamples <= 0) {
+        throw std::runtime_error("DataCollector needs variables, samples, a period and a chunk size");
+    }
+    m_chunk.resize(m_columns.size() * m_settings.ChunkSamples);
+}
+
+DataCollector::~DataCollector() {
+    Close();
+}
+
+bool DataCollector::Open(const std::string& filePath) {
+    Close();
+    if (!m_writer.Open(filePath)) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lastError = "cannot open collection file " + filePath;
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = true;
+        m_stopping = false;
+        m_idle = true;
+    }
+    m_thread = std::thread(&DataCollector::Run, this);
+    return true;
+}
+
+void DataCollector::Close() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_open = false;
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_writer.Close();
+}
+
+bool DataCollector::IsOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_open;
+}
+
+bool DataCollector::Begin(std::uint64_t moveId) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return !m_pending; });
+    if (!m_open) {
+        return false;
+    }
+    m_pending = moveId;
+    m_ended = false;
+    m_wake.notify_one();
+    m_done.wait(lock, [this] { return !m_pending; });
+    return m_started;
+}
+
+void DataCollector::End() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ended = true;
+    }
+    m_wake.notify_one();
+}
+
+void DataCollector::Flush() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return !m_pending && (m_idle || !m_open); });
+}
+
+DataCollectorStats DataCollector::Stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::string DataCollector::LastError() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
+
+void DataCollector::Run() {
+    const int trailing = static_cast<int>(m_settings.TrailingMs / m_settings.PeriodMs + 0.5);
+    const auto grace = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double, std::milli>(m_settings.TrailingMs)) + std::chrono::seconds(1);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        if (m_pending) {
+            const std::uint64_t moveId = *m_pending;
+            lock.unlock();
+            FinishRecord();
+            const bool started = StartRecord(moveId);
+            lock.lock();
+            m_pending.reset();
+            m_started = started;
+            m_idle = !started;
+            m_done.notify_all();
+            continue;
+        }
+        if (!m_active) {
+            if (m_stopping) {
+                break;
+            }
+            m_wake.wait(lock, [this] { return m_pending || m_stopping; });
+            continue;
+        }
+
+        const bool ended = m_ended;
+        const bool stopping = m_stopping;
+        lock.unlock();
+        int collected = 0;
+        if (!m_controller.ReadInteger("S_DCN", -1, -1, &collected)) {
+            Fail("read sample count");
+            FinishRecord();
+        }
+        else {
+            collected = std::min(collected, m_settings.Samples);
+            if (!Pull(collected)) {
+                FinishRecord();
+            }
+        }
+        if (m_active) {
+            Active& active = *m_active;
+            if (ended && !active.Target) {
+                active.Target = std::min(collected + trailing, m_settings.Samples);
+                active.Deadline = Clock::now() + grace;
+            }
+            // A controller that stops sampling, e.g. in a simulation that has no more
+            // events, doesn't hold the record open for ever
+            if (stopping || collected >= m_settings.Samples ||
+                (active.Target && (collected >= *active.Target || Clock::now() >= active.Deadline))) {
+                FinishRecord();
+            }
+        }
+        lock.lock();
+        if (!m_active) {
+            m_idle = true;
+            m_done.notify_all();
+            continue;
+        }
+        const bool targeted = m_active->Target.has_value();
+        m_wake.wait_for(lock, m_settings.PullPeriod,
+            [this, targeted] { return m_pending || m_stopping || (m_ended && !targeted); });
+    }
+    m_done.notify_all();
+}
+
+bool DataCollector::StartRecord(std::uint64_t moveId) {
+    if (!m_writer.BeginRecord(moveId, m_columns, m_settings.Samples, m_settings.PeriodMs)) {
+        Fail("begin record", false);
+        return false;
+    }
+    // A record begun here but never ended is overwritten by the next one
+    if (!m_controller.StartCollection(m_settings.Array.c_str(), m_settings.Samples, m_settings.PeriodMs,
+        m_settings.Variables.c_str())) {
+        Fail("start collection");
+        return false;
+    }
+    m_active = Active();
+    m_active->MoveId = moveId;
+    return true;
+}
+
+// Samples up to 'collected' that aren't in the file yet
+bool DataCollector::Pull(int collected) {
+    Active& active = *m_active;
+    const std::size_t rows = m_columns.size();
+    while (active.Pulled < collected) {
+        const int count = std::min(collected - active.Pulled, m_settings.ChunkSamples);
+        const Clock::time_point before = Clock::now();
+        const bool read = m_controller.ReadRealMatrix(m_settings.Array.c_str(), 0, static_cast<int>(rows) - 1,
+            active.Pulled, active.Pulled + count - 1, m_chunk.data());
+        const double microseconds = std::chrono::duration<double, std::micro>(Clock::now() - before).count();
+        if (!read) {
+            Fail("read samples");
+            return false;
+        }
+        // The matrix comes row by row, and a row is a column of the file
+        for (std::size_t row = 0; row < rows; ++row) {
+            m_writer.Write(row, active.Pulled, m_chunk.data() + row * count, count);
+        }
+        active.Pulled += count;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.MeanPullMicroseconds = (m_stats.MeanPullMicroseconds * m_stats.Chunks + microseconds) / (m_stats.Chunks + 1);
+        m_stats.MaxPullMicroseconds = std::max(m_stats.MaxPullMicroseconds, microseconds);
+        ++m_stats.Chunks;
+    }
+    return true;
+}
+
+// Stop the collection, take what is left, and complete the record
+void DataCollector::FinishRecord() {
+    if (!m_active) {
+        return;
+    }
+    if (!m_controller.StopCollection()) {
+        Fail("stop collection");
+    }
+    int collected = 0;
+    if (m_controller.ReadInteger("S_DCN", -1, -1, &collected)) {
+        Pull(std::min(collected, m_settings.Samples));
+    }
+    else {
+        Fail("read sample count");
+    }
+    const Active active = *m_active;
+    m_active.reset();
+    const bool written = m_writer.EndRecord(active.Pulled);
+    if (!written) {
+        Fail("write record", false);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.Moves;
+    m_stats.Samples += active.Pulled;
+    if (!active.Target || active.Pulled < *active.Target) {
+        ++m_stats.Truncated;
+    }
+}
+
+void DataCollector::Fail(const std::string& operation, bool controller) {
+    const std::string error = "Data collection: " + operation + " failed" +
+        (controller ? ": " + m_controller.LastError() : std::string());
+    std::cerr << error << std::endl;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastError = error;
+    ++m_stats.Failures;
+}
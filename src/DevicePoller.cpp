@@ -0,0 +1,120 @@
+#include "DevicePoller.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Microseconds(Clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+
+} // namespace
+
+DevicePoller::DevicePoller(const std::string& deviceName, StatusSource& source, double rateHz)
+    : m_deviceName(deviceName), m_source(source), m_rateHz(rateHz) {
+}
+
+DevicePoller::~DevicePoller() {
+    Stop();
+}
+
+void DevicePoller::Start() {
+    if (m_thread.joinable()) {
+        return;
+    }
+    m_stopping = false;
+    m_thread = std::thread(&DevicePoller::Loop, this);
+}
+
+void DevicePoller::Stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+void DevicePoller::SetRate(double rateHz) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_rateHz = rateHz;
+        m_rateChanged = true;
+    }
+    m_wake.notify_one();
+}
+
+void DevicePoller::Loop() {
+    std::uint64_t cycle = m_status.Load().Cycle;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        m_rateChanged = false;
+        const double rateHz = m_rateHz > 0.0 ? m_rateHz : 1.0;
+        const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rateHz));
+
+        PollStats stats;
+        stats.TargetHz = rateHz;
+        m_stats.Store(stats);
+        Clock::time_point first;
+        Clock::time_point previous;
+        double periodSum = 0.0;
+        double periodSquares = 0.0;
+        double readSum = 0.0;
+
+        Clock::time_point next = Clock::now();
+        while (!m_wake.wait_until(lock, next, [this] { return m_stopping || m_rateChanged; })) {
+            const Clock::time_point start = Clock::now();
+            lock.unlock();
+
+            DeviceStatus status;
+            const bool read = m_source.ReadStatus(status);
+            const Clock::time_point end = Clock::now();
+            if (read) {
+                status.Cycle = ++cycle;
+                status.Time = end;
+                m_status.Store(status);
+            }
+            else {
+                ++stats.Failures;
+            }
+
+            // Statistics of the cycle start times
+            if (stats.Cycles == 0) {
+                first = start;
+            }
+            else {
+                const double periodUs = Microseconds(start - previous);
+                periodSum += periodUs;
+                periodSquares += periodUs * periodUs;
+                const double intervals = static_cast<double>(stats.Cycles);
+                const double mean = periodSum / intervals;
+                stats.JitterUs = std::sqrt(std::max(0.0, periodSquares / intervals - mean * mean));
+                stats.AchievedHz = intervals * 1e6 / Microseconds(start - first);
+            }
+            previous = start;
+            ++stats.Cycles;
+            stats.MaxLateUs = std::max(stats.MaxLateUs, Microseconds(start - next));
+            readSum += Microseconds(end - start);
+            stats.MeanReadUs = readSum / static_cast<double>(stats.Cycles);
+
+            // Keep to the schedule; a cycle that is already due is skipped rather than
+            // run back to back
+            next += period;
+            const Clock::time_point now = Clock::now();
+            if (next <= now) {
+                const auto behind = (now - next) / period + 1;
+                stats.Overruns += static_cast<std::uint64_t>(behind);
+                next += behind * period;
+            }
+            m_stats.Store(stats);
+
+            lock.lock();
+        }
+    }
+}
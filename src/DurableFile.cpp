@@ -0,0 +1,220 @@
+#include "DurableFile.h"
+
+#include <filesystem>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+DurableFile::~DurableFile() {
+    Close();
+}
+
+DurableFile::DurableFile(DurableFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+DurableFile& DurableFile::operator=(DurableFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+#ifdef _WIN32
+        m_handle = std::exchange(other.m_handle, nullptr);
+#else
+        m_fd = std::exchange(other.m_fd, -1);
+#endif
+        m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool DurableFile::Open(const std::string& filePath, bool truncate) {
+    Close();
+
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr, truncate ? CREATE_ALWAYS : OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    m_handle = file;
+    m_size = static_cast<std::uint64_t>(size.QuadPart);
+    return true;
+}
+
+void DurableFile::Close() {
+    if (m_handle) {
+        CloseHandle(static_cast<HANDLE>(m_handle));
+        m_handle = nullptr;
+    }
+    m_size = 0;
+}
+
+bool DurableFile::IsOpen() const {
+    return m_handle != nullptr;
+}
+
+bool DurableFile::Append(const void* data, std::size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        // Writes go through an explicit offset so a reopened file never overwrites its tail
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(m_size);
+        overlapped.OffsetHigh = static_cast<DWORD>(m_size >> 32);
+        DWORD written = 0;
+        const DWORD chunk = size > 0x40000000 ? 0x40000000 : static_cast<DWORD>(size);
+        if (!WriteFile(static_cast<HANDLE>(m_handle), bytes, chunk, &written, &overlapped) || written == 0) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+        m_size += written;
+    }
+    return true;
+}
+
+bool DurableFile::Truncate(std::uint64_t size) {
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(size);
+    if (!SetFilePointerEx(static_cast<HANDLE>(m_handle), position, nullptr, FILE_BEGIN) ||
+        !SetEndOfFile(static_cast<HANDLE>(m_handle))) {
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+bool DurableFile::Sync() {
+    return FlushFileBuffers(static_cast<HANDLE>(m_handle)) != 0;
+}
+
+bool DurableFile::Replace(const std::string& from, const std::string& to) {
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+
+#else
+
+namespace {
+
+// A rename is only durable once the directory holding the entry is flushed
+bool SyncParentDirectory(const std::string& filePath) {
+    std::filesystem::path parent = std::filesystem::path(filePath).parent_path();
+    if (parent.empty()) {
+        parent = ".";
+    }
+    int fd = ::open(parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+} // namespace
+
+bool DurableFile::Open(const std::string& filePath, bool truncate) {
+    Close();
+
+    int fd = ::open(filePath.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (::fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    m_fd = fd;
+    m_size = static_cast<std::uint64_t>(info.st_size);
+    return true;
+}
+
+void DurableFile::Close() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_size = 0;
+}
+
+bool DurableFile::IsOpen() const {
+    return m_fd >= 0;
+}
+
+bool DurableFile::Append(const void* data, std::size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(m_fd, bytes, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+        m_size += static_cast<std::uint64_t>(written);
+    }
+    return true;
+}
+
+bool DurableFile::Truncate(std::uint64_t size) {
+    if (::ftruncate(m_fd, static_cast<off_t>(size)) != 0) {
+        return false;
+    }
+    m_size = size;
+    return true;
+}
+
+bool DurableFile::Sync() {
+#if defined(__APPLE__)
+    return ::fsync(m_fd) == 0;
+#else
+    return ::fdatasync(m_fd) == 0;
+#endif
+}
+
+bool DurableFile::Replace(const std::string& from, const std::string& to) {
+    if (::rename(from.c_str(), to.c_str()) != 0) {
+        return false;
+    }
+    return SyncParentDirectory(to);
+}
+
+#endif
+
+bool DurableFile::WriteAtomically(const std::string& filePath, const void* data, std::size_t size) {
+    const std::string tempPath = filePath + ".tmp";
+
+    DurableFile file;
+    if (!file.Open(tempPath, true) || !file.Append(data, size) || !file.Sync()) {
+        file.Close();
+        std::error_code ec;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    file.Close();
+
+    if (!Replace(tempPath, filePath)) {
+        std::error_code ec;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,269 @@
+#include "GraphExecutor.h"
+#include "TravelTimeTable.h"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+// Edge a route takes from one node to the next, either way round if bidirectional
+const Edge* ArrivalEdge(const MotionConfigVersion& version, const std::string& graphName, const std::string& from, const std::string& to) {
+    for (const Edge* edge : version.GetEdgesBySource(graphName, from)) {
+        if (edge->Target == to) {
+            return edge;
+        }
+    }
+    for (const Edge* edge : version.GetEdgesBySource(graphName, to)) {
+        if (edge->Target == from && edge->Conditions.IsBidirectional) {
+            return edge;
+        }
+    }
+    return nullptr;
+}
+
+double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool Perform(const GraphExecutor::MoveHandler& handler, const MotionTask& task) {
+    try {
+        return handler(task);
+    }
+    catch (const std::exception& ex) {
+        std::cerr << "Move of " << task.Device << " failed: " << ex.what() << std::endl;
+        return false;
+    }
+}
+
+} // namespace
+
+MotionPlan::MotionPlan(MotionConfigVersionPtr version, const std::string& graphName)
+    : m_version(std::move(version)), m_graphName(graphName) {
+    if (!m_version || !m_version->GetGraph(graphName)) {
+        throw std::runtime_error("Graph " + graphName + " not found");
+    }
+}
+
+void MotionPlan::SetStart(const std::string& nodeId) {
+    const Node* node = m_version->GetNodeById(m_graphName, nodeId);
+    if (!node) {
+        throw std::runtime_error("Node " + nodeId + " not found in graph " + m_graphName);
+    }
+    auto it = m_devices.find(node->Device);
+    if (it == m_devices.end()) {
+        m_devices.emplace(node->Device, DeviceState{ nodeId, ExecutionResult::NoTask });
+    }
+    else {
+        it->second.NodeId = nodeId;
+    }
+}
+
+std::size_t MotionPlan::MoveTo(const std::string& nodeId) {
+    const Node* target = m_version->GetNodeById(m_graphName, nodeId);
+    if (!target) {
+        throw std::runtime_error("Node " + nodeId + " not found in graph " + m_graphName);
+    }
+    auto state = m_devices.find(target->Device);
+    if (state == m_devices.end()) {
+        throw std::runtime_error("No start node for device " + target->Device);
+    }
+
+    auto path = m_version->FindPath(m_graphName, state->second.NodeId, nodeId, PathMetric::TravelTime);
+    if (path.empty()) {
+        throw std::runtime_error("No route from " + state->second.NodeId + " to " + nodeId + " in graph " + m_graphName);
+    }
+
+    MotionTask task;
+    task.Device = target->Device;
+    const Settings& settings = m_version->GetSettings();
+    const PositionStruct* previous = nullptr;
+    const Node* previousNode = nullptr;
+    for (const Node& node : path) {
+        auto position = m_version->GetNamedPosition(node.Device, node.Position);
+        if (node.Device != task.Device || !position) {
+            throw std::runtime_error("Node " + node.Id + " on the route to " + nodeId + " has no position of device " + task.Device);
+        }
+        if (previous) {
+            const Edge* edge = ArrivalEdge(*m_version, m_graphName, previousNode->Id, node.Id);
+            const EdgeConditions conditions = edge ? edge->Conditions : EdgeConditions();
+            task.Route.push_back({ node.Id, node.Position, position->get(), conditions.CornerTolerance, conditions.TimeoutSeconds });
+            task.EstimatedSeconds += TravelTimeTable::EstimateMoveTime(*previous, position->get(), settings);
+        }
+        previous = &position->get();
+        previousNode = &node;
+    }
+    if (state->second.LastTask != ExecutionResult::NoTask) {
+        task.Prerequisites.push_back(state->second.LastTask);
+    }
+
+    m_tasks.push_back(std::move(task));
+    state->second = { nodeId, m_tasks.size() - 1 };
+    return m_tasks.size() - 1;
+}
+
+void MotionPlan::AddDependency(std::size_t task, std::size_t prerequisite) {
+    if (task >= m_tasks.size() || prerequisite >= task) {
+        throw std::runtime_error("A task can only depend on a task planned before it");
+    }
+    std::vector<std::size_t>& prerequisites = m_tasks[task].Prerequisites;
+    if (std::find(prerequisites.begin(), prerequisites.end(), prerequisite) == prerequisites.end()) {
+        prerequisites.push_back(prerequisite);
+    }
+}
+
+double MotionPlan::EstimateSerialSeconds() const {
+    double total = 0.0;
+    for (const MotionTask& task : m_tasks) {
+        total += task.EstimatedSeconds;
+    }
+    return total;
+}
+
+double MotionPlan::EstimateCriticalPathSeconds() const {
+    // Prerequisites come first, so one pass in plan order finds every finish time
+    std::vector<double> finish(m_tasks.size(), 0.0);
+    double longest = 0.0;
+    for (std::size_t i = 0; i < m_tasks.size(); ++i) {
+        double start = 0.0;
+        for (std::size_t prerequisite : m_tasks[i].Prerequisites) {
+            start = std::max(start, finish[prerequisite]);
+        }
+        finish[i] = start + m_tasks[i].EstimatedSeconds;
+        longest = std::max(longest, finish[i]);
+    }
+    return longest;
+}
+
+GraphExecutor::GraphExecutor(MoveHandler handler)
+    : m_handler(std::move(handler)) {
+}
+
+GraphExecutor::~GraphExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    for (auto& [name, worker] : m_workers) {
+        worker->Ready.notify_one();
+        worker->Thread.join();
+    }
+}
+
+GraphExecutor::Worker& GraphExecutor::WorkerFor(const std::string& deviceName) {
+    std::unique_ptr<Worker>& worker = m_workers[deviceName];
+    if (!worker) {
+        worker = std::make_unique<Worker>();
+        worker->Thread = std::thread(&GraphExecutor::WorkerLoop, this, std::ref(*worker));
+    }
+    return *worker;
+}
+
+void GraphExecutor::Dispatch(std::size_t task) {
+    Worker& worker = WorkerFor(m_plan->Tasks()[task].Device);
+    worker.Queue.push_back(task);
+    ++m_running;
+    worker.Ready.notify_one();
+}
+
+ExecutionResult GraphExecutor::Run(const MotionPlan& plan) {
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+    const std::vector<MotionTask>& tasks = plan.Tasks();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_plan = &plan;
+    m_result = ExecutionResult();
+    m_result.Tasks.resize(tasks.size());
+    m_waitingOn.assign(tasks.size(), 0);
+    m_dependents.assign(tasks.size(), {});
+    m_finished = 0;
+    m_running = 0;
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        m_waitingOn[i] = tasks[i].Prerequisites.size();
+        for (std::size_t prerequisite : tasks[i].Prerequisites) {
+            m_dependents[prerequisite].push_back(i);
+        }
+    }
+
+    m_start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        if (m_waitingOn[i] == 0) {
+            Dispatch(i);
+        }
+    }
+    m_progress.wait(lock, [this, &tasks] {
+        return m_running == 0 && (m_finished == tasks.size() || m_result.FailedTask != ExecutionResult::NoTask);
+    });
+
+    m_result.Seconds = SecondsSince(m_start);
+    m_result.Success = m_result.FailedTask == ExecutionResult::NoTask;
+    m_plan = nullptr;
+    return std::move(m_result);
+}
+
+void GraphExecutor::WorkerLoop(Worker& worker) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        worker.Ready.wait(lock, [this, &worker] { return m_stopping || !worker.Queue.empty(); });
+        if (worker.Queue.empty()) {
+            return;
+        }
+        const std::size_t index = worker.Queue.front();
+        worker.Queue.pop_front();
+        const MotionTask& task = m_plan->Tasks()[index];
+        TaskTiming& timing = m_result.Tasks[index];
+        timing.Ran = true;
+        timing.Start = SecondsSince(m_start);
+
+        lock.unlock();
+        const bool succeeded = Perform(m_handler, task);
+        lock.lock();
+
+        timing.End = SecondsSince(m_start);
+        timing.Succeeded = succeeded;
+        --m_running;
+        ++m_finished;
+        if (!succeeded) {
+            if (m_result.FailedTask == ExecutionResult::NoTask) {
+                m_result.FailedTask = index;
+            }
+        }
+        else if (m_result.FailedTask == ExecutionResult::NoTask) {
+            for (std::size_t dependent : m_dependents[index]) {
+                if (--m_waitingOn[dependent] == 0) {
+                    Dispatch(dependent);
+                }
+            }
+        }
+        m_progress.notify_one();
+    }
+}
+
+ExecutionResult GraphExecutor::RunSerial(const MotionPlan& plan) {
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+    const std::vector<MotionTask>& tasks = plan.Tasks();
+
+    ExecutionResult result;
+    result.Tasks.resize(tasks.size());
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < tasks.size(); ++i) {
+        TaskTiming& timing = result.Tasks[i];
+        timing.Ran = true;
+        timing.Start = SecondsSince(start);
+        timing.Succeeded = Perform(m_handler, tasks[i]);
+        timing.End = SecondsSince(start);
+        if (!timing.Succeeded) {
+            result.FailedTask = i;
+            break;
+        }
+    }
+    result.Seconds = SecondsSince(start);
+    result.Success = result.FailedTask == ExecutionResult::NoTask;
+    return result;
+}
+
+bool SimulatedRig::Move(const MotionTask& task) const {
+    std::this_thread::sleep_for(std::chrono::duration<double>(task.EstimatedSeconds * m_timeScale));
+    return true;
+}
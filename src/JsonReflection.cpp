@@ -0,0 +1,532 @@
+#include "JsonReflection.h"
+
+#include <nlohmann/json.hpp>
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+int HexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void AppendUtf8(std::string& out, std::uint32_t codepoint) {
+    if (codepoint < 0x80) {
+        out.push_back(static_cast<char>(codepoint));
+    }
+    else if (codepoint < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+    else if (codepoint < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+    else {
+        out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+    }
+}
+
+} // namespace
+
+JsonReader::JsonReader(const char* data, std::size_t size)
+    : m_begin(data), m_cursor(data), m_end(data + size) {
+}
+
+void JsonReader::SkipWhitespace() {
+    while (m_cursor < m_end && (*m_cursor == ' ' || *m_cursor == '\n' || *m_cursor == '\r' || *m_cursor == '\t')) {
+        ++m_cursor;
+    }
+}
+
+bool JsonReader::Fail(const char* message) {
+    if (m_error.empty()) {
+        m_error = message;
+        m_errorOffset = static_cast<std::size_t>(m_cursor - m_begin);
+    }
+    return false;
+}
+
+bool JsonReader::Expect(char c) {
+    SkipWhitespace();
+    if (m_cursor == m_end || *m_cursor != c) {
+        std::string message = "expected '";
+        message += c;
+        message += '\'';
+        return Fail(message.c_str());
+    }
+    ++m_cursor;
+    return true;
+}
+
+JsonReader::Token JsonReader::Peek() {
+    if (Failed()) {
+        return Token::Error;
+    }
+    SkipWhitespace();
+    if (m_cursor == m_end) {
+        return Token::End;
+    }
+    switch (*m_cursor) {
+    case '{': return Token::Object;
+    case '[': return Token::Array;
+    case '"': return Token::String;
+    case 't':
+    case 'f': return Token::Boolean;
+    case 'n': return Token::Null;
+    default:
+        return *m_cursor == '-' || IsDigit(*m_cursor) ? Token::Number : Token::Error;
+    }
+}
+
+bool JsonReader::BeginObject() {
+    if (Failed() || !Expect('{')) {
+        return false;
+    }
+    m_first = true;
+    return true;
+}
+
+bool JsonReader::NextKey(std::string_view& key) {
+    if (Failed()) {
+        return false;
+    }
+    SkipWhitespace();
+    if (m_cursor < m_end && *m_cursor == '}') {
+        ++m_cursor;
+        m_first = false;
+        return false;
+    }
+    if (!m_first && !Expect(',')) {
+        return false;
+    }
+    m_first = false;
+    SkipWhitespace();
+    return ScanKey(key) && Expect(':');
+}
+
+bool JsonReader::BeginArray() {
+    if (Failed() || !Expect('[')) {
+        return false;
+    }
+    m_first = true;
+    return true;
+}
+
+bool JsonReader::NextElement() {
+    if (Failed()) {
+        return false;
+    }
+    SkipWhitespace();
+    if (m_cursor < m_end && *m_cursor == ']') {
+        ++m_cursor;
+        m_first = false;
+        return false;
+    }
+    if (!m_first && !Expect(',')) {
+        return false;
+    }
+    m_first = false;
+    return true;
+}
+
+bool JsonReader::ScanKey(std::string_view& key) {
+    if (m_cursor == m_end || *m_cursor != '"') {
+        return Fail("expected object key");
+    }
+
+    // Most keys have no escapes and can be handed out in place
+    const char* start = m_cursor + 1;
+    for (const char* p = start; p < m_end; ++p) {
+        if (*p == '"') {
+            key = std::string_view(start, static_cast<std::size_t>(p - start));
+            m_cursor = p + 1;
+            return true;
+        }
+        if (*p == '\\' || static_cast<unsigned char>(*p) < 0x20) {
+            break;
+        }
+    }
+
+    m_keyBuffer.clear();
+    if (!ScanString(&m_keyBuffer)) {
+        return false;
+    }
+    key = m_keyBuffer;
+    return true;
+}
+
+// Decodes the string at the cursor into value, or just steps over it if value is null
+bool JsonReader::ScanString(std::string* value) {
+    if (m_cursor == m_end || *m_cursor != '"') {
+        return Fail("expected string");
+    }
+    ++m_cursor;
+
+    for (;;) {
+        const char* run = m_cursor;
+        while (m_cursor < m_end && *m_cursor != '"' && *m_cursor != '\\' && static_cast<unsigned char>(*m_cursor) >= 0x20) {
+            ++m_cursor;
+        }
+        if (value) {
+            value->append(run, m_cursor);
+        }
+        if (m_cursor == m_end) {
+            return Fail("unterminated string");
+        }
+        if (*m_cursor == '"') {
+            ++m_cursor;
+            return true;
+        }
+        if (*m_cursor != '\\') {
+            return Fail("control character in string");
+        }
+
+        if (++m_cursor == m_end) {
+            return Fail("unterminated string");
+        }
+        char decoded = 0;
+        switch (*m_cursor) {
+        case '"': decoded = '"'; break;
+        case '\\': decoded = '\\'; break;
+        case '/': decoded = '/'; break;
+        case 'b': decoded = '\b'; break;
+        case 'f': decoded = '\f'; break;
+        case 'n': decoded = '\n'; break;
+        case 'r': decoded = '\r'; break;
+        case 't': decoded = '\t'; break;
+        case 'u': {
+            auto readHex = [this](std::uint32_t& out) {
+                if (m_end - m_cursor < 5 || m_cursor[0] != 'u') {
+                    return false;
+                }
+                out = 0;
+                for (int i = 1; i <= 4; ++i) {
+                    const int digit = HexValue(m_cursor[i]);
+                    if (digit < 0) {
+                        return false;
+                    }
+                    out = (out << 4) | static_cast<std::uint32_t>(digit);
+                }
+                m_cursor += 5;
+                return true;
+            };
+            std::uint32_t codepoint;
+            if (!readHex(codepoint)) {
+                return Fail("invalid \\u escape");
+            }
+            if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                std::uint32_t low;
+                if (m_end - m_cursor < 6 || m_cursor[0] != '\\' || (++m_cursor, !readHex(low)) || low < 0xDC00 || low > 0xDFFF) {
+                    return Fail("unpaired UTF-16 surrogate");
+                }
+                codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+            }
+            else if (codepoint >= 0xDC00 && codepoint <= 0xDFFF) {
+                return Fail("unpaired UTF-16 surrogate");
+            }
+            if (value) {
+                AppendUtf8(*value, codepoint);
+            }
+            continue;
+        }
+        default:
+            return Fail("invalid escape");
+        }
+        if (value) {
+            value->push_back(decoded);
+        }
+        ++m_cursor;
+    }
+}
+
+bool JsonReader::ScanNumber(std::string_view& text) {
+    const char* start = m_cursor;
+    const char* p = m_cursor;
+    if (p < m_end && *p == '-') {
+        ++p;
+    }
+    if (p < m_end && *p == '0') {
+        ++p;
+    }
+    else if (p < m_end && IsDigit(*p)) {
+        while (p < m_end && IsDigit(*p)) ++p;
+    }
+    else {
+        return Fail("invalid number");
+    }
+    if (p < m_end && *p == '.') {
+        ++p;
+        if (p == m_end || !IsDigit(*p)) {
+            m_cursor = p;
+            return Fail("invalid number");
+        }
+        while (p < m_end && IsDigit(*p)) ++p;
+    }
+    if (p < m_end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        if (p < m_end && (*p == '+' || *p == '-')) {
+            ++p;
+        }
+        if (p == m_end || !IsDigit(*p)) {
+            m_cursor = p;
+            return Fail("invalid number");
+        }
+        while (p < m_end && IsDigit(*p)) ++p;
+    }
+    text = std::string_view(start, static_cast<std::size_t>(p - start));
+    m_cursor = p;
+    return true;
+}
+
+bool JsonReader::ScanLiteral(std::string_view literal) {
+    if (static_cast<std::size_t>(m_end - m_cursor) < literal.size() || std::memcmp(m_cursor, literal.data(), literal.size()) != 0) {
+        return Fail("invalid literal");
+    }
+    m_cursor += literal.size();
+    return true;
+}
+
+bool JsonReader::ReadString(std::string& value) {
+    if (Peek() != Token::String) {
+        return Fail("expected string");
+    }
+    value.clear();
+    return ScanString(&value);
+}
+
+bool JsonReader::ReadNumber(double& value) {
+    if (Peek() != Token::Number) {
+        return Fail("expected number");
+    }
+    std::string_view text;
+    if (!ScanNumber(text)) {
+        return false;
+    }
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec == std::errc::result_out_of_range) {
+        // Rare; let strtod tell underflow (accepted, rounds toward zero) from overflow
+        value = std::strtod(std::string(text).c_str(), nullptr);
+        return std::isfinite(value) || Fail("number overflow");
+    }
+    return result.ec == std::errc() || Fail("invalid number");
+}
+
+bool JsonReader::ReadInteger(int& value) {
+    double number;
+    if (!ReadNumber(number)) {
+        return false;
+    }
+    // The conversion is undefined outside int's range, and would drop a fraction
+    if (!std::isfinite(number) || std::trunc(number) != number ||
+        number < static_cast<double>(std::numeric_limits<int>::min()) ||
+        number > static_cast<double>(std::numeric_limits<int>::max())) {
+        return Fail("integer out of range");
+    }
+    value = static_cast<int>(number);
+    return true;
+}
+
+bool JsonReader::ReadBoolean(bool& value) {
+    if (Peek() != Token::Boolean) {
+        return Fail("expected boolean");
+    }
+    value = *m_cursor == 't';
+    return ScanLiteral(value ? "true" : "false");
+}
+
+bool JsonReader::SkipValue() {
+    // Iterative, so hostile nesting can't exhaust the stack
+    std::vector<bool> open;  // true for objects
+    std::string_view key;
+    do {
+        switch (Peek()) {
+        case Token::Object:
+            BeginObject();
+            open.push_back(true);
+            break;
+        case Token::Array:
+            BeginArray();
+            open.push_back(false);
+            break;
+        case Token::String:
+            ScanString(nullptr);
+            break;
+        case Token::Number: {
+            std::string_view text;
+            ScanNumber(text);
+            break;
+        }
+        case Token::Boolean:
+            ScanLiteral(*m_cursor == 't' ? "true" : "false");
+            break;
+        case Token::Null:
+            ScanLiteral("null");
+            break;
+        case Token::End:
+            return Fail("unexpected end of input");
+        case Token::Error:
+            return Fail("unexpected character");
+        }
+
+        while (!open.empty()) {
+            const bool more = open.back() ? NextKey(key) : NextElement();
+            if (Failed()) {
+                return false;
+            }
+            if (more) {
+                break;
+            }
+            open.pop_back();
+        }
+    } while (!open.empty() && !Failed());
+    return !Failed();
+}
+
+bool JsonReader::AtEnd() {
+    SkipWhitespace();
+    return m_cursor == m_end;
+}
+
+bool ReadJson(JsonReader& reader, double& value) {
+    if (reader.Peek() != JsonReader::Token::Number) {
+        return reader.SkipValue();
+    }
+    return reader.ReadNumber(value);
+}
+
+bool ReadJson(JsonReader& reader, int& value) {
+    if (reader.Peek() != JsonReader::Token::Number) {
+        return reader.SkipValue();
+    }
+    return reader.ReadInteger(value);
+}
+
+bool ReadJson(JsonReader& reader, bool& value) {
+    if (reader.Peek() != JsonReader::Token::Boolean) {
+        return reader.SkipValue();
+    }
+    return reader.ReadBoolean(value);
+}
+
+bool ReadJson(JsonReader& reader, std::string& value) {
+    if (reader.Peek() != JsonReader::Token::String) {
+        return reader.SkipValue();
+    }
+    return reader.ReadString(value);
+}
+
+void JsonWriter::NewLine(std::size_t depth) {
+    m_out.push_back('\n');
+    m_out.append(depth * 2, ' ');
+}
+
+void JsonWriter::BeginObject() {
+    m_out.push_back('{');
+    m_counts.push_back(0);
+}
+
+void JsonWriter::Key(std::string_view key) {
+    if (m_counts.back()++ > 0) {
+        m_out.push_back(',');
+    }
+    NewLine(m_counts.size());
+    String(key);
+    m_out.append(": ");
+}
+
+void JsonWriter::EndObject() {
+    if (m_counts.back() > 0) {
+        NewLine(m_counts.size() - 1);
+    }
+    m_counts.pop_back();
+    m_out.push_back('}');
+}
+
+void JsonWriter::BeginArray() {
+    m_out.push_back('[');
+    m_counts.push_back(0);
+}
+
+void JsonWriter::Element() {
+    if (m_counts.back()++ > 0) {
+        m_out.push_back(',');
+    }
+    NewLine(m_counts.size());
+}
+
+void JsonWriter::EndArray() {
+    if (m_counts.back() > 0) {
+        NewLine(m_counts.size() - 1);
+    }
+    m_counts.pop_back();
+    m_out.push_back(']');
+}
+
+// Same escaping as nlohmann::json::dump without ensure_ascii
+void JsonWriter::String(std::string_view value) {
+    static const char hex[] = "0123456789abcdef";
+    m_out.push_back('"');
+    const char* run = value.data();
+    const char* end = value.data() + value.size();
+    for (const char* p = run; p < end; ++p) {
+        const unsigned char c = static_cast<unsigned char>(*p);
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        m_out.append(run, p);
+        run = p + 1;
+        switch (c) {
+        case '"': m_out.append("\\\""); break;
+        case '\\': m_out.append("\\\\"); break;
+        case '\b': m_out.append("\\b"); break;
+        case '\f': m_out.append("\\f"); break;
+        case '\n': m_out.append("\\n"); break;
+        case '\r': m_out.append("\\r"); break;
+        case '\t': m_out.append("\\t"); break;
+        default: {
+            const char escape[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            m_out.append(escape, sizeof(escape));
+            break;
+        }
+        }
+    }
+    m_out.append(run, end);
+    m_out.push_back('"');
+}
+
+void JsonWriter::Number(double value) {
+    if (!std::isfinite(value)) {
+        m_out.append("null");
+        return;
+    }
+    char buffer[64];
+    char* end = ::nlohmann::detail::to_chars(buffer, buffer + sizeof(buffer), value);
+    m_out.append(buffer, end);
+}
+
+void JsonWriter::Integer(long long value) {
+    char buffer[24];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    m_out.append(buffer, result.ptr);
+}
+
+void JsonWriter::Boolean(bool value) {
+    m_out.append(value ? "true" : "false");
+}
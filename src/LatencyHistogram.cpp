@@ -0,0 +1,80 @@
+#include "LatencyHistogram.h"
+
+#include <sstream>
+
+namespace {
+
+std::size_t BucketOf(std::int64_t microseconds) {
+    std::size_t bucket = 0;
+    while (microseconds > 0 && bucket + 1 < LatencyHistogram::BucketCount) {
+        microseconds >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+// Exclusive upper bound of a bucket, in microseconds
+std::int64_t BucketLimit(std::size_t bucket) {
+    return std::int64_t(1) << bucket;
+}
+
+} // namespace
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) {
+    const std::int64_t ns = latency.count() < 0 ? 0 : latency.count();
+    m_buckets[BucketOf(ns / 1000)].fetch_add(1, std::memory_order_relaxed);
+    m_totalNs.fetch_add(static_cast<std::uint64_t>(ns), std::memory_order_relaxed);
+    std::int64_t max = m_maxNs.load(std::memory_order_relaxed);
+    while (ns > max && !m_maxNs.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::Reset() {
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_totalNs.store(0, std::memory_order_relaxed);
+    m_maxNs.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t LatencyHistogram::Count() const {
+    std::uint64_t count = 0;
+    for (const auto& bucket : m_buckets) {
+        count += bucket.load(std::memory_order_relaxed);
+    }
+    return count;
+}
+
+std::chrono::nanoseconds LatencyHistogram::Mean() const {
+    const std::uint64_t count = Count();
+    return std::chrono::nanoseconds(count == 0 ? 0 : static_cast<std::int64_t>(m_totalNs.load(std::memory_order_relaxed) / count));
+}
+
+std::chrono::microseconds LatencyHistogram::Percentile(double fraction) const {
+    const std::uint64_t count = Count();
+    if (count == 0) {
+        return std::chrono::microseconds(0);
+    }
+    const double wanted = fraction * static_cast<double>(count);
+    std::uint64_t seen = 0;
+    for (std::size_t bucket = 0; bucket < BucketCount; ++bucket) {
+        seen += m_buckets[bucket].load(std::memory_order_relaxed);
+        if (static_cast<double>(seen) >= wanted) {
+            return std::chrono::microseconds(BucketLimit(bucket));
+        }
+    }
+    return std::chrono::microseconds(BucketLimit(BucketCount - 1));
+}
+
+std::string LatencyHistogram::Format() const {
+    std::ostringstream out;
+    out << Count() << " samples, mean " << Mean().count() / 1000.0 << " us, p50 < " << Percentile(0.5).count()
+        << " us, p99 < " << Percentile(0.99).count() << " us, max " << Max().count() / 1000.0 << " us\n";
+    for (std::size_t bucket = 0; bucket < BucketCount; ++bucket) {
+        const std::uint64_t samples = m_buckets[bucket].load(std::memory_order_relaxed);
+        if (samples > 0) {
+            out << "  < " << BucketLimit(bucket) << " us: " << samples << "\n";
+        }
+    }
+    return out.str();
+}
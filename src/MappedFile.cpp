@@ -0,0 +1,296 @@
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& filePath) {
+    Open(filePath);
+}
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Close();
+        m_data = std::exchange(other.m_data, nullptr);
+        m_size = std::exchange(other.m_size, 0);
+        m_isEmptyFile = std::exchange(other.m_isEmptyFile, false);
+#ifdef _WIN32
+        m_fileHandle = std::exchange(other.m_fileHandle, nullptr);
+        m_mappingHandle = std::exchange(other.m_mappingHandle, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& filePath) {
+    Close();
+
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    if (size.QuadPart == 0) {
+        // Zero-length files can't be mapped on Windows
+        CloseHandle(file);
+        m_isEmptyFile = true;
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        CloseHandle(file);
+        return false;
+    }
+
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    m_fileHandle = file;
+    m_mappingHandle = mapping;
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<std::size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle) {
+        CloseHandle(m_mappingHandle);
+    }
+    if (m_fileHandle) {
+        CloseHandle(m_fileHandle);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_isEmptyFile = false;
+    m_fileHandle = nullptr;
+    m_mappingHandle = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& filePath) {
+    Close();
+
+    int fd = ::open(filePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    if (st.st_size == 0) {
+        ::close(fd);
+        m_isEmptyFile = true;
+        return true;
+    }
+
+    void* view = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+
+    ::madvise(view, static_cast<std::size_t>(st.st_size), MADV_SEQUENTIAL);
+
+    m_data = static_cast<const char*>(view);
+    m_size = static_cast<std::size_t>(st.st_size);
+    return true;
+}
+
+void MappedFile::Close() {
+    if (m_data) {
+        ::munmap(const_cast<char*>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+    m_isEmptyFile = false;
+}
+
+#endif
+
+WritableMappedFile::~WritableMappedFile() {
+    Close();
+}
+
+#ifdef _WIN32
+
+bool WritableMappedFile::Open(const std::string& filePath, std::size_t minimumSize) {
+    Close();
+
+    HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    m_fileHandle = file;
+    if (!Map(std::max(static_cast<std::size_t>(size.QuadPart), minimumSize))) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool WritableMappedFile::Map(std::size_t size) {
+    // A mapping larger than the file extends it
+    const unsigned long long length = size;
+    HANDLE mapping = CreateFileMappingA(m_fileHandle, nullptr, PAGE_READWRITE, static_cast<DWORD>(length >> 32),
+        static_cast<DWORD>(length & 0xFFFFFFFFu), nullptr);
+    if (mapping == nullptr) {
+        return false;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        return false;
+    }
+    m_mappingHandle = mapping;
+    m_data = static_cast<char*>(view);
+    m_size = size;
+    return true;
+}
+
+void WritableMappedFile::Unmap() {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mappingHandle) {
+        CloseHandle(m_mappingHandle);
+    }
+    m_data = nullptr;
+    m_mappingHandle = nullptr;
+    m_size = 0;
+}
+
+void WritableMappedFile::Close() {
+    Unmap();
+    if (m_fileHandle) {
+        CloseHandle(m_fileHandle);
+    }
+    m_fileHandle = nullptr;
+}
+
+bool WritableMappedFile::Reserve(std::size_t size) {
+    if (!m_fileHandle) {
+        return false;
+    }
+    if (size <= m_size) {
+        return true;
+    }
+    Unmap();
+    return Map(size);
+}
+
+bool WritableMappedFile::Flush() {
+    return m_data && FlushViewOfFile(m_data, 0) && FlushFileBuffers(m_fileHandle);
+}
+
+#else
+
+bool WritableMappedFile::Open(const std::string& filePath, std::size_t minimumSize) {
+    Close();
+
+    int fd = ::open(filePath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    m_fd = fd;
+    const std::size_t size = std::max(static_cast<std::size_t>(st.st_size), minimumSize);
+    if ((size > static_cast<std::size_t>(st.st_size) && ::ftruncate(fd, static_cast<off_t>(size)) != 0) || !Map(size)) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+bool WritableMappedFile::Map(std::size_t size) {
+    void* view = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (view == MAP_FAILED) {
+        return false;
+    }
+    m_data = static_cast<char*>(view);
+    m_size = size;
+    return true;
+}
+
+void WritableMappedFile::Unmap() {
+    if (m_data) {
+        ::munmap(m_data, m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
+
+void WritableMappedFile::Close() {
+    Unmap();
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+}
+
+bool WritableMappedFile::Reserve(std::size_t size) {
+    if (m_fd < 0) {
+        return false;
+    }
+    if (size <= m_size) {
+        return true;
+    }
+    Unmap();
+    return ::ftruncate(m_fd, static_cast<off_t>(size)) == 0 && Map(size);
+}
+
+bool WritableMappedFile::Flush() {
+    return m_data && ::msync(m_data, m_size, MS_SYNC) == 0;
+}
+
+#endif
@@ -0,0 +1,306 @@
+#include "MotionConfigIndex.h"
+
+#include <functional>
+
+void FlatNameTable::Clear() {
+    m_slots.clear();
+    m_names.clear();
+    m_mask = 0;
+}
+
+void FlatNameTable::Reserve(std::size_t count) {
+    m_names.reserve(count);
+    // Keep the load factor at or below one half
+    std::size_t slotCount = 16;
+    while (slotCount < count * 2) {
+        slotCount *= 2;
+    }
+    if (slotCount > m_slots.size()) {
+        Rehash(slotCount);
+    }
+}
+
+std::uint32_t FlatNameTable::HashName(std::string_view name) {
+    // Widened first: shifting a 32-bit size_t by 32 is undefined
+    const std::uint64_t hash = std::hash<std::string_view>{}(name);
+    return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+}
+
+void FlatNameTable::Rehash(std::size_t slotCount) {
+    std::vector<Slot> slots(slotCount);
+    std::size_t mask = slotCount - 1;
+    for (const Slot& slot : m_slots) {
+        if (slot.Id == InvalidIndex) {
+            continue;
+        }
+        std::size_t i = slot.Hash & mask;
+        while (slots[i].Id != InvalidIndex) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+    m_slots = std::move(slots);
+    m_mask = mask;
+}
+
+std::uint32_t FlatNameTable::Intern(std::string_view name) {
+    if ((m_names.size() + 1) * 2 > m_slots.size()) {
+        Rehash(m_slots.empty() ? 16 : m_slots.size() * 2);
+    }
+
+    const std::uint32_t hash = HashName(name);
+    std::size_t i = hash & m_mask;
+    while (m_slots[i].Id != InvalidIndex) {
+        if (m_slots[i].Hash == hash && m_names[m_slots[i].Id] == name) {
+            return m_slots[i].Id;
+        }
+        i = (i + 1) & m_mask;
+    }
+
+    const std::uint32_t id = static_cast<std::uint32_t>(m_names.size());
+    m_names.emplace_back(name);
+    m_slots[i] = { hash, id };
+    return id;
+}
+
+std::uint32_t FlatNameTable::Find(std::string_view name) const {
+    if (m_slots.empty()) {
+        return InvalidIndex;
+    }
+
+    const std::uint32_t hash = HashName(name);
+    std::size_t i = hash & m_mask;
+    while (m_slots[i].Id != InvalidIndex) {
+        if (m_slots[i].Hash == hash && m_names[m_slots[i].Id] == name) {
+            return m_slots[i].Id;
+        }
+        i = (i + 1) & m_mask;
+    }
+    return InvalidIndex;
+}
+
+void DeviceIndex::Build(std::shared_ptr<const MotionDevice> device) {
+    Source = std::move(device);
+    Generation = MotionConfigIndex::NextGeneration();
+    PositionNames.Clear();
+    PositionNames.Reserve(Source->Positions.size());
+    Positions.clear();
+    Positions.reserve(Source->Positions.size());
+    for (const auto& [positionName, position] : Source->Positions) {
+        PositionNames.Intern(positionName);
+        Positions.push_back(position);
+    }
+    Spatial.Build(Positions);
+}
+
+void GraphIndex::Build(std::shared_ptr<const Graph> graphPtr) {
+    *this = GraphIndex();
+    Owner = std::move(graphPtr);
+    Source = Owner.get();
+    Generation = MotionConfigIndex::NextGeneration();
+    const Graph& graph = *Source;
+    const std::size_t nodeCount = graph.Nodes.size();
+    const std::size_t edgeCount = graph.Edges.size();
+
+    // Duplicate node ids resolve to the first occurrence, matching a linear search
+    NodeIds.Reserve(nodeCount);
+    NodeIndex.reserve(nodeCount);
+    for (std::uint32_t i = 0; i < nodeCount; ++i) {
+        if (NodeIds.Intern(graph.Nodes[i].Id) == NodeIndex.size()) {
+            NodeIndex.push_back(i);
+        }
+    }
+
+    EdgeIds.Reserve(edgeCount);
+    EdgeIndex.reserve(edgeCount);
+    EdgeSource.reserve(edgeCount);
+    EdgeTarget.reserve(edgeCount);
+    for (std::uint32_t i = 0; i < edgeCount; ++i) {
+        const Edge& edge = graph.Edges[i];
+        if (EdgeIds.Intern(edge.Id) == EdgeIndex.size()) {
+            EdgeIndex.push_back(i);
+        }
+        EdgeSource.push_back(FindNode(edge.Source));
+        EdgeTarget.push_back(FindNode(edge.Target));
+    }
+
+    // Counting pass, prefix sum, then fill. Cursors walk each row forward so
+    // rows keep the declaration order of the edges.
+    OutEdgeOffsets.assign(nodeCount + 1, 0);
+    AdjacencyOffsets.assign(nodeCount + 1, 0);
+    for (std::size_t e = 0; e < edgeCount; ++e) {
+        const std::uint32_t source = EdgeSource[e];
+        const std::uint32_t target = EdgeTarget[e];
+        if (source == InvalidIndex) {
+            continue;
+        }
+        ++OutEdgeOffsets[source + 1];
+        if (target == InvalidIndex) {
+            continue;
+        }
+        ++AdjacencyOffsets[source + 1];
+        if (graph.Edges[e].Conditions.IsBidirectional) {
+            ++AdjacencyOffsets[target + 1];
+        }
+    }
+    for (std::size_t n = 0; n < nodeCount; ++n) {
+        OutEdgeOffsets[n + 1] += OutEdgeOffsets[n];
+        AdjacencyOffsets[n + 1] += AdjacencyOffsets[n];
+    }
+
+    OutEdges.resize(OutEdgeOffsets[nodeCount]);
+    AdjacencyNodes.resize(AdjacencyOffsets[nodeCount]);
+    AdjacencyEdges.resize(AdjacencyOffsets[nodeCount]);
+    std::vector<std::uint32_t> outCursor(OutEdgeOffsets.begin(), OutEdgeOffsets.end() - 1);
+    std::vector<std::uint32_t> adjacencyCursor(AdjacencyOffsets.begin(), AdjacencyOffsets.end() - 1);
+    for (std::uint32_t e = 0; e < edgeCount; ++e) {
+        const std::uint32_t source = EdgeSource[e];
+        const std::uint32_t target = EdgeTarget[e];
+        if (source == InvalidIndex) {
+            continue;
+        }
+        OutEdges[outCursor[source]++] = &graph.Edges[e];
+        if (target == InvalidIndex) {
+            continue;
+        }
+        AdjacencyNodes[adjacencyCursor[source]] = target;
+        AdjacencyEdges[adjacencyCursor[source]++] = e;
+        if (graph.Edges[e].Conditions.IsBidirectional) {
+            AdjacencyNodes[adjacencyCursor[target]] = source;
+            AdjacencyEdges[adjacencyCursor[target]++] = e;
+        }
+    }
+
+    // Device buckets, same counting-sort layout
+    std::vector<std::uint32_t> nodeBucket(nodeCount);
+    for (std::size_t n = 0; n < nodeCount; ++n) {
+        nodeBucket[n] = DeviceNames.Intern(graph.Nodes[n].Device);
+    }
+    DeviceNodeOffsets.assign(DeviceNames.Size() + 1, 0);
+    for (std::uint32_t bucket : nodeBucket) {
+        ++DeviceNodeOffsets[bucket + 1];
+    }
+    for (std::size_t b = 0; b < DeviceNames.Size(); ++b) {
+        DeviceNodeOffsets[b + 1] += DeviceNodeOffsets[b];
+    }
+    DeviceNodes.resize(nodeCount);
+    std::vector<std::uint32_t> bucketCursor(DeviceNodeOffsets.begin(), DeviceNodeOffsets.end() - 1);
+    for (std::size_t n = 0; n < nodeCount; ++n) {
+        DeviceNodes[bucketCursor[nodeBucket[n]]++] = &graph.Nodes[n];
+    }
+}
+
+std::uint32_t GraphIndex::FindNode(std::string_view nodeId) const {
+    const std::uint32_t id = NodeIds.Find(nodeId);
+    return id == InvalidIndex ? InvalidIndex : NodeIndex[id];
+}
+
+Span<const Edge* const> GraphIndex::EdgesFrom(std::uint32_t node) const {
+    if (!Source || node >= Source->Nodes.size()) {
+        return {};
+    }
+    return { OutEdges.data() + OutEdgeOffsets[node], OutEdgeOffsets[node + 1] - OutEdgeOffsets[node] };
+}
+
+Span<const std::uint32_t> GraphIndex::Neighbours(std::uint32_t node) const {
+    return { AdjacencyNodes.data() + AdjacencyOffsets[node], AdjacencyOffsets[node + 1] - AdjacencyOffsets[node] };
+}
+
+Span<const std::uint32_t> GraphIndex::NeighbourEdges(std::uint32_t node) const {
+    return { AdjacencyEdges.data() + AdjacencyOffsets[node], AdjacencyOffsets[node + 1] - AdjacencyOffsets[node] };
+}
+
+Span<const Node* const> GraphIndex::NodesOfDevice(std::string_view deviceName) const {
+    const std::uint32_t bucket = DeviceNames.Find(deviceName);
+    if (bucket == InvalidIndex) {
+        return {};
+    }
+    return { DeviceNodes.data() + DeviceNodeOffsets[bucket], DeviceNodeOffsets[bucket + 1] - DeviceNodeOffsets[bucket] };
+}
+
+std::atomic<std::uint32_t> MotionConfigIndex::s_nextGeneration{ 1 };
+
+std::uint32_t MotionConfigIndex::NextGeneration() {
+    std::uint32_t generation = s_nextGeneration.fetch_add(1, std::memory_order_relaxed);
+    // 0 marks an invalid handle; only reached after 2^32 builds
+    while (generation == 0) {
+        generation = s_nextGeneration.fetch_add(1, std::memory_order_relaxed);
+    }
+    return generation;
+}
+
+void MotionConfigIndex::Build(const SharedDeviceMap& devices, const SharedGraphMap& graphs) {
+    m_devices.clear();
+    RebuildDevices(devices);
+
+    m_graphNames.Clear();
+    m_graphs.clear();
+    m_graphNames.Reserve(graphs.size());
+    m_graphs.resize(graphs.size());
+    for (const auto& [name, graph] : graphs) {
+        auto graphIndex = std::make_shared<GraphIndex>();
+        graphIndex->Build(graph);
+        m_graphs[m_graphNames.Intern(name)] = std::move(graphIndex);
+    }
+}
+
+void MotionConfigIndex::RebuildDevices(const SharedDeviceMap& devices) {
+    // Entries of devices that weren't replaced are carried over as is
+    std::vector<std::shared_ptr<const DeviceIndex>> previous = std::move(m_devices);
+    FlatNameTable previousNames = std::move(m_deviceNames);
+
+    m_deviceNames.Clear();
+    m_deviceNames.Reserve(devices.size());
+    m_devices.clear();
+    m_devices.reserve(devices.size());
+
+    for (const auto& [name, device] : devices) {
+        m_deviceNames.Intern(name);
+
+        const std::uint32_t old = previousNames.Find(name);
+        if (old != InvalidIndex && old < previous.size() && previous[old]->Source == device) {
+            m_devices.push_back(previous[old]);
+            continue;
+        }
+
+        auto deviceIndex = std::make_shared<DeviceIndex>();
+        deviceIndex->Build(device);
+        m_devices.push_back(std::move(deviceIndex));
+    }
+}
+
+void MotionConfigIndex::RebuildGraph(const std::string& graphName, std::shared_ptr<const Graph> graph) {
+    auto graphIndex = std::make_shared<GraphIndex>();
+    graphIndex->Build(std::move(graph));
+
+    std::uint32_t graphId = m_graphNames.Intern(graphName);
+    if (graphId == m_graphs.size()) {
+        m_graphs.push_back(std::move(graphIndex));
+    }
+    else {
+        m_graphs[graphId] = std::move(graphIndex);
+    }
+}
+
+std::uint32_t MotionConfigIndex::FindPosition(std::uint32_t device, std::string_view positionName) const {
+    if (device >= m_devices.size()) {
+        return InvalidIndex;
+    }
+    return m_devices[device]->PositionNames.Find(positionName);
+}
+
+std::uint32_t MotionConfigIndex::FindNode(std::uint32_t graph, std::string_view nodeId) const {
+    if (graph >= m_graphs.size()) {
+        return InvalidIndex;
+    }
+    return m_graphs[graph]->FindNode(nodeId);
+}
+
+std::uint32_t MotionConfigIndex::FindEdge(std::uint32_t graph, std::string_view edgeId) const {
+    if (graph >= m_graphs.size()) {
+        return InvalidIndex;
+    }
+    const GraphIndex& graphIndex = *m_graphs[graph];
+    const std::uint32_t id = graphIndex.EdgeIds.Find(edgeId);
+    return id == InvalidIndex ? InvalidIndex : graphIndex.EdgeIndex[id];
+}
@@ -0,0 +1,620 @@
+#include "MotionConfigJournal.h"
+#include "MotionConfigSnapshot.h"
+#include "MappedFile.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace {
+
+constexpr char kMagic[8] = { 'U', 'A', 'A', 'M', 'J', 'N', 'L', '\0' };
+constexpr std::uint32_t kEndianTag = 0x01020304;
+
+// Upper bound on a single frame; anything larger is treated as corruption
+constexpr std::uint32_t kMaxRecordSize = 64u * 1024u * 1024u;
+
+struct SegmentHeader {
+    char Magic[8];
+    std::uint32_t Version;
+    std::uint32_t EndianTag;
+    std::uint64_t BaseHash;
+};
+
+struct FrameHeader {
+    std::uint32_t Length;
+    std::uint32_t Checksum;
+};
+
+std::uint32_t Checksum(const char* data, std::size_t size) {
+    const std::uint64_t hash = MotionConfigSnapshot::HashBytes(data, size);
+    return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+}
+
+class RecordWriter {
+public:
+    explicit RecordWriter(std::string& out) : m_out(out) {}
+
+    template <typename T>
+    void Put(T value) {
+        m_out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void Put(const std::string& value) {
+        Put(static_cast<std::uint32_t>(value.size()));
+        m_out.append(value);
+    }
+
+    void Put(const PositionStruct& position) {
+        Put(position.x); Put(position.y); Put(position.z);
+        Put(position.u); Put(position.v); Put(position.w);
+    }
+
+    void Put(const MotionDevice& device) {
+        Put(static_cast<std::uint8_t>(device.IsEnabled));
+        Put(device.IpAddress);
+        Put(static_cast<std::int32_t>(device.Port));
+        Put(static_cast<std::int32_t>(device.Id));
+        Put(device.Name);
+        Put(device.TypeController);
+        Put(device.InstalledAxes);
+        Put(static_cast<std::uint32_t>(device.Positions.size()));
+        for (const auto& [name, position] : device.Positions) {
+            Put(name);
+            Put(position);
+        }
+    }
+
+    void Put(const Settings& settings) {
+        Put(settings.DefaultSpeed);
+        Put(settings.DefaultAcceleration);
+        Put(settings.LogLevel);
+        Put(static_cast<std::uint8_t>(settings.AutoReconnect));
+        Put(static_cast<std::int32_t>(settings.ConnectionTimeout));
+        Put(settings.PositionTolerance);
+    }
+
+    void Put(const Graph& graph) {
+        Put(static_cast<std::uint32_t>(graph.Nodes.size()));
+        for (const Node& node : graph.Nodes) {
+            Put(node.Id); Put(node.Label); Put(node.Device); Put(node.Position);
+            Put(static_cast<std::int32_t>(node.X));
+            Put(static_cast<std::int32_t>(node.Y));
+        }
+        Put(static_cast<std::uint32_t>(graph.Edges.size()));
+        for (const Edge& edge : graph.Edges) {
+            Put(edge.Id); Put(edge.Source); Put(edge.Target); Put(edge.Label);
+            Put(static_cast<std::uint8_t>(edge.Conditions.RequiresOperatorApproval));
+            Put(static_cast<std::int32_t>(edge.Conditions.TimeoutSeconds));
+            Put(static_cast<std::uint8_t>(edge.Conditions.IsBidirectional));
+            Put(edge.Conditions.CornerTolerance);
+        }
+    }
+
+private:
+    std::string& m_out;
+};
+
+// Bounds-checked reader; every Get returns false once the input is exhausted
+class RecordReader {
+public:
+    RecordReader(const char* data, std::size_t size) : m_data(data), m_size(size) {}
+
+    template <typename T>
+    bool Get(T& value) {
+        if (m_size - m_offset < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&value, m_data + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    bool Get(std::string& value) {
+        std::uint32_t length = 0;
+        if (!Get(length) || m_size - m_offset < length) {
+            return false;
+        }
+        value.assign(m_data + m_offset, length);
+        m_offset += length;
+        return true;
+    }
+
+    bool Get(bool& value) {
+        std::uint8_t byte = 0;
+        if (!Get(byte)) {
+            return false;
+        }
+        value = byte != 0;
+        return true;
+    }
+
+    bool Get(PositionStruct& position) {
+        return Get(position.x) && Get(position.y) && Get(position.z) &&
+            Get(position.u) && Get(position.v) && Get(position.w);
+    }
+
+    bool Get(MotionDevice& device) {
+        std::uint32_t positionCount = 0;
+        if (!Get(device.IsEnabled) || !Get(device.IpAddress) || !Get(device.Port) || !Get(device.Id) ||
+            !Get(device.Name) || !Get(device.TypeController) || !Get(device.InstalledAxes) || !Get(positionCount)) {
+            return false;
+        }
+        device.Positions.clear();
+        for (std::uint32_t i = 0; i < positionCount; ++i) {
+            std::string name;
+            PositionStruct position;
+            if (!Get(name) || !Get(position)) {
+                return false;
+            }
+            device.Positions.emplace_hint(device.Positions.end(), std::move(name), position);
+        }
+        return true;
+    }
+
+    bool Get(Settings& settings) {
+        return Get(settings.DefaultSpeed) && Get(settings.DefaultAcceleration) && Get(settings.LogLevel) &&
+            Get(settings.AutoReconnect) && Get(settings.ConnectionTimeout) && Get(settings.PositionTolerance);
+    }
+
+    bool Get(Graph& graph) {
+        std::uint32_t count = 0;
+        if (!Get(count) || count > m_size - m_offset) {
+            return false;
+        }
+        graph.Nodes.resize(count);
+        for (Node& node : graph.Nodes) {
+            if (!Get(node.Id) || !Get(node.Label) || !Get(node.Device) || !Get(node.Position) ||
+                !Get(node.X) || !Get(node.Y)) {
+                return false;
+            }
+        }
+        if (!Get(count) || count > m_size - m_offset) {
+            return false;
+        }
+        graph.Edges.resize(count);
+        for (Edge& edge : graph.Edges) {
+            if (!Get(edge.Id) || !Get(edge.Source) || !Get(edge.Target) || !Get(edge.Label) ||
+                !Get(edge.Conditions.RequiresOperatorApproval) || !Get(edge.Conditions.TimeoutSeconds) ||
+                !Get(edge.Conditions.IsBidirectional) || !Get(edge.Conditions.CornerTolerance)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool AtEnd() const { return m_offset == m_size; }
+
+private:
+    const char* m_data;
+    std::size_t m_size;
+    std::size_t m_offset = 0;
+};
+
+void EncodeRecord(const JournalRecord& record, std::string& out) {
+    const std::size_t frameStart = out.size();
+    out.append(sizeof(FrameHeader), '\0');
+
+    RecordWriter writer(out);
+    writer.Put(record.Sequence);
+    writer.Put(static_cast<std::uint8_t>(record.Op));
+    writer.Put(record.Name);
+    switch (record.Op) {
+    case JournalRecord::Type::UpdateDevice:
+    case JournalRecord::Type::AddDevice:
+        writer.Put(record.Device);
+        break;
+    case JournalRecord::Type::AddPosition:
+        writer.Put(record.PositionName);
+        writer.Put(record.Position);
+        break;
+    case JournalRecord::Type::DeletePosition:
+        writer.Put(record.PositionName);
+        break;
+    case JournalRecord::Type::DeleteDevice:
+        break;
+    case JournalRecord::Type::UpdateSettings:
+        writer.Put(record.NewSettings);
+        break;
+    case JournalRecord::Type::UpdateGraph:
+        writer.Put(record.NewGraph);
+        break;
+    }
+
+    const char* payload = out.data() + frameStart + sizeof(FrameHeader);
+    FrameHeader header;
+    header.Length = static_cast<std::uint32_t>(out.size() - frameStart - sizeof(FrameHeader));
+    header.Checksum = Checksum(payload, header.Length);
+    std::memcpy(&out[frameStart], &header, sizeof(header));
+}
+
+bool DecodeRecord(const char* data, std::size_t size, JournalRecord& record) {
+    RecordReader reader(data, size);
+    std::uint8_t op = 0;
+    if (!reader.Get(record.Sequence) || !reader.Get(op) || !reader.Get(record.Name)) {
+        return false;
+    }
+    record.Op = static_cast<JournalRecord::Type>(op);
+
+    bool ok = false;
+    switch (record.Op) {
+    case JournalRecord::Type::UpdateDevice:
+    case JournalRecord::Type::AddDevice:
+        ok = reader.Get(record.Device);
+        break;
+    case JournalRecord::Type::AddPosition:
+        ok = reader.Get(record.PositionName) && reader.Get(record.Position);
+        break;
+    case JournalRecord::Type::DeletePosition:
+        ok = reader.Get(record.PositionName);
+        break;
+    case JournalRecord::Type::DeleteDevice:
+        ok = true;
+        break;
+    case JournalRecord::Type::UpdateSettings:
+        ok = reader.Get(record.NewSettings);
+        break;
+    case JournalRecord::Type::UpdateGraph:
+        ok = reader.Get(record.NewGraph);
+        break;
+    }
+    return ok && reader.AtEnd();
+}
+
+std::string EncodeHeader(std::uint64_t baseHash) {
+    SegmentHeader header = {};
+    std::memcpy(header.Magic, kMagic, sizeof(kMagic));
+    header.Version = MotionConfigJournal::FormatVersion;
+    header.EndianTag = kEndianTag;
+    header.BaseHash = baseHash;
+    return std::string(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+struct Segment {
+    bool Exists = false;
+    std::uint64_t BaseHash = 0;
+    std::vector<JournalRecord> Records;
+    std::size_t ValidSize = 0;  // Header plus every intact frame
+    std::size_t FileSize = 0;
+};
+
+// Read a segment up to its first damaged frame
+Segment ReadSegment(const std::string& path) {
+    Segment segment;
+    std::error_code ec;
+    if (!std::filesystem::exists(path, ec)) {
+        return segment;
+    }
+    segment.Exists = true;
+
+    MappedFile file;
+    if (!file.Open(path) || file.Size() < sizeof(SegmentHeader)) {
+        return segment;
+    }
+    segment.FileSize = file.Size();
+
+    SegmentHeader header;
+    std::memcpy(&header, file.Data(), sizeof(header));
+    if (std::memcmp(header.Magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.Version != MotionConfigJournal::FormatVersion || header.EndianTag != kEndianTag) {
+        return segment;
+    }
+    segment.BaseHash = header.BaseHash;
+
+    std::size_t offset = sizeof(SegmentHeader);
+    segment.ValidSize = offset;
+    while (file.Size() - offset >= sizeof(FrameHeader)) {
+        FrameHeader frame;
+        std::memcpy(&frame, file.Data() + offset, sizeof(frame));
+        const char* payload = file.Data() + offset + sizeof(FrameHeader);
+        if (frame.Length > kMaxRecordSize || file.Size() - offset - sizeof(FrameHeader) < frame.Length ||
+            Checksum(payload, frame.Length) != frame.Checksum) {
+            break;
+        }
+
+        JournalRecord record;
+        if (!DecodeRecord(payload, frame.Length, record)) {
+            break;
+        }
+        segment.Records.push_back(std::move(record));
+        offset += sizeof(FrameHeader) + frame.Length;
+        segment.ValidSize = offset;
+    }
+    return segment;
+}
+
+} // namespace
+
+JournalRecord JournalRecord::ForDevice(Type op, const std::string& deviceName, const MotionDevice& device) {
+    JournalRecord record;
+    record.Op = op;
+    record.Name = deviceName;
+    record.Device = device;
+    return record;
+}
+
+JournalRecord JournalRecord::ForPosition(Type op, const std::string& deviceName, const std::string& positionName, const PositionStruct& position) {
+    JournalRecord record;
+    record.Op = op;
+    record.Name = deviceName;
+    record.PositionName = positionName;
+    record.Position = position;
+    return record;
+}
+
+JournalRecord JournalRecord::ForDeleteDevice(const std::string& deviceName) {
+    JournalRecord record;
+    record.Op = Type::DeleteDevice;
+    record.Name = deviceName;
+    return record;
+}
+
+JournalRecord JournalRecord::ForSettings(const Settings& settings) {
+    JournalRecord record;
+    record.Op = Type::UpdateSettings;
+    record.NewSettings = settings;
+    return record;
+}
+
+JournalRecord JournalRecord::ForGraph(const std::string& graphName, const Graph& graph) {
+    JournalRecord record;
+    record.Op = Type::UpdateGraph;
+    record.Name = graphName;
+    record.NewGraph = graph;
+    return record;
+}
+
+void JournalRecord::Apply(std::map<std::string, MotionDevice>& devices, std::map<std::string, Graph>& graphs, Settings& settings) const {
+    switch (Op) {
+    case Type::UpdateDevice:
+    case Type::AddDevice:
+        devices[Name] = Device;
+        break;
+    case Type::AddPosition: {
+        auto it = devices.find(Name);
+        if (it != devices.end()) {
+            it->second.Positions[PositionName] = Position;
+        }
+        break;
+    }
+    case Type::DeleteDevice:
+        devices.erase(Name);
+        break;
+    case Type::DeletePosition: {
+        auto it = devices.find(Name);
+        if (it != devices.end()) {
+            it->second.Positions.erase(PositionName);
+        }
+        break;
+    }
+    case Type::UpdateSettings:
+        settings = NewSettings;
+        break;
+    case Type::UpdateGraph:
+        graphs[Name] = NewGraph;
+        break;
+    }
+}
+
+std::string MotionConfigJournal::PathFor(const std::string& configFilePath) {
+    return configFilePath + ".journal";
+}
+
+bool MotionConfigJournal::Open(const std::string& journalPath, std::uint64_t baseHash, std::vector<JournalRecord>& recovered) {
+    Close();
+    m_path = journalPath;
+    recovered.clear();
+
+    Segment current = ReadSegment(m_path);
+    Segment next = ReadSegment(NextSegmentPath());
+
+    // A finished compaction leaves the base matching the newer segment; an
+    // interrupted one leaves it matching the older segment, which the newer one continues
+    if (next.Exists && next.BaseHash == baseHash && next.ValidSize > 0) {
+        recovered = std::move(next.Records);
+    }
+    else if (current.Exists && current.BaseHash == baseHash && current.ValidSize > 0) {
+        recovered = std::move(current.Records);
+        recovered.insert(recovered.end(), std::make_move_iterator(next.Records.begin()), std::make_move_iterator(next.Records.end()));
+    }
+    else if (current.Exists || next.Exists) {
+        // The configuration was replaced outside this program; its contents win
+        std::cerr << "Motion configuration journal " << m_path
+            << " does not match the configuration file and was set aside" << std::endl;
+        std::error_code ec;
+        if (current.Exists) {
+            std::filesystem::rename(m_path, m_path + ".stale", ec);
+        }
+        if (next.Exists) {
+            std::filesystem::rename(NextSegmentPath(), NextSegmentPath() + ".stale", ec);
+        }
+    }
+
+    // An aborted compaction can leave a record in both segments
+    std::stable_sort(recovered.begin(), recovered.end(),
+        [](const JournalRecord& a, const JournalRecord& b) { return a.Sequence < b.Sequence; });
+    recovered.erase(std::unique(recovered.begin(), recovered.end(),
+        [](const JournalRecord& a, const JournalRecord& b) { return a.Sequence == b.Sequence; }), recovered.end());
+
+    const bool intact = current.Exists && !next.Exists && current.BaseHash == baseHash &&
+        current.ValidSize == current.FileSize;
+    if (!intact) {
+        // Consolidate into a single clean segment before appending to it
+        std::string contents = EncodeHeader(baseHash);
+        for (const JournalRecord& record : recovered) {
+            EncodeRecord(record, contents);
+        }
+        if (!DurableFile::WriteAtomically(m_path, contents.data(), contents.size())) {
+            std::cerr << "Failed to write motion configuration journal " << m_path << std::endl;
+            return false;
+        }
+        std::error_code ec;
+        std::filesystem::remove(NextSegmentPath(), ec);
+    }
+
+    if (!m_file.Open(m_path, false)) {
+        std::cerr << "Failed to open motion configuration journal " << m_path << std::endl;
+        return false;
+    }
+
+    m_lastSequence = recovered.empty() ? 0 : recovered.back().Sequence;
+    m_syncedSequence = m_lastSequence;
+    m_compacting = false;
+    return true;
+}
+
+void MotionConfigJournal::Close() {
+    std::lock_guard<std::mutex> syncLock(m_syncMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_file.Close();
+    m_compacting = false;
+}
+
+bool MotionConfigJournal::IsOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.IsOpen();
+}
+
+std::uint64_t MotionConfigJournal::Append(std::vector<JournalRecord>& records) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.IsOpen()) {
+        return 0;
+    }
+
+    std::string frames;
+    std::uint64_t sequence = m_lastSequence;
+    for (JournalRecord& record : records) {
+        record.Sequence = ++sequence;
+        EncodeRecord(record, frames);
+    }
+    if (!m_file.Append(frames.data(), frames.size())) {
+        return 0;
+    }
+    m_lastSequence = sequence;
+    return sequence;
+}
+
+bool MotionConfigJournal::Sync(std::uint64_t sequence) {
+    // Callers queue on the sync mutex while one of them flushes; by the time the
+    // rest get in, their records have usually been covered by that flush
+    std::lock_guard<std::mutex> syncLock(m_syncMutex);
+    if (m_syncedSequence >= sequence) {
+        return true;
+    }
+
+    std::uint64_t target;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        target = m_lastSequence;
+    }
+    if (!m_file.Sync()) {
+        return false;
+    }
+    m_syncedSequence = target;
+    return true;
+}
+
+std::uint64_t MotionConfigJournal::LastSequence() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastSequence;
+}
+
+std::uint64_t MotionConfigJournal::Size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_file.Size();
+}
+
+bool MotionConfigJournal::BeginCompaction(std::uint64_t newBaseHash) {
+    std::lock_guard<std::mutex> syncLock(m_syncMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.IsOpen() || m_compacting) {
+        return false;
+    }
+
+    // Everything in the old segment must be durable before appends move on
+    if (!m_file.Sync()) {
+        return false;
+    }
+    m_syncedSequence = m_lastSequence;
+
+    DurableFile next;
+    const std::string header = EncodeHeader(newBaseHash);
+    if (!next.Open(NextSegmentPath(), true) || !next.Append(header.data(), header.size()) || !next.Sync()) {
+        next.Close();
+        std::error_code ec;
+        std::filesystem::remove(NextSegmentPath(), ec);
+        return false;
+    }
+    m_file = std::move(next);
+    m_compacting = true;
+    return true;
+}
+
+bool MotionConfigJournal::FinishCompaction() {
+    std::lock_guard<std::mutex> syncLock(m_syncMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_compacting) {
+        return false;
+    }
+    m_compacting = false;
+
+    // The open handle follows the rename, so appends continue uninterrupted
+    return DurableFile::Replace(NextSegmentPath(), m_path);
+}
+
+bool MotionConfigJournal::AbortCompaction() {
+    std::lock_guard<std::mutex> syncLock(m_syncMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_compacting) {
+        return false;
+    }
+    m_compacting = false;
+
+    // Fold the new segment's frames back into the old one. If this is interrupted,
+    // both segments are replayed and duplicate sequence numbers are skipped.
+    m_file.Close();
+    MappedFile nextFile;
+    DurableFile current;
+    bool folded = nextFile.Open(NextSegmentPath()) && current.Open(m_path, false);
+    if (folded) {
+        const std::size_t frameBytes = nextFile.Size() - sizeof(SegmentHeader);
+        folded = frameBytes == 0 || (current.Append(nextFile.Data() + sizeof(SegmentHeader), frameBytes) && current.Sync());
+    }
+    if (!folded) {
+        // Keep appending to the new segment; the next compaction starts from there
+        m_compacting = m_file.Open(NextSegmentPath(), false);
+        return false;
+    }
+    nextFile.Close();
+    m_file = std::move(current);
+
+    std::error_code ec;
+    std::filesystem::remove(NextSegmentPath(), ec);
+    return true;
+}
+
+bool MotionConfigJournal::Rebase(std::uint64_t newBaseHash, const std::vector<JournalRecord>& records) {
+    std::lock_guard<std::mutex> syncLock(m_syncMutex);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_file.IsOpen() || m_compacting) {
+        return false;
+    }
+
+    // Replaced whole, so a crash leaves either the old journal, which no longer
+    // matches the file and is set aside, or the new one
+    std::string contents = EncodeHeader(newBaseHash);
+    for (const JournalRecord& record : records) {
+        EncodeRecord(record, contents);
+    }
+    m_file.Close();
+    const bool written = DurableFile::WriteAtomically(m_path, contents.data(), contents.size());
+    if (!m_file.Open(m_path, false)) {
+        std::cerr << "Failed to reopen motion configuration journal " << m_path << std::endl;
+        return false;
+    }
+    if (written) {
+        m_syncedSequence = m_lastSequence;
+    }
+    return written;
+}
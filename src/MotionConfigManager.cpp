@@ -0,0 +1,731 @@
+#include "MotionConfigManager.h"
+#include "MotionConfigParser.h"
+#include "MotionConfigSnapshot.h"
+#include "MotionTypesReflection.h"
+#include "MappedFile.h"
+#include "DurableFile.h"
+
+#include <chrono>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+
+namespace {
+
+// Devices as the configuration file holds them, for writing its snapshot.
+// Without a product selected that's the version's cached plain map.
+const std::map<std::string, MotionDevice>& FileDevices(const MotionConfigVersion& version, std::map<std::string, MotionDevice>& scratch) {
+    if (!version.Overlay()) {
+        return version.GetAllDevices();
+    }
+    for (const auto& [name, device] : version.BaseDevices()) {
+        scratch.emplace_hint(scratch.end(), name, *device);
+    }
+    return scratch;
+}
+
+// The getters pin the version they read and copy out of it, so nothing they
+// return depends on that version outliving the call
+template <typename T>
+std::optional<T> CopyOf(const std::optional<std::reference_wrapper<const T>>& value) {
+    return value ? std::optional<T>(value->get()) : std::nullopt;
+}
+
+std::optional<Node> CopyOf(const Node* node) {
+    return node ? std::optional<Node>(*node) : std::nullopt;
+}
+
+std::vector<Node> CopyOf(const std::vector<std::reference_wrapper<const Node>>& nodes) {
+    return std::vector<Node>(nodes.begin(), nodes.end());
+}
+
+} // namespace
+
+MotionConfigManager::MotionConfigManager(const std::string& configFilePath)
+    : m_configFilePath(configFilePath) {
+    LoadConfig(configFilePath);
+    m_compactionThread = std::thread(&MotionConfigManager::CompactionLoop, this);
+    if (m_journal.IsOpen() && m_journal.LastSequence() > 0) {
+        RequestCompaction();
+    }
+    m_watcher.Watch(m_configFilePath, [this](const std::string&) { ReloadConfig(); });
+    m_watcher.Start();
+}
+
+MotionConfigManager::~MotionConfigManager() {
+    m_watcher.Stop();
+    {
+        std::lock_guard<std::mutex> lock(m_compactionMutex);
+        m_stopCompaction = true;
+    }
+    m_compactionSignal.notify_one();
+    if (m_compactionThread.joinable()) {
+        m_compactionThread.join();
+    }
+
+    // Leave the saved edits in the JSON file for other tools, and start the next
+    // run from an empty journal
+    bool journaled;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        journaled = !m_journalRecords.empty();
+    }
+    if (journaled) {
+        CompactJournal();
+    }
+}
+
+void MotionConfigManager::LoadConfig(const std::string& filePath) {
+    auto startTime = std::chrono::steady_clock::now();
+
+    MappedFile file;
+    if (!file.Open(filePath)) {
+        throw std::runtime_error("Failed to open motion configuration file: " + filePath);
+    }
+
+    std::map<std::string, MotionDevice> devices;
+    std::map<std::string, Graph> graphs;
+    auto version = std::make_shared<MotionConfigVersion>();
+
+    // The compiled snapshot is only trusted if it was built from these exact JSON bytes
+    const std::uint64_t sourceHash = MotionConfigSnapshot::HashBytes(file.Data(), file.Size());
+    const std::string snapshotPath = MotionConfigSnapshot::PathFor(filePath);
+
+    MotionConfigSnapshot snapshot;
+    const bool fromSnapshot = snapshot.Open(snapshotPath, sourceHash);
+    if (fromSnapshot) {
+        snapshot.Load(devices, graphs, version->m_settings);
+    }
+    else {
+        std::string errorMessage;
+        if (!ParseMotionConfig(file.Data(), file.Size(), devices, graphs, version->m_settings, errorMessage)) {
+            throw std::runtime_error("Failed to parse motion configuration file " + filePath + ": " + errorMessage);
+        }
+        MotionConfigSnapshot::Write(snapshotPath, sourceHash, devices, graphs, version->m_settings);
+    }
+
+    // Edits saved since the file was last compacted
+    std::vector<JournalRecord> journalRecords;
+    if (!m_journal.Open(MotionConfigJournal::PathFor(filePath), sourceHash, journalRecords)) {
+        std::cerr << "Motion configuration journal unavailable; saves will rewrite " << filePath << std::endl;
+    }
+    for (const JournalRecord& record : journalRecords) {
+        record.Apply(devices, graphs, version->m_settings);
+    }
+
+    std::size_t positionCount = 0;
+    for (auto& [name, device] : devices) {
+        positionCount += device.Positions.size();
+        version->m_baseDevices.emplace_hint(version->m_baseDevices.end(), name, std::make_shared<const MotionDevice>(std::move(device)));
+    }
+    for (auto& [name, graph] : graphs) {
+        version->m_graphs.emplace_hint(version->m_graphs.end(), name, std::make_shared<const Graph>(std::move(graph)));
+    }
+    version->RebuildIndex();
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+
+    std::cout << "Loaded motion configuration " << filePath << " (" << version->m_devices.size() << " devices, "
+        << positionCount << " positions, " << version->m_graphs.size() << " graphs) from "
+        << (fromSnapshot ? "snapshot" : "JSON") << " + " << journalRecords.size() << " journal records in "
+        << elapsed.count() << " ms" << std::endl;
+
+    const std::vector<ConfigDiagnostic> diagnostics = ValidateConfig(*version);
+    for (const ConfigDiagnostic& diagnostic : diagnostics) {
+        std::cerr << diagnostic.Message << std::endl;
+    }
+    if (!diagnostics.empty()) {
+        std::cerr << "Motion configuration " << filePath << " has " << diagnostics.size() << " validation errors" << std::endl;
+    }
+
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    m_fileHash = sourceHash;
+    m_journalRecords = std::move(journalRecords);
+    m_savedVersion = version;
+    Publish(std::move(version));
+}
+
+std::shared_ptr<MotionConfigVersion> MotionConfigManager::BeginUpdate() const {
+    return std::make_shared<MotionConfigVersion>(Current());
+}
+
+void MotionConfigManager::Publish(std::shared_ptr<MotionConfigVersion> version) {
+    m_published = version;
+    if (!version->TravelTablesWarm()) {
+        // Off the writer's thread; skipped if nothing holds the version by then
+        std::weak_ptr<const MotionConfigVersion> published = version;
+        ThreadPool::Shared().Submit([published] {
+            if (auto warming = published.lock()) {
+                warming->WarmTravelTables();
+            }
+        });
+    }
+    m_current.Publish(std::move(version));
+}
+
+void MotionConfigManager::Publish(std::shared_ptr<MotionConfigVersion> version, JournalRecord record) {
+    // Journaled on the next SaveConfig, like the edit itself becomes persistent then
+    m_pendingRecords.push_back(std::move(record));
+    Publish(std::move(version));
+}
+
+std::vector<ConfigDiagnostic> MotionConfigManager::ValidateConfig() const {
+    return ValidateConfig(*AcquireVersion());
+}
+
+std::vector<ConfigDiagnostic> MotionConfigManager::ValidateConfig(const MotionConfigVersion& version) const {
+    return m_validator.Validate(version);
+}
+
+std::map<std::string, MotionDevice> MotionConfigManager::GetAllDevices() const {
+    return AcquireVersion()->GetAllDevices();
+}
+
+std::optional<MotionDevice> MotionConfigManager::GetDevice(const std::string& deviceName) const {
+    return CopyOf(AcquireVersion()->GetDevice(deviceName));
+}
+
+std::map<std::string, MotionDevice> MotionConfigManager::GetEnabledDevices() const {
+    const MotionConfigVersionPtr version = AcquireVersion();
+    std::map<std::string, MotionDevice> devices;
+    for (const auto& [name, device] : version->GetEnabledDevices()) {
+        devices.emplace_hint(devices.end(), name, device.get());
+    }
+    return devices;
+}
+
+std::optional<std::map<std::string, PositionStruct>> MotionConfigManager::GetDevicePositions(const std::string& deviceName) const {
+    return CopyOf(AcquireVersion()->GetDevicePositions(deviceName));
+}
+
+std::optional<std::map<std::string, PositionStruct>> MotionConfigManager::GetNamedPositions(const std::string& deviceName) const {
+    return GetDevicePositions(deviceName);
+}
+
+std::optional<PositionStruct> MotionConfigManager::GetNamedPosition(const std::string& deviceName, const std::string& positionName) const {
+    return CopyOf(AcquireVersion()->GetNamedPosition(deviceName, positionName));
+}
+
+DeviceHandle MotionConfigManager::ResolveDevice(const std::string& deviceName) const {
+    return AcquireVersion()->ResolveDevice(deviceName);
+}
+
+PositionHandle MotionConfigManager::ResolvePosition(const std::string& deviceName, const std::string& positionName) const {
+    return AcquireVersion()->ResolvePosition(deviceName, positionName);
+}
+
+PositionHandle MotionConfigManager::ResolvePosition(DeviceHandle device, const std::string& positionName) const {
+    return AcquireVersion()->ResolvePosition(device, positionName);
+}
+
+NodeHandle MotionConfigManager::ResolveNode(const std::string& graphName, const std::string& nodeId) const {
+    return AcquireVersion()->ResolveNode(graphName, nodeId);
+}
+
+std::optional<MotionDevice> MotionConfigManager::GetDevice(DeviceHandle device) const {
+    return CopyOf(AcquireVersion()->GetDevice(device));
+}
+
+std::optional<PositionStruct> MotionConfigManager::GetNamedPosition(PositionHandle position) const {
+    return CopyOf(AcquireVersion()->GetNamedPosition(position));
+}
+
+std::optional<Node> MotionConfigManager::GetNodeById(NodeHandle node) const {
+    return CopyOf(AcquireVersion()->GetNodeById(node));
+}
+
+std::map<std::string, Graph> MotionConfigManager::GetAllGraphs() const {
+    return AcquireVersion()->GetAllGraphs();
+}
+
+std::optional<Graph> MotionConfigManager::GetGraph(const std::string& graphName) const {
+    return CopyOf(AcquireVersion()->GetGraph(graphName));
+}
+
+std::optional<Node> MotionConfigManager::GetNodeById(const std::string& graphName, const std::string& nodeId) const {
+    return CopyOf(AcquireVersion()->GetNodeById(graphName, nodeId));
+}
+
+std::vector<Node> MotionConfigManager::GetNodesByDevice(const std::string& graphName, const std::string& deviceName) const {
+    const MotionConfigVersionPtr version = AcquireVersion();
+    std::vector<Node> nodes;
+    for (const Node* node : version->GetNodesByDevice(graphName, deviceName)) {
+        nodes.push_back(*node);
+    }
+    return nodes;
+}
+
+std::vector<Edge> MotionConfigManager::GetEdgesBySource(const std::string& graphName, const std::string& sourceNodeId) const {
+    const MotionConfigVersionPtr version = AcquireVersion();
+    std::vector<Edge> edges;
+    for (const Edge* edge : version->GetEdgesBySource(graphName, sourceNodeId)) {
+        edges.push_back(*edge);
+    }
+    return edges;
+}
+
+std::vector<Node> MotionConfigManager::FindPath(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId) const {
+    return CopyOf(AcquireVersion()->FindPath(graphName, startNodeId, endNodeId, PathMetric::HopCount));
+}
+
+std::vector<Node> MotionConfigManager::FindPath(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId, PathMetric metric) const {
+    return CopyOf(AcquireVersion()->FindPath(graphName, startNodeId, endNodeId, metric));
+}
+
+double MotionConfigManager::EstimateTravelTime(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId) const {
+    return AcquireVersion()->EstimateTravelTime(graphName, startNodeId, endNodeId);
+}
+
+Settings MotionConfigManager::GetSettings() const {
+    return AcquireVersion()->GetSettings();
+}
+
+void MotionConfigManager::UpdateDevice(const std::string& deviceName, const MotionDevice& updatedDevice) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    auto version = BeginUpdate();
+    auto it = version->m_baseDevices.find(deviceName);
+    if (it == version->m_baseDevices.end()) {
+        throw std::runtime_error("Device not found: " + deviceName);
+    }
+    MotionDevice stored = version->StripOverlay(deviceName, updatedDevice);
+    it->second = std::make_shared<const MotionDevice>(stored);
+    version->RefreshDevices(deviceName);
+    Publish(std::move(version), JournalRecord::ForDevice(JournalRecord::Type::UpdateDevice, deviceName, stored));
+}
+
+void MotionConfigManager::AddPosition(const std::string& deviceName, const std::string& positionName, const PositionStruct& position) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    auto version = BeginUpdate();
+    auto it = version->m_baseDevices.find(deviceName);
+    if (it == version->m_baseDevices.end()) {
+        throw std::runtime_error("Device not found: " + deviceName);
+    }
+    auto device = std::make_shared<MotionDevice>(*it->second);
+    device->Positions[positionName] = position;
+    it->second = std::move(device);
+    version->RefreshDevices(deviceName);
+    Publish(std::move(version), JournalRecord::ForPosition(JournalRecord::Type::AddPosition, deviceName, positionName, position));
+}
+
+void MotionConfigManager::AddDevice(const std::string& deviceName, const MotionDevice& device) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    auto version = BeginUpdate();
+    if (version->m_baseDevices.find(deviceName) != version->m_baseDevices.end()) {
+        throw std::runtime_error("Device already exists: " + deviceName);
+    }
+    version->m_baseDevices.emplace(deviceName, std::make_shared<const MotionDevice>(device));
+    version->RefreshDevices(deviceName);
+    Publish(std::move(version), JournalRecord::ForDevice(JournalRecord::Type::AddDevice, deviceName, device));
+}
+
+bool MotionConfigManager::DeleteDevice(const std::string& deviceName) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    auto version = BeginUpdate();
+    if (version->m_baseDevices.erase(deviceName) == 0) {
+        return false;
+    }
+    version->RefreshDevices(deviceName);
+    Publish(std::move(version), JournalRecord::ForDeleteDevice(deviceName));
+    return true;
+}
+
+bool MotionConfigManager::DeletePosition(const std::string& deviceName, const std::string& positionName) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    auto version = BeginUpdate();
+    auto it = version->m_baseDevices.find(deviceName);
+    if (it == version->m_baseDevices.end() || it->second->Positions.count(positionName) == 0) {
+        return false;
+    }
+    auto device = std::make_shared<MotionDevice>(*it->second);
+    device->Positions.erase(positionName);
+    it->second = std::move(device);
+    version->RefreshDevices(deviceName);
+    Publish(std::move(version), JournalRecord::ForPosition(JournalRecord::Type::DeletePosition, deviceName, positionName));
+    return true;
+}
+
+void MotionConfigManager::UpdateSettings(const Settings& newSettings) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    auto version = BeginUpdate();
+    version->m_settings = newSettings;
+    version->RefreshAllTravelTables();
+    Publish(std::move(version), JournalRecord::ForSettings(newSettings));
+}
+
+void MotionConfigManager::UpdateGraph(const std::string& graphName, const Graph& updatedGraph) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    auto version = BeginUpdate();
+    version->m_graphs.insert_or_assign(graphName, std::make_shared<const Graph>(updatedGraph));
+    version->RefreshGraph(graphName);
+    Publish(std::move(version), JournalRecord::ForGraph(graphName, updatedGraph));
+}
+
+bool MotionConfigManager::ReloadConfig() {
+    auto startTime = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> fileLock(m_fileMutex);
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+
+    MappedFile file;
+    if (!file.Open(m_configFilePath)) {
+        std::cerr << "Reload: can't open " << m_configFilePath << "; keeping the running configuration" << std::endl;
+        return false;
+    }
+    const std::uint64_t fileHash = MotionConfigSnapshot::HashBytes(file.Data(), file.Size());
+    if (fileHash == m_fileHash) {
+        return true;
+    }
+
+    std::map<std::string, MotionDevice> devices;
+    std::map<std::string, Graph> graphs;
+    Settings settings;
+    std::string errorMessage;
+    if (!ParseMotionConfig(file.Data(), file.Size(), devices, graphs, settings, errorMessage)) {
+        std::cerr << "Reload: " << m_configFilePath << ": " << errorMessage << "; keeping the running configuration" << std::endl;
+        return false;
+    }
+    MotionConfigSnapshot::Write(MotionConfigSnapshot::PathFor(m_configFilePath), fileHash, devices, graphs, settings);
+
+    // Saved edits the old file didn't have yet still apply; they win over the file's
+    // values for the same entities, as they would have after a compaction
+    for (const JournalRecord& record : m_journalRecords) {
+        record.Apply(devices, graphs, settings);
+    }
+
+    // Structural diff against the base layer; unchanged entries keep their shared objects
+    auto version = BeginUpdate();
+    std::set<std::string> deviceNames;
+    for (auto it = version->m_baseDevices.begin(); it != version->m_baseDevices.end();) {
+        if (devices.count(it->first) == 0) {
+            deviceNames.insert(it->first);
+            it = version->m_baseDevices.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    for (auto& [name, device] : devices) {
+        auto current = version->m_baseDevices.find(name);
+        if (current == version->m_baseDevices.end() || !Reflection::Equal(*current->second, device)) {
+            version->m_baseDevices.insert_or_assign(name, std::make_shared<const MotionDevice>(std::move(device)));
+            deviceNames.insert(name);
+        }
+    }
+
+    std::set<std::string> graphNames;
+    std::size_t graphsRemoved = 0;
+    for (auto it = version->m_graphs.begin(); it != version->m_graphs.end();) {
+        if (graphs.count(it->first) == 0) {
+            ++graphsRemoved;
+            it = version->m_graphs.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+    for (auto& [name, graph] : graphs) {
+        auto current = version->m_graphs.find(name);
+        if (current == version->m_graphs.end() || !Reflection::Equal(*current->second, graph)) {
+            version->m_graphs.insert_or_assign(name, std::make_shared<const Graph>(std::move(graph)));
+            graphNames.insert(name);
+        }
+    }
+
+    const bool settingsChanged = !Reflection::Equal(version->m_settings, settings);
+    version->m_settings = settings;
+
+    if (graphsRemoved > 0) {
+        version->RebuildIndex();  // The index has no way to drop a graph
+    }
+    else {
+        version->Refresh(deviceNames, graphNames, settingsChanged);
+    }
+
+    // The journal described its edits on top of the old file; move them onto the new one
+    const std::size_t droppedEdits = m_pendingRecords.size();
+    if (m_journal.IsOpen() && !m_journal.Rebase(fileHash, m_journalRecords)) {
+        std::cerr << "Reload: failed to rewrite the journal of " << m_configFilePath
+            << "; saved edits are only in memory until the next save" << std::endl;
+    }
+    m_pendingRecords.clear();
+    m_fileHash = fileHash;
+
+    for (const ConfigDiagnostic& diagnostic : ValidateConfig(*version)) {
+        std::cerr << diagnostic.Message << std::endl;
+    }
+    m_savedVersion = version;
+    Publish(std::move(version));
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+    std::cout << "Reloaded motion configuration " << m_configFilePath << ": " << deviceNames.size() << " devices and "
+        << graphNames.size() + graphsRemoved << " graphs changed, settings " << (settingsChanged ? "changed" : "unchanged")
+        << ", " << m_journalRecords.size() << " saved edits replayed in " << elapsed.count() << " ms" << std::endl;
+    if (droppedEdits > 0) {
+        std::cerr << "Reload: discarded " << droppedEdits << " unsaved edits" << std::endl;
+    }
+    return true;
+}
+
+void MotionConfigManager::SelectProduct(const std::string& productName, const std::vector<std::string>& overlayPaths) {
+    ApplyProduct(std::make_shared<const ProductOverlay>(ProductOverlay::Load(productName, overlayPaths)));
+}
+
+void MotionConfigManager::ClearProduct() {
+    ApplyProduct(nullptr);
+}
+
+std::string MotionConfigManager::GetSelectedProduct() const {
+    const MotionConfigVersionPtr version = AcquireVersion();
+    const ProductOverlay* overlay = version->Overlay();
+    return overlay ? overlay->Product : std::string();
+}
+
+void MotionConfigManager::ApplyProduct(std::shared_ptr<const ProductOverlay> overlay) {
+    auto startTime = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    auto version = BeginUpdate();
+
+    // Devices the outgoing or incoming product overrides; everything else keeps its entries
+    std::set<std::string> deviceNames;
+    for (const ProductOverlay* layer : { version->Overlay(), overlay.get() }) {
+        if (!layer) {
+            continue;
+        }
+        for (const auto& [deviceName, positions] : layer->Positions) {
+            if (version->BaseDevices().count(deviceName) > 0) {
+                deviceNames.insert(deviceName);
+            }
+            else if (layer == overlay.get()) {
+                std::cerr << "Product " << layer->Product << " overrides positions of unknown device " << deviceName << std::endl;
+            }
+        }
+    }
+    const std::string productName = overlay ? overlay->Product : std::string("(none)");
+    version->m_overlay = std::move(overlay);
+    version->Refresh(deviceNames, {}, false);
+    Publish(std::move(version));
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+    std::cout << "Selected product " << productName << ": rebuilt " << deviceNames.size() << " devices in "
+        << elapsed.count() << " ms" << std::endl;
+}
+
+MotionConfigTransaction MotionConfigManager::BeginTransaction() {
+    return MotionConfigTransaction(*this);
+}
+
+bool MotionConfigManager::CommitTransaction(MotionConfigTransaction& transaction) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    const MotionConfigVersion& base = *transaction.m_base;
+    auto version = BeginUpdate();
+
+    // Optimistic check: every touched entry must still be the one the transaction copied
+    auto unchanged = [](const auto& baseMap, const auto& currentMap, const std::string& name) {
+        auto before = baseMap.find(name);
+        auto now = currentMap.find(name);
+        if (before == baseMap.end() || now == currentMap.end()) {
+            return (before == baseMap.end()) == (now == currentMap.end());
+        }
+        return before->second == now->second;
+    };
+
+    std::set<std::string> deviceNames;
+    for (auto& [name, device] : transaction.m_devices) {
+        if (!unchanged(base.BaseDevices(), version->m_baseDevices, name)) {
+            std::cerr << "Transaction rolled back: device " << name << " was modified concurrently" << std::endl;
+            return false;
+        }
+        if (device) {
+            version->m_baseDevices.insert_or_assign(name, std::shared_ptr<const MotionDevice>(std::move(device)));
+        }
+        else {
+            version->m_baseDevices.erase(name);
+        }
+        deviceNames.insert(name);
+    }
+
+    std::set<std::string> graphNames;
+    for (auto& [name, graph] : transaction.m_graphs) {
+        if (!unchanged(base.Graphs(), version->m_graphs, name)) {
+            std::cerr << "Transaction rolled back: graph " << name << " was modified concurrently" << std::endl;
+            return false;
+        }
+        version->m_graphs.insert_or_assign(name, std::move(graph));
+        graphNames.insert(name);
+    }
+
+    if (transaction.m_settings) {
+        version->m_settings = *transaction.m_settings;
+    }
+    version->Refresh(deviceNames, graphNames, transaction.m_settings.has_value());
+
+    // Reject only errors the batch introduced, so an already inconsistent file can still be edited
+    std::set<std::string> existing;
+    for (const ConfigDiagnostic& diagnostic : ValidateConfig(Current())) {
+        existing.insert(diagnostic.Message);
+    }
+    bool introducedErrors = false;
+    for (const ConfigDiagnostic& diagnostic : ValidateConfig(*version)) {
+        if (diagnostic.Level == ConfigDiagnostic::Severity::Error && existing.count(diagnostic.Message) == 0) {
+            std::cerr << diagnostic.Message << std::endl;
+            introducedErrors = true;
+        }
+    }
+    if (introducedErrors) {
+        std::cerr << "Transaction rolled back: the edits leave the configuration invalid" << std::endl;
+        return false;
+    }
+
+    m_pendingRecords.insert(m_pendingRecords.end(), std::make_move_iterator(transaction.m_records.begin()),
+        std::make_move_iterator(transaction.m_records.end()));
+    Publish(std::move(version));
+    return true;
+}
+
+// Root keys in the order nlohmann::json sorts them, so rewritten files diff cleanly
+// against ones the editor produced
+std::string MotionConfigManager::SerializeConfig(const MotionConfigVersion& version) {
+    std::string text;
+    JsonWriter writer(text);
+    writer.BeginObject();
+    writer.Key("Graphs");
+    WriteJson(writer, version.Graphs());
+    writer.Key("MotionDevices");
+    WriteJson(writer, version.BaseDevices());
+    writer.Key("Settings");
+    WriteJson(writer, version.GetSettings());
+    writer.EndObject();
+    return text;
+}
+
+bool MotionConfigManager::WriteConfigFile(const std::string& filePath, const MotionConfigVersion& version, std::uint64_t* fileHash) {
+    const std::string text = SerializeConfig(version);
+    if (!DurableFile::WriteAtomically(filePath, text.data(), text.size())) {
+        std::cerr << "Failed to write " << filePath << std::endl;
+        return false;
+    }
+    if (fileHash) {
+        *fileHash = MotionConfigSnapshot::HashBytes(text.data(), text.size());
+    }
+    return true;
+}
+
+void MotionConfigManager::WriteSnapshot(const MotionConfigVersion& version, std::uint64_t fileHash) const {
+    std::map<std::string, MotionDevice> scratch;
+    MotionConfigSnapshot::Write(MotionConfigSnapshot::PathFor(m_configFilePath), fileHash,
+        FileDevices(version, scratch), version.GetAllGraphs(), version.GetSettings());
+}
+
+bool MotionConfigManager::SaveConfig(const std::string& filePath) {
+    if (!filePath.empty() && filePath != m_configFilePath) {
+        return WriteConfigFile(filePath, *AcquireVersion());
+    }
+    if (!m_journal.IsOpen()) {
+        std::lock_guard<std::mutex> fileLock(m_fileMutex);
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        m_pendingRecords.clear();
+        m_savedVersion = m_current.Load();
+        if (!WriteConfigFile(m_configFilePath, *m_savedVersion, &m_fileHash)) {
+            return false;
+        }
+        WriteSnapshot(*m_savedVersion, m_fileHash);
+        return true;
+    }
+
+    // Append the edits made since the last save; the full file is rewritten
+    // later by the background compaction
+    std::uint64_t sequence;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        sequence = m_pendingRecords.empty() ? m_journal.LastSequence() : m_journal.Append(m_pendingRecords);
+        if (sequence == 0 && !m_pendingRecords.empty()) {
+            std::cerr << "Failed to append to the journal of " << m_configFilePath << std::endl;
+            return false;
+        }
+        m_journalRecords.insert(m_journalRecords.end(), std::make_move_iterator(m_pendingRecords.begin()),
+            std::make_move_iterator(m_pendingRecords.end()));
+        m_pendingRecords.clear();
+        m_savedVersion = m_current.Load();
+    }
+    if (!m_journal.Sync(sequence)) {
+        std::cerr << "Failed to flush the journal of " << m_configFilePath << std::endl;
+        return false;
+    }
+
+    if (m_journal.Size() > JournalCompactionBytes) {
+        RequestCompaction();
+    }
+    return true;
+}
+
+void MotionConfigManager::RequestCompaction() {
+    {
+        std::lock_guard<std::mutex> lock(m_compactionMutex);
+        m_compactionRequested = true;
+    }
+    m_compactionSignal.notify_one();
+}
+
+void MotionConfigManager::CompactionLoop() {
+    std::unique_lock<std::mutex> lock(m_compactionMutex);
+    for (;;) {
+        m_compactionSignal.wait(lock, [this] { return m_compactionRequested || m_stopCompaction; });
+        if (m_stopCompaction) {
+            return;
+        }
+        m_compactionRequested = false;
+
+        lock.unlock();
+        CompactJournal();
+        lock.lock();
+    }
+}
+
+bool MotionConfigManager::CompactJournal() {
+    auto startTime = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> fileLock(m_fileMutex);
+
+    MotionConfigVersionPtr version;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        version = m_savedVersion;
+    }
+    if (!version) {
+        return false;
+    }
+
+    // Serialize outside the writer lock. If a save lands meanwhile, the text no
+    // longer matches the journal; redo it under the lock so steady saves can't starve us.
+    std::string text = SerializeConfig(*version);
+    std::uint64_t hash = MotionConfigSnapshot::HashBytes(text.data(), text.size());
+    std::vector<JournalRecord> compacted;  // Folded into the file from here on
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        if (m_savedVersion != version) {
+            version = m_savedVersion;
+            text = SerializeConfig(*version);
+            hash = MotionConfigSnapshot::HashBytes(text.data(), text.size());
+        }
+        if (!m_journal.BeginCompaction(hash)) {
+            return false;
+        }
+        compacted.swap(m_journalRecords);
+    }
+
+    if (!DurableFile::WriteAtomically(m_configFilePath, text.data(), text.size())) {
+        std::cerr << "Failed to compact " << m_configFilePath << "; edits stay in the journal" << std::endl;
+        m_journal.AbortCompaction();
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        m_journalRecords.insert(m_journalRecords.begin(), std::make_move_iterator(compacted.begin()),
+            std::make_move_iterator(compacted.end()));
+        return false;
+    }
+    m_journal.FinishCompaction();
+    m_fileHash = hash;
+    WriteSnapshot(*version, hash);
+
+    auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime);
+    std::cout << "Compacted motion configuration journal into " << m_configFilePath
+        << " (" << text.size() << " bytes) in " << elapsed.count() << " ms" << std::endl;
+    return true;
+}
@@ -0,0 +1,34 @@
+#include "MotionConfigParser.h"
+#include "MotionTypesReflection.h"
+
+bool ParseMotionConfig(const char* data, std::size_t size,
+    std::map<std::string, MotionDevice>& devices,
+    std::map<std::string, Graph>& graphs,
+    Settings& settings,
+    std::string& errorMessage) {
+    JsonReader reader(data, size);
+
+    if (reader.Peek() == JsonReader::Token::Object) {
+        reader.BeginObject();
+        std::string_view key;
+        while (reader.NextKey(key)) {
+            if (key == "MotionDevices") ReadJson(reader, devices);
+            else if (key == "Graphs") ReadJson(reader, graphs);
+            else if (key == "Settings") ReadJson(reader, settings);
+            else reader.SkipValue();
+        }
+    }
+    else {
+        reader.SkipValue();
+    }
+
+    if (reader.Failed()) {
+        errorMessage = "JSON parse error at byte " + std::to_string(reader.ErrorOffset()) + ": " + reader.Error();
+        return false;
+    }
+    if (!reader.AtEnd()) {
+        errorMessage = "JSON parse error at byte " + std::to_string(reader.Offset()) + ": unexpected text after document";
+        return false;
+    }
+    return true;
+}
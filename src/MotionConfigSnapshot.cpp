@@ -0,0 +1,408 @@
+#include "MotionConfigSnapshot.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr char kMagic[8] = { 'U', 'A', 'A', 'M', 'C', 'F', 'G', '\0' };
+constexpr std::uint32_t kEndianTag = 0x01020304;
+
+struct StringRef {
+    std::uint32_t Offset;
+    std::uint32_t Length;
+};
+
+struct SettingsRecord {
+    double DefaultSpeed;
+    double DefaultAcceleration;
+    double PositionTolerance;
+    std::int32_t ConnectionTimeout;
+    std::uint8_t AutoReconnect;
+    std::uint8_t Padding[3];
+    StringRef LogLevel;
+};
+
+struct DeviceRecord {
+    StringRef Key;
+    StringRef Name;
+    StringRef IpAddress;
+    StringRef TypeController;
+    StringRef InstalledAxes;
+    std::int32_t Port;
+    std::int32_t Id;
+    std::uint32_t FirstPosition;
+    std::uint32_t PositionCount;
+    std::uint8_t IsEnabled;
+    std::uint8_t Padding[7];
+};
+
+struct PositionRecord {
+    StringRef Name;
+    double x, y, z, u, v, w;
+};
+
+struct GraphRecord {
+    StringRef Name;
+    std::uint32_t FirstNode;
+    std::uint32_t NodeCount;
+    std::uint32_t FirstEdge;
+    std::uint32_t EdgeCount;
+};
+
+struct NodeRecord {
+    StringRef Id;
+    StringRef Label;
+    StringRef Device;
+    StringRef Position;
+    std::int32_t X;
+    std::int32_t Y;
+};
+
+struct EdgeRecord {
+    StringRef Id;
+    StringRef Source;
+    StringRef Target;
+    StringRef Label;
+    std::int32_t TimeoutSeconds;
+    std::uint8_t RequiresOperatorApproval;
+    std::uint8_t IsBidirectional;
+    std::uint8_t Padding[2];
+    double CornerTolerance;
+};
+
+enum SectionIndex {
+    SettingsSection,
+    DeviceSection,
+    PositionSection,
+    GraphSection,
+    NodeSection,
+    EdgeSection,
+    StringSection,
+    SectionCount
+};
+
+struct SectionEntry {
+    std::uint64_t Offset;
+    std::uint64_t Count;
+};
+
+struct SnapshotHeader {
+    char Magic[8];
+    std::uint32_t Version;
+    std::uint32_t EndianTag;
+    std::uint64_t SourceHash;
+    std::uint64_t PayloadSize;
+    std::uint64_t PayloadChecksum;
+    SectionEntry Sections[SectionCount];
+};
+
+constexpr std::size_t kRecordSizes[SectionCount] = {
+    sizeof(SettingsRecord), sizeof(DeviceRecord), sizeof(PositionRecord),
+    sizeof(GraphRecord), sizeof(NodeRecord), sizeof(EdgeRecord), 1
+};
+
+static_assert(sizeof(SnapshotHeader) % 8 == 0, "Snapshot header must keep the payload 8-byte aligned");
+static_assert(sizeof(DeviceRecord) % 8 == 0 && sizeof(PositionRecord) % 8 == 0 && sizeof(NodeRecord) % 8 == 0,
+    "Snapshot records must be 8-byte aligned");
+
+// Builds the payload: record tables followed by a deduplicated string blob
+class SnapshotBuilder {
+public:
+    StringRef AddString(const std::string& value) {
+        auto it = m_stringIndex.find(value);
+        if (it != m_stringIndex.end()) {
+            return it->second;
+        }
+        StringRef ref{ static_cast<std::uint32_t>(m_strings.size()), static_cast<std::uint32_t>(value.size()) };
+        m_strings.insert(m_strings.end(), value.begin(), value.end());
+        m_stringIndex.emplace(value, ref);
+        return ref;
+    }
+
+    template <typename Record>
+    static void Append(std::vector<char>& payload, const std::vector<Record>& records) {
+        const char* bytes = reinterpret_cast<const char*>(records.data());
+        payload.insert(payload.end(), bytes, bytes + records.size() * sizeof(Record));
+    }
+
+    const std::vector<char>& Strings() const { return m_strings; }
+
+private:
+    std::vector<char> m_strings;
+    std::unordered_map<std::string, StringRef> m_stringIndex;
+};
+
+} // namespace
+
+std::string MotionConfigSnapshot::PathFor(const std::string& configFilePath) {
+    return configFilePath + ".snapshot";
+}
+
+std::uint64_t MotionConfigSnapshot::HashBytes(const void* data, std::size_t size) {
+    // FNV-1a style mixing, eight bytes per step
+    constexpr std::uint64_t prime = 0x100000001b3ULL;
+    std::uint64_t hash = 0xcbf29ce484222325ULL ^ size;
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ bytes[i]) * prime;
+    }
+    return hash;
+}
+
+bool MotionConfigSnapshot::Write(const std::string& snapshotPath, std::uint64_t sourceHash,
+    const std::map<std::string, MotionDevice>& devices,
+    const std::map<std::string, Graph>& graphs,
+    const Settings& settings) {
+    SnapshotBuilder builder;
+
+    std::vector<SettingsRecord> settingsRecords(1);
+    SettingsRecord& settingsRecord = settingsRecords[0];
+    settingsRecord.DefaultSpeed = settings.DefaultSpeed;
+    settingsRecord.DefaultAcceleration = settings.DefaultAcceleration;
+    settingsRecord.PositionTolerance = settings.PositionTolerance;
+    settingsRecord.ConnectionTimeout = settings.ConnectionTimeout;
+    settingsRecord.AutoReconnect = settings.AutoReconnect ? 1 : 0;
+    settingsRecord.LogLevel = builder.AddString(settings.LogLevel);
+
+    std::vector<DeviceRecord> deviceRecords;
+    std::vector<PositionRecord> positionRecords;
+    deviceRecords.reserve(devices.size());
+    for (const auto& [key, device] : devices) {
+        DeviceRecord record{};
+        record.Key = builder.AddString(key);
+        record.Name = builder.AddString(device.Name);
+        record.IpAddress = builder.AddString(device.IpAddress);
+        record.TypeController = builder.AddString(device.TypeController);
+        record.InstalledAxes = builder.AddString(device.InstalledAxes);
+        record.Port = device.Port;
+        record.Id = device.Id;
+        record.IsEnabled = device.IsEnabled ? 1 : 0;
+        record.FirstPosition = static_cast<std::uint32_t>(positionRecords.size());
+        record.PositionCount = static_cast<std::uint32_t>(device.Positions.size());
+
+        for (const auto& [positionName, position] : device.Positions) {
+            positionRecords.push_back({ builder.AddString(positionName),
+                position.x, position.y, position.z, position.u, position.v, position.w });
+        }
+        deviceRecords.push_back(record);
+    }
+
+    std::vector<GraphRecord> graphRecords;
+    std::vector<NodeRecord> nodeRecords;
+    std::vector<EdgeRecord> edgeRecords;
+    for (const auto& [name, graph] : graphs) {
+        graphRecords.push_back({ builder.AddString(name),
+            static_cast<std::uint32_t>(nodeRecords.size()), static_cast<std::uint32_t>(graph.Nodes.size()),
+            static_cast<std::uint32_t>(edgeRecords.size()), static_cast<std::uint32_t>(graph.Edges.size()) });
+
+        for (const auto& node : graph.Nodes) {
+            nodeRecords.push_back({ builder.AddString(node.Id), builder.AddString(node.Label),
+                builder.AddString(node.Device), builder.AddString(node.Position), node.X, node.Y });
+        }
+        for (const auto& edge : graph.Edges) {
+            EdgeRecord record{};
+            record.Id = builder.AddString(edge.Id);
+            record.Source = builder.AddString(edge.Source);
+            record.Target = builder.AddString(edge.Target);
+            record.Label = builder.AddString(edge.Label);
+            record.TimeoutSeconds = edge.Conditions.TimeoutSeconds;
+            record.RequiresOperatorApproval = edge.Conditions.RequiresOperatorApproval ? 1 : 0;
+            record.IsBidirectional = edge.Conditions.IsBidirectional ? 1 : 0;
+            record.CornerTolerance = edge.Conditions.CornerTolerance;
+            edgeRecords.push_back(record);
+        }
+    }
+
+    SnapshotHeader header{};
+    std::memcpy(header.Magic, kMagic, sizeof(kMagic));
+    header.Version = FormatVersion;
+    header.EndianTag = kEndianTag;
+    header.SourceHash = sourceHash;
+
+    std::vector<char> payload;
+    auto beginSection = [&](SectionIndex index, std::size_t count) {
+        header.Sections[index] = { payload.size(), count };
+    };
+    beginSection(SettingsSection, settingsRecords.size());
+    SnapshotBuilder::Append(payload, settingsRecords);
+    beginSection(DeviceSection, deviceRecords.size());
+    SnapshotBuilder::Append(payload, deviceRecords);
+    beginSection(PositionSection, positionRecords.size());
+    SnapshotBuilder::Append(payload, positionRecords);
+    beginSection(GraphSection, graphRecords.size());
+    SnapshotBuilder::Append(payload, graphRecords);
+    beginSection(NodeSection, nodeRecords.size());
+    SnapshotBuilder::Append(payload, nodeRecords);
+    beginSection(EdgeSection, edgeRecords.size());
+    SnapshotBuilder::Append(payload, edgeRecords);
+    beginSection(StringSection, builder.Strings().size());
+    payload.insert(payload.end(), builder.Strings().begin(), builder.Strings().end());
+
+    header.PayloadSize = payload.size();
+    header.PayloadChecksum = HashBytes(payload.data(), payload.size());
+
+    const std::string tempPath = snapshotPath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open " << tempPath << " for writing" << std::endl;
+            return false;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!file.good()) {
+            std::cerr << "Failed to write motion configuration snapshot " << tempPath << std::endl;
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, snapshotPath, ec);
+    if (ec) {
+        std::cerr << "Failed to replace motion configuration snapshot " << snapshotPath << ": " << ec.message() << std::endl;
+        std::filesystem::remove(tempPath, ec);
+        return false;
+    }
+    return true;
+}
+
+bool MotionConfigSnapshot::Open(const std::string& snapshotPath, std::uint64_t expectedSourceHash) {
+    m_payload = nullptr;
+    m_payloadSize = 0;
+
+    if (!m_file.Open(snapshotPath) || m_file.Size() < sizeof(SnapshotHeader)) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    std::memcpy(&header, m_file.Data(), sizeof(header));
+    if (std::memcmp(header.Magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.Version != FormatVersion ||
+        header.EndianTag != kEndianTag ||
+        header.SourceHash != expectedSourceHash ||
+        header.PayloadSize != m_file.Size() - sizeof(SnapshotHeader)) {
+        return false;
+    }
+
+    const char* payload = m_file.Data() + sizeof(SnapshotHeader);
+    for (int i = 0; i < SectionCount; ++i) {
+        const SectionEntry& section = header.Sections[i];
+        if (section.Offset > header.PayloadSize ||
+            section.Count > (header.PayloadSize - section.Offset) / kRecordSizes[i]) {
+            return false;
+        }
+    }
+    if (header.Sections[SettingsSection].Count != 1) {
+        return false;
+    }
+
+    if (HashBytes(payload, header.PayloadSize) != header.PayloadChecksum) {
+        std::cerr << "Motion configuration snapshot " << snapshotPath << " failed checksum verification" << std::endl;
+        return false;
+    }
+
+    m_payload = payload;
+    m_payloadSize = header.PayloadSize;
+    return true;
+}
+
+const char* MotionConfigSnapshot::Section(std::uint64_t offset) const {
+    return m_payload + offset;
+}
+
+std::string_view MotionConfigSnapshot::String(std::uint32_t offset, std::uint32_t length) const {
+    const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(m_file.Data());
+    const SectionEntry& strings = header->Sections[StringSection];
+    if (static_cast<std::uint64_t>(offset) + length > strings.Count) {
+        return {};
+    }
+    return std::string_view(Section(strings.Offset) + offset, length);
+}
+
+void MotionConfigSnapshot::Load(std::map<std::string, MotionDevice>& devices,
+    std::map<std::string, Graph>& graphs,
+    Settings& settings) const {
+    if (!m_payload) {
+        return;
+    }
+
+    const SnapshotHeader* header = reinterpret_cast<const SnapshotHeader*>(m_file.Data());
+    auto str = [this](const StringRef& ref) { return std::string(String(ref.Offset, ref.Length)); };
+    auto table = [&](SectionIndex index) { return Section(header->Sections[index].Offset); };
+
+    const SettingsRecord* settingsRecord = reinterpret_cast<const SettingsRecord*>(table(SettingsSection));
+    settings.DefaultSpeed = settingsRecord->DefaultSpeed;
+    settings.DefaultAcceleration = settingsRecord->DefaultAcceleration;
+    settings.PositionTolerance = settingsRecord->PositionTolerance;
+    settings.ConnectionTimeout = settingsRecord->ConnectionTimeout;
+    settings.AutoReconnect = settingsRecord->AutoReconnect != 0;
+    settings.LogLevel = str(settingsRecord->LogLevel);
+
+    const DeviceRecord* deviceRecords = reinterpret_cast<const DeviceRecord*>(table(DeviceSection));
+    const PositionRecord* positionRecords = reinterpret_cast<const PositionRecord*>(table(PositionSection));
+    const std::uint64_t positionCount = header->Sections[PositionSection].Count;
+    for (std::uint64_t i = 0; i < header->Sections[DeviceSection].Count; ++i) {
+        const DeviceRecord& record = deviceRecords[i];
+        MotionDevice& device = devices.emplace_hint(devices.end(), str(record.Key), MotionDevice())->second;
+        device.Name = str(record.Name);
+        device.IpAddress = str(record.IpAddress);
+        device.TypeController = str(record.TypeController);
+        device.InstalledAxes = str(record.InstalledAxes);
+        device.Port = record.Port;
+        device.Id = record.Id;
+        device.IsEnabled = record.IsEnabled != 0;
+
+        if (static_cast<std::uint64_t>(record.FirstPosition) + record.PositionCount > positionCount) {
+            continue;
+        }
+        for (std::uint32_t p = 0; p < record.PositionCount; ++p) {
+            const PositionRecord& position = positionRecords[record.FirstPosition + p];
+            device.Positions.emplace_hint(device.Positions.end(), str(position.Name),
+                PositionStruct{ position.x, position.y, position.z, position.u, position.v, position.w });
+        }
+    }
+
+    const GraphRecord* graphRecords = reinterpret_cast<const GraphRecord*>(table(GraphSection));
+    const NodeRecord* nodeRecords = reinterpret_cast<const NodeRecord*>(table(NodeSection));
+    const EdgeRecord* edgeRecords = reinterpret_cast<const EdgeRecord*>(table(EdgeSection));
+    const std::uint64_t nodeCount = header->Sections[NodeSection].Count;
+    const std::uint64_t edgeCount = header->Sections[EdgeSection].Count;
+    for (std::uint64_t i = 0; i < header->Sections[GraphSection].Count; ++i) {
+        const GraphRecord& record = graphRecords[i];
+        Graph& graph = graphs.emplace_hint(graphs.end(), str(record.Name), Graph())->second;
+
+        if (static_cast<std::uint64_t>(record.FirstNode) + record.NodeCount <= nodeCount) {
+            graph.Nodes.reserve(record.NodeCount);
+            for (std::uint32_t n = 0; n < record.NodeCount; ++n) {
+                const NodeRecord& node = nodeRecords[record.FirstNode + n];
+                graph.Nodes.push_back({ str(node.Id), str(node.Label), str(node.Device), str(node.Position), node.X, node.Y });
+            }
+        }
+
+        if (static_cast<std::uint64_t>(record.FirstEdge) + record.EdgeCount <= edgeCount) {
+            graph.Edges.reserve(record.EdgeCount);
+            for (std::uint32_t e = 0; e < record.EdgeCount; ++e) {
+                const EdgeRecord& edge = edgeRecords[record.FirstEdge + e];
+                EdgeConditions conditions;
+                conditions.RequiresOperatorApproval = edge.RequiresOperatorApproval != 0;
+                conditions.TimeoutSeconds = edge.TimeoutSeconds;
+                conditions.IsBidirectional = edge.IsBidirectional != 0;
+                conditions.CornerTolerance = edge.CornerTolerance;
+                graph.Edges.push_back({ str(edge.Id), str(edge.Source), str(edge.Target), str(edge.Label), conditions });
+            }
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#include "MotionConfigTransaction.h"
+#include "MotionConfigManager.h"
+
+#include <stdexcept>
+#include <utility>
+
+MotionConfigTransaction::MotionConfigTransaction(MotionConfigManager& manager)
+    : m_manager(&manager),
+      m_base(manager.AcquireVersion()) {
+}
+
+MotionConfigTransaction::~MotionConfigTransaction() {
+    Rollback();
+}
+
+MotionConfigTransaction::MotionConfigTransaction(MotionConfigTransaction&& other) noexcept {
+    *this = std::move(other);
+}
+
+MotionConfigTransaction& MotionConfigTransaction::operator=(MotionConfigTransaction&& other) noexcept {
+    if (this != &other) {
+        m_manager = std::exchange(other.m_manager, nullptr);
+        m_base = std::move(other.m_base);
+        m_devices = std::move(other.m_devices);
+        m_graphs = std::move(other.m_graphs);
+        m_settings = std::move(other.m_settings);
+        m_records = std::move(other.m_records);
+        other.Rollback();
+    }
+    return *this;
+}
+
+MotionDevice* MotionConfigTransaction::StagedDevice(const std::string& deviceName) {
+    auto staged = m_devices.find(deviceName);
+    if (staged != m_devices.end()) {
+        return staged->second.get();
+    }
+
+    auto it = m_base->BaseDevices().find(deviceName);
+    if (it == m_base->BaseDevices().end()) {
+        return nullptr;
+    }
+    auto device = std::make_shared<MotionDevice>(*it->second);
+    MotionDevice* result = device.get();
+    m_devices.emplace(deviceName, std::move(device));
+    return result;
+}
+
+void MotionConfigTransaction::UpdateDevice(const std::string& deviceName, const MotionDevice& updatedDevice) {
+    MotionDevice* device = StagedDevice(deviceName);
+    if (!device) {
+        throw std::runtime_error("Device not found: " + deviceName);
+    }
+    *device = m_base->StripOverlay(deviceName, updatedDevice);
+    m_records.push_back(JournalRecord::ForDevice(JournalRecord::Type::UpdateDevice, deviceName, *device));
+}
+
+void MotionConfigTransaction::AddPosition(const std::string& deviceName, const std::string& positionName, const PositionStruct& position) {
+    MotionDevice* device = StagedDevice(deviceName);
+    if (!device) {
+        throw std::runtime_error("Device not found: " + deviceName);
+    }
+    device->Positions[positionName] = position;
+    m_records.push_back(JournalRecord::ForPosition(JournalRecord::Type::AddPosition, deviceName, positionName, position));
+}
+
+void MotionConfigTransaction::AddDevice(const std::string& deviceName, const MotionDevice& device) {
+    if (StagedDevice(deviceName)) {
+        throw std::runtime_error("Device already exists: " + deviceName);
+    }
+    m_devices[deviceName] = std::make_shared<MotionDevice>(device);
+    m_records.push_back(JournalRecord::ForDevice(JournalRecord::Type::AddDevice, deviceName, device));
+}
+
+bool MotionConfigTransaction::DeleteDevice(const std::string& deviceName) {
+    if (!StagedDevice(deviceName)) {
+        return false;
+    }
+    m_devices[deviceName] = nullptr;
+    m_records.push_back(JournalRecord::ForDeleteDevice(deviceName));
+    return true;
+}
+
+bool MotionConfigTransaction::DeletePosition(const std::string& deviceName, const std::string& positionName) {
+    MotionDevice* device = StagedDevice(deviceName);
+    if (!device || device->Positions.erase(positionName) == 0) {
+        return false;
+    }
+    m_records.push_back(JournalRecord::ForPosition(JournalRecord::Type::DeletePosition, deviceName, positionName));
+    return true;
+}
+
+void MotionConfigTransaction::UpdateSettings(const Settings& newSettings) {
+    m_settings = newSettings;
+    m_records.push_back(JournalRecord::ForSettings(newSettings));
+}
+
+void MotionConfigTransaction::UpdateGraph(const std::string& graphName, const Graph& updatedGraph) {
+    m_graphs[graphName] = std::make_shared<const Graph>(updatedGraph);
+    m_records.push_back(JournalRecord::ForGraph(graphName, updatedGraph));
+}
+
+bool MotionConfigTransaction::Commit() {
+    if (!m_manager) {
+        return false;
+    }
+    const bool committed = m_records.empty() || m_manager->CommitTransaction(*this);
+    Rollback();
+    return committed;
+}
+
+void MotionConfigTransaction::Rollback() {
+    m_manager = nullptr;
+    m_base.reset();
+    m_devices.clear();
+    m_graphs.clear();
+    m_settings.reset();
+    m_records.clear();
+}
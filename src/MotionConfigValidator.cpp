@@ -0,0 +1,159 @@
+#include "MotionConfigValidator.h"
+#include "MotionConfigVersion.h"
+#include "ThreadPool.h"
+
+#include <cmath>
+
+namespace {
+
+// Below this many nodes to re-check, handing work to the pool costs more than it saves
+constexpr std::size_t kParallelNodeThreshold = 4096;
+
+ConfigDiagnostic MakeDiagnostic(ConfigDiagnostic::Kind type, const std::string& graphName, const std::string& subject,
+    const std::string& device, std::string message) {
+    ConfigDiagnostic diagnostic;
+    diagnostic.Level = ConfigDiagnostic::Severity::Error;
+    diagnostic.Type = type;
+    diagnostic.Graph = graphName;
+    diagnostic.Subject = subject;
+    diagnostic.Device = device;
+    diagnostic.Message = "Graph " + graphName + ": " + std::move(message);
+    return diagnostic;
+}
+
+void CheckGraph(const MotionConfigIndex& index, std::uint32_t graph, std::vector<ConfigDiagnostic>& out) {
+    const GraphIndex& graphIndex = index.GraphAt(graph);
+    const Graph& source = *graphIndex.Source;
+    const std::string& graphName = index.GraphName(graph);
+
+    for (std::uint32_t n = 0; n < source.Nodes.size(); ++n) {
+        const Node& node = source.Nodes[n];
+        if (graphIndex.FindNode(node.Id) != n) {
+            out.push_back(MakeDiagnostic(ConfigDiagnostic::Kind::DuplicateNodeId, graphName, node.Id, node.Device,
+                "duplicate node id " + node.Id));
+        }
+    }
+
+    for (std::size_t e = 0; e < source.Edges.size(); ++e) {
+        if (graphIndex.EdgeSource[e] == InvalidIndex || graphIndex.EdgeTarget[e] == InvalidIndex) {
+            out.push_back(MakeDiagnostic(ConfigDiagnostic::Kind::DanglingEdge, graphName, source.Edges[e].Id, std::string(),
+                "edge " + source.Edges[e].Id + " references unknown node"));
+        }
+        const double tolerance = source.Edges[e].Conditions.CornerTolerance;
+        if (!(tolerance >= 0.0) || std::isinf(tolerance)) {
+            out.push_back(MakeDiagnostic(ConfigDiagnostic::Kind::InvalidCornerTolerance, graphName, source.Edges[e].Id, std::string(),
+                "edge " + source.Edges[e].Id + " has invalid corner tolerance " + std::to_string(tolerance)));
+        }
+    }
+}
+
+void CheckDeviceReferences(const MotionConfigIndex& index, std::uint32_t graph, const std::string& deviceName,
+    std::vector<ConfigDiagnostic>& out) {
+    const std::string& graphName = index.GraphName(graph);
+    const std::uint32_t device = index.FindDevice(deviceName);
+
+    for (const Node* node : index.GraphAt(graph).NodesOfDevice(deviceName)) {
+        if (device == InvalidIndex) {
+            out.push_back(MakeDiagnostic(ConfigDiagnostic::Kind::UnknownDevice, graphName, node->Id, deviceName,
+                "node " + node->Id + " references unknown device " + deviceName));
+        }
+        else if (index.FindPosition(device, node->Position) == InvalidIndex) {
+            out.push_back(MakeDiagnostic(ConfigDiagnostic::Kind::UnknownPosition, graphName, node->Id, deviceName,
+                "node " + node->Id + " references unknown position " + node->Position + " on device " + deviceName));
+        }
+    }
+}
+
+} // namespace
+
+MotionConfigValidator::MotionConfigValidator(ThreadPool* pool)
+    : m_pool(pool) {
+}
+
+MotionConfigValidator::Stats MotionConfigValidator::LastStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::vector<ConfigDiagnostic> MotionConfigValidator::Validate(const MotionConfigVersion& version) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const MotionConfigIndex& index = version.Index();
+
+    struct WorkItem {
+        std::uint32_t Graph;
+        const std::string* Device;  // Null for the graph's own checks
+        std::vector<ConfigDiagnostic>* Out;
+    };
+    std::vector<WorkItem> work;
+    std::size_t nodesToCheck = 0;
+    std::size_t unitCount = 0;
+
+    std::map<std::string, GraphEntry> previous = std::move(m_graphs);
+    m_graphs.clear();
+
+    for (std::uint32_t g = 0; g < index.GraphCount(); ++g) {
+        const GraphIndex& graphIndex = index.GraphAt(g);
+        const std::string& graphName = index.GraphName(g);
+
+        GraphEntry& entry = m_graphs[graphName];
+        auto old = previous.find(graphName);
+        const bool graphChanged = old == previous.end() || old->second.Source != graphIndex.Owner;
+        if (!graphChanged) {
+            entry = std::move(old->second);
+        }
+        else {
+            entry.Source = graphIndex.Owner;
+            entry.Diagnostics.clear();
+            work.push_back({ g, nullptr, &entry.Diagnostics });
+            nodesToCheck += graphIndex.Source->Nodes.size();
+        }
+        ++unitCount;
+
+        for (std::uint32_t bucket = 0; bucket < graphIndex.DeviceNames.Size(); ++bucket) {
+            const std::string& deviceName = graphIndex.DeviceNames.Name(bucket);
+            auto device = version.Devices().find(deviceName);
+            std::shared_ptr<const MotionDevice> devicePtr = device == version.Devices().end() ? nullptr : device->second;
+
+            auto [unit, inserted] = entry.Devices.try_emplace(deviceName);
+            ++unitCount;
+            if (!inserted && unit->second.Device == devicePtr) {
+                continue;
+            }
+            unit->second.Device = std::move(devicePtr);
+            unit->second.Diagnostics.clear();
+            work.push_back({ g, &unit->first, &unit->second.Diagnostics });
+            nodesToCheck += graphIndex.DeviceNodeOffsets[bucket + 1] - graphIndex.DeviceNodeOffsets[bucket];
+        }
+    }
+
+    auto run = [&](std::size_t i) {
+        const WorkItem& item = work[i];
+        if (item.Device) {
+            CheckDeviceReferences(index, item.Graph, *item.Device, *item.Out);
+        }
+        else {
+            CheckGraph(index, item.Graph, *item.Out);
+        }
+    };
+    if (m_pool && nodesToCheck >= kParallelNodeThreshold) {
+        m_pool->ParallelFor(work.size(), run);
+    }
+    else {
+        for (std::size_t i = 0; i < work.size(); ++i) {
+            run(i);
+        }
+    }
+
+    m_stats.UnitsChecked = work.size();
+    m_stats.UnitsReused = unitCount - work.size();
+
+    std::vector<ConfigDiagnostic> diagnostics;
+    for (std::uint32_t g = 0; g < index.GraphCount(); ++g) {
+        const GraphEntry& entry = m_graphs[index.GraphName(g)];
+        diagnostics.insert(diagnostics.end(), entry.Diagnostics.begin(), entry.Diagnostics.end());
+        for (const auto& [deviceName, unit] : entry.Devices) {
+            diagnostics.insert(diagnostics.end(), unit.Diagnostics.begin(), unit.Diagnostics.end());
+        }
+    }
+    return diagnostics;
+}
@@ -0,0 +1,444 @@
+#include "MotionConfigVersion.h"
+#include "MotionTypesReflection.h"
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <queue>
+
+MotionConfigVersion::MotionConfigVersion(const MotionConfigVersion& other)
+    : m_baseDevices(other.m_baseDevices),
+      m_overlay(other.m_overlay),
+      m_devices(other.m_devices),
+      m_graphs(other.m_graphs),
+      m_settings(other.m_settings),
+      m_index(other.m_index),
+      m_travelTables(other.m_travelTables) {
+    // Plain-map views are rebuilt on demand for the new version
+}
+
+void MotionConfigVersion::RebuildIndex() {
+    m_devices.clear();
+    for (const auto& [name, device] : m_baseDevices) {
+        ApplyOverlay(name);
+    }
+    m_index.Build(m_devices, m_graphs);
+    RefreshAllTravelTables();
+}
+
+void MotionConfigVersion::RefreshDevices(const std::string& deviceName) {
+    auto previous = m_devices.find(deviceName);
+    const std::shared_ptr<const MotionDevice> before = previous == m_devices.end() ? nullptr : previous->second;
+    ApplyOverlay(deviceName);
+    m_index.RebuildDevices(m_devices);
+
+    auto current = m_devices.find(deviceName);
+    const MotionDevice* after = current == m_devices.end() ? nullptr : current->second.get();
+    for (std::uint32_t g = 0; g < m_index.GraphCount(); ++g) {
+        if (NodePositionsChanged(g, deviceName, before.get(), after)) {
+            RefreshTravelTable(g);
+        }
+    }
+}
+
+void MotionConfigVersion::RefreshGraph(const std::string& graphName) {
+    m_index.RebuildGraph(graphName, m_graphs.at(graphName));
+    RefreshTravelTable(m_index.FindGraph(graphName));
+}
+
+void MotionConfigVersion::Refresh(const std::set<std::string>& deviceNames, const std::set<std::string>& graphNames, bool settingsChanged) {
+    std::map<std::string, std::shared_ptr<const MotionDevice>> before;
+    if (!deviceNames.empty()) {
+        for (const std::string& deviceName : deviceNames) {
+            auto previous = m_devices.find(deviceName);
+            before.emplace(deviceName, previous == m_devices.end() ? nullptr : previous->second);
+            ApplyOverlay(deviceName);
+        }
+        m_index.RebuildDevices(m_devices);
+    }
+    for (const std::string& graphName : graphNames) {
+        m_index.RebuildGraph(graphName, m_graphs.at(graphName));
+    }
+
+    if (settingsChanged) {
+        RefreshAllTravelTables();
+        return;
+    }
+    for (std::uint32_t g = 0; g < m_index.GraphCount(); ++g) {
+        bool affected = graphNames.count(m_index.GraphName(g)) > 0;
+        for (auto it = before.begin(); !affected && it != before.end(); ++it) {
+            auto current = m_devices.find(it->first);
+            affected = NodePositionsChanged(g, it->first, it->second.get(),
+                current == m_devices.end() ? nullptr : current->second.get());
+        }
+        if (affected) {
+            RefreshTravelTable(g);
+        }
+    }
+}
+
+bool MotionConfigVersion::NodePositionsChanged(std::uint32_t graph, const std::string& deviceName,
+    const MotionDevice* before, const MotionDevice* after) const {
+    if (before == after) {
+        return false;
+    }
+    for (const Node* node : m_index.GraphAt(graph).NodesOfDevice(deviceName)) {
+        const PositionStruct* from = nullptr;
+        const PositionStruct* to = nullptr;
+        if (before) {
+            auto it = before->Positions.find(node->Position);
+            from = it == before->Positions.end() ? nullptr : &it->second;
+        }
+        if (after) {
+            auto it = after->Positions.find(node->Position);
+            to = it == after->Positions.end() ? nullptr : &it->second;
+        }
+        if ((from == nullptr) != (to == nullptr) || (from && !Reflection::Equal(*from, *to))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MotionConfigVersion::RefreshTravelTable(std::uint32_t graph) {
+    if (m_travelTables.size() < m_index.GraphCount()) {
+        m_travelTables.resize(m_index.GraphCount());
+    }
+    m_travelTables[graph] = std::make_shared<LazyTravelTable>();
+}
+
+const TravelTimeTable& MotionConfigVersion::TravelTable(std::uint32_t graph) const {
+    LazyTravelTable& lazy = *m_travelTables[graph];
+    std::call_once(lazy.Once, [&] {
+        const GraphIndex& graphIndex = m_index.GraphAt(graph);
+        if (graphIndex.Source && graphIndex.Source->Nodes.size() > TravelTimeTable::MaxNodes) {
+            std::cout << "Graph " << m_index.GraphName(graph) << " has " << graphIndex.Source->Nodes.size()
+                << " nodes, more than the travel table holds; travel-time routes are searched per query" << std::endl;
+            return;
+        }
+        lazy.Table.Build(graphIndex, m_index, m_settings);
+    });
+    lazy.Built.store(true, std::memory_order_release);
+    return lazy.Table;
+}
+
+void MotionConfigVersion::WarmTravelTables() const {
+    for (std::uint32_t g = 0; g < m_index.GraphCount(); ++g) {
+        TravelTable(g);
+    }
+}
+
+bool MotionConfigVersion::TravelTablesWarm() const {
+    for (const auto& lazy : m_travelTables) {
+        if (!lazy->Built.load(std::memory_order_acquire)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MotionConfigVersion::RefreshAllTravelTables() {
+    m_travelTables.clear();
+    m_travelTables.resize(m_index.GraphCount());
+    for (std::uint32_t g = 0; g < m_index.GraphCount(); ++g) {
+        RefreshTravelTable(g);
+    }
+}
+
+void MotionConfigVersion::ApplyOverlay(const std::string& deviceName) {
+    auto base = m_baseDevices.find(deviceName);
+    if (base == m_baseDevices.end()) {
+        m_devices.erase(deviceName);
+    }
+    else if (m_overlay && m_overlay->Overrides(deviceName)) {
+        m_devices.insert_or_assign(deviceName, std::make_shared<const MotionDevice>(m_overlay->Apply(deviceName, *base->second)));
+    }
+    else {
+        m_devices.insert_or_assign(deviceName, base->second);
+    }
+}
+
+MotionDevice MotionConfigVersion::StripOverlay(const std::string& deviceName, const MotionDevice& edited) const {
+    if (!m_overlay) {
+        return edited;
+    }
+    auto base = m_baseDevices.find(deviceName);
+    return m_overlay->Strip(deviceName, edited, base == m_baseDevices.end() ? nullptr : base->second.get());
+}
+
+const std::map<std::string, MotionDevice>& MotionConfigVersion::GetAllDevices() const {
+    std::call_once(m_plainMaps->DevicesOnce, [this] {
+        for (const auto& [name, device] : m_devices) {
+            m_plainMaps->Devices.emplace(name, *device);
+        }
+    });
+    return m_plainMaps->Devices;
+}
+
+const std::map<std::string, Graph>& MotionConfigVersion::GetAllGraphs() const {
+    std::call_once(m_plainMaps->GraphsOnce, [this] {
+        for (const auto& [name, graph] : m_graphs) {
+            m_plainMaps->Graphs.emplace(name, *graph);
+        }
+    });
+    return m_plainMaps->Graphs;
+}
+
+std::optional<std::reference_wrapper<const MotionDevice>> MotionConfigVersion::GetDevice(const std::string& deviceName) const {
+    std::uint32_t device = m_index.FindDevice(deviceName);
+    if (device == InvalidIndex) {
+        return std::nullopt;
+    }
+    return std::cref(m_index.Device(device));
+}
+
+std::map<std::string, std::reference_wrapper<const MotionDevice>> MotionConfigVersion::GetEnabledDevices() const {
+    std::map<std::string, std::reference_wrapper<const MotionDevice>> enabledDevices;
+    for (const auto& [name, device] : m_devices) {
+        if (device->IsEnabled) {
+            enabledDevices.emplace(name, std::cref(*device));
+        }
+    }
+    return enabledDevices;
+}
+
+std::optional<std::reference_wrapper<const std::map<std::string, PositionStruct>>> MotionConfigVersion::GetDevicePositions(const std::string& deviceName) const {
+    std::uint32_t device = m_index.FindDevice(deviceName);
+    if (device == InvalidIndex) {
+        return std::nullopt;
+    }
+    return std::cref(m_index.Device(device).Positions);
+}
+
+std::optional<std::reference_wrapper<const PositionStruct>> MotionConfigVersion::GetNamedPosition(const std::string& deviceName, const std::string& positionName) const {
+    std::uint32_t device = m_index.FindDevice(deviceName);
+    std::uint32_t position = m_index.FindPosition(device, positionName);
+    if (position == InvalidIndex) {
+        return std::nullopt;
+    }
+    return std::cref(m_index.Position(device, position));
+}
+
+DeviceHandle MotionConfigVersion::ResolveDevice(const std::string& deviceName) const {
+    const std::uint32_t device = m_index.FindDevice(deviceName);
+    return { device, m_index.DeviceGeneration(device) };
+}
+
+PositionHandle MotionConfigVersion::ResolvePosition(const std::string& deviceName, const std::string& positionName) const {
+    std::uint32_t device = m_index.FindDevice(deviceName);
+    std::uint32_t position = m_index.FindPosition(device, positionName);
+    if (position == InvalidIndex) {
+        return {};
+    }
+    return { device, position, m_index.DeviceGeneration(device) };
+}
+
+PositionHandle MotionConfigVersion::ResolvePosition(DeviceHandle device, const std::string& positionName) const {
+    if (!device.IsValid() || device.Generation != m_index.DeviceGeneration(device.Index)) {
+        return {};
+    }
+    std::uint32_t position = m_index.FindPosition(device.Index, positionName);
+    if (position == InvalidIndex) {
+        return {};
+    }
+    return { device.Index, position, device.Generation };
+}
+
+NodeHandle MotionConfigVersion::ResolveNode(const std::string& graphName, const std::string& nodeId) const {
+    std::uint32_t graph = m_index.FindGraph(graphName);
+    std::uint32_t node = m_index.FindNode(graph, nodeId);
+    if (node == InvalidIndex) {
+        return {};
+    }
+    return { graph, node, m_index.GraphGeneration(graph) };
+}
+
+std::optional<std::reference_wrapper<const MotionDevice>> MotionConfigVersion::GetDevice(DeviceHandle device) const {
+    if (!device.IsValid() || device.Generation != m_index.DeviceGeneration(device.Index)) {
+        return std::nullopt;
+    }
+    return std::cref(m_index.Device(device.Index));
+}
+
+std::optional<std::reference_wrapper<const PositionStruct>> MotionConfigVersion::GetNamedPosition(PositionHandle position) const {
+    if (!position.IsValid() || position.Generation != m_index.DeviceGeneration(position.Device)) {
+        return std::nullopt;
+    }
+    return std::cref(m_index.Position(position.Device, position.Index));
+}
+
+const Node* MotionConfigVersion::GetNodeById(NodeHandle node) const {
+    if (!node.IsValid() || node.Generation != m_index.GraphGeneration(node.Graph)) {
+        return nullptr;
+    }
+    return &m_index.GraphAt(node.Graph).Source->Nodes[node.Index];
+}
+
+std::optional<std::reference_wrapper<const Graph>> MotionConfigVersion::GetGraph(const std::string& graphName) const {
+    auto it = m_graphs.find(graphName);
+    if (it == m_graphs.end()) {
+        return std::nullopt;
+    }
+    return std::cref(*it->second);
+}
+
+const Node* MotionConfigVersion::GetNodeById(const std::string& graphName, const std::string& nodeId) const {
+    std::uint32_t graph = m_index.FindGraph(graphName);
+    std::uint32_t node = m_index.FindNode(graph, nodeId);
+    if (node == InvalidIndex) {
+        return nullptr;
+    }
+    return &m_index.GraphAt(graph).Source->Nodes[node];
+}
+
+std::optional<PositionMatch> MotionConfigVersion::FindNearestPosition(const std::string& deviceName, const PositionStruct& actual,
+    const std::string& graphName, double tolerance) const {
+    std::uint32_t device = m_index.FindDevice(deviceName);
+    if (device == InvalidIndex) {
+        return std::nullopt;
+    }
+    return FindNearestPosition(deviceName, actual, AxisWeights::ForDevice(m_index.Device(device)), graphName, tolerance);
+}
+
+std::optional<PositionMatch> MotionConfigVersion::FindNearestPosition(const std::string& deviceName, const PositionStruct& actual,
+    const AxisWeights& weights, const std::string& graphName, double tolerance) const {
+    std::uint32_t device = m_index.FindDevice(deviceName);
+    if (device == InvalidIndex) {
+        return std::nullopt;
+    }
+    const DeviceIndex& deviceIndex = m_index.DeviceAt(device);
+    auto nearest = deviceIndex.Spatial.Nearest(actual, weights, tolerance < 0.0 ? m_settings.PositionTolerance : tolerance);
+    if (!nearest) {
+        return std::nullopt;
+    }
+
+    PositionMatch match;
+    match.Position = { device, nearest->Index, m_index.DeviceGeneration(device) };
+    match.Name = deviceIndex.PositionNames.Name(nearest->Index);
+    match.Distance = nearest->Distance;
+    if (!graphName.empty()) {
+        for (const Node* node : GetNodesByDevice(graphName, deviceName)) {
+            if (node->Position == match.Name) {
+                match.GraphNode = node;
+                break;
+            }
+        }
+    }
+    return match;
+}
+
+Span<const Node* const> MotionConfigVersion::GetNodesByDevice(const std::string& graphName, const std::string& deviceName) const {
+    std::uint32_t graph = m_index.FindGraph(graphName);
+    if (graph == InvalidIndex) {
+        return {};
+    }
+    return m_index.GraphAt(graph).NodesOfDevice(deviceName);
+}
+
+Span<const Edge* const> MotionConfigVersion::GetEdgesBySource(const std::string& graphName, const std::string& sourceNodeId) const {
+    std::uint32_t graph = m_index.FindGraph(graphName);
+    std::uint32_t node = m_index.FindNode(graph, sourceNodeId);
+    if (node == InvalidIndex) {
+        return {};
+    }
+    return m_index.GraphAt(graph).EdgesFrom(node);
+}
+
+std::vector<std::reference_wrapper<const Node>> MotionConfigVersion::FindPath(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId, PathMetric metric) const {
+    std::vector<std::reference_wrapper<const Node>> path;
+    std::uint32_t graphId = m_index.FindGraph(graphName);
+    std::uint32_t start = m_index.FindNode(graphId, startNodeId);
+    std::uint32_t end = m_index.FindNode(graphId, endNodeId);
+    if (start == InvalidIndex || end == InvalidIndex) {
+        return path;
+    }
+
+    const GraphIndex& graphIndex = m_index.GraphAt(graphId);
+    const Graph& graph = *graphIndex.Source;
+
+    if (metric == PathMetric::TravelTime) {
+        const TravelTimeTable& table = TravelTable(graphId);
+        if (table.IsBuilt()) {
+            // Production path: walk the next-hop table
+            if (table.NextHop(start, end) == InvalidIndex) {
+                return path;
+            }
+            path.push_back(std::cref(graph.Nodes[start]));
+            for (std::uint32_t current = start; current != end; ) {
+                current = table.NextHop(current, end);
+                path.push_back(std::cref(graph.Nodes[current]));
+            }
+            return path;
+        }
+
+        std::vector<double> costs = TravelTimeTable::AdjacencyCosts(graphIndex, m_index, m_settings);
+        for (std::uint32_t node : TravelTimeTable::ShortestPath(graphIndex, costs, start, end)) {
+            path.push_back(std::cref(graph.Nodes[node]));
+        }
+        return path;
+    }
+
+    // Breadth-first search by hop count over the CSR adjacency, which already
+    // contains both directions of bidirectional edges
+    std::vector<std::uint32_t> previous(graph.Nodes.size(), InvalidIndex);
+    std::queue<std::uint32_t> frontier;
+    frontier.push(start);
+    previous[start] = start;
+
+    while (!frontier.empty()) {
+        std::uint32_t current = frontier.front();
+        frontier.pop();
+        if (current == end) {
+            break;
+        }
+
+        for (std::uint32_t next : graphIndex.Neighbours(current)) {
+            if (previous[next] == InvalidIndex) {
+                previous[next] = current;
+                frontier.push(next);
+            }
+        }
+    }
+
+    if (previous[end] == InvalidIndex) {
+        return path;
+    }
+
+    for (std::uint32_t current = end; ; current = previous[current]) {
+        path.push_back(std::cref(graph.Nodes[current]));
+        if (current == start) {
+            break;
+        }
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+double MotionConfigVersion::EstimateTravelTime(const std::string& graphName, const std::string& startNodeId, const std::string& endNodeId) const {
+    std::uint32_t graphId = m_index.FindGraph(graphName);
+    std::uint32_t start = m_index.FindNode(graphId, startNodeId);
+    std::uint32_t end = m_index.FindNode(graphId, endNodeId);
+    if (start == InvalidIndex || end == InvalidIndex) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    const TravelTimeTable& table = TravelTable(graphId);
+    if (table.IsBuilt()) {
+        return table.Cost(start, end);
+    }
+
+    auto path = FindPath(graphName, startNodeId, endNodeId, PathMetric::TravelTime);
+    if (path.empty()) {
+        return std::numeric_limits<double>::infinity();
+    }
+
+    double total = 0.0;
+    for (std::size_t i = 1; i < path.size(); ++i) {
+        auto from = GetNamedPosition(path[i - 1].get().Device, path[i - 1].get().Position);
+        auto to = GetNamedPosition(path[i].get().Device, path[i].get().Position);
+        if (from && to && path[i - 1].get().Device == path[i].get().Device) {
+            total += TravelTimeTable::EstimateMoveTime(from->get(), to->get(), m_settings);
+        }
+    }
+    return total;
+}
@@ -0,0 +1,164 @@
+#include "MotionEndNotifier.h"
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace {
+
+bool ValidAxis(int axis) {
+    return axis >= 0 && axis < MotionEndNotifier::MaxAxes;
+}
+
+std::uint64_t Bit(int axis) {
+    return std::uint64_t(1) << axis;
+}
+
+} // namespace
+
+void MotionEndNotifier::Arm(int axis) {
+    Expect(axis, nullptr);
+}
+
+void MotionEndNotifier::Expect(int axis, Callback done) {
+    if (!ValidAxis(axis)) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Slot& slot = m_slots[axis];
+        slot.Signalled = false;
+        slot.Done = std::move(done);
+        m_armed |= Bit(axis);
+    }
+    OnArmed();
+}
+
+bool MotionEndNotifier::Disarm(int axis) {
+    if (!ValidAxis(axis)) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const bool armed = (m_armed & Bit(axis)) != 0;
+    m_armed &= ~Bit(axis);
+    m_slots[axis].Done = nullptr;
+    return armed;
+}
+
+bool MotionEndNotifier::Wait(int axis, std::chrono::milliseconds timeout) {
+    if (!ValidAxis(axis)) {
+        return false;
+    }
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Slot& slot = m_slots[axis];
+    if (!slot.Ready.wait_for(lock, timeout, [&slot] { return slot.Signalled; })) {
+        m_armed &= ~Bit(axis);
+        return false;
+    }
+    m_latency.Record(Clock::now() - slot.SignalTime);
+    slot.Signalled = false;
+    return slot.Succeeded;
+}
+
+void MotionEndNotifier::Signal(std::uint64_t axisMask, bool succeeded) {
+    const Clock::time_point now = Clock::now();
+    std::vector<Callback> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::uint64_t woken = axisMask & m_armed;
+        m_armed &= ~woken;
+        for (int axis = 0; woken != 0; ++axis, woken >>= 1) {
+            if ((woken & 1) == 0) {
+                continue;
+            }
+            Slot& slot = m_slots[axis];
+            if (slot.Done) {
+                callbacks.push_back(std::move(slot.Done));
+                slot.Done = nullptr;
+            }
+            else {
+                slot.Signalled = true;
+                slot.Succeeded = succeeded;
+                slot.SignalTime = now;
+                slot.Ready.notify_one();
+            }
+        }
+    }
+    for (Callback& done : callbacks) {
+        done(succeeded, now);
+    }
+}
+
+std::uint64_t MotionEndNotifier::ArmedAxes() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_armed;
+}
+
+AcsMotionEndNotifier::~AcsMotionEndNotifier() {
+    Detach();
+}
+
+bool AcsMotionEndNotifier::Attach(AcsController& controller, std::uint64_t axisMask) {
+    Detach();
+    m_controller = &controller;
+    if (!controller.SetMotionEndHandler(axisMask, [this](std::uint64_t axes, bool succeeded) { Signal(axes, succeeded); })) {
+        std::cerr << "Failed to install motion interrupts: " << controller.LastError() << std::endl;
+        Detach();
+        return false;
+    }
+    return true;
+}
+
+void AcsMotionEndNotifier::Detach() {
+    if (!m_controller) {
+        return;
+    }
+    m_controller->SetMotionEndHandler(0, nullptr);
+    m_controller = nullptr;
+    Signal(~std::uint64_t(0), false);
+}
+
+PolledMotionEndNotifier::PolledMotionEndNotifier(StatusQuery query, std::chrono::microseconds period)
+    : m_query(std::move(query)), m_period(period) {
+    m_thread = std::thread(&PolledMotionEndNotifier::Loop, this);
+}
+
+PolledMotionEndNotifier::~PolledMotionEndNotifier() {
+    {
+        std::lock_guard<std::mutex> lock(m_pollMutex);
+        m_stopping = true;
+    }
+    m_pollWake.notify_one();
+    m_thread.join();
+}
+
+void PolledMotionEndNotifier::OnArmed() {
+    // Taking the lock orders this with the poll thread's check of ArmedAxes
+    { std::lock_guard<std::mutex> lock(m_pollMutex); }
+    m_pollWake.notify_one();
+}
+
+void PolledMotionEndNotifier::Loop() {
+    std::unique_lock<std::mutex> lock(m_pollMutex);
+    for (;;) {
+        // Nothing to ask the controller while no one waits
+        m_pollWake.wait(lock, [this] { return m_stopping || ArmedAxes() != 0; });
+        if (m_stopping) {
+            return;
+        }
+        const auto next = std::chrono::steady_clock::now() + m_period;
+        const std::uint64_t armed = ArmedAxes();
+
+        lock.unlock();
+        const std::optional<std::uint64_t> stopped = m_query(armed);
+        if (!stopped) {
+            Signal(armed, false);
+        }
+        else if ((*stopped & armed) != 0) {
+            Signal(*stopped & armed, true);
+        }
+        lock.lock();
+
+        m_pollWake.wait_until(lock, next, [this] { return m_stopping; });
+    }
+}
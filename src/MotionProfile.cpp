@@ -0,0 +1,262 @@
+#include "MotionProfile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+constexpr double kUnreachable = std::numeric_limits<double>::infinity();
+
+double LinearDistance(const PositionStruct& from, const PositionStruct& to) {
+    return std::sqrt((to.x - from.x) * (to.x - from.x) + (to.y - from.y) * (to.y - from.y) + (to.z - from.z) * (to.z - from.z));
+}
+
+double RotationalDistance(const PositionStruct& from, const PositionStruct& to) {
+    return std::sqrt((to.u - from.u) * (to.u - from.u) + (to.v - from.v) * (to.v - from.v) + (to.w - from.w) * (to.w - from.w));
+}
+
+// MoveProfile::Plan reduced to the duration. Limits must be positive.
+inline double TrapezoidDuration(double distance, double velocity, double acceleration) {
+    if (distance >= velocity * velocity / acceleration) {
+        return distance / velocity + velocity / acceleration;
+    }
+    return 2.0 * std::sqrt(distance / acceleration);
+}
+
+inline double SCurveDuration(double distance, double velocity, double acceleration, double jerk) {
+    // Time to reach full velocity, with or without reaching full acceleration
+    const double jerkTime = acceleration / jerk;
+    const double rampTime = velocity * jerk >= acceleration * acceleration
+        ? velocity / acceleration + jerkTime
+        : 2.0 * std::sqrt(velocity / jerk);
+    if (distance >= velocity * rampTime) {
+        return rampTime + distance / velocity;
+    }
+
+    // Too short to reach velocity: peak where the two ramps meet
+    const double peak = 0.5 * acceleration * (std::sqrt(jerkTime * jerkTime + 4.0 * distance / acceleration) - jerkTime);
+    if (peak * jerk >= acceleration * acceleration) {
+        return 2.0 * (peak / acceleration + jerkTime);
+    }
+    return 4.0 * std::sqrt(std::cbrt(0.25 * distance * distance * jerk) / jerk);
+}
+
+bool Rotates(const PositionStruct& from, const PositionStruct& to) {
+    return from.u != to.u || from.v != to.v || from.w != to.w;
+}
+
+// Trapezoidal move between two speeds; the distance must allow the change of speed
+double TrapezoidDuration(double distance, double startVelocity, double endVelocity, const AxisLimits& limits) {
+    const double a = limits.Acceleration;
+    const double peak = std::min(limits.Velocity,
+        std::sqrt(0.5 * (2.0 * a * distance + startVelocity * startVelocity + endVelocity * endVelocity)));
+    const double rampDistance = (2.0 * peak * peak - startVelocity * startVelocity - endVelocity * endVelocity) / (2.0 * a);
+    const double cruise = peak > 0.0 ? std::max(0.0, distance - rampDistance) / peak : 0.0;
+    return (2.0 * peak - startVelocity - endVelocity) / a + cruise;
+}
+
+} // namespace
+
+MotionLimits MotionLimits::FromSettings(const Settings& settings) {
+    MotionLimits limits;
+    limits.Linear = { settings.DefaultSpeed, settings.DefaultAcceleration, 0.0 };
+    limits.Rotational = limits.Linear;
+    return limits;
+}
+
+MoveProfile MoveProfile::Plan(double distance, const AxisLimits& limits) {
+    MoveProfile profile;
+    profile.Distance = distance;
+    if (distance <= 0.0) {
+        return profile;
+    }
+    const double velocity = limits.Velocity;
+    const double acceleration = limits.Acceleration;
+    const double jerk = limits.Jerk;
+    if (velocity <= 0.0 || acceleration <= 0.0) {
+        profile.Duration = kUnreachable;
+        return profile;
+    }
+
+    double jerkTime = 0.0;       // Each jerk segment
+    double constantTime = 0.0;   // Each constant-acceleration segment
+    double cruiseTime = 0.0;
+
+    // Ramp to velocity v: jerk and constant-acceleration segment lengths
+    auto ramp = [&](double v) {
+        if (jerk <= 0.0) {
+            jerkTime = 0.0;
+            constantTime = v / acceleration;
+        }
+        else if (v * jerk >= acceleration * acceleration) {
+            jerkTime = acceleration / jerk;
+            constantTime = v / acceleration - jerkTime;
+        }
+        else {
+            jerkTime = std::sqrt(v / jerk);
+            constantTime = 0.0;
+        }
+    };
+
+    ramp(velocity);
+    const double rampTime = 2.0 * jerkTime + constantTime;
+    if (distance >= velocity * rampTime) {
+        profile.PeakVelocity = velocity;
+        cruiseTime = (distance - velocity * rampTime) / velocity;
+    }
+    else if (jerk <= 0.0) {
+        profile.PeakVelocity = std::sqrt(distance * acceleration);
+        ramp(profile.PeakVelocity);
+    }
+    else {
+        // Each ramp covers v * rampTime(v) / 2; solve for the peak that covers half the distance
+        const double fullJerkTime = acceleration / jerk;
+        double peak = 0.5 * acceleration * (std::sqrt(fullJerkTime * fullJerkTime + 4.0 * distance / acceleration) - fullJerkTime);
+        if (peak * jerk < acceleration * acceleration) {
+            peak = std::cbrt(0.25 * distance * distance * jerk);
+        }
+        profile.PeakVelocity = peak;
+        ramp(peak);
+    }
+
+    profile.PeakAcceleration = jerk <= 0.0 ? acceleration : jerkTime * jerk;
+    profile.Phases = { jerkTime, constantTime, jerkTime, cruiseTime, jerkTime, constantTime, jerkTime };
+    profile.Duration = 4.0 * jerkTime + 2.0 * constantTime + cruiseTime;
+    return profile;
+}
+
+TrajectoryEstimator::TrajectoryEstimator(const Settings& settings)
+    : m_defaultLimits(MotionLimits::FromSettings(settings)) {
+}
+
+void TrajectoryEstimator::SetDeviceLimits(const std::string& deviceName, const MotionLimits& limits) {
+    m_deviceLimits[deviceName] = limits;
+}
+
+const MotionLimits& TrajectoryEstimator::LimitsFor(const std::string& deviceName) const {
+    auto it = m_deviceLimits.find(deviceName);
+    return it == m_deviceLimits.end() ? m_defaultLimits : it->second;
+}
+
+MoveEstimate TrajectoryEstimator::Estimate(const std::string& deviceName, const PositionStruct& from, const PositionStruct& to) const {
+    return Estimate(from, to, LimitsFor(deviceName));
+}
+
+MoveEstimate TrajectoryEstimator::Estimate(const PositionStruct& from, const PositionStruct& to, const MotionLimits& limits) {
+    MoveEstimate estimate;
+    estimate.Linear = MoveProfile::Plan(LinearDistance(from, to), limits.Linear);
+    estimate.Rotational = MoveProfile::Plan(RotationalDistance(from, to), limits.Rotational);
+    estimate.RotationLimited = estimate.Rotational.Duration > estimate.Linear.Duration;
+    estimate.Duration = std::max(estimate.Linear.Duration, estimate.Rotational.Duration);
+    return estimate;
+}
+
+void TrajectoryEstimator::EstimateDurations(Span<const PositionStruct> from, Span<const PositionStruct> to,
+    const MotionLimits& limits, Span<double> durations) {
+    const std::size_t count = std::min({ from.size(), to.size(), durations.size() });
+
+    // Degenerate limits make every non-zero move unreachable; leave that to the scalar path
+    const AxisLimits& linear = limits.Linear;
+    const AxisLimits& rotational = limits.Rotational;
+    if (linear.Velocity <= 0.0 || linear.Acceleration <= 0.0 || rotational.Velocity <= 0.0 || rotational.Acceleration <= 0.0) {
+        for (std::size_t i = 0; i < count; ++i) {
+            durations[i] = Estimate(from[i], to[i], limits).Duration;
+        }
+        return;
+    }
+
+    // One loop per jerk mode, so the choice isn't made per element and no profile is built
+    auto run = [&](auto linearDuration, auto rotationalDuration) {
+        for (std::size_t i = 0; i < count; ++i) {
+            const double l = LinearDistance(from[i], to[i]);
+            const double r = RotationalDistance(from[i], to[i]);
+            const double lt = l > 0.0 ? linearDuration(l) : 0.0;
+            const double rt = r > 0.0 ? rotationalDuration(r) : 0.0;
+            durations[i] = std::max(lt, rt);
+        }
+    };
+    auto trapezoid = [](const AxisLimits& axis) {
+        return [v = axis.Velocity, a = axis.Acceleration](double d) { return TrapezoidDuration(d, v, a); };
+    };
+    auto sCurve = [](const AxisLimits& axis) {
+        return [v = axis.Velocity, a = axis.Acceleration, j = axis.Jerk](double d) { return SCurveDuration(d, v, a, j); };
+    };
+
+    if (linear.Jerk <= 0.0 && rotational.Jerk <= 0.0) {
+        run(trapezoid(linear), trapezoid(rotational));
+    }
+    else if (linear.Jerk > 0.0 && rotational.Jerk > 0.0) {
+        run(sCurve(linear), sCurve(rotational));
+    }
+    else if (linear.Jerk > 0.0) {
+        run(sCurve(linear), trapezoid(rotational));
+    }
+    else {
+        run(trapezoid(linear), sCurve(rotational));
+    }
+}
+
+double BlendedPath::CornerVelocity(const PositionStruct& previous, const PositionStruct& corner, const PositionStruct& next,
+    double tolerance, const AxisLimits& limits) {
+    const double in = LinearDistance(previous, corner);
+    const double out = LinearDistance(corner, next);
+    if (tolerance <= 0.0 || in <= 0.0 || out <= 0.0 || limits.Velocity <= 0.0 || limits.Acceleration <= 0.0) {
+        return 0.0;
+    }
+
+    // cos of the angle between the reversed incoming and the outgoing direction:
+    // -1 for a straight line, 1 for a full reversal
+    const double cosTheta = -((corner.x - previous.x) * (next.x - corner.x) + (corner.y - previous.y) * (next.y - corner.y) +
+        (corner.z - previous.z) * (next.z - corner.z)) / (in * out);
+    const double sinHalfTheta = std::sqrt(std::max(0.0, 0.5 * (1.0 - cosTheta)));
+    if (sinHalfTheta >= 1.0 - 1e-9) {
+        return limits.Velocity;
+    }
+    // A blend arc of this radius deviates from the corner by exactly 'tolerance'
+    const double radius = tolerance * sinHalfTheta / (1.0 - sinHalfTheta);
+    return std::min(limits.Velocity, std::sqrt(limits.Acceleration * radius));
+}
+
+std::vector<BlendSegment> BlendedPath::Plan(const PositionStruct& start, const std::vector<PositionStruct>& points,
+    const std::vector<double>& tolerances, const MotionLimits& limits) {
+    const AxisLimits& linear = limits.Linear;
+    std::vector<BlendSegment> segments(points.size());
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        const PositionStruct& from = i == 0 ? start : points[i - 1];
+        segments[i].Target = points[i];
+        segments[i].Distance = LinearDistance(from, points[i]);
+        if (i + 1 < points.size() && i < tolerances.size() && !Rotates(from, points[i]) && !Rotates(points[i], points[i + 1])) {
+            segments[i].EndVelocity = CornerVelocity(from, points[i], points[i + 1], tolerances[i], linear);
+        }
+    }
+
+    // Each segment must be able to slow down to the next corner's speed, then speed up to it
+    for (std::size_t i = segments.size(); i-- > 1;) {
+        const double reachable = std::sqrt(segments[i].EndVelocity * segments[i].EndVelocity + 2.0 * linear.Acceleration * segments[i].Distance);
+        segments[i - 1].EndVelocity = std::min(segments[i - 1].EndVelocity, reachable);
+    }
+    double startVelocity = 0.0;
+    for (std::size_t i = 0; i < segments.size(); ++i) {
+        BlendSegment& segment = segments[i];
+        segment.EndVelocity = std::min(segment.EndVelocity,
+            std::sqrt(startVelocity * startVelocity + 2.0 * linear.Acceleration * segment.Distance));
+        const PositionStruct& from = i == 0 ? start : points[i - 1];
+        if (startVelocity == 0.0 && segment.EndVelocity == 0.0) {
+            segment.Seconds = TrajectoryEstimator::Estimate(from, segment.Target, limits).Duration;
+        }
+        else {
+            segment.Seconds = TrapezoidDuration(segment.Distance, startVelocity, segment.EndVelocity, linear);
+        }
+        startVelocity = segment.EndVelocity;
+    }
+    return segments;
+}
+
+double BlendedPath::TotalSeconds(const std::vector<BlendSegment>& segments) {
+    double total = 0.0;
+    for (const BlendSegment& segment : segments) {
+        total += segment.Seconds;
+    }
+    return total;
+}
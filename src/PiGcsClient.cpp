@@ -0,0 +1,241 @@
+#include "PiGcsClient.h"
+
+#include <SFML/Network/IpAddress.hpp>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::string_view Trim(std::string_view text) {
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    while (!text.empty() && text.front() == ' ') {
+        text.remove_prefix(1);
+    }
+    return text;
+}
+
+// Calls visit(axisIndex, valueText) for each "X=value" line of a reply
+template <typename Visit>
+bool ForEachAxisLine(std::string_view reply, const char* axes, Visit visit) {
+    const std::size_t axisCount = std::strlen(axes);
+    std::uint32_t seen = 0;
+    while (!reply.empty()) {
+        const std::size_t end = reply.find('\n');
+        const std::string_view line = Trim(reply.substr(0, end));
+        reply = end == std::string_view::npos ? std::string_view() : reply.substr(end + 1);
+
+        const std::size_t equals = line.find('=');
+        if (equals != 1) {
+            continue;
+        }
+        const char* axis = line[0] == '\0' ? nullptr : std::strchr(axes, line[0]);
+        if (!axis) {
+            continue;
+        }
+        const std::size_t index = static_cast<std::size_t>(axis - axes);
+        if (!visit(index, Trim(line.substr(equals + 1)))) {
+            return false;
+        }
+        seen |= 1u << index;
+    }
+    return seen == (1u << axisCount) - 1;
+}
+
+} // namespace
+
+PiGcsClient::~PiGcsClient() {
+    Disconnect();
+}
+
+bool PiGcsClient::Connect(const std::string& address, unsigned short port, std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_connected) {
+        return true;
+    }
+    m_timeout = timeout;
+    m_socket.setBlocking(true);
+    if (m_socket.connect(sf::IpAddress(address), port, sf::milliseconds(static_cast<sf::Int32>(timeout.count()))) != sf::Socket::Done) {
+        return Fail("cannot connect to " + address + ":" + std::to_string(port), false);
+    }
+    m_selector.add(m_socket);
+    m_connected = true;
+
+    // Start without an error left over from an earlier session
+    return Append("ERR?\n") && Exchange(1);
+}
+
+void PiGcsClient::Disconnect() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_connected) {
+        m_selector.clear();
+        m_socket.disconnect();
+        m_connected = false;
+    }
+}
+
+bool PiGcsClient::IsConnected() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_connected;
+}
+
+bool PiGcsClient::Move(const char* axes, const double* targets, const double* velocities) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (velocities && !AppendAxisValues("VEL", axes, velocities)) {
+        return false;
+    }
+    return AppendAxisValues("MOV", axes, targets) && Append("ERR?\n") && Exchange(1) && CheckError(m_replies[0], "MOV");
+}
+
+bool PiGcsClient::SetVelocity(const char* axes, const double* velocities) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return AppendAxisValues("VEL", axes, velocities) && Append("ERR?\n") && Exchange(1) && CheckError(m_replies[0], "VEL");
+}
+
+bool PiGcsClient::Halt() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // "Controller was stopped by command" is the expected answer
+    return Append("HLT\nERR?\n") && Exchange(1) && CheckError(m_replies[0], "HLT", 10);
+}
+
+bool PiGcsClient::ReadStatus(const char* axes, double* positions, std::uint32_t& onTargetAxes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!AppendAxisValues("POS?", axes, nullptr) || !AppendAxisValues("ONT?", axes, nullptr) || !Exchange(2)) {
+        return false;
+    }
+    if (!ParseAxisValues(m_replies[0], axes, positions)) {
+        return Fail("unexpected POS? reply", false);
+    }
+    return ParseOnTarget(m_replies[1], axes, onTargetAxes);
+}
+
+bool PiGcsClient::ReadOnTarget(const char* axes, std::uint32_t& onTargetAxes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return AppendAxisValues("ONT?", axes, nullptr) && Exchange(1) && ParseOnTarget(m_replies[0], axes, onTargetAxes);
+}
+
+bool PiGcsClient::ParseAxisValues(std::string_view reply, const char* axes, double* values) {
+    return ForEachAxisLine(reply, axes, [values](std::size_t index, std::string_view text) {
+        const std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), values[index]);
+        return result.ec == std::errc();
+    });
+}
+
+bool PiGcsClient::ParseOnTarget(std::string_view reply, const char* axes, std::uint32_t& onTargetAxes) {
+    std::uint32_t mask = 0;
+    const bool parsed = ForEachAxisLine(reply, axes, [&mask](std::size_t index, std::string_view text) {
+        if (text == "1") {
+            mask |= 1u << index;
+        }
+        return text == "0" || text == "1";
+    });
+    if (!parsed) {
+        return Fail("unexpected ONT? reply", false);
+    }
+    onTargetAxes = mask;
+    return true;
+}
+
+bool PiGcsClient::Append(std::string_view text) {
+    if (text.size() > m_out.size() - m_outSize) {
+        m_outSize = 0;
+        return Fail("command batch too long", false);
+    }
+    std::memcpy(m_out.data() + m_outSize, text.data(), text.size());
+    m_outSize += text.size();
+    return true;
+}
+
+// "MOV X 1.5 Y 2\n", or "POS? X Y\n" without values
+bool PiGcsClient::AppendAxisValues(std::string_view command, const char* axes, const double* values) {
+    if (!Append(command)) {
+        return false;
+    }
+    for (std::size_t i = 0; axes[i] != '\0'; ++i) {
+        const char prefix[] = { ' ', axes[i], ' ' };
+        if (!Append(std::string_view(prefix, values ? 3 : 2))) {
+            return false;
+        }
+        if (values) {
+            char number[32];
+            const std::to_chars_result result = std::to_chars(number, number + sizeof(number), values[i]);
+            if (!Append(std::string_view(number, static_cast<std::size_t>(result.ptr - number)))) {
+                return false;
+            }
+        }
+    }
+    return Append("\n");
+}
+
+bool PiGcsClient::Exchange(std::size_t replies) {
+    const std::size_t size = m_outSize;
+    m_outSize = 0;
+    if (!m_connected) {
+        return Fail("not connected", false);
+    }
+    if (m_socket.send(m_out.data(), size) != sf::Socket::Done) {
+        return Fail("send failed", true);
+    }
+    ++m_roundTrips;
+
+    // A reply ends at a line feed; a space before it means another line follows
+    const Clock::time_point deadline = Clock::now() + m_timeout;
+    std::size_t used = 0;
+    std::size_t start = 0;
+    std::size_t scan = 0;
+    std::size_t count = 0;
+    for (;;) {
+        for (; scan < used && count < replies; ++scan) {
+            if (m_in[scan] == '\n' && (scan == start || m_in[scan - 1] != ' ')) {
+                m_replies[count++] = std::string_view(m_in.data() + start, scan - start);
+                start = scan + 1;
+            }
+        }
+        if (count == replies) {
+            return true;
+        }
+        if (used == m_in.size()) {
+            return Fail("reply too long", true);
+        }
+        const auto left = std::chrono::duration_cast<std::chrono::microseconds>(deadline - Clock::now());
+        if (left.count() <= 0 || !m_selector.wait(sf::microseconds(left.count()))) {
+            return Fail("no reply within " + std::to_string(m_timeout.count()) + " ms", true);
+        }
+        std::size_t received = 0;
+        if (m_socket.receive(m_in.data() + used, m_in.size() - used, received) != sf::Socket::Done) {
+            return Fail("connection lost", true);
+        }
+        used += received;
+    }
+}
+
+bool PiGcsClient::CheckError(std::string_view reply, const char* operation, int tolerated) {
+    int code = 0;
+    reply = Trim(reply);
+    if (std::from_chars(reply.data(), reply.data() + reply.size(), code).ec != std::errc()) {
+        return Fail("unexpected ERR? reply", false);
+    }
+    if (code == 0) {
+        return true;
+    }
+    m_controllerError = code;
+    if (code == tolerated) {
+        return true;
+    }
+    return Fail(std::string(operation) + " failed with controller error " + std::to_string(code), false);
+}
+
+bool PiGcsClient::Fail(const std::string& message, bool disconnect) {
+    m_lastError = "GCS: " + message;
+    std::cerr << m_lastError << std::endl;
+    if (disconnect && m_connected) {
+        m_selector.clear();
+        m_socket.disconnect();
+        m_connected = false;
+    }
+    return false;
+}
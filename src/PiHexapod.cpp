@@ -0,0 +1,210 @@
+#include "PiHexapod.h"
+
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+double& Coordinate(PositionStruct& position, std::size_t index) {
+    switch (index) {
+    case 0: return position.x;
+    case 1: return position.y;
+    case 2: return position.z;
+    case 3: return position.u;
+    case 4: return position.v;
+    default: return position.w;
+    }
+}
+
+double Coordinate(const PositionStruct& position, std::size_t index) {
+    const double values[] = { position.x, position.y, position.z, position.u, position.v, position.w };
+    return values[index < 6 ? index : 5];
+}
+
+} // namespace
+
+PiHexapod::PiHexapod(const MotionDevice& device, const MotionLimits& limits, std::chrono::microseconds onTargetPollPeriod)
+    : m_device(device),
+      m_limits(limits),
+      m_motionEnd([this](std::uint64_t) { return QueryStopped(); }, onTargetPollPeriod) {
+    const char* identifiers = "XYZUVW";
+    for (std::size_t index = 0; index < 6; ++index) {
+        for (char c : device.InstalledAxes) {
+            if (std::toupper(static_cast<unsigned char>(c)) == identifiers[index]) {
+                m_axes.push_back(identifiers[index]);
+                m_coordinates.push_back(index);
+                m_velocities.push_back(index < 3 ? limits.Linear.Velocity : limits.Rotational.Velocity);
+                break;
+            }
+        }
+    }
+}
+
+PiHexapod::~PiHexapod() {
+    Disconnect();
+}
+
+bool PiHexapod::Connect() {
+    if (!m_client.Connect(m_device.IpAddress, static_cast<unsigned short>(m_device.Port))) {
+        return false;
+    }
+    for (double velocity : m_velocities) {
+        if (velocity <= 0.0) {
+            return true;  // Keep the controller's own
+        }
+    }
+    return m_client.SetVelocity(m_axes.c_str(), m_velocities.data());
+}
+
+void PiHexapod::Disconnect() {
+    m_client.Disconnect();
+}
+
+bool PiHexapod::MoveTo(const PositionStruct& target) {
+    MotionWaypoint waypoint;
+    waypoint.Target = target;
+    return MoveAlong({ waypoint });
+}
+
+bool PiHexapod::MoveAlong(const std::vector<MotionWaypoint>& route) {
+    {
+        std::lock_guard<std::mutex> lock(m_moveMutex);
+        m_halted = false;
+    }
+    std::optional<PositionStruct> from = GetPosition();
+    if (!from) {
+        return false;
+    }
+    for (const MotionWaypoint& waypoint : route) {
+        // Twice the estimate plus some slack, unless the edge sets a timeout
+        const double estimate = TrajectoryEstimator::Estimate(*from, waypoint.Target, m_limits).Duration;
+        const double seconds = waypoint.TimeoutSeconds > 0 ? waypoint.TimeoutSeconds
+            : std::isfinite(estimate) ? 2.0 * estimate + 5.0 : 60.0;
+
+        // ONT? goes out after the MOV on the same connection, so arming now can't
+        // see the position before the move
+        if (!SendMove(waypoint.Target)) {
+            return false;
+        }
+        m_motionEnd.Arm(AllAxes);
+        if (!m_motionEnd.Wait(AllAxes, std::chrono::milliseconds(static_cast<long long>(seconds * 1000.0)))) {
+            std::cerr << m_device.Name << ": not on target after " << seconds << " s" << std::endl;
+            m_client.Halt();
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(m_moveMutex);
+        if (m_halted) {
+            return false;
+        }
+        from = waypoint.Target;
+    }
+    return true;
+}
+
+std::optional<PositionStruct> PiHexapod::GetPosition() {
+    DeviceStatus status;
+    if (!ReadStatus(status)) {
+        return std::nullopt;
+    }
+    return status.Position;
+}
+
+bool PiHexapod::ReadStatus(DeviceStatus& status) {
+    std::array<double, PiGcsClient::MaxAxes> values{};
+    std::uint32_t onTarget = 0;
+    if (!m_client.ReadStatus(m_axes.c_str(), values.data(), onTarget)) {
+        return false;
+    }
+    status.MovingAxes = 0;
+    for (std::size_t i = 0; i < m_axes.size(); ++i) {
+        Coordinate(status.Position, m_coordinates[i]) = values[i];
+        if ((onTarget & (1u << i)) == 0) {
+            status.MovingAxes |= 1u << m_coordinates[i];
+        }
+    }
+    return true;
+}
+
+bool PiHexapod::StartMove(const std::vector<MotionWaypoint>& route, Completion done) {
+    if (route.empty()) {
+        done(true, std::string(), {});
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_moveMutex);
+        m_route = route;
+        m_nextWaypoint = 1;
+        m_done = std::move(done);
+        m_halted = false;
+    }
+    if (!SendMove(route.front().Target)) {
+        std::lock_guard<std::mutex> lock(m_moveMutex);
+        m_done = nullptr;
+        return false;
+    }
+    m_motionEnd.Expect(AllAxes, [this](bool succeeded, MotionEndNotifier::Clock::time_point signalled) {
+        WaypointReached(succeeded, signalled);
+    });
+    return true;
+}
+
+void PiHexapod::Halt() {
+    {
+        std::lock_guard<std::mutex> lock(m_moveMutex);
+        m_halted = true;
+    }
+    m_client.Halt();
+}
+
+void PiHexapod::WaypointReached(bool succeeded, MotionEndNotifier::Clock::time_point signalled) {
+    std::unique_lock<std::mutex> lock(m_moveMutex);
+    if (succeeded && !m_halted && m_nextWaypoint < m_route.size()) {
+        const PositionStruct target = m_route[m_nextWaypoint++].Target;
+        lock.unlock();
+        if (SendMove(target)) {
+            m_motionEnd.Expect(AllAxes, [this](bool next, MotionEndNotifier::Clock::time_point nextSignalled) {
+                WaypointReached(next, nextSignalled);
+            });
+            return;
+        }
+        succeeded = false;
+        lock.lock();
+    }
+    Completion done = std::move(m_done);
+    m_done = nullptr;
+    // Stopped short of the target
+    if (m_halted) {
+        succeeded = false;
+        m_halted = false;
+    }
+    lock.unlock();
+    if (done) {
+        done(succeeded, succeeded ? std::string() : m_device.Name + " halted or failed: " + m_client.LastError(), signalled);
+    }
+}
+
+bool PiHexapod::SendMove(const PositionStruct& target) {
+    std::array<double, PiGcsClient::MaxAxes> values{};
+    for (std::size_t i = 0; i < m_axes.size(); ++i) {
+        values[i] = Coordinate(target, m_coordinates[i]);
+    }
+    return m_client.Move(m_axes.c_str(), values.data());
+}
+
+std::optional<std::uint64_t> PiHexapod::QueryStopped() {
+    const std::uint64_t stopped = std::uint64_t(1) << AllAxes;
+    {
+        // A halted hexapod won't get on target; HLT has already stopped it
+        std::lock_guard<std::mutex> lock(m_moveMutex);
+        if (m_halted) {
+            return stopped;
+        }
+    }
+    std::uint32_t onTarget = 0;
+    if (!m_client.ReadOnTarget(m_axes.c_str(), onTarget)) {
+        return std::nullopt;
+    }
+    return onTarget == (1u << m_axes.size()) - 1 ? stopped : 0;
+}
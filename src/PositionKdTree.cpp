@@ -0,0 +1,118 @@
+#include "PositionKdTree.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+
+namespace {
+
+std::array<double, 6> ToArray(const PositionStruct& p) {
+    return { p.x, p.y, p.z, p.u, p.v, p.w };
+}
+
+} // namespace
+
+AxisWeights AxisWeights::ForDevice(const MotionDevice& device, double linear, double rotational) {
+    static const char axisNames[] = "XYZUVW";
+    AxisWeights weights;
+    for (std::size_t axis = 0; axis < 6; ++axis) {
+        bool installed = false;
+        for (char c : device.InstalledAxes) {
+            installed = installed || std::toupper(static_cast<unsigned char>(c)) == axisNames[axis];
+        }
+        weights.Axis[axis] = !installed ? 0.0 : axis < 3 ? linear : rotational;
+    }
+    return weights;
+}
+
+void PositionKdTree::Build(const std::vector<PositionStruct>& positions) {
+    m_nodes.clear();
+    m_nodes.reserve(positions.size());
+    for (std::uint32_t i = 0; i < positions.size(); ++i) {
+        m_nodes.push_back({ ToArray(positions[i]), i, 0 });
+    }
+    Build(0, m_nodes.size());
+}
+
+void PositionKdTree::Build(std::size_t lo, std::size_t hi) {
+    if (hi - lo < 2) {
+        return;
+    }
+
+    // Split on the axis with the widest spread
+    std::array<double, 6> low, high;
+    low.fill(std::numeric_limits<double>::infinity());
+    high.fill(-std::numeric_limits<double>::infinity());
+    for (std::size_t i = lo; i < hi; ++i) {
+        for (std::size_t axis = 0; axis < 6; ++axis) {
+            low[axis] = std::min(low[axis], m_nodes[i].Point[axis]);
+            high[axis] = std::max(high[axis], m_nodes[i].Point[axis]);
+        }
+    }
+    std::uint8_t splitAxis = 0;
+    for (std::uint8_t axis = 1; axis < 6; ++axis) {
+        if (high[axis] - low[axis] > high[splitAxis] - low[splitAxis]) {
+            splitAxis = axis;
+        }
+    }
+
+    const std::size_t mid = lo + (hi - lo) / 2;
+    std::nth_element(m_nodes.begin() + lo, m_nodes.begin() + mid, m_nodes.begin() + hi,
+        [splitAxis](const TreeNode& a, const TreeNode& b) { return a.Point[splitAxis] < b.Point[splitAxis]; });
+    m_nodes[mid].Axis = splitAxis;
+
+    Build(lo, mid);
+    Build(mid + 1, hi);
+}
+
+std::optional<PositionKdTree::Match> PositionKdTree::Nearest(const PositionStruct& query, const AxisWeights& weights,
+    double maxDistance) const {
+    double bestSquared = std::isinf(maxDistance) ? maxDistance : maxDistance * maxDistance;
+    std::uint32_t best = 0xFFFFFFFFu;
+    Search(0, m_nodes.size(), ToArray(query), weights.Axis, bestSquared, best);
+    if (best == 0xFFFFFFFFu) {
+        return std::nullopt;
+    }
+    return Match{ best, std::sqrt(bestSquared) };
+}
+
+void PositionKdTree::Search(std::size_t lo, std::size_t hi, const std::array<double, 6>& query,
+    const std::array<double, 6>& weights, double& bestSquared, std::uint32_t& best) const {
+    if (lo >= hi) {
+        return;
+    }
+    const std::size_t mid = lo + (hi - lo) / 2;
+    const TreeNode& node = m_nodes[mid];
+
+    double distanceSquared = 0.0;
+    for (std::size_t axis = 0; axis < 6; ++axis) {
+        const double d = (query[axis] - node.Point[axis]) * weights[axis];
+        distanceSquared += d * d;
+    }
+    // Ties go to the lowest index so results don't depend on tree layout
+    if (distanceSquared < bestSquared || (distanceSquared == bestSquared && node.Index < best)) {
+        bestSquared = distanceSquared;
+        best = node.Index;
+    }
+    if (hi - lo == 1) {
+        return;
+    }
+
+    const double offset = (query[node.Axis] - node.Point[node.Axis]) * weights[node.Axis];
+    const bool leftFirst = offset < 0.0;
+    if (leftFirst) {
+        Search(lo, mid, query, weights, bestSquared, best);
+    }
+    else {
+        Search(mid + 1, hi, query, weights, bestSquared, best);
+    }
+    // The far side can only hold something closer if the splitting plane is within reach
+    if (offset * offset <= bestSquared) {
+        if (leftFirst) {
+            Search(mid + 1, hi, query, weights, bestSquared, best);
+        }
+        else {
+            Search(lo, mid, query, weights, bestSquared, best);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#include "ProductOverlay.h"
+#include "MotionConfigParser.h"
+#include "MappedFile.h"
+
+#include <stdexcept>
+
+namespace {
+
+bool SamePosition(const PositionStruct& a, const PositionStruct& b) {
+    return a.x == b.x && a.y == b.y && a.z == b.z && a.u == b.u && a.v == b.v && a.w == b.w;
+}
+
+} // namespace
+
+ProductOverlay ProductOverlay::Load(const std::string& product, const std::vector<std::string>& layerPaths) {
+    ProductOverlay overlay;
+    overlay.Product = product;
+    overlay.LayerPaths = layerPaths;
+
+    for (const std::string& path : layerPaths) {
+        MappedFile file;
+        if (!file.Open(path)) {
+            throw std::runtime_error("Failed to open product overlay file: " + path);
+        }
+        std::map<std::string, MotionDevice> devices;
+        std::map<std::string, Graph> graphs;
+        Settings settings;
+        std::string errorMessage;
+        if (!ParseMotionConfig(file.Data(), file.Size(), devices, graphs, settings, errorMessage)) {
+            throw std::runtime_error("Failed to parse product overlay file " + path + ": " + errorMessage);
+        }
+        for (auto& [deviceName, device] : devices) {
+            for (auto& [positionName, position] : device.Positions) {
+                overlay.Positions[deviceName][positionName] = position;
+            }
+        }
+    }
+    return overlay;
+}
+
+MotionDevice ProductOverlay::Apply(const std::string& deviceName, const MotionDevice& base) const {
+    MotionDevice device = base;
+    auto overrides = Positions.find(deviceName);
+    if (overrides != Positions.end()) {
+        for (const auto& [positionName, position] : overrides->second) {
+            device.Positions[positionName] = position;
+        }
+    }
+    return device;
+}
+
+MotionDevice ProductOverlay::Strip(const std::string& deviceName, MotionDevice edited, const MotionDevice* base) const {
+    auto overrides = Positions.find(deviceName);
+    if (overrides == Positions.end()) {
+        return edited;
+    }
+    for (const auto& [positionName, position] : overrides->second) {
+        auto it = edited.Positions.find(positionName);
+        if (it == edited.Positions.end() || !SamePosition(it->second, position)) {
+            continue;
+        }
+        auto original = base ? base->Positions.find(positionName) : std::map<std::string, PositionStruct>::const_iterator();
+        if (base && original != base->Positions.end()) {
+            it->second = original->second;
+        }
+        else {
+            edited.Positions.erase(it);
+        }
+    }
+    return edited;
+}
@@ -0,0 +1,192 @@
+#include "PvtFeeder.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double Coordinate(const PositionStruct& position, int axis) {
+    return axis == 0 ? position.x : axis == 1 ? position.y : position.z;
+}
+
+} // namespace
+
+PvtFeeder::PvtFeeder(AcsController& controller, std::vector<int> axes)
+    : m_controller(controller), m_axes(std::move(axes)) {
+    if (m_axes.empty() || m_axes.back() != -1) {
+        m_axes.push_back(-1);
+    }
+}
+
+PvtFeeder::~PvtFeeder() {
+    Stop();
+}
+
+bool PvtFeeder::Start(const TrajectoryPath& path, double period, std::chrono::microseconds refill) {
+    if (m_thread.joinable() || m_axes.size() < 2) {
+        return false;
+    }
+    const std::size_t count = path.PointCount(period);
+    if (count == 0) {
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = false;
+        m_succeeded = false;
+        m_stats = PvtFeederStats();
+        m_stats.TotalPoints = count;
+        m_stats.Period = path.PointPeriod(period);
+        m_lastError.clear();
+    }
+    m_thread = std::thread(&PvtFeeder::Run, this, path, period, refill);
+    return true;
+}
+
+bool PvtFeeder::Wait() {
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_succeeded;
+}
+
+void PvtFeeder::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    Wait();
+}
+
+PvtFeederStats PvtFeeder::Stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+std::string PvtFeeder::LastError() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
+
+void PvtFeeder::Run(TrajectoryPath path, double period, std::chrono::microseconds refill) {
+    const int lead = m_axes[0];
+    const std::size_t total = path.PointCount(period);
+    const double pointPeriod = path.PointPeriod(period);
+
+    if (!m_controller.Spline(m_axes.data(), pointPeriod * 1000.0)) {
+        Fail("start spline");
+        return;
+    }
+    int free = 0;
+    if (!m_controller.ReadInteger("GSFREE", lead, lead, &free)) {
+        Fail("read buffer");
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.BufferSize = free;
+    }
+    if (free <= 0 || !Send(path, std::min<std::size_t>(free, total))) {
+        Fail("fill buffer");
+        return;
+    }
+    if (!m_controller.Go(m_axes.data())) {
+        Fail("go");
+        return;
+    }
+    const Clock::time_point start = Clock::now();
+    if (refill.count() <= 0) {
+        refill = std::chrono::microseconds(static_cast<long long>(pointPeriod * free * 1e6 / 4.0));
+    }
+
+    std::size_t sent = std::min<std::size_t>(free, total);
+    while (sent < total) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_wake.wait_for(lock, refill, [this] { return m_stopping; })) {
+                break;
+            }
+        }
+        if (!m_controller.ReadInteger("GSFREE", lead, lead, &free)) {
+            Fail("read buffer");
+            return;
+        }
+        const std::size_t count = std::min<std::size_t>(std::max(free, 0), total - sent);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const int queued = m_stats.BufferSize - free;
+            m_stats.LowestQueued = m_stats.LowestQueued < 0 ? queued : std::min(m_stats.LowestQueued, queued);
+            if (queued <= 0) {
+                ++m_stats.Underruns;
+            }
+            if (count > 0) {
+                ++m_stats.Refills;
+            }
+        }
+        if (count > 0 && !Send(path, count)) {
+            Fail("add point");
+            return;
+        }
+        sent += count;
+    }
+    if (sent < total) {
+        m_controller.Halt(m_axes.data());
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_lastError = "PV stream stopped";
+        return;
+    }
+    if (!m_controller.EndSequence(m_axes.data())) {
+        Fail("end sequence");
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.Seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    m_stats.PointsPerSecond = m_stats.Seconds > 0.0 ? m_stats.Points / m_stats.Seconds : 0.0;
+    m_succeeded = true;
+}
+
+// The next 'count' points of the path
+bool PvtFeeder::Send(const TrajectoryPath& path, std::size_t count) {
+    double position[3] = {};
+    double velocity[3] = {};
+    double addMicroseconds = 0.0;
+    double maxMicroseconds = 0.0;
+    std::size_t next = Stats().Points + 1;
+    const double period = Stats().Period;
+
+    for (std::size_t i = 0; i < count; ++i, ++next) {
+        const PvPoint point = path.At(next * period);
+        for (std::size_t j = 0; j < 3 && m_axes[j] >= 0; ++j) {
+            position[j] = Coordinate(point.Position, m_axes[j]);
+            velocity[j] = Coordinate(point.Velocity, m_axes[j]);
+        }
+        const Clock::time_point before = Clock::now();
+        const bool added = m_controller.AddPVPoint(m_axes.data(), position, velocity);
+        const double microseconds = std::chrono::duration<double, std::micro>(Clock::now() - before).count();
+        if (!added) {
+            return false;
+        }
+        addMicroseconds += microseconds;
+        maxMicroseconds = std::max(maxMicroseconds, microseconds);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.MeanAddMicroseconds = (m_stats.MeanAddMicroseconds * m_stats.Points + addMicroseconds) / (m_stats.Points + count);
+    m_stats.MaxAddMicroseconds = std::max(m_stats.MaxAddMicroseconds, maxMicroseconds);
+    m_stats.Points += count;
+    return true;
+}
+
+bool PvtFeeder::Fail(const std::string& operation) {
+    const std::string error = "PV stream: " + operation + " failed: " + m_controller.LastError();
+    std::cerr << error << std::endl;
+    m_controller.Halt(m_axes.data());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_lastError = error;
+    return false;
+}
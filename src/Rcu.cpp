@@ -0,0 +1,101 @@
+#include "Rcu.h"
+
+#include <cstdint>
+#include <thread>
+
+namespace {
+
+constexpr std::size_t kReaderSlotCount = 256;
+
+// One slot per reader thread, on its own cache line so readers don't contend.
+// Epoch is 0 while the thread is outside a critical section.
+struct alignas(64) ReaderSlot {
+    std::atomic<std::uint64_t> Epoch{ 0 };
+    std::atomic<bool> Claimed{ false };
+};
+
+ReaderSlot g_readerSlots[kReaderSlotCount];
+alignas(64) std::atomic<std::uint64_t> g_epoch{ 1 };
+
+// Readers that couldn't claim a slot share this counter
+alignas(64) std::atomic<std::uint32_t> g_overflowReaders{ 0 };
+
+struct ReaderRegistration {
+    ReaderSlot* Slot = nullptr;
+    unsigned Depth = 0;
+
+    ReaderRegistration() {
+        for (ReaderSlot& slot : g_readerSlots) {
+            bool expected = false;
+            if (!slot.Claimed.load(std::memory_order_relaxed) &&
+                slot.Claimed.compare_exchange_strong(expected, true)) {
+                Slot = &slot;
+                break;
+            }
+        }
+    }
+
+    ~ReaderRegistration() {
+        if (Slot) {
+            Slot->Epoch.store(0);
+            Slot->Claimed.store(false);
+        }
+    }
+};
+
+thread_local ReaderRegistration t_reader;
+
+} // namespace
+
+namespace Rcu {
+
+ReadGuard::ReadGuard() {
+    ReaderRegistration& reader = t_reader;
+    if (reader.Depth++ > 0) {
+        return;
+    }
+    // Both accesses are sequentially consistent: seeing a writer's new epoch must
+    // imply seeing the value it published, and the slot store must be ordered
+    // before the caller's loads
+    if (reader.Slot) {
+        reader.Slot->Epoch.store(g_epoch.load());
+    }
+    else {
+        g_overflowReaders.fetch_add(1);
+    }
+}
+
+ReadGuard::~ReadGuard() {
+    ReaderRegistration& reader = t_reader;
+    if (--reader.Depth > 0) {
+        return;
+    }
+    if (reader.Slot) {
+        reader.Slot->Epoch.store(0, std::memory_order_release);
+    }
+    else {
+        g_overflowReaders.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void Synchronize() {
+    // Readers that enter after this point see the newly published value,
+    // so only slots holding an older epoch have to drain
+    const std::uint64_t target = g_epoch.fetch_add(1) + 1;
+
+    for (ReaderSlot& slot : g_readerSlots) {
+        for (;;) {
+            const std::uint64_t epoch = slot.Epoch.load(std::memory_order_acquire);
+            if (epoch == 0 || epoch >= target) {
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
+
+    while (g_overflowReaders.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+} // namespace Rcu
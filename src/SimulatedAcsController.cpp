@@ -0,0 +1,797 @@
+#include "SimulatedAcsController.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// MST bits besides AcsController::MotorMoving
+const int kMotorEnabled = 0x01;
+const int kMotorInPosition = 0x10;
+
+} // namespace
+
+double SimulatedAcsController::Motion::Distance(double time) const {
+    if (time <= 0.0) {
+        return 0.0;
+    }
+    const double first = PeakVelocity >= StartVelocity ? Acceleration : -Acceleration;
+    if (time < AccelerationTime) {
+        return StartVelocity * time + 0.5 * first * time * time;
+    }
+    const double ramp = 0.5 * (StartVelocity + PeakVelocity) * AccelerationTime;
+    time -= AccelerationTime;
+    if (time < CruiseTime) {
+        return ramp + PeakVelocity * time;
+    }
+    const double cruise = PeakVelocity * CruiseTime;
+    time -= CruiseTime;
+    if (time < DecelerationTime) {
+        return ramp + cruise + PeakVelocity * time - 0.5 * Acceleration * time * time;
+    }
+    return Length;
+}
+
+SimulatedAcsController::SimulatedAcsController(const SimulatedGantrySettings& settings)
+    : m_settings(settings) {
+    m_thread = std::thread(&SimulatedAcsController::Loop, this);
+}
+
+SimulatedAcsController::~SimulatedAcsController() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+bool SimulatedAcsController::Open(const std::string&, int) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_open = true;
+    return true;
+}
+
+void SimulatedAcsController::Close() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_ended.wait(lock, [this] { return !m_inHandler || std::this_thread::get_id() == m_thread.get_id(); });
+    m_open = false;
+    m_handler = nullptr;
+    m_handlerMask = 0;
+}
+
+bool SimulatedAcsController::IsOpen() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_open;
+}
+
+bool SimulatedAcsController::Enable(const int* axes) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    std::uint32_t mask = 0;
+    if (!ValidAxes(axes, mask)) {
+        return false;
+    }
+    m_enabled |= mask;
+    return true;
+}
+
+bool SimulatedAcsController::ToPoint(const int* axes, const double* point) {
+    return ExtToPoint(axes, point, m_settings.MaxVelocity, 0.0);
+}
+
+bool SimulatedAcsController::ExtToPoint(const int* axes, const double* point, double velocity, double endVelocity) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    std::uint32_t mask = 0;
+    if (!ValidAxes(axes, mask)) {
+        return false;
+    }
+    if ((mask & m_enabled) != mask) {
+        return Fail("axis is disabled");
+    }
+    if (m_spline && (m_spline->Axes & mask)) {
+        return Fail("axis is in a spline");
+    }
+    const double now = NowLocked();
+
+    Motion motion;
+    motion.Axes = mask;
+    motion.Start = now;
+    for (int axis = 0; axis < AxisCount; ++axis) {
+        motion.From[axis] = PositionAt(axis, now);
+    }
+    if (!m_motions.empty()) {
+        // Queued behind the previous motion, from where it ends
+        const Motion& previous = m_motions.back();
+        for (int axis = 0; axis < AxisCount; ++axis) {
+            if (previous.Axes & (1u << axis)) {
+                motion.From[axis] = previous.To[axis];
+            }
+        }
+        if (previous.End() > now) {
+            motion.Start = previous.End();
+            motion.StartVelocity = previous.EndVelocity;
+        }
+        else if (previous.EndVelocity > 0.0) {
+            ++m_underruns;  // Came too late to run into
+        }
+    }
+    motion.To = motion.From;
+    for (int i = 0; axes[i] >= 0; ++i) {
+        motion.To[axes[i]] = point[i];
+    }
+    double squares = 0.0;
+    for (int axis = 0; axis < AxisCount; ++axis) {
+        squares += (motion.To[axis] - motion.From[axis]) * (motion.To[axis] - motion.From[axis]);
+    }
+    motion.Length = std::sqrt(squares);
+    Plan(motion, velocity, endVelocity);
+
+    m_motions.push_back(motion);
+    m_wake.notify_one();
+    return true;
+}
+
+// Trapezoid from StartVelocity through PeakVelocity to EndVelocity. An end velocity
+// that can't be reached within the length is lowered; a start velocity that is too
+// high to slow down from in time raises it.
+void SimulatedAcsController::Plan(Motion& motion, double velocity, double endVelocity) {
+    const double a = m_settings.Acceleration;
+    const double length = motion.Length;
+    const double v0 = motion.StartVelocity;
+    const double limit = velocity > 0.0 ? std::min(velocity, m_settings.MaxVelocity) : m_settings.MaxVelocity;
+    if (length <= 0.0 || a <= 0.0 || limit <= 0.0) {
+        motion.EndVelocity = 0.0;
+        return;
+    }
+    motion.Acceleration = a;
+
+    double v1 = std::min({ std::max(endVelocity, 0.0), limit, std::sqrt(v0 * v0 + 2.0 * a * length) });
+    if (v0 * v0 > v1 * v1 + 2.0 * a * length) {
+        v1 = std::sqrt(v0 * v0 - 2.0 * a * length);
+        motion.PeakVelocity = v0;
+        motion.EndVelocity = v1;
+        motion.DecelerationTime = (v0 - v1) / a;
+        return;
+    }
+    const double peak = std::min(limit, std::sqrt((2.0 * a * length + v0 * v0 + v1 * v1) / 2.0));
+    const double ramp = std::fabs(peak * peak - v0 * v0) / (2.0 * a);
+    const double brake = (peak * peak - v1 * v1) / (2.0 * a);
+    motion.PeakVelocity = peak;
+    motion.EndVelocity = v1;
+    motion.AccelerationTime = std::fabs(peak - v0) / a;
+    motion.DecelerationTime = (peak - v1) / a;
+    motion.CruiseTime = std::max(0.0, length - ramp - brake) / peak;
+}
+
+bool SimulatedAcsController::Halt(const int* axes) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    std::uint32_t mask = 0;
+    if (!ValidAxes(axes, mask)) {
+        return false;
+    }
+    // Stops at once. A zero-length motion in place of the rest reports the end.
+    const double now = NowLocked();
+    std::uint32_t stopped = 0;
+    for (const Motion& motion : m_motions) {
+        if ((motion.Axes & mask) && motion.End() > now) {
+            stopped |= motion.Axes;
+        }
+    }
+    if (m_spline && m_spline->Started && (m_spline->Axes & mask)) {
+        stopped |= m_spline->Axes;
+    }
+    for (int axis = 0; axis < AxisCount; ++axis) {
+        m_positions[axis] = PositionAt(axis, now);
+    }
+    if (m_spline && (m_spline->Axes & mask)) {
+        m_spline.reset();
+    }
+    m_motions.erase(std::remove_if(m_motions.begin(), m_motions.end(), [mask](const Motion& motion) {
+        return (motion.Axes & mask) != 0;
+    }), m_motions.end());
+    if (stopped) {
+        Motion halt;
+        halt.Axes = stopped;
+        halt.Start = now;
+        for (int axis = 0; axis < AxisCount; ++axis) {
+            halt.From[axis] = halt.To[axis] = m_positions[axis];
+        }
+        m_motions.push_front(halt);
+        m_wake.notify_one();
+    }
+    return true;
+}
+
+bool SimulatedAcsController::Spline(const int* axes, double periodMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    std::uint32_t mask = 0;
+    if (!ValidAxes(axes, mask)) {
+        return false;
+    }
+    if ((mask & m_enabled) != mask) {
+        return Fail("axis is disabled");
+    }
+    if (m_spline) {
+        return Fail("a spline is already in progress");
+    }
+    if (MovingAxes() & mask) {
+        return Fail("axis is moving");
+    }
+    if (periodMs <= 0.0) {
+        return Fail("invalid spline period");
+    }
+    const double now = NowLocked();
+    PvSpline spline;
+    spline.Axes = mask;
+    spline.Period = periodMs / 1000.0;
+    for (int axis = 0; axis < AxisCount; ++axis) {
+        spline.From.Position[axis] = PositionAt(axis, now);
+    }
+    m_spline = std::move(spline);
+    return true;
+}
+
+bool SimulatedAcsController::AddPVPoint(const int* axes, const double* point, const double* velocity) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    std::uint32_t mask = 0;
+    if (!SplineAxes(axes, mask)) {
+        return false;
+    }
+    if (m_spline->Ended) {
+        return Fail("sequence has ended");
+    }
+    if (static_cast<int>(m_spline->Points.size()) >= m_settings.PvBufferSize) {
+        return Fail("point buffer is full");
+    }
+    PvSample sample = m_spline->Points.empty() ? m_spline->From : m_spline->Points.back();
+    for (int i = 0; axes[i] >= 0; ++i) {
+        sample.Position[axes[i]] = point[i];
+        sample.Velocity[axes[i]] = velocity[i];
+    }
+    m_spline->Points.push_back(sample);
+    if (m_spline->Starved) {
+        // Starts again from where the axes wait
+        m_spline->Starved = false;
+        m_spline->SegmentStart = NowLocked();
+    }
+    m_wake.notify_one();
+    return true;
+}
+
+bool SimulatedAcsController::EndSequence(const int* axes) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    std::uint32_t mask = 0;
+    if (!SplineAxes(axes, mask)) {
+        return false;
+    }
+    m_spline->Ended = true;
+    if (m_spline->Starved) {
+        m_spline->SegmentStart = NowLocked();
+    }
+    m_wake.notify_one();
+    return true;
+}
+
+bool SimulatedAcsController::Go(const int* axes) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    std::uint32_t mask = 0;
+    if (!SplineAxes(axes, mask)) {
+        return false;
+    }
+    if (m_spline->Started) {
+        return true;
+    }
+    m_spline->Started = true;
+    m_spline->SegmentStart = NowLocked();
+    if (m_spline->Points.empty() && !m_spline->Ended) {
+        m_spline->Starved = true;
+        ++m_underruns;
+    }
+    m_wake.notify_one();
+    return true;
+}
+
+bool SimulatedAcsController::GetFPosition(int axis, double& position) {
+    return ReadReal("FPOS", axis, axis, &position);
+}
+
+bool SimulatedAcsController::GetMotorState(int axis, int& state) {
+    return ReadInteger("MST", axis, axis, &state);
+}
+
+bool SimulatedAcsController::ReadReal(const char* variable, int from, int to, double* values) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    if (!m_open) {
+        return Fail("not connected");
+    }
+    if (from < 0 || to >= AxisCount || from > to) {
+        return Fail("index out of range");
+    }
+    Quantity quantity;
+    if (std::strcmp(variable, "FPOS") == 0) {
+        quantity = Quantity::FeedbackPosition;
+    }
+    else if (std::strcmp(variable, "RPOS") == 0) {
+        quantity = Quantity::ReferencePosition;
+    }
+    else if (std::strcmp(variable, "PE") == 0) {
+        quantity = Quantity::PositionError;
+    }
+    else {
+        return Fail(std::string("unknown variable ") + variable);
+    }
+    const double now = NowLocked();
+    for (int axis = from; axis <= to; ++axis) {
+        values[axis - from] = Sample(quantity, axis, now);
+    }
+    return true;
+}
+
+bool SimulatedAcsController::ReadInteger(const char* variable, int from, int to, int* values) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    if (!m_open) {
+        return Fail("not connected");
+    }
+    if (std::strcmp(variable, "S_DCN") == 0 && from == -1 && to == -1) {
+        *values = m_collection ? m_collection->Collected : 0;
+        return true;
+    }
+    if (from < 0 || to >= AxisCount || from > to) {
+        return Fail("index out of range");
+    }
+    if (std::strcmp(variable, "GSFREE") == 0) {
+        for (int axis = from; axis <= to; ++axis) {
+            const bool buffered = m_spline && (m_spline->Axes & (1u << axis));
+            values[axis - from] = m_settings.PvBufferSize - (buffered ? static_cast<int>(m_spline->Points.size()) : 0);
+        }
+        return true;
+    }
+    if (std::strcmp(variable, "MST") != 0) {
+        return Fail(std::string("unknown variable ") + variable);
+    }
+    const std::uint32_t moving = MovingAxes();
+    for (int axis = from; axis <= to; ++axis) {
+        const std::uint32_t bit = 1u << axis;
+        values[axis - from] = ((m_enabled & bit) ? kMotorEnabled : 0) |
+            ((moving & bit) ? AcsController::MotorMoving : kMotorInPosition);
+    }
+    return true;
+}
+
+bool SimulatedAcsController::ReadRealMatrix(const char* variable, int fromRow, int toRow, int fromColumn, int toColumn,
+    double* values) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    if (!m_open) {
+        return Fail("not connected");
+    }
+    if (!m_collection || m_collection->Array != variable) {
+        return Fail(std::string("unknown variable ") + variable);
+    }
+    const Collection& collection = *m_collection;
+    if (fromRow < 0 || toRow >= static_cast<int>(collection.Rows.size()) || fromRow > toRow ||
+        fromColumn < 0 || toColumn >= collection.Capacity || fromColumn > toColumn) {
+        return Fail("index out of range");
+    }
+    const int columns = toColumn - fromColumn + 1;
+    for (int row = fromRow; row <= toRow; ++row) {
+        std::copy_n(collection.Values.begin() + row * collection.Capacity + fromColumn, columns,
+            values + (row - fromRow) * columns);
+    }
+    return true;
+}
+
+bool SimulatedAcsController::StartCollection(const char* array, int samples, double periodMs, const char* variables) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    if (!m_open) {
+        return Fail("not connected");
+    }
+    if (m_collection && m_collection->Active) {
+        return Fail("data collection in progress");
+    }
+    if (samples <= 0 || periodMs <= 0.0) {
+        return Fail("invalid data collection size or period");
+    }
+    // Names with an index, e.g. "FPOS(0) PE(0) AIN(1)"
+    Collection collection;
+    const std::string list = variables;
+    std::size_t position = 0;
+    while ((position = list.find_first_not_of(' ', position)) != std::string::npos) {
+        const std::size_t end = std::min(list.find(' ', position), list.size());
+        const std::string token = list.substr(position, end - position);
+        position = end;
+        const std::size_t open = token.find('(');
+        const std::string name = token.substr(0, open);
+        int index = -1;
+        if (open != std::string::npos && token.back() == ')') {
+            index = std::atoi(token.c_str() + open + 1);
+        }
+        Quantity quantity;
+        if (name == "FPOS") {
+            quantity = Quantity::FeedbackPosition;
+        }
+        else if (name == "RPOS") {
+            quantity = Quantity::ReferencePosition;
+        }
+        else if (name == "PE") {
+            quantity = Quantity::PositionError;
+        }
+        else if (name == "AIN") {
+            quantity = Quantity::AnalogInput;
+        }
+        else {
+            return Fail("unknown variable " + token);
+        }
+        if (index < 0 || (quantity != Quantity::AnalogInput && index >= AxisCount)) {
+            return Fail("index out of range in " + token);
+        }
+        collection.Rows.emplace_back(quantity, index);
+    }
+    if (collection.Rows.empty()) {
+        return Fail("no variables to collect");
+    }
+    collection.Array = array;
+    collection.Capacity = samples;
+    collection.Period = periodMs / 1000.0;
+    collection.Start = NowLocked();
+    collection.Active = true;
+    collection.Values.assign(collection.Rows.size() * samples, 0.0);
+    m_collection = std::move(collection);
+    Collect(m_collection->Start);
+    return true;
+}
+
+bool SimulatedAcsController::StopCollection() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    if (!m_open) {
+        return Fail("not connected");
+    }
+    if (m_collection) {
+        m_collection->Active = false;
+    }
+    return true;
+}
+
+bool SimulatedAcsController::WaitMotionEnd(int axis, int timeoutMs) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    Call(lock);
+    if (axis < 0 || axis >= AxisCount) {
+        return Fail("invalid axis");
+    }
+    // Simulated milliseconds; as fast as possible still gives up after as many real ones
+    const double scale = m_settings.TimeScale > 0.0 ? m_settings.TimeScale : 1.0;
+    const auto timeout = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(timeoutMs / scale));
+    const std::uint32_t bit = 1u << axis;
+    const bool ended = m_ended.wait_for(lock, timeout, [this, bit] {
+        if (m_spline && m_spline->Started && (m_spline->Axes & bit)) {
+            return false;
+        }
+        for (const Motion& motion : m_motions) {
+            if (motion.Axes & bit) {
+                return false;
+            }
+        }
+        return true;
+    });
+    return ended || Fail("timeout waiting for motion end");
+}
+
+bool SimulatedAcsController::SetMotionEndHandler(std::uint64_t axisMask, MotionEndHandler handler) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    // Like the library, wait for a handler in progress unless it is the caller
+    m_ended.wait(lock, [this] { return !m_inHandler || std::this_thread::get_id() == m_thread.get_id(); });
+    m_handler = std::move(handler);
+    m_handlerMask = m_handler ? axisMask : 0;
+    return true;
+}
+
+std::string SimulatedAcsController::LastError() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_lastError;
+}
+
+double SimulatedAcsController::Now() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return NowLocked();
+}
+
+void SimulatedAcsController::SetPosition(int axis, double position) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Collect(NowLocked());
+    if (axis >= 0 && axis < AxisCount) {
+        m_positions[axis] = position;
+    }
+}
+
+std::uint64_t SimulatedAcsController::Calls() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_calls;
+}
+
+std::uint64_t SimulatedAcsController::Underruns() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_underruns;
+}
+
+double SimulatedAcsController::NowLocked() const {
+    if (m_settings.TimeScale > 0.0) {
+        return std::chrono::duration<double>(Clock::now() - m_realStart).count() * m_settings.TimeScale;
+    }
+    return m_virtualNow;
+}
+
+// Every call takes its latency, and sees the samples up to its time collected before
+// it changes anything
+void SimulatedAcsController::Call(std::unique_lock<std::mutex>& lock) {
+    ++m_calls;
+    m_lastCall = Clock::now();
+    if (m_settings.CallLatency > 0.0 && m_settings.TimeScale > 0.0) {
+        lock.unlock();
+        std::this_thread::sleep_for(std::chrono::duration<double>(m_settings.CallLatency / m_settings.TimeScale));
+        lock.lock();
+    }
+    else if (m_settings.CallLatency > 0.0) {
+        m_virtualNow += m_settings.CallLatency;
+    }
+    Collect(NowLocked());
+}
+
+bool SimulatedAcsController::Fail(const std::string& message) {
+    m_lastError = "simulated controller: " + message;
+    return false;
+}
+
+bool SimulatedAcsController::ValidAxes(const int* axes, std::uint32_t& mask) {
+    if (!m_open) {
+        return Fail("not connected");
+    }
+    mask = 0;
+    for (int i = 0; axes[i] >= 0; ++i) {
+        if (axes[i] >= AxisCount) {
+            return Fail("invalid axis " + std::to_string(axes[i]));
+        }
+        mask |= 1u << axes[i];
+    }
+    return mask != 0 || Fail("no axes");
+}
+
+double SimulatedAcsController::PositionAt(int axis, double time) const {
+    const std::uint32_t bit = 1u << axis;
+    if (m_spline && (m_spline->Axes & bit)) {
+        const PvSpline& spline = *m_spline;
+        if (!spline.Started || spline.Points.empty()) {
+            return spline.From.Position[axis];
+        }
+        // Cubic Hermite from the segment's start to the next point
+        const double period = spline.Period;
+        const double s = std::clamp((time - spline.SegmentStart) / period, 0.0, 1.0);
+        const double s2 = s * s;
+        const double s3 = s2 * s;
+        const PvSample& to = spline.Points.front();
+        return (2.0 * s3 - 3.0 * s2 + 1.0) * spline.From.Position[axis] +
+            (s3 - 2.0 * s2 + s) * period * spline.From.Velocity[axis] +
+            (-2.0 * s3 + 3.0 * s2) * to.Position[axis] +
+            (s3 - s2) * period * to.Velocity[axis];
+    }
+    double position = m_positions[axis];
+    for (const Motion& motion : m_motions) {
+        if ((motion.Axes & bit) == 0) {
+            continue;
+        }
+        if (time < motion.Start) {
+            return position;
+        }
+        if (time < motion.End() && motion.Length > 0.0) {
+            const double fraction = motion.Distance(time - motion.Start) / motion.Length;
+            return motion.From[axis] + (motion.To[axis] - motion.From[axis]) * fraction;
+        }
+        position = motion.To[axis];
+    }
+    return position;
+}
+
+std::uint32_t SimulatedAcsController::MovingAxes() const {
+    const double now = NowLocked();
+    std::uint32_t moving = 0;
+    for (const Motion& motion : m_motions) {
+        if (motion.End() > now || (m_settings.TimeScale <= 0.0 && motion.End() >= now)) {
+            moving |= motion.Axes;
+        }
+    }
+    if (m_spline && m_spline->Started) {
+        moving |= m_spline->Axes;
+    }
+    return moving;
+}
+
+bool SimulatedAcsController::SplineAxes(const int* axes, std::uint32_t& mask) {
+    if (!ValidAxes(axes, mask)) {
+        return false;
+    }
+    if (!m_spline || m_spline->Axes != mask) {
+        return Fail("no spline on these axes");
+    }
+    return true;
+}
+
+std::optional<double> SimulatedAcsController::NextEvent() const {
+    std::optional<double> next;
+    if (!m_motions.empty()) {
+        next = m_motions.front().End();
+    }
+    if (m_spline && m_spline->Started && !m_spline->Starved) {
+        const double boundary = m_spline->Points.empty() ? m_spline->SegmentStart : m_spline->SegmentStart + m_spline->Period;
+        next = next ? std::min(*next, boundary) : boundary;
+    }
+    return next;
+}
+
+double SimulatedAcsController::FeedbackAt(int axis, double time) const {
+    const double reference = PositionAt(axis, time);
+    const Stop& stop = m_stops[axis];
+    const double since = time - stop.Time;
+    if (stop.Direction == 0.0 || since < 0.0 || m_settings.SettleAmplitude == 0.0 ||
+        since > 20.0 * m_settings.SettleTimeConstant) {
+        return reference;
+    }
+    const double pi = 3.14159265358979323846;
+    return reference + stop.Direction * m_settings.SettleAmplitude * std::exp(-since / m_settings.SettleTimeConstant) *
+        std::cos(2.0 * pi * m_settings.SettleFrequency * since);
+}
+
+double SimulatedAcsController::Sample(Quantity quantity, int index, double time) const {
+    switch (quantity) {
+    case Quantity::FeedbackPosition:
+        return FeedbackAt(index, time);
+    case Quantity::ReferencePosition:
+        return PositionAt(index, time);
+    case Quantity::PositionError:
+        return PositionAt(index, time) - FeedbackAt(index, time);
+    default:
+        return 0.0;
+    }
+}
+
+// Fill in the samples due by 'now' while the motions that make them are still queued
+void SimulatedAcsController::Collect(double now) {
+    if (!m_collection || !m_collection->Active) {
+        return;
+    }
+    Collection& collection = *m_collection;
+    while (collection.Collected < collection.Capacity) {
+        const double time = collection.Start + collection.Collected * collection.Period;
+        if (time > now) {
+            return;
+        }
+        for (std::size_t row = 0; row < collection.Rows.size(); ++row) {
+            collection.Values[row * collection.Capacity + collection.Collected] =
+                Sample(collection.Rows[row].first, collection.Rows[row].second, time);
+        }
+        ++collection.Collected;
+    }
+    collection.Active = false;
+}
+
+void SimulatedAcsController::Rest(int axis, double time, double direction) {
+    m_stops[axis].Time = time;
+    m_stops[axis].Direction = direction;
+}
+
+// The spline's current segment has run its course: on to the next point, or the
+// end of the motion, whose axes are returned
+std::uint32_t SimulatedAcsController::AdvanceSpline() {
+    PvSpline& spline = *m_spline;
+    const PvSample previous = spline.From;
+    if (!spline.Points.empty()) {
+        spline.From = spline.Points.front();
+        spline.Points.pop_front();
+        spline.SegmentStart += spline.Period;
+    }
+    if (!spline.Points.empty()) {
+        return 0;
+    }
+    if (spline.Ended) {
+        const std::uint32_t axes = spline.Axes;
+        double squares = 0.0;
+        for (int axis = 0; axis < AxisCount; ++axis) {
+            const double step = spline.From.Position[axis] - previous.Position[axis];
+            squares += (axes & (1u << axis)) ? step * step : 0.0;
+        }
+        const double length = std::sqrt(squares);
+        for (int axis = 0; axis < AxisCount; ++axis) {
+            if (axes & (1u << axis)) {
+                m_positions[axis] = spline.From.Position[axis];
+                if (length > 0.0) {
+                    Rest(axis, spline.SegmentStart, (spline.From.Position[axis] - previous.Position[axis]) / length);
+                }
+            }
+        }
+        m_spline.reset();
+        return axes;
+    }
+    spline.Starved = true;
+    spline.From.Velocity.fill(0.0);
+    ++m_underruns;
+    return 0;
+}
+
+void SimulatedAcsController::Loop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping) {
+        const std::optional<double> next = NextEvent();
+        if (!next) {
+            m_wake.wait(lock);
+            continue;
+        }
+        if (m_settings.TimeScale > 0.0) {
+            if (NowLocked() < *next) {
+                const auto real = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(*next / m_settings.TimeScale));
+                m_wake.wait_until(lock, m_realStart + real);
+                continue;
+            }
+        }
+        else {
+            // Let the client finish what it is queueing, and react to the last event,
+            // before time moves on
+            const Clock::time_point quiet = std::max(m_lastCall, m_lastEvent) + m_settings.SettleTime;
+            if (Clock::now() < quiet) {
+                m_wake.wait_until(lock, quiet);
+                continue;
+            }
+            m_virtualNow = std::max(m_virtualNow, *next);
+            m_lastEvent = Clock::now();
+        }
+
+        Collect(NowLocked());
+        std::uint32_t ended = 0;
+        if (!m_motions.empty() && m_motions.front().End() <= *next) {
+            const Motion done = m_motions.front();
+            m_motions.pop_front();
+            const bool continued = std::any_of(m_motions.begin(), m_motions.end(), [&done](const Motion& motion) {
+                return (motion.Axes & done.Axes) != 0;
+            });
+            for (int axis = 0; axis < AxisCount; ++axis) {
+                if (done.Axes & (1u << axis)) {
+                    m_positions[axis] = done.To[axis];
+                    if (!continued && done.Length > 0.0) {
+                        Rest(axis, done.End(), (done.To[axis] - done.From[axis]) / done.Length);
+                    }
+                }
+            }
+            if (done.EndVelocity > 0.0 && !continued) {
+                ++m_underruns;
+            }
+            ended = done.Axes;
+        }
+        else {
+            ended = AdvanceSpline();
+        }
+        m_ended.notify_all();
+
+        const std::uint64_t axes = ended & m_handlerMask;
+        if (m_handler && axes) {
+            MotionEndHandler handler = m_handler;
+            m_inHandler = true;
+            lock.unlock();
+            handler(axes, true);
+            lock.lock();
+            m_inHandler = false;
+            m_ended.notify_all();
+        }
+    }
+}
@@ -0,0 +1,96 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(std::size_t threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    m_workers.reserve(threadCount);
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        m_workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_taskAvailable.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::Shared() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_taskAvailable.notify_one();
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_taskAvailable.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(std::size_t count, const std::function<void(std::size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1) {
+        body(0);
+        return;
+    }
+
+    // Indices are claimed from a shared counter, so helpers that start late (or
+    // never get scheduled) don't hold anything up
+    struct State {
+        std::atomic<std::size_t> Next{ 0 };
+        std::atomic<std::size_t> Done{ 0 };
+        std::mutex Mutex;
+        std::condition_variable Finished;
+    };
+    auto state = std::make_shared<State>();
+
+    auto drain = [state, count, &body] {
+        std::size_t finished = 0;
+        for (std::size_t i = state->Next.fetch_add(1); i < count; i = state->Next.fetch_add(1)) {
+            body(i);
+            ++finished;
+        }
+        if (finished > 0 && state->Done.fetch_add(finished) + finished == count) {
+            std::lock_guard<std::mutex> lock(state->Mutex);
+            state->Finished.notify_all();
+        }
+    };
+
+    const std::size_t helpers = std::min(count - 1, m_workers.size());
+    for (std::size_t h = 0; h < helpers; ++h) {
+        Submit(drain);
+    }
+    drain();
+
+    std::unique_lock<std::mutex> lock(state->Mutex);
+    state->Finished.wait(lock, [&] { return state->Done.load() == count; });
+}
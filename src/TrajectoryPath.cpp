@@ -0,0 +1,227 @@
+#include "TrajectoryPath.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+double Distance(const PositionStruct& a, const PositionStruct& b) {
+    return std::sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y) + (b.z - a.z) * (b.z - a.z));
+}
+
+// Of the circle through three points; 0 if they are in line
+double Curvature(const PositionStruct& a, const PositionStruct& b, const PositionStruct& c) {
+    const double ab = Distance(a, b);
+    const double bc = Distance(b, c);
+    const double ca = Distance(c, a);
+    if (ab <= 0.0 || bc <= 0.0 || ca <= 0.0) {
+        return 0.0;
+    }
+    const double ux = b.x - a.x, uy = b.y - a.y, uz = b.z - a.z;
+    const double vx = c.x - a.x, vy = c.y - a.y, vz = c.z - a.z;
+    const double cx = uy * vz - uz * vy, cy = uz * vx - ux * vz, cz = ux * vy - uy * vx;
+    return 2.0 * std::sqrt(cx * cx + cy * cy + cz * cz) / (ab * bc * ca);
+}
+
+} // namespace
+
+TrajectoryPath::TrajectoryPath(Function position, double duration, Function velocity)
+    : m_position(std::move(position)), m_velocity(std::move(velocity)), m_duration(std::max(duration, 0.0)) {
+}
+
+TrajectoryPath TrajectoryPath::FromCurve(const Curve& curve, const AxisLimits& limits, double resolution) {
+    if (limits.Velocity <= 0.0 || limits.Acceleration <= 0.0 || resolution <= 0.0) {
+        throw std::runtime_error("TrajectoryPath needs positive velocity, acceleration and resolution");
+    }
+    // A coarse pass for the length decides how finely to sample
+    const int coarse = 1000;
+    double estimate = 0.0;
+    PositionStruct previous = curve(0.0);
+    for (int i = 1; i <= coarse; ++i) {
+        const PositionStruct point = curve(double(i) / coarse);
+        estimate += Distance(previous, point);
+        previous = point;
+    }
+    const std::size_t intervals = static_cast<std::size_t>(std::clamp(estimate / resolution, double(coarse), 200000.0));
+
+    auto timing = std::make_shared<Timing>();
+    timing->Shape = curve;
+    timing->Parameter.resize(intervals + 1);
+    timing->Length.resize(intervals + 1);
+    std::vector<PositionStruct> points(intervals + 1);
+    for (std::size_t k = 0; k <= intervals; ++k) {
+        timing->Parameter[k] = double(k) / intervals;
+        points[k] = curve(timing->Parameter[k]);
+        timing->Length[k] = k == 0 ? 0.0 : timing->Length[k - 1] + Distance(points[k - 1], points[k]);
+    }
+
+    timing->Tangent.resize(intervals + 1);
+    for (std::size_t k = 0; k <= intervals; ++k) {
+        const PositionStruct& a = points[k == 0 ? 0 : k - 1];
+        const PositionStruct& b = points[k == intervals ? k : k + 1];
+        const double length = Distance(a, b);
+        if (length > 0.0) {
+            timing->Tangent[k].x = (b.x - a.x) / length;
+            timing->Tangent[k].y = (b.y - a.y) / length;
+            timing->Tangent[k].z = (b.z - a.z) / length;
+        }
+    }
+
+    // Highest speed the curvature allows, then ramps from rest and down to rest
+    const double a = limits.Acceleration;
+    std::vector<double>& speed = timing->Speed;
+    speed.assign(intervals + 1, limits.Velocity);
+    for (std::size_t k = 1; k < intervals; ++k) {
+        const double curvature = Curvature(points[k - 1], points[k], points[k + 1]);
+        if (curvature > 0.0) {
+            speed[k] = std::min(speed[k], std::sqrt(a / curvature));
+        }
+    }
+    speed.front() = 0.0;
+    speed.back() = 0.0;
+    for (std::size_t k = 1; k <= intervals; ++k) {
+        const double step = timing->Length[k] - timing->Length[k - 1];
+        speed[k] = std::min(speed[k], std::sqrt(speed[k - 1] * speed[k - 1] + 2.0 * a * step));
+    }
+    for (std::size_t k = intervals; k-- > 0;) {
+        const double step = timing->Length[k + 1] - timing->Length[k];
+        speed[k] = std::min(speed[k], std::sqrt(speed[k + 1] * speed[k + 1] + 2.0 * a * step));
+    }
+
+    timing->Time.resize(intervals + 1);
+    timing->Time[0] = 0.0;
+    for (std::size_t k = 1; k <= intervals; ++k) {
+        const double step = timing->Length[k] - timing->Length[k - 1];
+        const double sum = speed[k - 1] + speed[k];
+        timing->Time[k] = timing->Time[k - 1] + (sum > 0.0 ? 2.0 * step / sum : 0.0);
+    }
+
+    TrajectoryPath path;
+    path.m_duration = timing->Time.back();
+    path.m_timing = std::move(timing);
+    return path;
+}
+
+TrajectoryPath TrajectoryPath::Raster(const PositionStruct& corner, double width, double height, double lineSpacing,
+    const AxisLimits& limits) {
+    if (width <= 0.0 || height < 0.0 || lineSpacing <= 0.0) {
+        throw std::runtime_error("Raster needs a positive width and line spacing");
+    }
+    const int lines = static_cast<int>(std::floor(height / lineSpacing + 1e-9)) + 1;
+    const double radius = lineSpacing / 2.0;
+    const double pitch = width + kPi * radius;   // One line and the turn after it
+    const double length = lines * width + (lines - 1) * kPi * radius;
+
+    return FromCurve([=](double u) {
+        const double s = u * length;
+        int line = static_cast<int>(s / pitch);
+        double along = s - line * pitch;
+        if (line >= lines) {
+            line = lines - 1;
+            along = width;
+        }
+        const bool forward = line % 2 == 0;
+        PositionStruct point = corner;
+        point.y = corner.y + line * lineSpacing;
+        if (along <= width) {
+            point.x = forward ? corner.x + along : corner.x + width - along;
+            return point;
+        }
+        const double angle = (along - width) / radius;
+        point.x = forward ? corner.x + width + radius * std::sin(angle) : corner.x - radius * std::sin(angle);
+        point.y += radius - radius * std::cos(angle);
+        return point;
+    }, limits, std::min(0.05, lineSpacing / 20.0));
+}
+
+TrajectoryPath TrajectoryPath::Spiral(const PositionStruct& center, double radius, double pitch, const AxisLimits& limits) {
+    if (radius <= 0.0 || pitch <= 0.0) {
+        throw std::runtime_error("Spiral needs a positive radius and pitch");
+    }
+    const double growth = pitch / (2.0 * kPi);   // Radius per radian
+    const double turns = radius / growth;
+
+    return FromCurve([=](double u) {
+        const double angle = u * turns;
+        PositionStruct point = center;
+        point.x = center.x + growth * angle * std::cos(angle);
+        point.y = center.y + growth * angle * std::sin(angle);
+        return point;
+    }, limits, std::min(0.05, pitch / 20.0));
+}
+
+PvPoint TrajectoryPath::At(double seconds) const {
+    seconds = std::clamp(seconds, 0.0, m_duration);
+    if (m_timing) {
+        return AtTiming(seconds);
+    }
+    PvPoint point;
+    point.Position = m_position(seconds);
+    if (m_velocity) {
+        point.Velocity = m_velocity(seconds);
+        return point;
+    }
+    const double h = std::min(1e-5, m_duration / 2.0);
+    if (h <= 0.0) {
+        return point;
+    }
+    const double before = std::max(seconds - h, 0.0);
+    const double after = std::min(seconds + h, m_duration);
+    const PositionStruct a = m_position(before);
+    const PositionStruct b = m_position(after);
+    const double span = after - before;
+    point.Velocity.x = (b.x - a.x) / span;
+    point.Velocity.y = (b.y - a.y) / span;
+    point.Velocity.z = (b.z - a.z) / span;
+    return point;
+}
+
+PvPoint TrajectoryPath::AtTiming(double seconds) const {
+    const Timing& timing = *m_timing;
+    const std::size_t last = timing.Time.size() - 1;
+    std::size_t k = static_cast<std::size_t>(std::upper_bound(timing.Time.begin(), timing.Time.end(), seconds) - timing.Time.begin());
+    k = std::min(k == 0 ? 0 : k - 1, last - 1);
+
+    // Constant acceleration between samples
+    const double step = timing.Length[k + 1] - timing.Length[k];
+    const double v0 = timing.Speed[k];
+    const double v1 = timing.Speed[k + 1];
+    const double t = std::clamp(seconds - timing.Time[k], 0.0, timing.Time[k + 1] - timing.Time[k]);
+    const double acceleration = step > 0.0 ? (v1 * v1 - v0 * v0) / (2.0 * step) : 0.0;
+    const double along = std::clamp(v0 * t + 0.5 * acceleration * t * t, 0.0, step);
+    const double speed = std::max(v0 + acceleration * t, 0.0);
+
+    const double fraction = step > 0.0 ? along / step : 0.0;
+    const double u0 = timing.Parameter[k];
+    const double u1 = timing.Parameter[k + 1];
+    const PositionStruct& from = timing.Tangent[k];
+    const PositionStruct& to = timing.Tangent[k + 1];
+    const double x = from.x + (to.x - from.x) * fraction;
+    const double y = from.y + (to.y - from.y) * fraction;
+    const double z = from.z + (to.z - from.z) * fraction;
+    const double norm = std::sqrt(x * x + y * y + z * z);
+
+    PvPoint point;
+    point.Position = timing.Shape(u0 + (u1 - u0) * fraction);
+    if (norm > 0.0) {
+        point.Velocity.x = x / norm * speed;
+        point.Velocity.y = y / norm * speed;
+        point.Velocity.z = z / norm * speed;
+    }
+    return point;
+}
+
+std::size_t TrajectoryPath::PointCount(double period) const {
+    if (m_duration <= 0.0 || period <= 0.0) {
+        return 0;
+    }
+    return std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(m_duration / period - 1e-9)));
+}
+
+double TrajectoryPath::PointPeriod(double period) const {
+    const std::size_t count = PointCount(period);
+    return count > 0 ? m_duration / count : period;
+}
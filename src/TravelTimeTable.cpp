@@ -0,0 +1,147 @@
+#include "TravelTimeTable.h"
+#include "MotionProfile.h"
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+
+namespace {
+
+constexpr double kUnreachable = std::numeric_limits<double>::infinity();
+
+// Added to every hop so zero-length moves can't form zero-cost cycles in the
+// next-hop table, and ties prefer fewer hops
+constexpr double kHopPenalty = 1e-6;
+
+using QueueEntry = std::pair<double, std::uint32_t>;
+using MinQueue = std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>>;
+
+// Dijkstra over the CSR adjacency. Fills cost and predecessor per node and
+// returns the nodes in the order they were settled.
+std::vector<std::uint32_t> Dijkstra(const GraphIndex& graph, const std::vector<double>& costs, std::uint32_t start,
+    std::vector<double>& distance, std::vector<std::uint32_t>& previous, std::uint32_t stopAt = InvalidIndex) {
+    const std::size_t nodeCount = graph.AdjacencyOffsets.size() - 1;
+    distance.assign(nodeCount, kUnreachable);
+    previous.assign(nodeCount, InvalidIndex);
+
+    std::vector<std::uint32_t> settled;
+    settled.reserve(nodeCount);
+
+    MinQueue queue;
+    distance[start] = 0.0;
+    previous[start] = start;
+    queue.push({ 0.0, start });
+
+    while (!queue.empty()) {
+        auto [d, current] = queue.top();
+        queue.pop();
+        if (d > distance[current]) {
+            continue;
+        }
+        settled.push_back(current);
+        if (current == stopAt) {
+            break;
+        }
+
+        for (std::uint32_t a = graph.AdjacencyOffsets[current]; a < graph.AdjacencyOffsets[current + 1]; ++a) {
+            const std::uint32_t next = graph.AdjacencyNodes[a];
+            const double candidate = d + costs[a];
+            if (candidate < distance[next]) {
+                distance[next] = candidate;
+                previous[next] = current;
+                queue.push({ candidate, next });
+            }
+        }
+    }
+    return settled;
+}
+
+} // namespace
+
+double TravelTimeTable::EstimateMoveTime(const PositionStruct& from, const PositionStruct& to, const Settings& settings) {
+    return TrajectoryEstimator::Estimate(from, to, MotionLimits::FromSettings(settings)).Duration;
+}
+
+std::vector<double> TravelTimeTable::AdjacencyCosts(const GraphIndex& graph, const MotionConfigIndex& index, const Settings& settings) {
+    const Graph& source = *graph.Source;
+
+    // Resolve every node to its device and flat position once
+    std::vector<std::uint32_t> nodeDevice(source.Nodes.size(), InvalidIndex);
+    std::vector<std::uint32_t> nodePosition(source.Nodes.size(), InvalidIndex);
+    for (std::size_t n = 0; n < source.Nodes.size(); ++n) {
+        nodeDevice[n] = index.FindDevice(source.Nodes[n].Device);
+        nodePosition[n] = index.FindPosition(nodeDevice[n], source.Nodes[n].Position);
+    }
+
+    std::vector<double> costs(graph.AdjacencyNodes.size(), kHopPenalty);
+    for (std::uint32_t node = 0; node < source.Nodes.size(); ++node) {
+        for (std::uint32_t a = graph.AdjacencyOffsets[node]; a < graph.AdjacencyOffsets[node + 1]; ++a) {
+            const std::uint32_t next = graph.AdjacencyNodes[a];
+            if (nodePosition[node] == InvalidIndex || nodePosition[next] == InvalidIndex ||
+                nodeDevice[node] != nodeDevice[next]) {
+                continue;
+            }
+            costs[a] += EstimateMoveTime(index.Position(nodeDevice[node], nodePosition[node]),
+                index.Position(nodeDevice[next], nodePosition[next]), settings);
+        }
+    }
+    return costs;
+}
+
+std::vector<std::uint32_t> TravelTimeTable::ShortestPath(const GraphIndex& graph, const std::vector<double>& costs,
+    std::uint32_t start, std::uint32_t end) {
+    std::vector<double> distance;
+    std::vector<std::uint32_t> previous;
+    Dijkstra(graph, costs, start, distance, previous, end);
+
+    std::vector<std::uint32_t> path;
+    if (previous[end] == InvalidIndex) {
+        return path;
+    }
+    for (std::uint32_t current = end; ; current = previous[current]) {
+        path.push_back(current);
+        if (current == start) {
+            break;
+        }
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+void TravelTimeTable::Build(const GraphIndex& graph, const MotionConfigIndex& index, const Settings& settings) {
+    Clear();
+    if (!graph.Source || graph.Source->Nodes.empty() || graph.Source->Nodes.size() > MaxNodes) {
+        return;
+    }
+
+    const std::size_t nodeCount = graph.Source->Nodes.size();
+    const std::vector<double> costs = AdjacencyCosts(graph, index, settings);
+
+    m_nextHop.assign(nodeCount * nodeCount, InvalidIndex);
+    m_cost.assign(nodeCount * nodeCount, kUnreachable);
+
+    std::vector<double> distance;
+    std::vector<std::uint32_t> previous;
+    std::vector<std::uint32_t> firstHop(nodeCount);
+    for (std::uint32_t source = 0; source < nodeCount; ++source) {
+        const std::vector<std::uint32_t> settled = Dijkstra(graph, costs, source, distance, previous);
+
+        // A node's predecessor is settled before it, so first hops propagate in settle order
+        std::uint32_t* nextHopRow = &m_nextHop[source * nodeCount];
+        double* costRow = &m_cost[source * nodeCount];
+        for (std::uint32_t node : settled) {
+            firstHop[node] = (node == source || previous[node] == source) ? node : firstHop[previous[node]];
+            nextHopRow[node] = firstHop[node];
+            costRow[node] = distance[node];
+        }
+    }
+    m_nodeCount = nodeCount;
+}
+
+void TravelTimeTable::Clear() {
+    m_nodeCount = 0;
+    m_nextHop.clear();
+    m_cost.clear();
+}
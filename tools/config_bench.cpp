@@ -0,0 +1,574 @@
+// config_bench.cpp
+//
+// Benchmarks of the motion configuration layer on synthetic configurations.
+//
+//   config_bench generate [--positions N] [--nodes N] [--edges N] FILE
+//   config_bench load [--dom | --snapshot] FILE
+//   config_bench snapshot [--runs N] FILE
+//   config_bench lookup [--queries N] FILE
+//   config_bench import [--positions N] FILE
+//   config_bench roundtrip [--runs N] FILE
+//
+// generate writes a configuration with N taught positions spread over 8 devices
+// (50000 by default) and one graph "Process" of N nodes (10000) on those positions
+// and N edges (50000), a chain through every node plus random ones, every other
+// one bidirectional. Values come from a fixed seed, so the file is the same each time.
+//
+// load times one MotionConfigManager load of FILE from its JSON, with any snapshot
+// and journal removed first, and reports the process's peak resident set size
+// before and after. --dom parses the file into a nlohmann::json document instead,
+// for comparison, and --snapshot keeps the snapshot the previous load wrote, so the
+// manager starts from it. Run each load in its own process, so the peak is its own.
+//
+// snapshot compares the two ways into the configuration containers N times (5 by
+// default) and reports the fastest of each: parsing the JSON, and mapping, checking
+// and copying out the snapshot. The whole manager load is timed both ways as well.
+//
+// lookup times GetEdgesBySource and GetNodesByDevice on a pinned version against a
+// linear scan of the graph that collects the same matches, over N random nodes and
+// devices (10000 by default), and FindPath by hops and by travel time between
+// N / 100 random pairs of nodes.
+//
+// import adds N new positions (5000 by default) spread over the devices of FILE,
+// once with a MotionConfigManager::AddPosition call each and once staged in a
+// MotionConfigTransaction, which re-indexes and validates once on Commit. Nothing
+// is saved.
+//
+// roundtrip parses FILE and writes it back out N times (5 by default), through the
+// field tables (ParseMotionConfig and JsonWriter) and through a nlohmann::json
+// document and dump(2), reports the fastest of each and checks the two texts match.
+
+#include "MotionConfigManager.h"
+#include "MotionConfigParser.h"
+#include "MotionConfigJournal.h"
+#include "MotionConfigSnapshot.h"
+#include "MotionTypesReflection.h"
+#include "DurableFile.h"
+#include "MappedFile.h"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int kDevices = 8;
+
+double MillisecondsSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Peak resident set size of this process so far, in MB
+double PeakRssMegabytes() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0.0;
+    }
+    return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / (1024.0 * 1024.0);   // Bytes
+#else
+    return usage.ru_maxrss / 1024.0;              // KB
+#endif
+#endif
+}
+
+std::string DeviceName(int device) {
+    return "device-" + std::to_string(device);
+}
+
+// Node k stands on position k / kDevices of device k % kDevices
+std::string PositionName(int index) {
+    return "p" + std::to_string(index);
+}
+
+std::string NodeId(int node) {
+    return "node_" + std::to_string(node);
+}
+
+void RemoveDerivedFiles(const std::string& path) {
+    std::error_code ec;
+    for (const std::string& file : { MotionConfigSnapshot::PathFor(path), MotionConfigJournal::PathFor(path),
+        MotionConfigJournal::PathFor(path) + ".next" }) {
+        std::filesystem::remove(file, ec);
+    }
+}
+
+int Generate(int positions, int nodes, int edges, const std::string& path) {
+    if (positions < kDevices || nodes < 2 || nodes > positions || edges < nodes - 1) {
+        std::cerr << "Need at least " << kDevices << " positions, 2 to that many nodes, and an edge per node" << std::endl;
+        return 1;
+    }
+    std::mt19937 random(12345);
+    std::uniform_real_distribution<double> coordinate(-100.0, 100.0);
+    std::uniform_int_distribution<int> anyNode(0, nodes - 1);
+
+    std::map<std::string, MotionDevice> devices;
+    for (int d = 0; d < kDevices; ++d) {
+        MotionDevice& device = devices[DeviceName(d)];
+        device.IsEnabled = true;
+        device.IpAddress = "192.168.0." + std::to_string(10 + d);
+        device.Port = 50000;
+        device.Id = d;
+        device.Name = DeviceName(d);
+        device.TypeController = d == 0 ? "ACS" : "PI";
+        device.InstalledAxes = d == 0 ? "XYZ" : "XYZUVW";
+    }
+    for (int i = 0; i < positions; ++i) {
+        PositionStruct& position = devices[DeviceName(i % kDevices)].Positions[PositionName(i / kDevices)];
+        position = { coordinate(random), coordinate(random), coordinate(random),
+            coordinate(random) / 10.0, coordinate(random) / 10.0, coordinate(random) / 10.0 };
+    }
+
+    Graph graph;
+    for (int k = 0; k < nodes; ++k) {
+        Node node;
+        node.Id = NodeId(k);
+        node.Label = "n" + std::to_string(k);
+        node.Device = DeviceName(k % kDevices);
+        node.Position = PositionName(k / kDevices);
+        node.X = k % 100 * 40;
+        node.Y = k / 100 * 40;
+        graph.Nodes.push_back(std::move(node));
+    }
+    for (int e = 0; e < edges; ++e) {
+        Edge edge;
+        edge.Id = "edge_" + std::to_string(e);
+        const int source = e < nodes - 1 ? e : anyNode(random);
+        int target = e < nodes - 1 ? e + 1 : anyNode(random);
+        if (target == source) {
+            target = (source + 1) % nodes;
+        }
+        edge.Source = NodeId(source);
+        edge.Target = NodeId(target);
+        edge.Label = edge.Source + ">" + edge.Target;
+        edge.Conditions.IsBidirectional = e % 2 == 0;
+        graph.Edges.push_back(std::move(edge));
+    }
+    std::map<std::string, Graph> graphs;
+    graphs.emplace("Process", std::move(graph));
+
+    std::string text;
+    JsonWriter writer(text);
+    writer.BeginObject();
+    writer.Key("Graphs");
+    WriteJson(writer, graphs);
+    writer.Key("MotionDevices");
+    WriteJson(writer, devices);
+    writer.Key("Settings");
+    WriteJson(writer, Settings());
+    writer.EndObject();
+    if (!DurableFile::WriteAtomically(path, text.data(), text.size())) {
+        std::cerr << "Can't write " << path << std::endl;
+        return 1;
+    }
+    RemoveDerivedFiles(path);
+    std::cout << "Wrote " << path << ": " << positions << " positions on " << kDevices << " devices, "
+        << nodes << " nodes, " << edges << " edges, " << text.size() / 1024 << " KB" << std::endl;
+    return 0;
+}
+
+int Load(const std::string& path, bool dom, bool fromSnapshot) {
+    if (fromSnapshot) {
+        // Not opened here, which would count towards the peak; the manager's log
+        // says whether it was used
+        if (!std::filesystem::exists(MotionConfigSnapshot::PathFor(path))) {
+            std::cerr << "No snapshot of " << path << "; run a load without --snapshot first" << std::endl;
+            return 1;
+        }
+    }
+    else {
+        RemoveDerivedFiles(path);
+    }
+    const double before = PeakRssMegabytes();
+    const Clock::time_point start = Clock::now();
+    if (dom) {
+        MappedFile file;
+        if (!file.Open(path)) {
+            std::cerr << "Can't open " << path << std::endl;
+            return 1;
+        }
+        const nlohmann::json document = nlohmann::json::parse(file.Data(), file.Data() + file.Size());
+        const double milliseconds = MillisecondsSince(start);
+        std::cout << "nlohmann::json DOM parse: " << milliseconds << " ms, peak RSS " << PeakRssMegabytes()
+            << " MB (" << before << " MB before), " << document["MotionDevices"].size() << " devices" << std::endl;
+        return 0;
+    }
+    MotionConfigManager config(path);
+    const double milliseconds = MillisecondsSince(start);
+    std::cout << "MotionConfigManager load from " << (fromSnapshot ? "snapshot" : "JSON") << ": " << milliseconds << " ms, peak RSS " << PeakRssMegabytes()
+        << " MB (" << before << " MB before)" << std::endl;
+    return 0;
+}
+
+int CompareSnapshot(const std::string& path, int runs) {
+    RemoveDerivedFiles(path);
+    MappedFile file;
+    if (!file.Open(path)) {
+        std::cerr << "Can't open " << path << std::endl;
+        return 1;
+    }
+    const std::uint64_t hash = MotionConfigSnapshot::HashBytes(file.Data(), file.Size());
+    const std::string snapshotPath = MotionConfigSnapshot::PathFor(path);
+
+    double parse = INFINITY;
+    double write = INFINITY;
+    double read = INFINITY;
+    double jsonLoad = INFINITY;
+    double snapshotLoad = INFINITY;
+    for (int run = 0; run < runs; ++run) {
+        std::map<std::string, MotionDevice> devices;
+        std::map<std::string, Graph> graphs;
+        Settings settings;
+        std::string errorMessage;
+        Clock::time_point start = Clock::now();
+        if (!ParseMotionConfig(file.Data(), file.Size(), devices, graphs, settings, errorMessage)) {
+            std::cerr << path << ": " << errorMessage << std::endl;
+            return 1;
+        }
+        parse = std::min(parse, MillisecondsSince(start));
+
+        start = Clock::now();
+        MotionConfigSnapshot::Write(snapshotPath, hash, devices, graphs, settings);
+        write = std::min(write, MillisecondsSince(start));
+
+        std::map<std::string, MotionDevice> snapshotDevices;
+        std::map<std::string, Graph> snapshotGraphs;
+        start = Clock::now();
+        MotionConfigSnapshot snapshot;
+        if (!snapshot.Open(snapshotPath, hash)) {
+            std::cerr << "Can't open the snapshot just written" << std::endl;
+            return 1;
+        }
+        snapshot.Load(snapshotDevices, snapshotGraphs, settings);
+        read = std::min(read, MillisecondsSince(start));
+        if (!Reflection::Equal(devices, snapshotDevices) || !Reflection::Equal(graphs, snapshotGraphs)) {
+            std::cerr << "The snapshot doesn't hold what the JSON does" << std::endl;
+            return 2;
+        }
+
+        RemoveDerivedFiles(path);
+        start = Clock::now();
+        { MotionConfigManager config(path); }
+        jsonLoad = std::min(jsonLoad, MillisecondsSince(start));
+        start = Clock::now();
+        { MotionConfigManager config(path); }
+        snapshotLoad = std::min(snapshotLoad, MillisecondsSince(start));
+    }
+
+    std::cout << "Fastest of " << runs << ":" << std::endl
+        << "  JSON parse into containers:          " << parse << " ms" << std::endl
+        << "  snapshot open, verify and copy out:  " << read << " ms" << std::endl
+        << "  snapshot write:                      " << write << " ms" << std::endl
+        << "  manager load from JSON:              " << jsonLoad << " ms (includes the snapshot write)" << std::endl
+        << "  manager load from snapshot:          " << snapshotLoad << " ms" << std::endl;
+    return 0;
+}
+
+// What the graph index replaces: a scan of every edge or node per query
+std::vector<std::reference_wrapper<const Edge>> ScanEdgesBySource(const Graph& graph, const std::string& nodeId) {
+    std::vector<std::reference_wrapper<const Edge>> edges;
+    for (const Edge& edge : graph.Edges) {
+        if (edge.Source == nodeId) {
+            edges.push_back(edge);
+        }
+    }
+    return edges;
+}
+
+std::vector<std::reference_wrapper<const Node>> ScanNodesByDevice(const Graph& graph, const std::string& deviceName) {
+    std::vector<std::reference_wrapper<const Node>> nodes;
+    for (const Node& node : graph.Nodes) {
+        if (node.Device == deviceName) {
+            nodes.push_back(node);
+        }
+    }
+    return nodes;
+}
+
+int Lookup(const std::string& path, int queries) {
+    MotionConfigManager config(path);
+    const MotionConfigVersionPtr version = config.AcquireVersion();
+    if (version->GetAllGraphs().empty()) {
+        std::cerr << path << " has no graph" << std::endl;
+        return 1;
+    }
+    const auto& [graphName, graph] = *version->GetAllGraphs().begin();
+    if (graph.Nodes.size() < 2) {
+        std::cerr << "Graph " << graphName << " has fewer than 2 nodes" << std::endl;
+        return 1;
+    }
+
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<std::size_t> anyNode(0, graph.Nodes.size() - 1);
+    std::vector<const std::string*> nodeIds(queries);
+    std::vector<const std::string*> deviceNames(queries);
+    for (int i = 0; i < queries; ++i) {
+        nodeIds[i] = &graph.Nodes[anyNode(random)].Id;
+        deviceNames[i] = &graph.Nodes[anyNode(random)].Device;
+    }
+
+    // Results are summed so the work can't be optimized away, and compared
+    std::size_t indexed = 0;
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < queries; ++i) {
+        indexed += version->GetEdgesBySource(graphName, *nodeIds[i]).size();
+    }
+    const double edgesIndexed = MillisecondsSince(start);
+    std::size_t scanned = 0;
+    start = Clock::now();
+    for (int i = 0; i < queries; ++i) {
+        scanned += ScanEdgesBySource(graph, *nodeIds[i]).size();
+    }
+    const double edgesScanned = MillisecondsSince(start);
+    if (indexed != scanned) {
+        std::cerr << "GetEdgesBySource found " << indexed << " edges, the scan " << scanned << std::endl;
+        return 2;
+    }
+
+    indexed = 0;
+    start = Clock::now();
+    for (int i = 0; i < queries; ++i) {
+        indexed += version->GetNodesByDevice(graphName, *deviceNames[i]).size();
+    }
+    const double nodesIndexed = MillisecondsSince(start);
+    scanned = 0;
+    start = Clock::now();
+    for (int i = 0; i < queries; ++i) {
+        scanned += ScanNodesByDevice(graph, *deviceNames[i]).size();
+    }
+    const double nodesScanned = MillisecondsSince(start);
+    if (indexed != scanned) {
+        std::cerr << "GetNodesByDevice found " << indexed << " nodes, the scan " << scanned << std::endl;
+        return 2;
+    }
+
+    const int paths = std::max(1, queries / 100);
+    double pathMilliseconds[2] = {};
+    std::size_t found[2] = {};
+    for (PathMetric metric : { PathMetric::HopCount, PathMetric::TravelTime }) {
+        const int m = metric == PathMetric::HopCount ? 0 : 1;
+        start = Clock::now();
+        for (int i = 0; i < paths; ++i) {
+            found[m] += version->FindPath(graphName, *nodeIds[i], *nodeIds[(i + 1) % queries], metric).empty() ? 0 : 1;
+        }
+        pathMilliseconds[m] = MillisecondsSince(start);
+    }
+
+    const auto perQuery = [](double milliseconds, int count) { return milliseconds * 1000.0 / count; };
+    std::cout << "Graph " << graphName << ": " << graph.Nodes.size() << " nodes, " << graph.Edges.size() << " edges" << std::endl
+        << "  GetEdgesBySource: " << perQuery(edgesIndexed, queries) << " us/query, linear scan "
+        << perQuery(edgesScanned, queries) << " us/query (" << queries << " queries)" << std::endl
+        << "  GetNodesByDevice: " << perQuery(nodesIndexed, queries) << " us/query, linear scan "
+        << perQuery(nodesScanned, queries) << " us/query" << std::endl
+        << "  FindPath by hops: " << perQuery(pathMilliseconds[0], paths) << " us/query, by travel time "
+        << perQuery(pathMilliseconds[1], paths) << " us/query (" << paths << " pairs, "
+        << found[0] << " and " << found[1] << " connected)" << std::endl;
+    return 0;
+}
+
+int Import(const std::string& path, int positions) {
+    MotionConfigManager config(path);
+    std::vector<std::string> deviceNames;
+    for (const auto& [name, device] : config.GetAllDevices()) {
+        deviceNames.push_back(name);
+    }
+    if (deviceNames.empty()) {
+        std::cerr << path << " has no devices" << std::endl;
+        return 1;
+    }
+    const auto position = [](int i) {
+        const double value = i * 0.001;
+        return PositionStruct{ value, value, value, 0.0, 0.0, 0.0 };
+    };
+
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < positions; ++i) {
+        config.AddPosition(deviceNames[i % deviceNames.size()], "import_call_" + std::to_string(i), position(i));
+    }
+    const double perCall = MillisecondsSince(start);
+
+    start = Clock::now();
+    MotionConfigTransaction transaction = config.BeginTransaction();
+    for (int i = 0; i < positions; ++i) {
+        transaction.AddPosition(deviceNames[i % deviceNames.size()], "import_batch_" + std::to_string(i), position(i));
+    }
+    const bool committed = transaction.Commit();
+    const double batched = MillisecondsSince(start);
+    if (!committed) {
+        std::cerr << "The transaction didn't commit" << std::endl;
+        return 2;
+    }
+
+    start = Clock::now();
+    const std::size_t diagnostics = config.ValidateConfig().size();
+    const double validation = MillisecondsSince(start);
+
+    std::cout << "Import of " << positions << " positions over " << deviceNames.size() << " devices:" << std::endl
+        << "  one AddPosition call each:  " << perCall << " ms (" << perCall * 1000.0 / positions << " us/position)" << std::endl
+        << "  one transaction:            " << batched << " ms (" << batched * 1000.0 / positions << " us/position), validated on commit" << std::endl
+        << "  a ValidateConfig afterwards: " << validation << " ms, " << diagnostics << " diagnostics" << std::endl;
+    return 0;
+}
+
+int RoundTrip(const std::string& path, int runs) {
+    MappedFile file;
+    if (!file.Open(path)) {
+        std::cerr << "Can't open " << path << std::endl;
+        return 1;
+    }
+
+    double reflectedParse = INFINITY;
+    double reflectedWrite = INFINITY;
+    double domParse = INFINITY;
+    double domWrite = INFINITY;
+    std::string reflected;
+    std::string dom;
+    for (int run = 0; run < runs; ++run) {
+        std::map<std::string, MotionDevice> devices;
+        std::map<std::string, Graph> graphs;
+        Settings settings;
+        std::string errorMessage;
+        Clock::time_point start = Clock::now();
+        if (!ParseMotionConfig(file.Data(), file.Size(), devices, graphs, settings, errorMessage)) {
+            std::cerr << path << ": " << errorMessage << std::endl;
+            return 1;
+        }
+        reflectedParse = std::min(reflectedParse, MillisecondsSince(start));
+
+        // As MotionConfigManager::SerializeConfig lays the file out
+        start = Clock::now();
+        reflected.clear();
+        JsonWriter writer(reflected);
+        writer.BeginObject();
+        writer.Key("Graphs");
+        WriteJson(writer, graphs);
+        writer.Key("MotionDevices");
+        WriteJson(writer, devices);
+        writer.Key("Settings");
+        WriteJson(writer, settings);
+        writer.EndObject();
+        reflectedWrite = std::min(reflectedWrite, MillisecondsSince(start));
+
+        start = Clock::now();
+        const nlohmann::json document = nlohmann::json::parse(file.Data(), file.Data() + file.Size());
+        domParse = std::min(domParse, MillisecondsSince(start));
+        start = Clock::now();
+        dom = document.dump(2);
+        domWrite = std::min(domWrite, MillisecondsSince(start));
+    }
+
+    std::cout << "Fastest of " << runs << " round trips of " << file.Size() / 1024 << " KB:" << std::endl
+        << "  field tables:    parse " << reflectedParse << " ms, write " << reflectedWrite << " ms, total "
+        << reflectedParse + reflectedWrite << " ms" << std::endl
+        << "  nlohmann::json:  parse " << domParse << " ms, dump " << domWrite << " ms, total "
+        << domParse + domWrite << " ms" << std::endl;
+    if (reflected != dom) {
+        const auto mismatch = std::mismatch(reflected.begin(), reflected.end(), dom.begin(), dom.end());
+        std::cerr << "The outputs differ from byte " << (mismatch.first - reflected.begin()) << std::endl;
+        return 2;
+    }
+    std::cout << "  outputs identical" << std::endl;
+    return 0;
+}
+
+int Usage() {
+    std::cerr << "Usage: config_bench generate [--positions N] [--nodes N] [--edges N] FILE" << std::endl
+        << "       config_bench load [--dom | --snapshot] FILE" << std::endl
+        << "       config_bench snapshot [--runs N] FILE" << std::endl
+        << "       config_bench lookup [--queries N] FILE" << std::endl
+        << "       config_bench import [--positions N] FILE" << std::endl
+        << "       config_bench roundtrip [--runs N] FILE" << std::endl;
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        return Usage();
+    }
+    const std::string command = argv[1];
+    int positions = 50000;
+    bool positionsGiven = false;
+    int nodes = 10000;
+    int edges = 50000;
+    int runs = 5;
+    int queries = 10000;
+    bool dom = false;
+    bool fromSnapshot = false;
+    std::string path;
+    for (int i = 2; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--positions" && i + 1 < argc) {
+            positions = std::atoi(argv[++i]);
+            positionsGiven = true;
+        }
+        else if (arg == "--nodes" && i + 1 < argc) {
+            nodes = std::atoi(argv[++i]);
+        }
+        else if (arg == "--edges" && i + 1 < argc) {
+            edges = std::atoi(argv[++i]);
+        }
+        else if (arg == "--runs" && i + 1 < argc) {
+            runs = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--queries" && i + 1 < argc) {
+            queries = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--dom") {
+            dom = true;
+        }
+        else if (arg == "--snapshot") {
+            fromSnapshot = true;
+        }
+        else if (path.empty()) {
+            path = arg;
+        }
+        else {
+            return Usage();
+        }
+    }
+    if (path.empty()) {
+        return Usage();
+    }
+
+    if (command == "generate") {
+        return Generate(positions, nodes, edges, path);
+    }
+    if (command == "load") {
+        return Load(path, dom, fromSnapshot);
+    }
+    if (command == "snapshot") {
+        return CompareSnapshot(path, runs);
+    }
+    if (command == "lookup") {
+        return Lookup(path, queries);
+    }
+    if (command == "roundtrip") {
+        return RoundTrip(path, runs);
+    }
+    if (command == "import") {
+        return Import(path, positionsGiven ? positions : 5000);
+    }
+    return Usage();
+}
@@ -0,0 +1,191 @@
+// config_stress.cpp
+//
+// Readers against a writer on one MotionConfigManager, to catch lifetime and
+// consistency bugs in the lock-free read path. Best run from a build with
+// -fsanitize=address or -fsanitize=thread.
+//
+//   config_stress [--readers N] [--writes N] motion_config.json
+//
+// N readers (16 by default) call the manager's getters in a loop while the main
+// thread adds and deletes a scratch position N times (5000 by default) on the
+// first device that has positions. The edits are never saved. Every reader
+// checks the scratch position it sees is one the writer wrote whole. Exits
+// non-zero if any read was inconsistent.
+//
+// The writer starts once every reader is running, after the readers have had
+// the configuration to themselves for a while, and its first write waits until
+// every reader has begun a round in the writing phase. Each lookup is timed into one
+// histogram before the first write and another during the writes, so the
+// p50/p99/max printed for both show what the writer costs the readers.
+
+#include "LatencyHistogram.h"
+#include "MotionConfigManager.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const char* kScratchPosition = "__config_stress";
+
+// How long the readers run before the first write
+const auto kQuietPeriod = std::chrono::milliseconds(200);
+
+enum Phase { Starting, Quiet, Writing, Stopped };
+
+template <typename Lookup>
+auto Timed(LatencyHistogram& latency, Lookup&& lookup) {
+    const auto start = std::chrono::steady_clock::now();
+    auto result = lookup();
+    latency.Record(std::chrono::steady_clock::now() - start);
+    return result;
+}
+
+void Report(const char* label, const LatencyHistogram& latency) {
+    std::cout << label << latency.Count() << " lookups, p50 < " << latency.Percentile(0.5).count() << " us, p99 < "
+        << latency.Percentile(0.99).count() << " us, max " << latency.Max().count() / 1000.0 << " us" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int readers = 16;
+    int writes = 5000;
+    std::string configPath;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--readers" && i + 1 < argc) {
+            readers = std::atoi(argv[++i]);
+        }
+        else if (arg == "--writes" && i + 1 < argc) {
+            writes = std::atoi(argv[++i]);
+        }
+        else if (configPath.empty()) {
+            configPath = arg;
+        }
+        else {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (configPath.empty() || readers <= 0 || writes <= 0) {
+        std::cerr << "Usage: config_stress [--readers N] [--writes N] motion_config.json" << std::endl;
+        return 1;
+    }
+
+    MotionConfigManager config(configPath);
+
+    std::string deviceName;
+    std::string positionName;
+    for (const auto& [name, device] : config.GetAllDevices()) {
+        if (!device.Positions.empty()) {
+            deviceName = name;
+            positionName = device.Positions.begin()->first;
+            break;
+        }
+    }
+    if (deviceName.empty()) {
+        std::cerr << configPath << " has no device with positions" << std::endl;
+        return 1;
+    }
+    std::string graphName;
+    std::string startNode;
+    std::string endNode;
+    for (const auto& [name, graph] : config.GetAllGraphs()) {
+        if (graph.Nodes.size() >= 2) {
+            graphName = name;
+            startNode = graph.Nodes.front().Id;
+            endNode = graph.Nodes.back().Id;
+            break;
+        }
+    }
+
+    std::atomic<int> phase{ Starting };
+    std::atomic<int> started{ 0 };
+    std::atomic<int> startedWriting{ 0 };
+    std::atomic<long long> reads{ 0 };
+    std::atomic<long long> writingReads{ 0 };
+    std::atomic<long long> inconsistent{ 0 };
+    LatencyHistogram quietLatency;
+    LatencyHistogram writingLatency;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < readers; ++i) {
+        threads.emplace_back([&] {
+            ++started;
+            while (phase.load() == Starting) {
+                std::this_thread::yield();
+            }
+            long long count = 0;
+            long long writingCount = 0;
+            for (int current = phase.load(std::memory_order_relaxed); current != Stopped; current = phase.load(std::memory_order_relaxed)) {
+                if (current == Writing && writingCount == 0) {
+                    ++startedWriting;
+                }
+                LatencyHistogram& latency = current == Quiet ? quietLatency : writingLatency;
+                if (!Timed(latency, [&] { return config.GetNamedPosition(deviceName, positionName); })) {
+                    ++inconsistent;
+                }
+                auto scratch = Timed(latency, [&] { return config.GetNamedPosition(deviceName, kScratchPosition); });
+                if (scratch && (scratch->x != scratch->y || scratch->x != scratch->z)) {
+                    ++inconsistent;
+                }
+                auto device = Timed(latency, [&] { return config.GetDevice(deviceName); });
+                if (!device || device->Positions.count(positionName) == 0) {
+                    ++inconsistent;
+                }
+                Timed(latency, [&] { return config.GetSettings(); });
+                if (!graphName.empty()) {
+                    Timed(latency, [&] { return config.GetNodesByDevice(graphName, deviceName); });
+                    Timed(latency, [&] { return config.GetEdgesBySource(graphName, startNode); });
+                    Timed(latency, [&] { return config.FindPath(graphName, startNode, endNode, PathMetric::TravelTime); });
+                }
+                // A pinned version must not change underneath its reader
+                const MotionConfigVersionPtr version = Timed(latency, [&] { return config.AcquireVersion(); });
+                auto first = version->GetNamedPosition(deviceName, kScratchPosition);
+                auto second = version->GetNamedPosition(deviceName, kScratchPosition);
+                if (first.has_value() != second.has_value() || (first && first->get().x != second->get().x)) {
+                    ++inconsistent;
+                }
+                ++count;
+                writingCount += current == Writing;
+            }
+            reads += count;
+            writingReads += writingCount;
+        });
+    }
+
+    while (started.load() < readers) {
+        std::this_thread::yield();
+    }
+    phase = Quiet;
+    std::this_thread::sleep_for(kQuietPeriod);
+    phase = Writing;
+    while (startedWriting.load() < readers) {
+        std::this_thread::yield();
+    }
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < writes; ++i) {
+        const double value = i;
+        config.AddPosition(deviceName, kScratchPosition, PositionStruct{ value, value, value, 0.0, 0.0, 0.0 });
+        if (i % 3 == 0) {
+            config.DeletePosition(deviceName, kScratchPosition);
+        }
+    }
+    config.DeletePosition(deviceName, kScratchPosition);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    phase = Stopped;
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    std::cout << readers << " readers, " << writes << " writes in " << seconds << " s, "
+        << reads.load() << " read rounds (" << writingReads.load() << " during the writes), "
+        << inconsistent.load() << " inconsistent" << std::endl;
+    Report("  no writer:   ", quietLatency);
+    Report("  with writer: ", writingLatency);
+    return inconsistent.load() == 0 ? 0 : 2;
+}
@@ -0,0 +1,268 @@
+// corner_blend_check.cpp
+//
+// Drives an AcsGantry on a SimulatedAcsController along an L-shaped route, once
+// blended and once stopping at the corner, and checks what blending promises:
+//
+//   corner_blend_check [--tolerance MM] [--velocity V] [--acceleration A]
+//                      [--config FILE] [--graph NAME]
+//
+// - the blended route passes the corner at the speed BlendedPath::CornerVelocity
+//   allows for the tolerance (0.5 mm by default), without the controller running
+//   out of queued motion, and the stopping route comes to rest there
+// - the blended route takes less time, and both end on the final point
+// The reference position is collected on the simulated controller every 1 ms of
+// simulated time.
+//
+// Then it does the same for the real routes: every ACS gantry route of the graph
+// (Process_Flow of config/motion_config.json by default) from the device's first
+// node to each of its nodes more than one hop away, planned with MotionPlan, with
+// the tolerance on every intermediate node and the limits of the file's Settings.
+// It reports the cycle time of each both ways. Every route must complete on its
+// final point without an underrun and be no slower blended.
+// Exits non-zero if a check fails.
+
+#include "AcsGantry.h"
+#include "GraphExecutor.h"
+#include "MotionConfigManager.h"
+#include "SimulatedAcsController.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+const double kPeriodMs = 1.0;
+const int kSamples = 20000;
+
+struct RouteRun {
+    bool Reached = false;
+    double Seconds = 0.0;         // Simulated
+    double CornerSpeed = 0.0;     // Where the path comes closest to the corner
+    double CornerDistance = 0.0;
+    PositionStruct End;
+    std::uint64_t Underruns = 0;
+};
+
+// Without measureCorner nothing is collected, so the route may take any time
+RouteRun Run(const MotionDevice& device, const PositionStruct& from, const std::vector<MotionWaypoint>& route,
+    bool blended, const MotionLimits& limits, bool measureCorner) {
+    SimulatedGantrySettings settings;
+    settings.TimeScale = 0.0;
+    settings.MaxVelocity = limits.Linear.Velocity;
+    settings.Acceleration = limits.Linear.Acceleration;
+    SimulatedAcsController controller(settings);
+    controller.SetPosition(0, from.x);
+    controller.SetPosition(1, from.y);
+    controller.SetPosition(2, from.z);
+    AcsGantry gantry(device, limits, controller);
+
+    RouteRun run;
+    if (!gantry.Connect() || (measureCorner && !controller.StartCollection("DCA", kSamples, kPeriodMs, "RPOS(0) RPOS(1)"))) {
+        std::cerr << "Can't start the simulated gantry: " << controller.LastError() << std::endl;
+        return run;
+    }
+    const double start = controller.Now();
+    run.Reached = gantry.MoveAlong(route, blended);
+    run.Seconds = controller.Now() - start;
+    run.Underruns = controller.Underruns();
+    run.End = gantry.GetPosition().value_or(PositionStruct());
+    if (!measureCorner) {
+        return run;
+    }
+    controller.StopCollection();
+
+    int collected = 0;
+    controller.ReadInteger("S_DCN", -1, -1, &collected);
+    collected = std::min(collected, kSamples);
+    std::vector<double> samples(2 * static_cast<std::size_t>(collected));
+    if (collected < 3 || !controller.ReadRealMatrix("DCA", 0, 1, 0, collected - 1, samples.data())) {
+        std::cerr << "Can't read the collected positions: " << controller.LastError() << std::endl;
+        run.Reached = false;
+        return run;
+    }
+    const double* x = samples.data();
+    const double* y = samples.data() + collected;
+
+    const PositionStruct& corner = route.front().Target;
+    std::size_t closest = 1;
+    run.CornerDistance = INFINITY;
+    for (int i = 1; i + 1 < collected; ++i) {
+        const double distance = std::hypot(x[i] - corner.x, y[i] - corner.y);
+        if (distance < run.CornerDistance) {
+            run.CornerDistance = distance;
+            closest = i;
+        }
+    }
+    // Path length over the samples either side, which turns the corner
+    run.CornerSpeed = (std::hypot(x[closest] - x[closest - 1], y[closest] - y[closest - 1]) +
+        std::hypot(x[closest + 1] - x[closest], y[closest + 1] - y[closest])) / (2.0 * kPeriodMs / 1000.0);
+    return run;
+}
+
+bool Check(bool passed, const std::string& what) {
+    std::cout << (passed ? "  ok    " : "  FAIL  ") << what << std::endl;
+    return passed;
+}
+
+bool AtTarget(const RouteRun& run, const PositionStruct& target) {
+    return std::fabs(run.End.x - target.x) < 1e-6 && std::fabs(run.End.y - target.y) < 1e-6 &&
+        std::fabs(run.End.z - target.z) < 1e-6;
+}
+
+// Blended against stopping on every multi-hop gantry route of the graph
+bool CheckGraphRoutes(const std::string& configPath, const std::string& graphName, double tolerance) {
+    MotionConfigVersionPtr version;
+    try {
+        MotionConfigManager config(configPath);
+        version = config.AcquireVersion();
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return false;
+    }
+    auto graph = version->GetGraph(graphName);
+    if (!graph) {
+        std::cerr << "No graph " << graphName << " in " << configPath << std::endl;
+        return false;
+    }
+    const MotionLimits limits = MotionLimits::FromSettings(version->GetSettings());
+
+    bool passed = true;
+    int routes = 0;
+    double blendedTotal = 0.0;
+    double stoppingTotal = 0.0;
+    std::set<std::string> gantries;
+    for (const Node& node : graph->get().Nodes) {
+        auto device = version->GetDevice(node.Device);
+        if (!device || device->get().TypeController != "ACS" || !gantries.insert(node.Device).second) {
+            continue;
+        }
+        const std::string& home = node.Id;
+        const PositionStruct from = version->GetNamedPosition(node.Device, node.Position)->get();
+        std::cout << "Routes of " << node.Device << " from " << home << " (" << node.Position << "), tolerance "
+            << tolerance << " mm, " << limits.Linear.Velocity << " mm/s, " << limits.Linear.Acceleration << " mm/s^2:" << std::endl;
+        for (const Node* target : version->GetNodesByDevice(graphName, node.Device)) {
+            if (target->Id == home) {
+                continue;
+            }
+            MotionPlan plan(version, graphName);
+            plan.SetStart(home);
+            std::vector<MotionWaypoint> route;
+            try {
+                route = plan.Tasks()[plan.MoveTo(target->Id)].Route;
+            }
+            catch (const std::exception& e) {
+                std::cout << "  skip  " << target->Id << ": " << e.what() << std::endl;
+                continue;
+            }
+            if (route.size() < 2) {
+                continue;
+            }
+            for (std::size_t i = 0; i + 1 < route.size(); ++i) {
+                route[i].CornerTolerance = tolerance;
+            }
+
+            const RouteRun blended = Run(device->get(), from, route, true, limits, false);
+            const RouteRun stopping = Run(device->get(), from, route, false, limits, false);
+            ++routes;
+            blendedTotal += blended.Seconds;
+            stoppingTotal += stopping.Seconds;
+            std::string via;
+            for (const MotionWaypoint& waypoint : route) {
+                via += (via.empty() ? "" : " > ") + waypoint.Position;
+            }
+            const bool ok = blended.Reached && stopping.Reached && AtTarget(blended, route.back().Target) &&
+                AtTarget(stopping, route.back().Target) && blended.Underruns == 0 && blended.Seconds <= stopping.Seconds + 1e-9;
+            std::cout << (ok ? "  ok    " : "  FAIL  ") << via << ": blended " << blended.Seconds << " s, stopping "
+                << stopping.Seconds << " s, saves " << stopping.Seconds - blended.Seconds << " s" << std::endl;
+            passed &= ok;
+        }
+    }
+    if (routes == 0) {
+        std::cerr << "No multi-hop gantry route in " << graphName << std::endl;
+        return false;
+    }
+    std::cout << routes << " routes: blended " << blendedTotal << " s, stopping " << stoppingTotal << " s, saves "
+        << stoppingTotal - blendedTotal << " s (" << 100.0 * (stoppingTotal - blendedTotal) / stoppingTotal << "%)" << std::endl;
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double tolerance = 0.5;
+    std::string configPath = "config/motion_config.json";
+    std::string graphName = "Process_Flow";
+    MotionLimits limits;
+    limits.Linear = { 100.0, 1000.0, 0.0 };
+    limits.Rotational = { 20.0, 100.0, 0.0 };
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--tolerance" && i + 1 < argc) {
+            tolerance = std::atof(argv[++i]);
+        }
+        else if (arg == "--velocity" && i + 1 < argc) {
+            limits.Linear.Velocity = std::atof(argv[++i]);
+        }
+        else if (arg == "--acceleration" && i + 1 < argc) {
+            limits.Linear.Acceleration = std::atof(argv[++i]);
+        }
+        else if (arg == "--config" && i + 1 < argc) {
+            configPath = argv[++i];
+        }
+        else if (arg == "--graph" && i + 1 < argc) {
+            graphName = argv[++i];
+        }
+        else {
+            std::cerr << "Usage: corner_blend_check [--tolerance MM] [--velocity V] [--acceleration A] [--config FILE] [--graph NAME]" << std::endl;
+            return 1;
+        }
+    }
+
+    // From the origin along X, then a right angle along Y
+    std::vector<MotionWaypoint> route(2);
+    route[0].NodeId = "corner";
+    route[0].Target.x = 50.0;
+    route[0].CornerTolerance = tolerance;
+    route[1].NodeId = "end";
+    route[1].Target.x = 50.0;
+    route[1].Target.y = 50.0;
+
+    MotionDevice device;
+    device.Name = "gantry";
+    device.TypeController = "ACS";
+    device.InstalledAxes = "XYZ";
+
+    const double allowed = BlendedPath::CornerVelocity(PositionStruct(), route[0].Target, route[1].Target, tolerance, limits.Linear);
+    const RouteRun blended = Run(device, PositionStruct(), route, true, limits, true);
+    const RouteRun stopping = Run(device, PositionStruct(), route, false, limits, true);
+
+    std::cout << "Corner tolerance " << tolerance << " mm, corner velocity allowed " << allowed << " mm/s" << std::endl;
+    std::cout << "  blended:  " << blended.Seconds << " s, " << blended.CornerSpeed << " mm/s at the corner ("
+        << blended.CornerDistance << " mm from it), " << blended.Underruns << " underruns" << std::endl;
+    std::cout << "  stopping: " << stopping.Seconds << " s, " << stopping.CornerSpeed << " mm/s at the corner ("
+        << stopping.CornerDistance << " mm from it)" << std::endl;
+
+    // The speed is averaged over a sample either side of the corner
+    const double speedSlack = limits.Linear.Acceleration * kPeriodMs / 1000.0 + 1e-6;
+    const auto atEnd = [&](const RouteRun& run) {
+        return std::fabs(run.End.x - route[1].Target.x) < 1e-6 && std::fabs(run.End.y - route[1].Target.y) < 1e-6;
+    };
+    bool passed = true;
+    passed &= Check(blended.Reached && stopping.Reached, "both routes complete");
+    passed &= Check(atEnd(blended) && atEnd(stopping), "both end on the final point");
+    passed &= Check(allowed > 0.0, "the tolerance allows a blend");
+    passed &= Check(blended.CornerSpeed > 0.5 * allowed && blended.CornerSpeed < allowed + speedSlack,
+        "the blended route keeps moving through the corner, no faster than allowed");
+    passed &= Check(blended.Underruns == 0, "the controller never ran out of queued motion");
+    passed &= Check(stopping.CornerSpeed < speedSlack, "the stopping route comes to rest at the corner");
+    passed &= Check(blended.Seconds < stopping.Seconds, "blending saves time");
+
+    std::cout << std::endl;
+    passed &= CheckGraphRoutes(configPath, graphName, tolerance);
+    return passed ? 0 : 2;
+}
@@ -0,0 +1,171 @@
+// executor_bench.cpp
+//
+// Cycle time of a lens placement on Process_Flow run by GraphExecutor, one device
+// at a time against concurrently, on a SimulatedRig.
+//
+//   executor_bench [--scale S] [--runs N] [--slack F] [--config FILE]
+//
+// The plan starts every device at home. The gantry looks at the sled while both
+// hexapods grip a lens; it looks at each lens once its hexapod holds it, and
+// each hexapod places its lens once the gantry has looked. The gantry goes to
+// UV once both lenses are placed, then everything returns home.
+//
+// The rig sleeps for each task's estimate scaled by S (0.02 by default), and the
+// plan is run N times (3 by default) each way; the fastest run of each is
+// reported in rig seconds. Exits non-zero if a run fails, the concurrent run
+// starts a task before its prerequisites finish, or it takes longer than the
+// plan's critical path estimate plus the slack F (0.1, i.e. 10%) or than the
+// serial run.
+
+#include "GraphExecutor.h"
+#include "MotionConfigManager.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+const char* kGraph = "Process_Flow";
+
+// Id of the node of the graph that stands for a device's taught position
+std::string NodeOf(const MotionConfigVersion& version, const std::string& device, const std::string& position) {
+    for (const Node* node : version.GetNodesByDevice(kGraph, device)) {
+        if (node->Position == position) {
+            return node->Id;
+        }
+    }
+    throw std::runtime_error("No node for " + device + " " + position + " in " + kGraph);
+}
+
+MotionPlan LensPlacement(const MotionConfigVersionPtr& version) {
+    const auto node = [&](const std::string& device, const std::string& position) {
+        return NodeOf(*version, device, position);
+    };
+
+    MotionPlan plan(version, kGraph);
+    plan.SetStart(node("gantry-main", "home"));
+    plan.SetStart(node("hex-left", "home"));
+    plan.SetStart(node("hex-right", "home"));
+
+    plan.MoveTo(node("gantry-main", "seesled"));
+    const std::size_t leftGrip = plan.MoveTo(node("hex-left", "lensgrip"));
+    const std::size_t rightGrip = plan.MoveTo(node("hex-right", "lensgrip"));
+
+    const std::size_t seeCollimate = plan.MoveTo(node("gantry-main", "seecollimatelens"));
+    plan.AddDependency(seeCollimate, leftGrip);
+    const std::size_t leftPlace = plan.MoveTo(node("hex-left", "lensplace"));
+    plan.AddDependency(leftPlace, seeCollimate);
+
+    const std::size_t seeFocus = plan.MoveTo(node("gantry-main", "seefocuslens"));
+    plan.AddDependency(seeFocus, rightGrip);
+    const std::size_t rightPlace = plan.MoveTo(node("hex-right", "lensplace"));
+    plan.AddDependency(rightPlace, seeFocus);
+
+    const std::size_t uv = plan.MoveTo(node("gantry-main", "uv"));
+    plan.AddDependency(uv, leftPlace);
+    plan.AddDependency(uv, rightPlace);
+
+    plan.AddDependency(plan.MoveTo(node("hex-left", "home")), uv);
+    plan.AddDependency(plan.MoveTo(node("hex-right", "home")), uv);
+    plan.MoveTo(node("gantry-main", "home"));
+    return plan;
+}
+
+bool DependenciesHonoured(const MotionPlan& plan, const ExecutionResult& result) {
+    for (std::size_t task = 0; task < plan.Tasks().size(); ++task) {
+        for (std::size_t prerequisite : plan.Tasks()[task].Prerequisites) {
+            if (result.Tasks[prerequisite].End > result.Tasks[task].Start) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool Check(bool passed, const std::string& what) {
+    std::cout << (passed ? "  ok    " : "  FAIL  ") << what << std::endl;
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double scale = 0.02;
+    int runs = 3;
+    double slack = 0.1;
+    std::string configPath = "config/motion_config.json";
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--scale" && i + 1 < argc) {
+            scale = std::atof(argv[++i]);
+        }
+        else if (arg == "--runs" && i + 1 < argc) {
+            runs = std::atoi(argv[++i]);
+        }
+        else if (arg == "--slack" && i + 1 < argc) {
+            slack = std::atof(argv[++i]);
+        }
+        else if (arg == "--config" && i + 1 < argc) {
+            configPath = argv[++i];
+        }
+        else {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (scale <= 0.0 || runs <= 0 || slack < 0.0) {
+        std::cerr << "Usage: executor_bench [--scale S] [--runs N] [--slack F] [--config FILE]" << std::endl;
+        return 1;
+    }
+
+    MotionConfigVersionPtr version;
+    try {
+        MotionConfigManager config(configPath);
+        version = config.AcquireVersion();
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    std::unique_ptr<MotionPlan> plan;
+    try {
+        plan = std::make_unique<MotionPlan>(LensPlacement(version));
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Can't plan the lens placement: " << e.what() << std::endl;
+        return 1;
+    }
+    const double serialEstimate = plan->EstimateSerialSeconds();
+    const double criticalEstimate = plan->EstimateCriticalPathSeconds();
+    std::cout << plan->Tasks().size() << " tasks, estimated " << serialEstimate << " s serial, "
+        << criticalEstimate << " s critical path" << std::endl;
+
+    SimulatedRig rig(scale);
+    GraphExecutor executor(rig.Handler());
+    bool succeeded = true;
+    bool honoured = true;
+    double serial = 0.0;
+    double concurrent = 0.0;
+    for (int run = 0; run < runs; ++run) {
+        const ExecutionResult serialRun = executor.RunSerial(*plan);
+        const ExecutionResult concurrentRun = executor.Run(*plan);
+        succeeded &= serialRun.Success && concurrentRun.Success;
+        honoured &= DependenciesHonoured(*plan, concurrentRun);
+        serial = run == 0 ? serialRun.Seconds : std::min(serial, serialRun.Seconds);
+        concurrent = run == 0 ? concurrentRun.Seconds : std::min(concurrent, concurrentRun.Seconds);
+    }
+    serial /= scale;
+    concurrent /= scale;
+    std::cout << "RunSerial " << serial << " s, Run " << concurrent << " s, saves " << serial - concurrent
+        << " s (" << 100.0 * (serial - concurrent) / serial << "%), fastest of " << runs << " at scale " << scale << std::endl;
+
+    bool passed = true;
+    passed &= Check(succeeded, "every run succeeds");
+    passed &= Check(honoured, "no task starts before its prerequisites finish");
+    passed &= Check(concurrent <= criticalEstimate * (1.0 + slack), "Run keeps to the critical path estimate");
+    passed &= Check(concurrent < serial, "Run is faster than RunSerial");
+    return passed ? 0 : 2;
+}
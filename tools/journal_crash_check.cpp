@@ -0,0 +1,209 @@
+// journal_crash_check.cpp
+//
+// Kills a process that is saving configuration edits, over and over, and checks
+// that every save it had completed survives into the next load.
+//
+//   journal_crash_check [--rounds N] [--seed S] motion_config.json
+//
+// Works on a copy of the file next to it (<file>.crash-check.json plus its journal
+// and snapshot), which is removed afterwards unless a round fails. Each of the N
+// rounds (20 by default) forks a child that adds a position to the first device
+// that has one and saves, in a loop, reporting each completed save through a pipe.
+// Every fourth edit rewrites the whole device, so the journal is compacted often.
+// After a random 1-50 ms the child gets SIGKILL, mid-append, mid-flush or
+// mid-compaction. The copy is then loaded again and must hold every reported
+// position with its value. Exits non-zero on the first round that doesn't.
+// POSIX only.
+
+#include "MotionConfigManager.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+std::string ScratchPosition(long index) {
+    return "__crash_check_" + std::to_string(index);
+}
+
+void RemoveCopy(const std::string& path) {
+    std::error_code ec;
+    for (const std::string& file : { path, path + ".journal", path + ".journal.next", path + ".snapshot" }) {
+        std::filesystem::remove(file, ec);
+    }
+}
+
+} // namespace
+
+#ifdef _WIN32
+
+int main() {
+    std::cerr << "journal_crash_check needs fork and SIGKILL; it only runs on POSIX systems" << std::endl;
+    return 1;
+}
+
+#else
+
+namespace {
+
+// Child: save edits until killed, writing the index of each completed save to 'out'
+[[noreturn]] void SaveUntilKilled(const std::string& path, const std::string& deviceName, long first, int out) {
+    std::cout.rdbuf(nullptr);
+    try {
+        MotionConfigManager config(path);
+        for (long index = first;; ++index) {
+            const double value = static_cast<double>(index);
+            const PositionStruct position{ value, value, value, 0.0, 0.0, 0.0 };
+            if (index % 4 == 0) {
+                // Whole-device records grow the journal past the compaction threshold quickly
+                MotionDevice device = *config.GetDevice(deviceName);
+                device.Positions[ScratchPosition(index)] = position;
+                config.UpdateDevice(deviceName, device);
+            }
+            else {
+                config.AddPosition(deviceName, ScratchPosition(index), position);
+            }
+            if (config.SaveConfig() && write(out, &index, sizeof(index)) != sizeof(index)) {
+                _exit(3);
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Child: " << e.what() << std::endl;
+    }
+    _exit(2);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int rounds = 20;
+    unsigned seed = std::random_device()();
+    std::string sourcePath;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--rounds" && i + 1 < argc) {
+            rounds = std::atoi(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (sourcePath.empty()) {
+            sourcePath = arg;
+        }
+        else {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (sourcePath.empty() || rounds <= 0) {
+        std::cerr << "Usage: journal_crash_check [--rounds N] [--seed S] motion_config.json" << std::endl;
+        return 1;
+    }
+
+    const std::string path = sourcePath + ".crash-check.json";
+    RemoveCopy(path);
+    std::error_code ec;
+    if (!std::filesystem::copy_file(sourcePath, path, ec)) {
+        std::cerr << "Can't copy " << sourcePath << " to " << path << std::endl;
+        return 1;
+    }
+
+    std::string deviceName;
+    {
+        MotionConfigManager config(path);
+        for (const auto& [name, device] : config.GetAllDevices()) {
+            if (!device.Positions.empty()) {
+                deviceName = name;
+                break;
+            }
+        }
+    }
+    if (deviceName.empty()) {
+        std::cerr << sourcePath << " has no device with positions" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Seed " << seed << std::endl;
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> delayMs(1, 50);
+    long next = 0;   // First index the next child writes
+    long saved = 0;  // Positions the children reported saved, 0..saved-1
+
+    for (int round = 0; round < rounds; ++round) {
+        int pipeEnds[2];
+        if (pipe(pipeEnds) != 0) {
+            std::cerr << "pipe failed" << std::endl;
+            return 1;
+        }
+        std::cout.flush();
+        const pid_t child = fork();
+        if (child < 0) {
+            std::cerr << "fork failed" << std::endl;
+            return 1;
+        }
+        if (child == 0) {
+            close(pipeEnds[0]);
+            SaveUntilKilled(path, deviceName, next, pipeEnds[1]);
+        }
+        close(pipeEnds[1]);
+
+        // Let the first save land so the kill doesn't always hit the load
+        long index = -1;
+        const bool started = read(pipeEnds[0], &index, sizeof(index)) == sizeof(index);
+        const int delay = delayMs(random);
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        kill(child, SIGKILL);
+        int status = 0;
+        waitpid(child, &status, 0);
+        long last = started ? index : next - 1;
+        while (read(pipeEnds[0], &index, sizeof(index)) == sizeof(index)) {
+            last = index;
+        }
+        close(pipeEnds[0]);
+        if (!started) {
+            std::cerr << "Round " << round << ": the child exited before its first save" << std::endl;
+            return 2;
+        }
+        saved = last + 1;
+        next = saved;
+
+        long missing = 0;
+        try {
+            MotionConfigManager config(path);
+            for (long i = 0; i < saved; ++i) {
+                auto position = config.GetNamedPosition(deviceName, ScratchPosition(i));
+                if (!position || position->x != static_cast<double>(i)) {
+                    ++missing;
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "Round " << round << ": " << e.what() << std::endl;
+            return 2;
+        }
+        std::cout << "Round " << round << ": killed after " << delay << " ms, " << saved << " saves, "
+            << missing << " missing" << std::endl;
+        if (missing > 0) {
+            std::cerr << "Saved edits lost; files kept at " << path << std::endl;
+            return 2;
+        }
+    }
+
+    RemoveCopy(path);
+    std::cout << rounds << " rounds, " << saved << " saves recovered" << std::endl;
+    return 0;
+}
+
+#endif
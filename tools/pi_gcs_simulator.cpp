@@ -0,0 +1,268 @@
+// pi_gcs_simulator.cpp
+//
+// Stands in for PI hexapod controllers so the motion stack can run without
+// hardware. Each port given on the command line is one hexapod; point a device's
+// IpAddress at this machine and its Port at one of them.
+//
+//   pi_gcs_simulator [--latency-us N] [--velocity V] port...
+//
+// Speaks the part of GCS 2.0 that PiGcsClient uses: MOV, VEL, HLT, STP, POS?,
+// ONT?, VEL?, ERR? and *IDN?. Every axis moves at its own velocity (V, 10 mm/s
+// or deg/s by default) toward its target. Each received packet that gets a reply
+// waits N us first, 500 by default, like one network round trip.
+
+#include <SFML/Network/TcpListener.hpp>
+#include <SFML/Network/TcpSocket.hpp>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* kAxes = "XYZUVW";
+const double kLimits[6] = { 50.0, 50.0, 25.0, 15.0, 15.0, 15.0 };   // +/- travel of a C-887 hexapod
+
+// GCS error codes
+const int kParameterSyntaxError = 1;
+const int kUnknownCommand = 2;
+const int kOutOfLimits = 7;
+const int kStoppedByCommand = 10;
+const int kParameterOutOfRange = 17;
+const int kInvalidAxis = 15;
+
+struct Axis {
+    double Start = 0.0;
+    double Target = 0.0;
+    double Velocity = 10.0;
+    Clock::time_point Since;
+
+    double Position(Clock::time_point now) const {
+        const double travelled = Velocity * std::chrono::duration<double>(now - Since).count();
+        const double distance = Target - Start;
+        return std::fabs(distance) <= travelled ? Target : Start + std::copysign(travelled, distance);
+    }
+};
+
+class Hexapod {
+public:
+    explicit Hexapod(double velocity) {
+        for (Axis& axis : m_axes) {
+            axis.Velocity = velocity;
+        }
+    }
+
+    // Runs one command line; appends its reply, if any
+    void Execute(const std::string& line, std::string& reply) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::istringstream in(line);
+        std::string command;
+        in >> command;
+        if (command.empty()) {
+            return;
+        }
+        const Clock::time_point now = Clock::now();
+
+        if (command == "MOV" || command == "VEL") {
+            SetAxes(command == "MOV", in, now);
+        }
+        else if (command == "HLT" || command == "STP") {
+            for (Axis& axis : m_axes) {
+                axis.Start = axis.Target = axis.Position(now);
+                axis.Since = now;
+            }
+            SetError(kStoppedByCommand);
+        }
+        else if (command == "POS?" || command == "ONT?" || command == "VEL?") {
+            QueryAxes(command, in, now, reply);
+        }
+        else if (command == "ERR?") {
+            reply += std::to_string(m_error) + "\n";
+            m_error = 0;
+        }
+        else if (command == "*IDN?") {
+            reply += "PI GCS hexapod simulator\n";
+        }
+        else {
+            SetError(kUnknownCommand);
+        }
+    }
+
+private:
+    // GCS keeps the first error until ERR? reads it
+    void SetError(int code) {
+        if (m_error == 0) {
+            m_error = code;
+        }
+    }
+
+    static int AxisIndex(const std::string& name) {
+        const char* found = name.size() == 1 ? std::strchr(kAxes, name[0]) : nullptr;
+        return found && *found ? static_cast<int>(found - kAxes) : -1;
+    }
+
+    // "MOV X 1 Y 2" or "VEL X 5"; a bad argument rejects the whole command
+    void SetAxes(bool move, std::istringstream& in, Clock::time_point now) {
+        std::vector<std::pair<int, double>> values;
+        std::string name;
+        while (in >> name) {
+            double value = 0.0;
+            if (!(in >> value)) {
+                SetError(kParameterSyntaxError);
+                return;
+            }
+            const int index = AxisIndex(name);
+            if (index < 0) {
+                SetError(kInvalidAxis);
+                return;
+            }
+            if (move ? std::fabs(value) > kLimits[index] : value <= 0.0) {
+                SetError(move ? kOutOfLimits : kParameterOutOfRange);
+                return;
+            }
+            values.emplace_back(index, value);
+        }
+        if (values.empty()) {
+            SetError(kParameterSyntaxError);
+            return;
+        }
+        for (const auto& [index, value] : values) {
+            Axis& axis = m_axes[index];
+            axis.Start = axis.Position(now);
+            axis.Since = now;
+            if (move) {
+                axis.Target = value;
+            }
+            else {
+                axis.Velocity = value;
+            }
+        }
+    }
+
+    // Multi-line replies end every line but the last with a space
+    void QueryAxes(const std::string& command, std::istringstream& in, Clock::time_point now, std::string& reply) {
+        std::vector<int> axes;
+        std::string name;
+        while (in >> name) {
+            const int index = AxisIndex(name);
+            if (index < 0) {
+                SetError(kInvalidAxis);
+                return;
+            }
+            axes.push_back(index);
+        }
+        if (axes.empty()) {
+            axes = { 0, 1, 2, 3, 4, 5 };
+        }
+        for (std::size_t i = 0; i < axes.size(); ++i) {
+            const Axis& axis = m_axes[axes[i]];
+            char line[64];
+            if (command == "POS?") {
+                std::snprintf(line, sizeof(line), "%c=%.6f", kAxes[axes[i]], axis.Position(now));
+            }
+            else if (command == "ONT?") {
+                std::snprintf(line, sizeof(line), "%c=%d", kAxes[axes[i]], axis.Position(now) == axis.Target ? 1 : 0);
+            }
+            else {
+                std::snprintf(line, sizeof(line), "%c=%.6f", kAxes[axes[i]], axis.Velocity);
+            }
+            reply += line;
+            reply += i + 1 < axes.size() ? " \n" : "\n";
+        }
+    }
+
+    std::mutex m_mutex;
+    std::array<Axis, 6> m_axes;
+    int m_error = 0;
+};
+
+void Serve(std::unique_ptr<sf::TcpSocket> socket, Hexapod& hexapod, std::chrono::microseconds latency) {
+    std::string pending;
+    std::string reply;
+    char buffer[4096];
+    for (;;) {
+        std::size_t received = 0;
+        if (socket->receive(buffer, sizeof(buffer), received) != sf::Socket::Done) {
+            return;
+        }
+        pending.append(buffer, received);
+        reply.clear();
+        std::size_t end;
+        while ((end = pending.find('\n')) != std::string::npos) {
+            hexapod.Execute(pending.substr(0, end), reply);
+            pending.erase(0, end + 1);
+        }
+        if (!reply.empty()) {
+            std::this_thread::sleep_for(latency);
+            if (socket->send(reply.data(), reply.size()) != sf::Socket::Done) {
+                return;
+            }
+        }
+    }
+}
+
+void Listen(unsigned short port, Hexapod& hexapod, std::chrono::microseconds latency) {
+    sf::TcpListener listener;
+    if (listener.listen(port) != sf::Socket::Done) {
+        std::cerr << "Cannot listen on port " << port << std::endl;
+        return;
+    }
+    std::cout << "Hexapod simulator listening on port " << port << std::endl;
+    for (;;) {
+        auto socket = std::make_unique<sf::TcpSocket>();
+        if (listener.accept(*socket) != sf::Socket::Done) {
+            continue;
+        }
+        std::thread(Serve, std::move(socket), std::ref(hexapod), latency).detach();
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    std::chrono::microseconds latency(500);
+    double velocity = 10.0;
+    std::vector<unsigned short> ports;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--latency-us" && i + 1 < argc) {
+            latency = std::chrono::microseconds(std::atoll(argv[++i]));
+        }
+        else if (arg == "--velocity" && i + 1 < argc) {
+            velocity = std::atof(argv[++i]);
+        }
+        else if (std::atoi(arg.c_str()) > 0) {
+            ports.push_back(static_cast<unsigned short>(std::atoi(arg.c_str())));
+        }
+        else {
+            std::cerr << "Unknown argument " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (ports.empty()) {
+        std::cerr << "Usage: pi_gcs_simulator [--latency-us N] [--velocity V] port..." << std::endl;
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<Hexapod>> hexapods;
+    std::vector<std::thread> listeners;
+    for (unsigned short port : ports) {
+        hexapods.push_back(std::make_unique<Hexapod>(velocity));
+        listeners.emplace_back(Listen, port, std::ref(*hexapods.back()), latency);
+    }
+    for (std::thread& listener : listeners) {
+        listener.join();
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+// stream_check.cpp
+//
+// Streams a raster, a spiral and a parametric path through AcsGantry::StreamPath
+// on a SimulatedAcsController and checks the stream kept up:
+//
+//   stream_check [--scale S] [--period SECONDS] [--velocity V] [--acceleration A]
+//
+// - StreamPath succeeds and the feeder sent every point of the path
+// - neither the feeder nor the controller ever found the point buffer empty
+// - the gantry comes to rest on the end of the path
+// The simulated controller runs S times faster than real time (2 by default).
+// The feeder tops its buffer up every quarter of the time the buffer holds, in
+// real time, so from S = 4 on every top-up finds it empty. Points are 'period'
+// apart (10 ms by default). Exits non-zero if a check fails.
+
+#include "AcsGantry.h"
+#include "SimulatedAcsController.h"
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct NamedPath {
+    std::string Name;
+    TrajectoryPath Path;
+};
+
+bool Check(bool passed, const std::string& what) {
+    std::cout << (passed ? "  ok    " : "  FAIL  ") << what << std::endl;
+    return passed;
+}
+
+bool Stream(const NamedPath& named, double scale, double period, const MotionLimits& limits) {
+    SimulatedGantrySettings settings;
+    settings.TimeScale = scale;
+    settings.MaxVelocity = limits.Linear.Velocity;
+    settings.Acceleration = limits.Linear.Acceleration;
+    SimulatedAcsController controller(settings);
+
+    MotionDevice device;
+    device.Name = "gantry";
+    device.TypeController = "ACS";
+    device.InstalledAxes = "XYZ";
+    AcsGantry gantry(device, limits, controller);
+    if (!gantry.Connect()) {
+        std::cerr << "Can't start the simulated gantry: " << controller.LastError() << std::endl;
+        return false;
+    }
+
+    const TrajectoryPath& path = named.Path;
+    PvtFeederStats stats;
+    const bool streamed = gantry.StreamPath(path, period, &stats);
+    const PositionStruct end = gantry.GetPosition().value_or(PositionStruct());
+    const PositionStruct target = path.At(path.Duration()).Position;
+    const double endError = std::sqrt((end.x - target.x) * (end.x - target.x) +
+        (end.y - target.y) * (end.y - target.y) + (end.z - target.z) * (end.z - target.z));
+
+    std::cout << named.Name << ": " << path.Duration() << " s, " << stats.Points << "/" << stats.TotalPoints
+        << " points every " << stats.Period * 1000.0 << " ms, buffer " << stats.BufferSize << ", lowest queued "
+        << stats.LowestQueued << ", " << stats.Refills << " refills, " << stats.PointsPerSecond << " points/s, "
+        << stats.Underruns << " feeder and " << controller.Underruns() << " controller underruns, ends "
+        << endError << " mm off" << std::endl;
+    if (!streamed) {
+        std::cout << "  " << gantry.LastError() << std::endl;
+    }
+
+    bool passed = true;
+    passed &= Check(streamed, "the path streams to its end");
+    passed &= Check(stats.TotalPoints == path.PointCount(period) && stats.Points == stats.TotalPoints,
+        "every point is delivered");
+    passed &= Check(stats.Underruns == 0 && controller.Underruns() == 0, "the point buffer never runs empty");
+    passed &= Check(endError < 1e-6, "the gantry ends on the end of the path");
+    return passed;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    double scale = 2.0;
+    double period = 0.01;
+    MotionLimits limits;
+    limits.Linear.Velocity = 50.0;
+    limits.Linear.Acceleration = 500.0;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--scale" && i + 1 < argc) {
+            scale = std::atof(argv[++i]);
+        }
+        else if (arg == "--period" && i + 1 < argc) {
+            period = std::atof(argv[++i]);
+        }
+        else if (arg == "--velocity" && i + 1 < argc) {
+            limits.Linear.Velocity = std::atof(argv[++i]);
+        }
+        else if (arg == "--acceleration" && i + 1 < argc) {
+            limits.Linear.Acceleration = std::atof(argv[++i]);
+        }
+        else {
+            std::cerr << "Usage: stream_check [--scale S] [--period SECONDS] [--velocity V] [--acceleration A]" << std::endl;
+            return 1;
+        }
+    }
+    if (scale <= 0.0 || period <= 0.0 || limits.Linear.Velocity <= 0.0 || limits.Linear.Acceleration <= 0.0) {
+        std::cerr << "Scale, period and limits must be positive" << std::endl;
+        return 1;
+    }
+
+    PositionStruct origin;
+    origin.x = 10.0;
+    origin.y = 20.0;
+    origin.z = 5.0;
+    const double pi = std::acos(-1.0);
+    // A figure eight, timed by the limits
+    const TrajectoryPath::Curve figureEight = [origin, pi](double u) {
+        PositionStruct position = origin;
+        position.x += 8.0 * std::sin(2.0 * pi * u);
+        position.y += 4.0 * std::sin(4.0 * pi * u);
+        return position;
+    };
+    const std::vector<NamedPath> paths = {
+        { "raster 20 x 10 mm, lines 1 mm apart", TrajectoryPath::Raster(origin, 20.0, 10.0, 1.0, limits.Linear) },
+        { "spiral to 5 mm, turns 0.5 mm apart", TrajectoryPath::Spiral(origin, 5.0, 0.5, limits.Linear) },
+        { "figure eight 16 x 8 mm", TrajectoryPath::FromCurve(figureEight, limits.Linear) },
+    };
+
+    bool passed = true;
+    for (const NamedPath& path : paths) {
+        passed &= Stream(path, scale, period, limits);
+    }
+    return passed ? 0 : 2;
+}